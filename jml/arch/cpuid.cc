@@ -29,7 +29,8 @@ enum {
     CPUID_EXT_CACHE_INFO = 4,
     CPUID_MONITOR_MWAIT = 5,
     CPUID_THERMAL_POWER = 6,
-    CPUID_DCA_ACCESS = 7,
+    CPUID_STRUCTURED_FEATURES = 7,
+    CPUID_DCA_ACCESS = 9,
     CPUID_EXT_LEVEL =      0x80000000,
     CPUID_EXT_FEATURES =   0x80000001,
     CPUID_EXT_BRAND1 =     0x80000002,
@@ -139,6 +140,7 @@ std::string model_id()
 CPU_Info::CPU_Info()
 {
     cpuid_level = cpuid_extlevel = standard1 = standard2 = extended = amd = 0;
+    structured = 0;
 
     cpuid_level = cpuid(CPUID_LEVEL).eax;
     cpuid_extlevel = cpuid(CPUID_EXT_LEVEL).eax;
@@ -156,6 +158,9 @@ CPU_Info::CPU_Info()
     standard1 = r.edx;
     standard2 = r.ecx;
 
+    if (cpuid_level >= CPUID_STRUCTURED_FEATURES)
+        structured = cpuid(CPUID_STRUCTURED_FEATURES, 0).ebx;
+
     if (cpuid_extlevel >= CPUID_EXT_FEATURES) {
         r = cpuid(CPUID_EXT_FEATURES);
         extended = r.edx;
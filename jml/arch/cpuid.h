@@ -84,11 +84,33 @@ struct CPU_Info {
             uint32_t xtpr:1;      // 14
             uint32_t res6:3;      // 15, 16, 17
             uint32_t dca:1;       // 18
-            uint32_t res7:14;
+            uint32_t sse41:1;     // 19
+            uint32_t sse42:1;     // 20
+            uint32_t res7:2;      // 21, 22
+            uint32_t popcnt:1;    // 23
+            uint32_t res8:3;      // 24, 25, 26
+            uint32_t osxsave:1;   // 27
+            uint32_t avx:1;       // 28
+            uint32_t res9:3;
         };
         uint32_t standard2;
     };
 
+    // Structured extended flags (leaf 7, ebx)
+    union {
+        struct {
+            uint32_t fsgsbase:1;  // 0
+            uint32_t res1_ext7:2;
+            uint32_t bmi1:1;      // 3
+            uint32_t res2_ext7:1;
+            uint32_t avx2:1;      // 5
+            uint32_t res3_ext7:2;
+            uint32_t bmi2:1;      // 8
+            uint32_t res4_ext7:23;
+        };
+        uint32_t structured;
+    };
+
     // Entended1 flags for AMD
     union {
         struct {
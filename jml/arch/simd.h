@@ -39,6 +39,23 @@ JML_ALWAYS_INLINE bool has_sse3() { return cpu_info().sse3; }
 
 JML_ALWAYS_INLINE bool has_pni() { return cpu_info().pni; }
 
+JML_ALWAYS_INLINE bool has_popcnt() { return cpu_info().popcnt; }
+
+/** AVX registers are only usable if the OS saves the ymm state on context
+    switches which needs to be checked through xgetbv.
+*/
+JML_ALWAYS_INLINE bool has_avx()
+{
+    const CPU_Info & info = cpu_info();
+    if (!info.osxsave || !info.avx) return false;
+
+    uint32_t eax, edx;
+    asm volatile ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+    return (eax & 0x6) == 0x6;
+}
+
+JML_ALWAYS_INLINE bool has_avx2() { return has_avx() && cpu_info().avx2; }
+
 
 #endif // __i686__
 
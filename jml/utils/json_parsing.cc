@@ -92,6 +92,28 @@ void jsonEscape(const std::string & str, std::ostream & stream)
     stream.write(buf, p - buf);
 }
 
+namespace {
+
+/** Characters that end the part of a JSON string that can be taken as is
+    from the parse buffer. */
+struct JsonStringSpecial {
+    bool operator () (char c) const
+    {
+        return c == '"' || c == '\\' || c == '\n';
+    }
+};
+
+/** Same, but also stops at characters that aren't valid in an ASCII
+    string so that they are reported by the slow path. */
+struct JsonStringAsciiSpecial {
+    bool operator () (char c) const
+    {
+        return c == '"' || c == '\\' || c == '\n' || c < 0 || c >= 127;
+    }
+};
+
+} // file scope
+
 bool matchJsonString(Parse_Context & context, std::string & str)
 {
     Parse_Context::Revert_Token token(context);
@@ -199,6 +221,13 @@ std::string expectJsonString(Parse_Context & context)
     skipJsonWhitespace(context);
     context.expect_literal('"');
 
+    // Strings without escapes are taken straight from the parse buffer
+    const char * start, * end;
+    if (context.match_span(start, end, JsonStringSpecial(), '"')) {
+        ++context;
+        return string(start, end);
+    }
+
     char internalBuffer[4096];
 
     char * buffer = internalBuffer;
@@ -302,6 +331,16 @@ ssize_t expectJsonStringAscii(Parse_Context & context, char * buffer, size_t max
     size_t bufferSize = maxLength - 1;
     size_t pos = 0;
 
+    const char * start, * end;
+    if (context.match_span(start, end, JsonStringAsciiSpecial(), '"')) {
+        if (end - start > (ssize_t)bufferSize)
+            return -1;
+        ++context;
+        std::copy(start, end, buffer);
+        buffer[end - start] = 0;
+        return end - start;
+    }
+
     // Try multiple times to make it fit
     while (!context.match_literal('"')) {
         int c = *context++;
@@ -346,6 +385,13 @@ std::string expectJsonStringAscii(Parse_Context & context)
     skipJsonWhitespace(context);
     context.expect_literal('"');
 
+    // Strings without escapes are taken straight from the parse buffer
+    const char * start, * end;
+    if (context.match_span(start, end, JsonStringAsciiSpecial(), '"')) {
+        ++context;
+        return string(start, end);
+    }
+
     char internalBuffer[4096];
 
     char * buffer = internalBuffer;
@@ -409,6 +455,82 @@ std::string expectJsonStringAscii(Parse_Context & context)
     return result;
 }
 
+namespace {
+
+void skipJsonString(Parse_Context & context)
+{
+    context.expect_literal('"');
+
+    const char * start, * end;
+    if (context.match_span(start, end, JsonStringSpecial(), '"')) {
+        ++context;
+        return;
+    }
+
+    while (!context.match_literal('"')) {
+        int c = *context++;
+        if (c != '\\')
+            continue;
+
+        c = *context++;
+        switch (c) {
+        case 't': case 'n': case 'r': case 'f': case 'b':
+        case '/': case '\\': case '"':
+            break;
+        case 'u':
+            context.expect_hex4();
+            break;
+        default:
+            context.exception("invalid escaped char");
+        }
+    }
+}
+
+} // file scope
+
+void skipJson(Parse_Context & context)
+{
+    skipJsonWhitespace(context);
+
+    if (*context == '"')
+        skipJsonString(context);
+    else if (context.match_literal("null")
+             || context.match_literal("true")
+             || context.match_literal("false"))
+        return;
+    else if (context.match_literal('[')) {
+        skipJsonWhitespace(context);
+        if (context.match_literal(']')) return;
+
+        for (;;) {
+            skipJson(context);
+            skipJsonWhitespace(context);
+            if (!context.match_literal(',')) break;
+        }
+
+        skipJsonWhitespace(context);
+        context.expect_literal(']');
+    }
+    else if (context.match_literal('{')) {
+        skipJsonWhitespace(context);
+        if (context.match_literal('}')) return;
+
+        for (;;) {
+            skipJsonWhitespace(context);
+            skipJsonString(context);
+            skipJsonWhitespace(context);
+            context.expect_literal(':');
+            skipJson(context);
+            skipJsonWhitespace(context);
+            if (!context.match_literal(',')) break;
+        }
+
+        skipJsonWhitespace(context);
+        context.expect_literal('}');
+    }
+    else expectJsonNumber(context);
+}
+
 bool
 matchJsonNull(Parse_Context & context)
 {
@@ -72,6 +72,11 @@ matchJsonObject(Parse_Context & context,
 
 void skipJsonWhitespace(Parse_Context & context);
 
+/** Skip over a JSON value of any type without constructing it, which
+    avoids the allocations that expectJson would make.
+*/
+void skipJson(Parse_Context & context);
+
 inline bool expectJsonBool(Parse_Context & context)
 {
     if (context.match_literal("true"))
@@ -267,6 +267,34 @@ struct Parse_Context {
 
     bool match_text(std::string & text, const char * delimiters);
 
+    /** Zero-copy version of match_text for text that lies entirely within
+        the current buffer.  If the first character for which found returns
+        true is before the end of the buffer and is the given delimiter,
+        start and end are set to the text before it, which is consumed, and
+        true is returned.  The position will be at the delimiter, and the
+        pointers stay valid for as long as the buffer does (for the lifetime
+        of the memory it was initialized from).  Otherwise nothing is
+        consumed and false is returned, in which case the caller needs to
+        fall back to matching character by character.
+
+        The text can't contain a newline; make found match '\n' if it may
+        occur.
+    */
+    template<class FoundEnd>
+    bool match_span(const char * & start, const char * & end,
+                    const FoundEnd & found, char delimiter)
+    {
+        const char * p = cur_;
+        while (p < ebuf_ && !found(*p)) ++p;
+        if (p == ebuf_ || *p != delimiter) return false;
+
+        start = cur_;
+        end = p;
+        ofs_ += p - cur_;  col_ += p - cur_;
+        cur_ = p;
+        return true;
+    }
+
     std::string expect_text(char delimiter,
                             bool allow_empty = true,
                             const char * error = "expected text");
@@ -12,6 +12,7 @@
 #include <vector>
 #include "jml/arch/futex.h"
 #include "jml/arch/spinlock.h"
+#include <atomic>
 #include <mutex>
 #include <thread>
 
@@ -350,6 +351,95 @@ struct RingBufferSRMW : public RingBufferBase<Request> {
     }
 };
 
+
+/*****************************************************************************/
+/* RING BUFFER SINGLE WRITER SINGLE READER                                   */
+/*****************************************************************************/
+
+/** Lock-free ring buffer with exactly one writer thread and one reader
+    thread.  Nothing blocks: it's up to the caller to decide what to do
+    when the ring is full or empty.
+
+    tryPush() reports whether the ring was empty before the push, which is
+    what allows a writer to only wake up the reader on the empty to
+    non-empty transition.  Both positions are accessed sequentially
+    consistently so that a reader that checks couldPop() after popping the
+    last entry and a writer that checks whether the ring was empty after
+    pushing can't both miss each other.
+*/
+template<typename Request>
+struct RingBufferSWSR {
+
+    /** The size is rounded up to a power of two. */
+    RingBufferSWSR(size_t size)
+        : readPosition(0), writePosition(0)
+    {
+        size_t capacity = 1;
+        while (capacity < size) capacity *= 2;
+        ring.resize(capacity);
+        mask = capacity - 1;
+    }
+
+    RingBufferSWSR(const RingBufferSWSR & other) = delete;
+    RingBufferSWSR & operator = (const RingBufferSWSR & other) = delete;
+
+    template<typename R>
+    bool tryPush(R && request, bool & wasEmpty)
+    {
+        uint64_t write = writePosition.load(std::memory_order_relaxed);
+        if (write - readPosition.load(std::memory_order_acquire) > mask)
+            return false;
+
+        ring[write & mask] = std::forward<R>(request);
+        writePosition.store(write + 1);
+        wasEmpty = readPosition.load() == write;
+        return true;
+    }
+
+    template<typename R>
+    bool tryPush(R && request)
+    {
+        bool wasEmpty;
+        return tryPush(std::forward<R>(request), wasEmpty);
+    }
+
+    bool tryPop(Request & result)
+    {
+        uint64_t read = readPosition.load(std::memory_order_relaxed);
+        if (read == writePosition.load(std::memory_order_acquire))
+            return false;
+
+        result = std::move(ring[read & mask]);
+        ring[read & mask] = Request();
+        readPosition.store(read + 1);
+        return true;
+    }
+
+    bool couldPop() const
+    {
+        return readPosition.load() != writePosition.load();
+    }
+
+    size_t size() const
+    {
+        return writePosition.load() - readPosition.load();
+    }
+
+    size_t capacity() const
+    {
+        return ring.size();
+    }
+
+private:
+    std::vector<Request> ring;
+    uint64_t mask;
+
+    // Each position is only ever written by one side; keep them on their
+    // own cache lines.
+    alignas(64) std::atomic<uint64_t> readPosition;
+    alignas(64) std::atomic<uint64_t> writePosition;
+};
+
 } // namespace ML
 
 #endif /* __jml_utils__ring_buffer_h__ */
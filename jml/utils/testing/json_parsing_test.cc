@@ -14,6 +14,8 @@
 #include <boost/test/unit_test.hpp>
 #include <boost/test/auto_unit_test.hpp>
 #include <math.h>
+#include <sstream>
+#include <vector>
 
 using namespace ML;
 
@@ -86,3 +88,79 @@ BOOST_AUTO_TEST_CASE( test1 )
     BOOST_CHECK_THROW(testHex4("002G", 2), std::exception);
     BOOST_CHECK_THROW(testHex4("002.", 2), std::exception);
 }
+
+/* Strings are taken from the parse buffer when they are entirely within it
+   and contain no escapes; check that the result doesn't depend on where the
+   buffer boundaries fall. */
+BOOST_AUTO_TEST_CASE( test_strings_across_buffers )
+{
+    std::string json
+        = "[\"hello\", \"esc\\\"aped\\n\", \"\", \"caf\\u00e9\", "
+        "\"a longer string that spans several buffers\"]";
+
+    std::vector<std::string> expected = {
+        "hello", "esc\"aped\n", "", "caf\xc3\xa9",
+        "a longer string that spans several buffers"
+    };
+
+    auto parse = [&] (Parse_Context & context)
+        {
+            std::vector<std::string> result;
+            expectJsonArray(context, [&] (int, Parse_Context & context)
+                            {
+                                result.push_back(expectJsonString(context));
+                            });
+            context.expect_eof();
+            return result;
+        };
+
+    Parse_Context context(json, json.c_str(), json.c_str() + json.size());
+    BOOST_CHECK(parse(context) == expected);
+
+    for (size_t chunkSize: { 1, 2, 3, 7, 16 }) {
+        std::istringstream stream(json);
+        Parse_Context context(json, stream, 1, 1, chunkSize);
+        BOOST_CHECK(parse(context) == expected);
+    }
+
+    std::string ascii = "\"ascii\" \"t\\tab\" \"caf\xc3\xa9\"";
+    Parse_Context asciiContext(ascii, ascii.c_str(),
+                               ascii.c_str() + ascii.size());
+    BOOST_CHECK_EQUAL(expectJsonStringAscii(asciiContext), "ascii");
+
+    char buffer[8];
+    BOOST_CHECK_EQUAL(expectJsonStringAscii(asciiContext, buffer, 8), 4);
+    BOOST_CHECK_EQUAL(std::string(buffer), "t\tab");
+
+    {
+        JML_TRACE_EXCEPTIONS(false);
+        BOOST_CHECK_THROW(expectJsonStringAscii(asciiContext), std::exception);
+    }
+
+    std::string tooLong = "\"ascii\"";
+    Parse_Context tooLongContext(tooLong, tooLong.c_str(),
+                                 tooLong.c_str() + tooLong.size());
+    BOOST_CHECK_EQUAL(expectJsonStringAscii(tooLongContext, buffer, 5), -1);
+}
+
+BOOST_AUTO_TEST_CASE( test_skip_json )
+{
+    std::string json
+        = "{ \"a\": [1, -2.5e3, true, false, null, \"x\\\"y\"],"
+        " \"b\\u0062\": {}, \"c\": [] } 42";
+
+    for (size_t chunkSize: { 1, 3, 65500 }) {
+        std::istringstream stream(json);
+        Parse_Context context(json, stream, 1, 1, chunkSize);
+        skipJson(context);
+        skipJsonWhitespace(context);
+        BOOST_CHECK_EQUAL(context.expect_int(), 42);
+        context.expect_eof();
+    }
+
+    JML_TRACE_EXCEPTIONS(false);
+    for (std::string bad: { "[1,", "{\"a\" 1}", "\"\\q\"", "nul" }) {
+        Parse_Context context(bad, bad.c_str(), bad.c_str() + bad.size());
+        BOOST_CHECK_THROW(skipJson(context), std::exception);
+    }
+}
@@ -22,6 +22,7 @@
 #include "ace/SOCK_Acceptor.h"
 #include <ace/High_Res_Timer.h>
 #include <ace/Dev_Poll_Reactor.h>
+#include <mutex>
 #include <set>
 
 using namespace std;
@@ -216,9 +217,33 @@ createDescription(AuctionResponseDescription & d) {
     d.addField("wcm", &Response::wcm, "");
 }
 
+void
+Auction::DataDeleter::
+operator () (Data * data) const
+{
+    if (arena) data->~Data();
+    else delete data;
+}
+
+template<typename... Args>
+Auction::DataPtr
+Auction::
+makeData(Args &&... args) const
+{
+    if (!arena)
+        return DataPtr(new Data(std::forward<Args>(args)...),
+                       DataDeleter{ nullptr });
+
+    void * mem = arena->allocate(sizeof(Data), alignof(Data));
+    return DataPtr(new (mem) Data(std::forward<Args>(args)...),
+                   DataDeleter{ arena.get() });
+}
+
 Auction::
 Auction()
-    : isZombie(false), exchangeConnector(nullptr), data(new Data())
+    : isZombie(false), exchangeConnector(nullptr), data(makeData().release()),
+      hasRequestStr(false), hasRequestSerialized(false),
+      requestStrGiven(false)
 {
 }
 
@@ -229,35 +254,134 @@ Auction(ExchangeConnector * exchangeConnector,
         const std::string & requestStr,
         const std::string & requestStrFormat,
         Date start,
-        Date expiry)
+        Date expiry,
+        std::shared_ptr<AuctionArena> arena)
     : isZombie(false), start(start), expiry(expiry),
       request(request),
-      requestStr(requestStr),
       requestStrFormat(requestStrFormat),
       exchangeConnector(exchangeConnector),
       handleAuction(handleAuction),
-      data(new Data(numSpots()))
+      arena(std::move(arena)),
+      data(makeData(numSpots()).release()),
+      hasRequestStr(true), hasRequestSerialized(false),
+      requestStrGiven(true),
+      requestStr_(requestStr)
+{
+    ML::atomic_add(created, 1);
+
+    this->id = request->auctionId;
+}
+
+Auction::
+Auction(ExchangeConnector * exchangeConnector,
+        HandleAuction handleAuction,
+        std::shared_ptr<BidRequest> request,
+        Date start,
+        Date expiry,
+        std::shared_ptr<AuctionArena> arena)
+    : isZombie(false), start(start), expiry(expiry),
+      request(request),
+      requestStrFormat("datacratic"),
+      exchangeConnector(exchangeConnector),
+      handleAuction(handleAuction),
+      arena(std::move(arena)),
+      data(makeData(numSpots()).release()),
+      hasRequestStr(false), hasRequestSerialized(false),
+      requestStrGiven(false)
 {
     ML::atomic_add(created, 1);
 
     this->id = request->auctionId;
-    this->requestSerialized = request->serializeToString();
 }
 
 Auction::
 ~Auction()
 {
     // Clean up the chain of data pointers
+    DataDeleter deleter{ arena.get() };
     Data * d = data;
     while (d) {
         Data * d2 = d->oldData;
-        delete d;
+        deleter(d);
         d = d2;
     }
 
     ML::atomic_add(destroyed, 1);
 }
 
+const std::string &
+Auction::
+requestStr() const
+{
+    if (hasRequestStr.load(std::memory_order_acquire))
+        return requestStr_;
+
+    std::lock_guard<ML::Spinlock> guard(lazyLock);
+    if (!hasRequestStr.load(std::memory_order_relaxed)) {
+        if (request) requestStr_ = request->toJsonStr();
+        hasRequestStr.store(true, std::memory_order_release);
+    }
+
+    return requestStr_;
+}
+
+void
+Auction::
+setRequestStr(const std::string & str)
+{
+    std::lock_guard<ML::Spinlock> guard(lazyLock);
+    requestStr_ = str;
+    requestStrGiven = true;
+    hasRequestStr.store(true, std::memory_order_release);
+}
+
+const std::string &
+Auction::
+requestSerialized() const
+{
+    if (hasRequestSerialized.load(std::memory_order_acquire))
+        return requestSerialized_;
+
+    std::lock_guard<ML::Spinlock> guard(lazyLock);
+    if (!hasRequestSerialized.load(std::memory_order_relaxed)) {
+        if (request) requestSerialized_ = request->serializeToString();
+        hasRequestSerialized.store(true, std::memory_order_release);
+    }
+
+    return requestSerialized_;
+}
+
+void
+Auction::
+completeRequest()
+{
+    if (!request || request->isComplete()) return;
+
+    request->complete(requestOriginal);
+
+    std::lock_guard<ML::Spinlock> guard(lazyLock);
+    if (!requestStrGiven) {
+        requestStr_.clear();
+        hasRequestStr.store(false, std::memory_order_release);
+    }
+    requestSerialized_.clear();
+    hasRequestSerialized.store(false, std::memory_order_release);
+    requestProjections_.clear();
+}
+
+const std::string &
+Auction::
+requestProjection(const std::vector<std::string> & fields) const
+{
+    std::lock_guard<ML::Spinlock> guard(lazyLock);
+
+    auto res = requestProjections_.insert(make_pair(fields, std::string()));
+    if (res.second && request)
+        res.first->second = request->toJsonStr(fields);
+
+    return res.first->second;
+}
+
 long long Auction::created = 0;
 long long Auction::destroyed = 0;
 
@@ -295,7 +419,7 @@ setResponse(int spotNum, Response newResponse)
 
     WinLoss result;
 
-    auto_ptr<Data> newData(new Data());
+    DataPtr newData = makeData();
 
     for (;;) {
         if (current->tooLate)
@@ -353,7 +477,7 @@ addDataSources(const std::set<std::string> & sources)
     if (sources.empty()) return;
 
     Data * current = this->data;
-    unique_ptr<Data> newData(new Data);
+    DataPtr newData = makeData();
 
     for (;;) {
 
@@ -363,9 +487,10 @@ addDataSources(const std::set<std::string> & sources)
         // Nothing new was added, just bail.
         if (newSources.size() == current->dataSources.size()) return;
 
-        if (!newData) newData.reset(new Data);
+        if (!newData) newData = makeData();
         *newData = *current;
         std::swap(newData->dataSources, newSources);
+        newData->oldData = current;
 
         if (!ML::cmp_xchg(this->data, current, newData.get())) continue;
         newData.release();
@@ -391,7 +516,7 @@ finish()
         if (current->tooLate)
             return false;
 
-        auto_ptr<Data> newData(new Data(*current));
+        DataPtr newData = makeData(*current);
 
         for (unsigned spotNum = 0;  spotNum < numSpots(); ++spotNum) {
             if (newData->hasValidResponse(spotNum))
@@ -421,7 +546,7 @@ setError(const std::string & error, const std::string & details)
         if (current->tooLate)
             return false;
 
-        auto_ptr<Data> newData(new Data(*current));
+        DataPtr newData = makeData(*current);
         
         newData->error = error;
         newData->details = details;
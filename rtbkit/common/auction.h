@@ -14,14 +14,18 @@
 #include "rtbkit/common/account_key.h"
 #include "rtbkit/common/augmentation.h"
 #include "rtbkit/common/win_cost_model.h"
+#include "rtbkit/common/auction_arena.h"
 #include <boost/function.hpp>
 #include <boost/enable_shared_from_this.hpp>
 #include "soa/jsoncpp/json.h"
 #include "soa/types/date.h"
 #include "jml/arch/atomic_ops.h"
 #include "jml/arch/exception.h"
+#include "jml/arch/spinlock.h"
 #include "jml/utils/compact_vector.h"
 #include "jml/db/persistent_fwd.h"
+#include <atomic>
+#include <map>
 
 namespace RTBKIT {
 
@@ -52,10 +56,36 @@ struct Auction : public std::enable_shared_from_this<Auction> {
             const std::string & requestStr,
             const std::string & requestStrFormat,
             Date start,
-            Date expiry);
+            Date expiry,
+            std::shared_ptr<AuctionArena> arena = nullptr);
+
+    /** Same as above but the stringified request is only produced from the
+        request, in the datacratic format, when it's first needed.
+    */
+    Auction(ExchangeConnector * exchangeConnector,
+            HandleAuction handleAuction,
+            std::shared_ptr<BidRequest> request,
+            Date start,
+            Date expiry,
+            std::shared_ptr<AuctionArena> arena = nullptr);
     
     ~Auction();
 
+    /** Create an auction which, along with all the versions of its Data,
+        lives in a new arena.  The arena is released in one go when the
+        last reference to the auction goes away.  Takes the arguments of
+        the constructors above, without the arena.
+    */
+    template<typename... Args>
+    static std::shared_ptr<Auction> createInArena(Args &&... args)
+    {
+        auto arena = std::make_shared<AuctionArena>();
+        ArenaAllocator<Auction> allocator(arena);
+        return std::allocate_shared<Auction>(allocator,
+                                             std::forward<Args>(args)...,
+                                             std::move(arena));
+    }
+
     bool isZombie;  ///< Auction was externally cancelled
 
     Date start;
@@ -70,11 +100,40 @@ struct Auction : public std::enable_shared_from_this<Auction> {
 
     Id id;
     std::shared_ptr<BidRequest>  request;
-    std::string requestStr;  ///< Stringified version of request
     std::string requestStrFormat;  ///< Format of stringified request
-    std::string requestSerialized; ///< Serialized bid request (canonical)
     std::string requestOriginal;
 
+    /** Stringified version of the request in requestStrFormat. Unless it
+        was given on construction it's produced from the request the first
+        time it's called, which saves serializing the requests that never
+        reach an agent. Can be called from multiple threads.
+    */
+    const std::string & requestStr() const;
+
+    /** Replaces the stringified request. Must not be called once the
+        auction is visible to other threads.
+    */
+    void setRequestStr(const std::string & str);
+
+    /** Serialized bid request (canonical), produced on the first call. */
+    const std::string & requestSerialized() const;
+
+    /** Completes a lazily parsed request from requestOriginal (see
+        BidRequest::complete()) and drops whatever was already produced from
+        the partial request so that requestStr(), requestSerialized() and
+        the projections include every field.  A requestStr given on
+        construction or through setRequestStr() is kept as is.  Same thread
+        safety as BidRequest::complete().
+    */
+    void completeRequest();
+
+    /** Canonical JSON of the request restricted to the given top level
+        fields, produced on the first call for each set of fields and shared
+        by all the agents that ask for it. Can be called from multiple threads.
+    */
+    const std::string &
+    requestProjection(const std::vector<std::string> & fields) const;
+
     ///< AugmentationList for each augmentors.
     std::unordered_map<std::string, AugmentationList> augmentations;
     AgentAugmentations agentAugmentations; ///< per agent augmentations.
@@ -250,6 +309,7 @@ struct Auction : public std::enable_shared_from_this<Auction> {
 
     ExchangeConnector * exchangeConnector; ///< Exchange connector for auction
     HandleAuction handleAuction;   ///< Callback for when auction is finished
+    std::shared_ptr<AuctionArena> arena; ///< Arena for the Data, if any
 
     struct Data {
         Data()
@@ -299,6 +359,30 @@ struct Auction : public std::enable_shared_from_this<Auction> {
 private:
     Data * data;
 
+    /** Destroys Data versions allocated by makeData. */
+    struct DataDeleter {
+        AuctionArena * arena;
+        void operator () (Data * data) const;
+    };
+
+    typedef std::unique_ptr<Data, DataDeleter> DataPtr;
+
+    /** Allocate a new version of the Data, from the arena if there is
+        one.
+    */
+    template<typename... Args>
+    DataPtr makeData(Args &&... args) const;
+
+    // Lazily produced versions of the request; guarded by lazyLock until
+    // the matching flag is set.
+    mutable ML::Spinlock lazyLock;
+    mutable std::atomic<bool> hasRequestStr;
+    mutable std::atomic<bool> hasRequestSerialized;
+    bool requestStrGiven;   ///< requestStr_ wasn't produced from request
+    mutable std::string requestStr_;
+    mutable std::string requestSerialized_;
+    mutable std::map<std::vector<std::string>, std::string> requestProjections_;
+
 public:
     /// Memory leak tracking
     static long long created;
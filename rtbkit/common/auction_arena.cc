@@ -0,0 +1,225 @@
+/* auction_arena.cc
+   Copyright (c) 2013 Datacratic.  All rights reserved.
+
+   Monotonic memory arena for auctions.
+*/
+
+#include "rtbkit/common/auction_arena.h"
+#include "jml/utils/exc_assert.h"
+#include <mutex>
+#include <stdlib.h>
+
+
+using namespace std;
+using namespace ML;
+
+namespace RTBKIT {
+
+/*****************************************************************************/
+/* BLOCK POOL                                                                */
+/*****************************************************************************/
+
+/** Header of the blocks and big chunks; padded so that the memory that
+    follows it is aligned.
+*/
+struct AuctionArena::Chunk {
+    Chunk * next;
+    char padding[MAX_ALIGNMENT - sizeof(Chunk *)];
+};
+
+namespace {
+
+struct BlockPool {
+    BlockPool()
+        : freeList(0), numFree(0), maxFree(4096)
+    {
+    }
+
+    void * get()
+    {
+        {
+            std::lock_guard<ML::Spinlock> guard(lock);
+            if (freeList) {
+                FreeBlock * result = freeList;
+                freeList = freeList->next;
+                --numFree;
+                return result;
+            }
+        }
+
+        void * result;
+        if (posix_memalign(&result, AuctionArena::MAX_ALIGNMENT,
+                           AuctionArena::BLOCK_SIZE))
+            throw std::bad_alloc();
+        return result;
+    }
+
+    void put(void * block)
+    {
+        {
+            std::lock_guard<ML::Spinlock> guard(lock);
+            if (numFree < maxFree) {
+                FreeBlock * b = reinterpret_cast<FreeBlock *>(block);
+                b->next = freeList;
+                freeList = b;
+                ++numFree;
+                return;
+            }
+        }
+
+        free(block);
+    }
+
+    void clear()
+    {
+        FreeBlock * blocks;
+        {
+            std::lock_guard<ML::Spinlock> guard(lock);
+            blocks = freeList;
+            freeList = 0;
+            numFree = 0;
+        }
+
+        while (blocks) {
+            FreeBlock * next = blocks->next;
+            free(blocks);
+            blocks = next;
+        }
+    }
+
+    struct FreeBlock {
+        FreeBlock * next;
+    };
+
+    ML::Spinlock lock;
+    FreeBlock * freeList;
+    size_t numFree;
+    size_t maxFree;
+};
+
+// Never destroyed as arenas can outlive static destruction
+BlockPool & blockPool()
+{
+    static BlockPool * pool = new BlockPool();
+    return *pool;
+}
+
+} // file scope
+
+
+/*****************************************************************************/
+/* AUCTION ARENA                                                             */
+/*****************************************************************************/
+
+AuctionArena::
+AuctionArena()
+    : blocks(0), bigChunks(0), current(0), end(0),
+      bytesAllocated_(0), blocksUsed_(0)
+{
+}
+
+AuctionArena::
+~AuctionArena()
+{
+    BlockPool & pool = blockPool();
+
+    while (blocks) {
+        Chunk * next = blocks->next;
+        pool.put(blocks);
+        blocks = next;
+    }
+
+    while (bigChunks) {
+        Chunk * next = bigChunks->next;
+        free(bigChunks);
+        bigChunks = next;
+    }
+}
+
+void *
+AuctionArena::
+allocate(size_t bytes, size_t alignment)
+{
+    ExcAssert(alignment && alignment <= MAX_ALIGNMENT
+              && (alignment & (alignment - 1)) == 0);
+
+    if (bytes > BLOCK_SIZE / 4)
+        return allocateBig(bytes);
+
+    std::lock_guard<ML::Spinlock> guard(lock);
+
+    size_t misalignment = reinterpret_cast<size_t>(current) & (alignment - 1);
+    char * result = current + (misalignment ? alignment - misalignment : 0);
+
+    if (!current || result + bytes > end) {
+        newBlock();
+        result = current;
+    }
+
+    current = result + bytes;
+    bytesAllocated_ += bytes;
+    return result;
+}
+
+void *
+AuctionArena::
+allocateBig(size_t bytes)
+{
+    void * mem;
+    if (posix_memalign(&mem, MAX_ALIGNMENT, sizeof(Chunk) + bytes))
+        throw std::bad_alloc();
+
+    Chunk * chunk = reinterpret_cast<Chunk *>(mem);
+
+    std::lock_guard<ML::Spinlock> guard(lock);
+    chunk->next = bigChunks;
+    bigChunks = chunk;
+    bytesAllocated_ += bytes;
+
+    return chunk + 1;
+}
+
+void
+AuctionArena::
+newBlock()
+{
+    Chunk * block = reinterpret_cast<Chunk *>(blockPool().get());
+    block->next = blocks;
+    blocks = block;
+    ++blocksUsed_;
+
+    current = reinterpret_cast<char *>(block + 1);
+    end = reinterpret_cast<char *>(block) + BLOCK_SIZE;
+}
+
+void
+AuctionArena::
+setMaxPooledBlocks(size_t maxBlocks)
+{
+    BlockPool & pool = blockPool();
+    {
+        std::lock_guard<ML::Spinlock> guard(pool.lock);
+        pool.maxFree = maxBlocks;
+    }
+
+    if (pooledBlocks() > maxBlocks)
+        pool.clear();
+}
+
+size_t
+AuctionArena::
+pooledBlocks()
+{
+    BlockPool & pool = blockPool();
+    std::lock_guard<ML::Spinlock> guard(pool.lock);
+    return pool.numFree;
+}
+
+void
+AuctionArena::
+clearPool()
+{
+    blockPool().clear();
+}
+
+} // namespace RTBKIT
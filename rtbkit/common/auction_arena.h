@@ -0,0 +1,169 @@
+/* auction_arena.h                                                 -*- C++ -*-
+   Copyright (c) 2013 Datacratic.  All rights reserved.
+
+   Monotonic memory arena holding the objects that live and die with a
+   single auction.
+*/
+
+#pragma once
+
+#include "jml/arch/spinlock.h"
+#include <memory>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+
+namespace RTBKIT {
+
+/*****************************************************************************/
+/* AUCTION ARENA                                                             */
+/*****************************************************************************/
+
+/** Memory arena for the objects of a single auction.  Memory is handed out
+    by bumping a pointer in fixed size blocks and is never given back
+    individually: everything is released in one shot when the arena is
+    destroyed, which is when the last object allocated through an
+    ArenaAllocator goes away.  This replaces many small allocations that
+    are made on the exchange thread and freed from the router threads by
+    a few block allocations.
+
+    Released blocks are kept in a process wide pool, up to a limit, so that
+    a steady stream of auctions doesn't go back to the heap at all.
+
+    Allocation is thread safe as the router threads add responses to an
+    auction concurrently.
+*/
+
+struct AuctionArena {
+
+    enum {
+        BLOCK_SIZE = 4096,   ///< Size of the pooled blocks
+        MAX_ALIGNMENT = 16   ///< Alignment of the blocks
+    };
+
+    AuctionArena();
+
+    ~AuctionArena();
+
+    AuctionArena(const AuctionArena &) = delete;
+    AuctionArena & operator = (const AuctionArena &) = delete;
+
+    /** Allocate the given number of bytes with the given alignment, which
+        must be a power of two no larger than MAX_ALIGNMENT.
+        Requests for more than a quarter of a block get their own chunk of
+        memory, which is also released with the arena.
+    */
+    void * allocate(size_t bytes, size_t alignment = MAX_ALIGNMENT);
+
+    /** Memory is only released with the arena, so this does nothing. */
+    void deallocate(void * mem, size_t bytes)
+    {
+    }
+
+    /** Number of bytes handed out by the arena. */
+    size_t bytesAllocated() const { return bytesAllocated_; }
+
+    /** Number of blocks, pooled or not, used by the arena. */
+    size_t blocksUsed() const { return blocksUsed_; }
+
+    /** Maximum number of free blocks kept in the pool; the blocks released
+        past that are freed.  Defaults to 4096 (16MB).
+    */
+    static void setMaxPooledBlocks(size_t maxBlocks);
+
+    /** Number of free blocks currently in the pool. */
+    static size_t pooledBlocks();
+
+    /** Free all the blocks in the pool. */
+    static void clearPool();
+
+private:
+    struct Chunk;
+
+    ML::Spinlock lock;
+    Chunk * blocks;        ///< Pooled blocks in use by the arena
+    Chunk * bigChunks;     ///< Chunks for the larger allocations
+    char * current;        ///< Free space in the current block
+    char * end;
+    size_t bytesAllocated_;
+    size_t blocksUsed_;
+
+    void * allocateBig(size_t bytes);
+    void newBlock();
+};
+
+
+/*****************************************************************************/
+/* ARENA ALLOCATOR                                                           */
+/*****************************************************************************/
+
+/** Standard allocator drawing from an AuctionArena.  Each copy keeps the
+    arena alive, which means that an object created with std::allocate_shared
+    and this allocator owns its arena.
+*/
+
+template<typename T>
+struct ArenaAllocator {
+    typedef T value_type;
+    typedef T * pointer;
+    typedef const T * const_pointer;
+    typedef T & reference;
+    typedef const T & const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    ArenaAllocator(std::shared_ptr<AuctionArena> arena)
+        : arena(std::move(arena))
+    {
+    }
+
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U> & other)
+        : arena(other.arena)
+    {
+    }
+
+    T * allocate(size_t n)
+    {
+        return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T * p, size_t n)
+    {
+        arena->deallocate(p, n * sizeof(T));
+    }
+
+    template<typename U, typename... Args>
+    void construct(U * p, Args &&... args)
+    {
+        new (p) U(std::forward<Args>(args)...);
+    }
+
+    template<typename U>
+    void destroy(U * p)
+    {
+        p->~U();
+    }
+
+    template<typename U>
+    struct rebind {
+        typedef ArenaAllocator<U> other;
+    };
+
+    std::shared_ptr<AuctionArena> arena;
+};
+
+template<typename T, typename U>
+bool operator == (const ArenaAllocator<T> & a1, const ArenaAllocator<U> & a2)
+{
+    return a1.arena == a2.arena;
+}
+
+template<typename T, typename U>
+bool operator != (const ArenaAllocator<T> & a1, const ArenaAllocator<U> & a2)
+{
+    return a1.arena != a2.arena;
+}
+
+} // namespace RTBKIT
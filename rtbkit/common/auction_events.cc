@@ -11,6 +11,7 @@
 #include "jml/utils/pair_utils.h"
 
 #include "auction_events.h"
+#include "binary_bid_request.h"
 
 using namespace std;
 using namespace ML;
@@ -25,8 +26,11 @@ std::shared_ptr<BidRequest>
 SubmittedAuctionEvent::
 bidRequest() const
 {
-    if (!bidRequest_)
-        bidRequest_.reset(BidRequest::parse(bidRequestStrFormat, bidRequestStr));
+    if (!bidRequest_) {
+        if (!bidRequestBinary.empty())
+            bidRequest_.reset(BinaryBidRequest::decode(bidRequestBinary));
+        else bidRequest_.reset(BidRequest::parse(bidRequestStrFormat, bidRequestStr));
+    }
     return bidRequest_;
 }
 
@@ -37,13 +41,33 @@ bidRequest(std::shared_ptr<BidRequest> event)
     bidRequest_ = std::move(event);
 }
 
+SubmittedAuctionEvent
+SubmittedAuctionEvent::
+toJsonEvent() const
+{
+    SubmittedAuctionEvent result(*this);
+    if (!bidRequestBinary.empty()) {
+        result.bidRequestStr = Datacratic::UnicodeString(bidRequest()->toJsonStr());
+        result.bidRequestStrFormat = "datacratic";
+        result.bidRequestBinary.clear();
+    }
+    return result;
+}
+
 void
 SubmittedAuctionEvent::
 serialize(ML::DB::Store_Writer & store) const
 {
-    store << (unsigned char)0
+    // Readers that predate bidRequestBinary only understand version 0 so
+    // it's kept for the events that don't carry a binary request.
+    unsigned char version = bidRequestBinary.empty() ? 0 : 1;
+
+    store << version
           << auctionId << adSpotId << lossTimeout << augmentations
           << bidRequestStr << bidResponse << bidRequestStrFormat;
+
+    if (version > 0)
+        store << bidRequestBinary;
 }
 
 void
@@ -52,12 +76,14 @@ reconstitute(ML::DB::Store_Reader & store)
 {
     unsigned char version;
     store >> version;
-    if (version != 0)
+    if (version > 1)
         throw ML::Exception("unknown SubmittedAuctionEvent type");
 
     store >> auctionId >> adSpotId >> lossTimeout >> augmentations
           >> bidRequestStr >> bidResponse >> bidRequestStrFormat;
 
+    if (version > 0)
+        store >> bidRequestBinary;
 }
 
 SubmittedAuctionEventDescription::
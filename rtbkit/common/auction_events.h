@@ -45,6 +45,24 @@ struct SubmittedAuctionEvent {
     Auction::Response bidResponse; ///< Bid response that was sent
     std::string bidRequestStrFormat;  ///< Format of stringified request(i.e "datacratic")
 
+    /** Bid request encoded with BinaryBidRequest.  Takes precedence over
+        bidRequestStr, which the router then leaves empty, as it's much
+        cheaper to produce and to decode.  Only part of the binary
+        serialization of the event: see toJsonEvent() for the JSON one.
+
+        Events that carry it are serialized as version 1, which older
+        readers reject, so the router only fills it in once told that the
+        post auction services were upgraded (see
+        Router::setBinaryPostAuctionEvents()).
+    */
+    std::string bidRequestBinary;
+
+    /** Copy of the event for its JSON description, which carries the bid
+        request in bidRequestStr: the binary request is converted to
+        canonical JSON.
+    */
+    SubmittedAuctionEvent toJsonEvent() const;
+
     void serialize(ML::DB::Store_Writer & store) const;
     void reconstitute(ML::DB::Store_Reader & store);
 
@@ -5,12 +5,14 @@
 */
 
 #include "rtbkit/common/bid_request.h"
+#include "rtbkit/common/binary_bid_request.h"
 #include "jml/arch/exception.h"
 #include "jml/arch/format.h"
 
 #include <boost/thread/locks.hpp>
 #include <boost/algorithm/string.hpp>
 #include <unordered_map>
+#include <algorithm>
 
 #include "jml/db/persistent.h"
 #include "rtbkit/openrtb/openrtb_parsing.h"
@@ -905,6 +907,55 @@ sortAll()
     segments.sortAll();
 }
 
+void
+BidRequest::
+complete(const std::string & payload)
+{
+    if (isComplete())
+        return;
+
+    ExcAssert(parseRest);
+    std::unique_ptr<BidRequest> full(parseRest(payload));
+    uint32_t missing = BidRequestFields::ALL & ~parsedFields;
+
+    // The Optional fields are swapped as their move assignment copies
+    if (missing & BidRequestFields::SITE) {
+        site.swap(full->site);
+        app.swap(full->app);
+        url = std::move(full->url);
+    }
+    if (missing & BidRequestFields::DEVICE) {
+        device.swap(full->device);
+        language = std::move(full->language);
+        location = std::move(full->location);
+        ipAddress = std::move(full->ipAddress);
+        userAgent = std::move(full->userAgent);
+        userAgentIPHash = full->userAgentIPHash;
+    }
+    if (missing & BidRequestFields::USER)
+        user.swap(full->user);
+    if (missing & BidRequestFields::USER_IDS)
+        userIds = std::move(full->userIds);
+    if (missing & BidRequestFields::SEGMENTS)
+        segments = std::move(full->segments);
+    if (missing & BidRequestFields::RESTRICTIONS) {
+        restrictions = std::move(full->restrictions);
+        blockedCategories = std::move(full->blockedCategories);
+        badv = std::move(full->badv);
+    }
+    if (missing & BidRequestFields::CURRENCY)
+        bidCurrency = std::move(full->bidCurrency);
+    if (missing & BidRequestFields::REGS)
+        regs.swap(full->regs);
+    if (missing & BidRequestFields::EXT)
+        ext = std::move(full->ext);
+    if (missing & BidRequestFields::UNPARSEABLE)
+        unparseable = std::move(full->unparseable);
+
+    parsedFields = BidRequestFields::ALL;
+    parseRest = nullptr;
+}
+
 template<typename T>
 void toJsonValue(Json::Value & v, const T & val)
 {
@@ -982,6 +1033,40 @@ toJsonStr() const
     //return boost::trim_copy(toJson().toString());
 }
 
+std::string
+BidRequest::
+toJsonStr(const std::vector<std::string> & fields) const
+{
+    static const DefaultDescription<BidRequest> BidRequestDesc;
+
+    if (fields.empty())
+        return toJsonStr();
+
+    std::ostringstream stream;
+    StreamJsonPrintingContext context(stream);
+
+    context.startObject();
+
+    auto onField = [&] (const ValueDescription::FieldDescription & fd)
+        {
+            if (fd.fieldName != "id"
+                && std::find(fields.begin(), fields.end(), fd.fieldName)
+                   == fields.end())
+                return;
+
+            const void * mbr = reinterpret_cast<const char *>(this) + fd.offset;
+            if (fd.description->isDefault(mbr))
+                return;
+            context.startMember(fd.fieldName);
+            fd.description->printJson(mbr, context);
+        };
+    BidRequestDesc.forEachField(this, onField);
+
+    context.endObject();
+
+    return stream.str();
+}
+
 template<typename T>
 void fromJsonOptional(const Json::Value & val,
                       std::unique_ptr<T> & ptr,
@@ -1130,12 +1215,24 @@ struct CanonicalParser {
     }
 };
 
+/** Decodes the output of BidRequest::serializeToString(), which is what the
+    router sends to the agents that asked for binary bid requests.
+*/
+struct BinaryParser {
+
+    static BidRequest * parse(const std::string & str)
+    {
+        return new BidRequest(BidRequest::createFromString(str));
+    }
+};
+
 struct AtInit {
     AtInit()
     {
         PluginInterface<BidRequest>::registerPlugin("recoset", CanonicalParser::parse);
         PluginInterface<BidRequest>::registerPlugin("datacratic", CanonicalParser::parse);
         PluginInterface<BidRequest>::registerPlugin("rtbkit", CanonicalParser::parse);
+        PluginInterface<BidRequest>::registerPlugin("datacratic-binary", BinaryParser::parse);
     }
 } atInit;
 } // file scope
@@ -1222,16 +1319,19 @@ std::string
 BidRequest::
 serializeToString() const
 {
-    ostringstream stream;
-    DB::Store_Writer store(stream);
-    serialize(store);
-    return stream.str();
+    return BinaryBidRequest::encode(*this);
 }
 
 BidRequest
 BidRequest::
 createFromString(const std::string & str)
 {
+    if (BinaryBidRequest::isEncoded(str)) {
+        std::unique_ptr<BidRequest> result(BinaryBidRequest::decode(str));
+        return std::move(*result);
+    }
+
+    // Written by serialize() before the binary encoding existed
     DB::Store_Reader store(str.c_str(), str.size());
     BidRequest result;
     result.reconstitute(store);
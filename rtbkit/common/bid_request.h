@@ -19,6 +19,7 @@
 #include "soa/types/url.h"
 #include "rtbkit/common/segments.h"
 #include <set>
+#include <functional>
 #include "rtbkit/common/currency.h"
 #include "tags.h"
 #include "rtbkit/openrtb/openrtb.h"
@@ -262,6 +263,37 @@ IMPL_SERIALIZE_RECONSTITUTE(Location);
 
 using OpenRTB::AuctionType;
 
+/*****************************************************************************/
+/* BID REQUEST FIELDS                                                        */
+/*****************************************************************************/
+
+/** Groups of top level fields of a BidRequest, as bits of a mask.  Code that
+    reads the request before it is known to be worth bidding on (the filters)
+    declares the groups it needs so that a connector can parse only those up
+    front and leave the rest for BidRequest::complete().
+
+    The id, auction type, time available, timestamp, exchange, provider,
+    protocol version and impressions are always parsed.
+*/
+struct BidRequestFields {
+    enum {
+        NONE         = 0,
+        SITE         = 1 << 0,  ///< site, app and url
+        DEVICE       = 1 << 1,  ///< device, language, location, ipAddress,
+                                ///< userAgent and userAgentIPHash
+        USER         = 1 << 2,  ///< user
+        USER_IDS     = 1 << 3,  ///< userIds
+        SEGMENTS     = 1 << 4,  ///< segments
+        RESTRICTIONS = 1 << 5,  ///< restrictions, blockedCategories and badv
+        CURRENCY     = 1 << 6,  ///< bidCurrency
+        REGS         = 1 << 7,  ///< regs
+        EXT          = 1 << 8,  ///< ext
+        UNPARSEABLE  = 1 << 9,  ///< unparseable
+        ALL          = (1 << 10) - 1
+    };
+};
+
+
 /*****************************************************************************/
 /* BID REQUEST                                                               */
 /*****************************************************************************/
@@ -269,7 +301,7 @@ using OpenRTB::AuctionType;
 struct BidRequest {
     BidRequest()
         : auctionType(AuctionType::SECOND_PRICE), timeAvailableMs(0.0),
-          isTest(false) 
+          isTest(false), parsedFields(BidRequestFields::ALL)
     {
     }
 
@@ -361,12 +393,47 @@ struct BidRequest {
     /** Transposition of the "ext" field of the OpenRTB request */
     Json::Value ext;
 
+    /** Groups of fields (see BidRequestFields) that have been parsed.  Only
+        differs from BidRequestFields::ALL for a request that was parsed
+        lazily and hasn't been completed yet; the other fields are then
+        left to their default value.
+    */
+    uint32_t parsedFields;
+
+    /** Parses the whole request again from its payload for complete().
+        Only set on requests that were parsed lazily.  The payload isn't
+        kept here as the auction already holds on to it.
+    */
+    std::function<BidRequest * (const std::string & payload)> parseRest;
+
+    /** Whether all the fields of the request have been parsed. */
+    bool isComplete() const
+    {
+        return parsedFields == BidRequestFields::ALL;
+    }
+
+    /** Fill in the fields that were left out by a lazy parse by running
+        parseRest on the payload the request was parsed from.  Does nothing
+        if the request is already complete.
+
+        This isn't thread safe: it must be called before the fields that
+        weren't parsed are read by anyone, which the router does as soon as
+        an auction has made it through the filters.
+    */
+    void complete(const std::string & payload);
+
     /** Return a canonical JSON version of the bid request. */
     Json::Value toJson() const;
 
     /** Return a canonical stringified JSON version of the bid request. */
     std::string toJsonStr() const;
 
+    /** Return a canonical stringified JSON version of the bid request that
+        only contains the given top level fields and the id. All the fields
+        are printed if the list is empty.
+    */
+    std::string toJsonStr(const std::vector<std::string> & fields) const;
+
     /** Create a new BidRequest from a canonical JSON value. */
     static BidRequest createFromJson(const Json::Value & json);
 
@@ -425,7 +492,14 @@ struct BidRequest {
     void serialize(ML::DB::Store_Writer & store) const;
     void reconstitute(ML::DB::Store_Reader & store);
 
+    /** Encode the request with BinaryBidRequest, which unlike serialize()
+        keeps every member of the request.
+    */
     std::string serializeToString() const;
+
+    /** Decode a request produced by serializeToString() or, for older
+        data, by serialize().
+    */
     static BidRequest createFromString(const std::string & str);
 };
 
@@ -0,0 +1,712 @@
+/* binary_bid_request.cc
+   Copyright (c) 2013 Datacratic.  All rights reserved.
+
+   Compact binary encoding of bid requests.
+*/
+
+#include "rtbkit/common/binary_bid_request.h"
+#include "rtbkit/common/bid_request.h"
+#include "rtbkit/openrtb/openrtb_parsing.h"
+#include "soa/types/json_printing.h"
+#include "soa/types/json_parsing.h"
+#include "jml/db/compact_size_types.h"
+#include "jml/arch/exception.h"
+
+#include <unordered_map>
+#include <sstream>
+#include <string.h>
+
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+
+namespace RTBKIT {
+
+namespace {
+
+/** Tags of the members of the request.  Never reuse or renumber them. */
+enum RecordTag {
+    TAG_ID                  = 1,
+    TAG_AUCTION_TYPE        = 2,
+    TAG_TIME_AVAILABLE      = 3,
+    TAG_TIMESTAMP           = 4,
+    TAG_IS_TEST             = 5,
+    TAG_PROTOCOL_VERSION    = 6,
+    TAG_EXCHANGE            = 7,
+    TAG_PROVIDER            = 8,
+    TAG_USER_AGENT_IP_HASH  = 9,
+    TAG_SITE                = 10,
+    TAG_APP                 = 11,
+    TAG_DEVICE              = 12,
+    TAG_USER                = 13,
+    TAG_IMP                 = 14,
+    TAG_REGS                = 15,
+    TAG_LANGUAGE            = 16,
+    TAG_LOCATION            = 17,
+    TAG_URL                 = 18,
+    TAG_IP_ADDRESS          = 19,
+    TAG_USER_AGENT          = 20,
+    TAG_USER_IDS            = 21,
+    TAG_RESTRICTIONS        = 22,
+    TAG_SEGMENTS            = 23,
+    TAG_META                = 24,
+    TAG_UNPARSEABLE         = 25,
+    TAG_BID_CURRENCY        = 26,
+    TAG_BLOCKED_CATEGORIES  = 27,
+    TAG_BADV                = 28,
+    TAG_WIN_SURCHARGES      = 29,
+    TAG_EXT                 = 30,
+    TAG_PARSED_FIELDS       = 31
+};
+
+uint64_t zigzag(int64_t val)
+{
+    return (uint64_t(val) << 1) ^ uint64_t(val >> 63);
+}
+
+int64_t unzigzag(uint64_t val)
+{
+    return int64_t(val >> 1) ^ -int64_t(val & 1);
+}
+
+
+/*****************************************************************************/
+/* WRITER                                                                    */
+/*****************************************************************************/
+
+/** Accumulates the records of the request.  Each record is written to
+    `record` and appended to `records` with its tag and length once it is
+    complete; the string table goes in front of the records at the end as
+    the strings are only known then.
+*/
+
+struct Writer {
+
+    std::string records;
+    std::string record;
+
+    std::vector<const std::string *> strings;
+    std::unordered_map<std::string, unsigned> stringIndex;
+
+    std::ostringstream jsonStream;
+
+    static void varint(std::string & out, uint64_t val)
+    {
+        char buf[9];
+        char * p = buf;
+        ML::DB::encode_compact(p, buf + sizeof(buf), val);
+        out.append(buf, p);
+    }
+
+    void varint(uint64_t val)
+    {
+        varint(record, val);
+    }
+
+    void signedVarint(int64_t val)
+    {
+        varint(zigzag(val));
+    }
+
+    void byte(unsigned char val)
+    {
+        record.push_back(val);
+    }
+
+    template<typename T>
+    void raw(T val)
+    {
+        record.append(reinterpret_cast<const char *>(&val), sizeof(val));
+    }
+
+    void string(const char * data, size_t length)
+    {
+        varint(length);
+        record.append(data, length);
+    }
+
+    void string(const std::string & str)
+    {
+        string(str.c_str(), str.size());
+    }
+
+    void string(const Utf8String & str)
+    {
+        string(str.rawString());
+    }
+
+    void id(const Id & id)
+    {
+        string(id.toString());
+    }
+
+    /** Write a reference to the given string in the string table. */
+    void ref(const std::string & str)
+    {
+        auto res = stringIndex.insert(make_pair(str, strings.size()));
+        if (res.second)
+            strings.push_back(&res.first->first);
+        varint(res.first->second);
+    }
+
+    void segments(const SegmentList & segs)
+    {
+        varint(segs.ints.size());
+        int last = 0;
+        for (int i: segs.ints) {
+            signedVarint((int64_t)i - last);
+            last = i;
+        }
+
+        varint(segs.strings.size());
+        for (auto & s: segs.strings)
+            ref(s);
+
+        varint(segs.weights.size());
+        for (float w: segs.weights)
+            raw(w);
+    }
+
+    void segments(const SegmentsBySource & segs)
+    {
+        varint(segs.size());
+        for (auto & source: segs) {
+            ref(source.first);
+            if (source.second) segments(*source.second);
+            else segments(SegmentList());
+        }
+    }
+
+    /** Write the value as a raw slice of JSON. */
+    template<typename T>
+    void json(const T & val)
+    {
+        static const auto desc = getDefaultDescriptionShared((T *)0);
+
+        jsonStream.str(std::string());
+        StreamJsonPrintingContext context(jsonStream);
+        desc->printJsonTyped(&val, context);
+        string(jsonStream.str());
+    }
+
+    void json(const Json::Value & val)
+    {
+        string(val.toStringNoNewLine());
+    }
+
+    /** Finish the current record and give it the given tag. */
+    void endRecord(RecordTag tag)
+    {
+        varint(records, tag);
+        varint(records, record.size());
+        records += record;
+        record.clear();
+    }
+
+    void finish(std::string & result)
+    {
+        result.clear();
+        result.reserve(records.size() + strings.size() * 8 + 8);
+        result.push_back(BinaryBidRequest::MAGIC);
+        varint(result, BinaryBidRequest::VERSION);
+        varint(result, strings.size());
+        for (auto str: strings) {
+            varint(result, str->size());
+            result += *str;
+        }
+        result += records;
+    }
+};
+
+
+/*****************************************************************************/
+/* READER                                                                    */
+/*****************************************************************************/
+
+struct Reader {
+
+    Reader(const char * data, const char * end,
+           const std::vector<std::string> & strings)
+        : data(data), end(end), strings(strings)
+    {
+    }
+
+    const char * data;
+    const char * end;
+
+    const std::vector<std::string> & strings;  ///< String table
+
+    void need(size_t bytes)
+    {
+        if (end - data < (ptrdiff_t)bytes)
+            throw ML::Exception("truncated binary bid request");
+    }
+
+    uint64_t varint()
+    {
+        return ML::DB::decode_compact(data, end);
+    }
+
+    /** Number of elements of a list, each of which takes at least
+        minBytes.  Bounded by what's left so that a corrupt count can't
+        make us reserve an arbitrary amount of memory.
+    */
+    size_t count(size_t minBytes = 1)
+    {
+        uint64_t n = varint();
+        if (n > uint64_t(end - data) / minBytes)
+            throw ML::Exception("invalid element count in binary bid request");
+        return n;
+    }
+
+    int64_t signedVarint()
+    {
+        return unzigzag(varint());
+    }
+
+    unsigned char byte()
+    {
+        need(1);
+        return *data++;
+    }
+
+    template<typename T>
+    T raw()
+    {
+        T result;
+        need(sizeof(result));
+        memcpy(&result, data, sizeof(result));
+        data += sizeof(result);
+        return result;
+    }
+
+    std::pair<const char *, size_t> slice()
+    {
+        size_t length = varint();
+        need(length);
+        const char * start = data;
+        data += length;
+        return make_pair(start, length);
+    }
+
+    std::string string()
+    {
+        auto s = slice();
+        return std::string(s.first, s.second);
+    }
+
+    Utf8String utf8()
+    {
+        return Utf8String(string(), false /* check */);
+    }
+
+    Id id()
+    {
+        auto s = slice();
+        return Id(s.first, s.second);
+    }
+
+    const std::string & ref()
+    {
+        uint64_t index = varint();
+        if (index >= strings.size())
+            throw ML::Exception("invalid string reference in binary "
+                                "bid request");
+        return strings[index];
+    }
+
+    void segments(SegmentList & segs)
+    {
+        size_t n = count();
+        segs.ints.reserve(n);
+        int last = 0;
+        for (size_t i = 0;  i < n;  ++i) {
+            last += signedVarint();
+            segs.ints.push_back(last);
+        }
+
+        n = count();
+        segs.strings.reserve(n);
+        for (size_t i = 0;  i < n;  ++i)
+            segs.strings.push_back(ref());
+
+        n = count(sizeof(float));
+        segs.weights.reserve(n);
+        for (size_t i = 0;  i < n;  ++i)
+            segs.weights.push_back(raw<float>());
+    }
+
+    void segments(SegmentsBySource & segs)
+    {
+        size_t n = count();
+        for (size_t i = 0;  i < n;  ++i) {
+            const std::string & source = ref();
+            auto list = std::make_shared<SegmentList>();
+            segments(*list);
+            segs[source] = std::move(list);
+        }
+    }
+
+    template<typename T>
+    void json(T & val)
+    {
+        static const auto desc = getDefaultDescriptionShared((T *)0);
+
+        auto s = slice();
+        StreamingJsonParsingContext context("binary bid request",
+                                            s.first, s.second);
+        desc->parseJsonTyped(&val, context);
+    }
+
+    template<typename T>
+    void json(OpenRTB::Optional<T> & val)
+    {
+        val.reset(new T());
+        json(*val);
+    }
+
+    void json(Json::Value & val)
+    {
+        auto s = slice();
+        val = Json::parse(std::string(s.first, s.second));
+    }
+};
+
+void encodeRecords(const BidRequest & br, Writer & w)
+{
+    static const BidRequest defaults;
+
+    if (br.auctionId) {
+        w.id(br.auctionId);
+        w.endRecord(TAG_ID);
+    }
+    if (br.auctionType.val != defaults.auctionType.val) {
+        w.signedVarint(br.auctionType.val);
+        w.endRecord(TAG_AUCTION_TYPE);
+    }
+    if (br.timeAvailableMs != 0.0) {
+        w.raw(br.timeAvailableMs);
+        w.endRecord(TAG_TIME_AVAILABLE);
+    }
+    if (br.timestamp != Date()) {
+        w.raw(br.timestamp.secondsSinceEpoch());
+        w.endRecord(TAG_TIMESTAMP);
+    }
+    if (br.isTest) {
+        w.byte(1);
+        w.endRecord(TAG_IS_TEST);
+    }
+    if (!br.protocolVersion.empty()) {
+        w.ref(br.protocolVersion);
+        w.endRecord(TAG_PROTOCOL_VERSION);
+    }
+    if (!br.exchange.empty()) {
+        w.ref(br.exchange);
+        w.endRecord(TAG_EXCHANGE);
+    }
+    if (!br.provider.empty()) {
+        w.ref(br.provider);
+        w.endRecord(TAG_PROVIDER);
+    }
+    if (br.userAgentIPHash) {
+        w.id(br.userAgentIPHash);
+        w.endRecord(TAG_USER_AGENT_IP_HASH);
+    }
+    if (br.site) {
+        w.json(*br.site);
+        w.endRecord(TAG_SITE);
+    }
+    if (br.app) {
+        w.json(*br.app);
+        w.endRecord(TAG_APP);
+    }
+    if (br.device) {
+        w.json(*br.device);
+        w.endRecord(TAG_DEVICE);
+    }
+    if (br.user) {
+        w.json(*br.user);
+        w.endRecord(TAG_USER);
+    }
+    if (!br.imp.empty()) {
+        w.json(br.imp);
+        w.endRecord(TAG_IMP);
+    }
+    if (br.regs) {
+        w.json(*br.regs);
+        w.endRecord(TAG_REGS);
+    }
+    if (!br.language.empty()) {
+        w.string(br.language);
+        w.endRecord(TAG_LANGUAGE);
+    }
+
+    const Location & loc = br.location;
+    const Location & defLoc = defaults.location;
+    if (!loc.countryCode.empty() || !loc.regionCode.empty()
+        || !loc.cityName.empty() || !loc.postalCode.empty()
+        || loc.dma != defLoc.dma || loc.metro != defLoc.metro
+        || loc.timezoneOffsetMinutes != defLoc.timezoneOffsetMinutes) {
+        w.ref(loc.countryCode);
+        w.ref(loc.regionCode);
+        w.string(loc.cityName);
+        w.string(loc.postalCode);
+        w.signedVarint(loc.dma);
+        w.signedVarint(loc.metro);
+        w.signedVarint(loc.timezoneOffsetMinutes);
+        w.endRecord(TAG_LOCATION);
+    }
+
+    if (!br.url.empty()) {
+        w.string(br.url.toString());
+        w.endRecord(TAG_URL);
+    }
+    if (!br.ipAddress.empty()) {
+        w.string(br.ipAddress);
+        w.endRecord(TAG_IP_ADDRESS);
+    }
+    if (!br.userAgent.empty()) {
+        w.string(br.userAgent);
+        w.endRecord(TAG_USER_AGENT);
+    }
+    if (!br.userIds.empty()) {
+        w.varint(br.userIds.size());
+        for (auto & id: br.userIds) {
+            w.ref(id.first);
+            w.id(id.second);
+        }
+        w.endRecord(TAG_USER_IDS);
+    }
+    if (!br.restrictions.empty()) {
+        w.segments(br.restrictions);
+        w.endRecord(TAG_RESTRICTIONS);
+    }
+    if (!br.segments.empty()) {
+        w.segments(br.segments);
+        w.endRecord(TAG_SEGMENTS);
+    }
+    if (!br.meta.isNull()) {
+        w.json(br.meta);
+        w.endRecord(TAG_META);
+    }
+    if (!br.unparseable.isNull()) {
+        w.json(br.unparseable);
+        w.endRecord(TAG_UNPARSEABLE);
+    }
+    if (!br.bidCurrency.empty()) {
+        w.varint(br.bidCurrency.size());
+        for (auto code: br.bidCurrency)
+            w.varint((uint32_t)code);
+        w.endRecord(TAG_BID_CURRENCY);
+    }
+    if (!br.blockedCategories.empty()) {
+        w.json(br.blockedCategories);
+        w.endRecord(TAG_BLOCKED_CATEGORIES);
+    }
+    if (!br.badv.empty()) {
+        w.varint(br.badv.size());
+        for (auto & adv: br.badv)
+            w.string(adv);
+        w.endRecord(TAG_BADV);
+    }
+    if (!br.winSurcharges.empty()) {
+        w.json(br.winSurcharges);
+        w.endRecord(TAG_WIN_SURCHARGES);
+    }
+    if (!br.ext.isNull()) {
+        w.json(br.ext);
+        w.endRecord(TAG_EXT);
+    }
+    if (!br.isComplete()) {
+        w.varint(br.parsedFields);
+        w.endRecord(TAG_PARSED_FIELDS);
+    }
+}
+
+void decodeRecord(RecordTag tag, Reader & r, BidRequest & br)
+{
+    switch (tag) {
+    case TAG_ID:
+        br.auctionId = r.id();
+        break;
+    case TAG_AUCTION_TYPE:
+        br.auctionType.val = r.signedVarint();
+        break;
+    case TAG_TIME_AVAILABLE:
+        br.timeAvailableMs = r.raw<double>();
+        break;
+    case TAG_TIMESTAMP:
+        br.timestamp = Date::fromSecondsSinceEpoch(r.raw<double>());
+        break;
+    case TAG_IS_TEST:
+        br.isTest = r.byte();
+        break;
+    case TAG_PROTOCOL_VERSION:
+        br.protocolVersion = r.ref();
+        break;
+    case TAG_EXCHANGE:
+        br.exchange = r.ref();
+        break;
+    case TAG_PROVIDER:
+        br.provider = r.ref();
+        break;
+    case TAG_USER_AGENT_IP_HASH:
+        br.userAgentIPHash = r.id();
+        break;
+    case TAG_SITE:
+        r.json(br.site);
+        break;
+    case TAG_APP:
+        r.json(br.app);
+        break;
+    case TAG_DEVICE:
+        r.json(br.device);
+        break;
+    case TAG_USER:
+        r.json(br.user);
+        break;
+    case TAG_IMP:
+        r.json(br.imp);
+        break;
+    case TAG_REGS:
+        r.json(br.regs);
+        break;
+    case TAG_LANGUAGE:
+        br.language = r.utf8();
+        break;
+    case TAG_LOCATION: {
+        Location & loc = br.location;
+        loc.countryCode = r.ref();
+        loc.regionCode = r.ref();
+        loc.cityName = r.utf8();
+        loc.postalCode = r.utf8();
+        loc.dma = r.signedVarint();
+        loc.metro = r.signedVarint();
+        loc.timezoneOffsetMinutes = r.signedVarint();
+        break;
+    }
+    case TAG_URL:
+        br.url = Url(r.string());
+        break;
+    case TAG_IP_ADDRESS:
+        br.ipAddress = r.string();
+        break;
+    case TAG_USER_AGENT:
+        br.userAgent = r.utf8();
+        break;
+    case TAG_USER_IDS: {
+        size_t n = r.count();
+        for (size_t i = 0;  i < n;  ++i) {
+            const std::string & domain = r.ref();
+            br.userIds.add(r.id(), domain);
+        }
+        break;
+    }
+    case TAG_RESTRICTIONS:
+        r.segments(br.restrictions);
+        break;
+    case TAG_SEGMENTS:
+        r.segments(br.segments);
+        break;
+    case TAG_META:
+        r.json(br.meta);
+        break;
+    case TAG_UNPARSEABLE:
+        r.json(br.unparseable);
+        break;
+    case TAG_BID_CURRENCY: {
+        size_t n = r.count();
+        br.bidCurrency.reserve(n);
+        for (size_t i = 0;  i < n;  ++i)
+            br.bidCurrency.push_back((CurrencyCode)r.varint());
+        break;
+    }
+    case TAG_BLOCKED_CATEGORIES:
+        r.json(br.blockedCategories);
+        break;
+    case TAG_BADV: {
+        size_t n = r.count();
+        br.badv.reserve(n);
+        for (size_t i = 0;  i < n;  ++i)
+            br.badv.push_back(r.utf8());
+        break;
+    }
+    case TAG_WIN_SURCHARGES:
+        r.json(br.winSurcharges);
+        break;
+    case TAG_EXT:
+        r.json(br.ext);
+        break;
+    case TAG_PARSED_FIELDS:
+        br.parsedFields = r.varint();
+        break;
+    default:
+        // Written by a later version; skipped by the caller
+        break;
+    }
+}
+
+} // file scope
+
+
+/*****************************************************************************/
+/* BINARY BID REQUEST                                                        */
+/*****************************************************************************/
+
+constexpr unsigned char BinaryBidRequest::MAGIC;
+constexpr unsigned BinaryBidRequest::VERSION;
+
+std::string
+BinaryBidRequest::
+encode(const BidRequest & request)
+{
+    std::string result;
+    encode(request, result);
+    return result;
+}
+
+void
+BinaryBidRequest::
+encode(const BidRequest & request, std::string & result)
+{
+    Writer writer;
+    encodeRecords(request, writer);
+    writer.finish(result);
+}
+
+BidRequest *
+BinaryBidRequest::
+decode(const char * data, size_t length)
+{
+    if (!isEncoded(data, length))
+        throw ML::Exception("not a binary bid request");
+
+    std::vector<std::string> strings;
+    Reader reader(data + 1, data + length, strings);
+
+    uint64_t version = reader.varint();
+    if (version == 0 || version > VERSION)
+        throw ML::Exception("unknown binary bid request version %lld",
+                            (long long)version);
+
+    size_t numStrings = reader.count();
+    strings.reserve(numStrings);
+    for (size_t i = 0;  i < numStrings;  ++i)
+        strings.push_back(reader.string());
+
+    std::unique_ptr<BidRequest> result(new BidRequest());
+
+    while (reader.data != reader.end) {
+        RecordTag tag = (RecordTag)reader.varint();
+        auto record = reader.slice();
+
+        Reader recordReader(record.first, record.first + record.second,
+                            strings);
+        decodeRecord(tag, recordReader, *result);
+    }
+
+    return result.release();
+}
+
+} // namespace RTBKIT
@@ -0,0 +1,82 @@
+/* binary_bid_request.h                                            -*- C++ -*-
+   Copyright (c) 2013 Datacratic.  All rights reserved.
+
+   Compact binary encoding of bid requests.
+*/
+
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+
+namespace RTBKIT {
+
+struct BidRequest;
+
+
+/*****************************************************************************/
+/* BINARY BID REQUEST                                                        */
+/*****************************************************************************/
+
+/** Compact, versioned binary encoding of a BidRequest, used to hand bid
+    requests over between our own processes: the router sends it to the
+    post auction service and to the agents that ask for binary bid
+    requests.  It carries every member of the request, including those that
+    the canonical JSON leaves out, and is much cheaper to produce and to
+    decode than the JSON.
+
+    The encoding starts with a magic byte that can't start JSON nor the
+    older ML::DB serialization, followed by the version of the encoding and
+    a table of the strings that are interned in the request (exchange,
+    segment sources, user id domains...).  Then comes one record per
+    member that isn't at its default value: a tag identifying the member,
+    the length of the record and its value.  Numbers are stored as varints,
+    strings as a length and their bytes, and the members that are OpenRTB
+    objects or arbitrary JSON (site, device, imp, ext...) as raw slices of
+    JSON produced by their value description.
+
+    Tags are never reused: new members get new tags and decoders skip the
+    records whose tag they don't know, so the version only changes when the
+    layout of the encoding itself does.
+*/
+
+struct BinaryBidRequest {
+
+    /** First byte of an encoded request. */
+    static constexpr unsigned char MAGIC = 0xb1;
+
+    /** Version of the encoding written by encode(). */
+    static constexpr unsigned VERSION = 1;
+
+    /** Encode the given bid request. */
+    static std::string encode(const BidRequest & request);
+
+    /** Encode the given bid request, replacing the contents of result.
+        Allows the same buffer to be reused from one request to the next.
+    */
+    static void encode(const BidRequest & request, std::string & result);
+
+    /** Decode a bid request produced by encode().  Throws if the data
+        isn't a valid encoding or was written by a later version.
+    */
+    static BidRequest * decode(const char * data, size_t length);
+
+    static BidRequest * decode(const std::string & str)
+    {
+        return decode(str.c_str(), str.size());
+    }
+
+    /** Tell if the given data looks like an encoded bid request. */
+    static bool isEncoded(const char * data, size_t length)
+    {
+        return length > 0 && (unsigned char)data[0] == MAGIC;
+    }
+
+    static bool isEncoded(const std::string & str)
+    {
+        return isEncoded(str.c_str(), str.size());
+    }
+};
+
+} // namespace RTBKIT
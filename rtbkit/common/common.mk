@@ -2,6 +2,7 @@
 
 LIBBIDREQUEST_SOURCES := \
 	bid_request.cc \
+	binary_bid_request.cc \
 	segments.cc \
 	json_holder.cc \
 	currency.cc \
@@ -14,6 +15,7 @@ $(eval $(call library,bid_request,$(LIBBIDREQUEST_SOURCES),$(LIBBIDREQUEST_LINK)
 
 LIBRTB_SOURCES := \
 	auction.cc \
+	auction_arena.cc \
 	augmentation.cc \
 	account_key.cc \
 	bids.cc \
@@ -22,6 +24,7 @@ LIBRTB_SOURCES := \
 	bidder_interface.cc \
 	win_cost_model.cc \
 	post_auction_proxy.cc \
+	post_auction_ring.cc \
 	analytics_publisher.cc \
 	extension.cc \
 	bid_request_pipeline.cc
@@ -31,6 +34,12 @@ LIBRTB_LINK := \
 
 $(eval $(call library,rtb,$(LIBRTB_SOURCES),$(LIBRTB_LINK)))
 
-$(eval $(call library,filter_registry,filter.cc,arch utils rtb))
+LIBFILTER_REGISTRY_SOURCES := \
+	filter.cc \
+	config_set_kernels.cc \
+	config_set_avx2.cc
+
+$(eval $(call library,filter_registry,$(LIBFILTER_REGISTRY_SOURCES),arch utils rtb))
+$(eval $(call set_single_compile_option,config_set_avx2.cc,-mavx2 -mpopcnt))
 
 $(eval $(call include_sub_make,testing,,common_testing.mk))
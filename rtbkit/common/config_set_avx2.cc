@@ -0,0 +1,98 @@
+/** config_set_avx2.cc                                 -*- C++ -*-
+    Copyright (c) 2013 Datacratic.  All rights reserved.
+
+    AVX2 bitfield kernels for ConfigSet. This file is the only one compiled
+    with -mavx2 (see common.mk) and the kernels are only selected at runtime
+    if the cpu and the OS both support them.
+
+*/
+
+#include "filter.h"
+
+#ifdef __AVX2__
+#  include <immintrin.h>
+#endif
+
+
+namespace RTBKIT {
+
+#ifdef __AVX2__
+
+namespace {
+
+typedef ConfigSetKernels::Word Word;
+
+// Processes 4 words per iteration with unaligned loads since the bitfields
+// are not guaranteed to be aligned. The left over words are done in scalar.
+
+#define RTBKIT_AVX2_BINARY_OP(_name_, _intrinsic_, _op_)                \
+    void _name_(Word* dst, const Word* src, size_t n)                   \
+    {                                                                   \
+        size_t i = 0;                                                   \
+        for (; i + 4 <= n; i += 4) {                                    \
+            __m256i a = _mm256_loadu_si256((const __m256i*) (dst + i)); \
+            __m256i b = _mm256_loadu_si256((const __m256i*) (src + i)); \
+            _mm256_storeu_si256((__m256i*) (dst + i), _intrinsic_(a, b)); \
+        }                                                               \
+        for (; i < n; ++i) dst[i] _op_ src[i];                          \
+    }
+
+RTBKIT_AVX2_BINARY_OP(avx2And, _mm256_and_si256, &=)
+RTBKIT_AVX2_BINARY_OP(avx2Or,  _mm256_or_si256,  |=)
+RTBKIT_AVX2_BINARY_OP(avx2Xor, _mm256_xor_si256, ^=)
+
+#undef RTBKIT_AVX2_BINARY_OP
+
+void avx2Not(Word* dst, size_t n)
+{
+    const __m256i ones = _mm256_set1_epi32(-1);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i a = _mm256_loadu_si256((const __m256i*) (dst + i));
+        _mm256_storeu_si256((__m256i*) (dst + i), _mm256_xor_si256(a, ones));
+    }
+    for (; i < n; ++i) dst[i] = ~dst[i];
+}
+
+bool avx2Any(const Word* src, size_t n)
+{
+    __m256i acc = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        acc = _mm256_or_si256(acc, _mm256_loadu_si256((const __m256i*) (src + i)));
+
+    if (!_mm256_testz_si256(acc, acc)) return true;
+
+    for (; i < n; ++i)
+        if (src[i]) return true;
+    return false;
+}
+
+// Every avx2 capable cpu also has popcnt which beats any of the vectorized
+// popcount tricks for the bitfield sizes we deal with.
+size_t avx2Count(const Word* src, size_t n)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < n; ++i)
+        total += __builtin_popcountll(src[i]);
+    return total;
+}
+
+const ConfigSetKernels avx2Kernels = {
+    "avx2",
+    &avx2And, &avx2Or, &avx2Xor, &avx2Not, &avx2Any, &avx2Count
+};
+
+} // namespace anonymous
+
+const ConfigSetKernels* ConfigSetKernels::avx2 = &avx2Kernels;
+
+#else
+
+const ConfigSetKernels* ConfigSetKernels::avx2 = nullptr;
+
+#endif // __AVX2__
+
+} // namepsace RTBKIT
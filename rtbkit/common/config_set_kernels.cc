@@ -0,0 +1,163 @@
+/** config_set_kernels.cc                                 -*- C++ -*-
+    Copyright (c) 2013 Datacratic.  All rights reserved.
+
+    Scalar and SSE2 bitfield kernels for ConfigSet along with the startup
+    detection of the best kernels supported by the cpu.
+
+*/
+
+#include "filter.h"
+#include "jml/arch/simd.h"
+#include "jml/arch/bitops.h"
+
+#include <emmintrin.h>
+
+
+using namespace std;
+using namespace ML;
+
+
+namespace RTBKIT {
+
+namespace {
+
+typedef ConfigSetKernels::Word Word;
+
+
+/******************************************************************************/
+/* SCALAR                                                                     */
+/******************************************************************************/
+
+void scalarAnd(Word* dst, const Word* src, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) dst[i] &= src[i];
+}
+
+void scalarOr(Word* dst, const Word* src, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) dst[i] |= src[i];
+}
+
+void scalarXor(Word* dst, const Word* src, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) dst[i] ^= src[i];
+}
+
+void scalarNot(Word* dst, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) dst[i] = ~dst[i];
+}
+
+bool scalarAny(const Word* src, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        if (src[i]) return true;
+    return false;
+}
+
+size_t scalarCount(const Word* src, size_t n)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (!src[i]) continue;
+        total += num_bits_set(src[i]);
+    }
+    return total;
+}
+
+
+/******************************************************************************/
+/* SSE2                                                                       */
+/******************************************************************************/
+
+// Processes 2 words per iteration with unaligned loads since the bitfields
+// are not guaranteed to be aligned. The odd word left over is done in scalar.
+
+#define RTBKIT_SSE2_BINARY_OP(_name_, _intrinsic_, _op_)                \
+    void _name_(Word* dst, const Word* src, size_t n)                   \
+    {                                                                   \
+        size_t i = 0;                                                   \
+        for (; i + 2 <= n; i += 2) {                                    \
+            __m128i a = _mm_loadu_si128((const __m128i*) (dst + i));    \
+            __m128i b = _mm_loadu_si128((const __m128i*) (src + i));    \
+            _mm_storeu_si128((__m128i*) (dst + i), _intrinsic_(a, b));  \
+        }                                                               \
+        if (i < n) dst[i] _op_ src[i];                                  \
+    }
+
+RTBKIT_SSE2_BINARY_OP(sse2And, _mm_and_si128, &=)
+RTBKIT_SSE2_BINARY_OP(sse2Or,  _mm_or_si128,  |=)
+RTBKIT_SSE2_BINARY_OP(sse2Xor, _mm_xor_si128, ^=)
+
+#undef RTBKIT_SSE2_BINARY_OP
+
+void sse2Not(Word* dst, size_t n)
+{
+    const __m128i ones = _mm_set1_epi32(-1);
+
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128i a = _mm_loadu_si128((const __m128i*) (dst + i));
+        _mm_storeu_si128((__m128i*) (dst + i), _mm_xor_si128(a, ones));
+    }
+    if (i < n) dst[i] = ~dst[i];
+}
+
+bool sse2Any(const Word* src, size_t n)
+{
+    __m128i acc = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2)
+        acc = _mm_or_si128(acc, _mm_loadu_si128((const __m128i*) (src + i)));
+
+    const __m128i zero = _mm_setzero_si128();
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(acc, zero)) != 0xFFFF) return true;
+    return i < n && src[i];
+}
+
+} // namespace anonymous
+
+
+/******************************************************************************/
+/* CONFIG SET KERNELS                                                         */
+/******************************************************************************/
+
+const ConfigSetKernels ConfigSetKernels::scalar = {
+    "scalar",
+    &scalarAnd, &scalarOr, &scalarXor, &scalarNot, &scalarAny, &scalarCount
+};
+
+// There's no popcount in SSE2 so we fallback on the scalar version.
+const ConfigSetKernels ConfigSetKernels::sse2 = {
+    "sse2",
+    &sse2And, &sse2Or, &sse2Xor, &sse2Not, &sse2Any, &scalarCount
+};
+
+// Constant initialized so that any ConfigSet used during static
+// initialization still has a valid set of kernels.
+const ConfigSetKernels* ConfigSetKernels::active = &ConfigSetKernels::scalar;
+
+const ConfigSetKernels&
+ConfigSetKernels::
+detect()
+{
+#ifdef JML_INTEL_ISA
+    if (avx2 && has_avx2()) return *avx2;
+    if (has_sse2()) return sse2;
+#endif
+    return scalar;
+}
+
+namespace {
+
+struct AtInit {
+    AtInit()
+    {
+        ConfigSetKernels::select(ConfigSetKernels::detect());
+    }
+} atInit;
+
+} // namespace anonymous
+
+} // namepsace RTBKIT
@@ -37,6 +37,7 @@ ExchangeConnector(const std::string & name,
     onAuctionError = [=] (const std::string & channel,
                           std::shared_ptr<Auction> auction,
                           const string & message) {};
+    getFilterFields = [] () -> uint32_t { return BidRequestFields::ALL; };
 
     numRequests = 0;
     numAuctions = 0;
@@ -58,6 +59,7 @@ ExchangeConnector(const std::string & name,
     onAuctionError = [=] (const std::string & channel,
                           std::shared_ptr<Auction> auction,
                           const string & message) {};
+    getFilterFields = [] () -> uint32_t { return BidRequestFields::ALL; };
 
     numRequests = 0;
     numAuctions = 0;
@@ -198,6 +200,13 @@ bidRequestCreativeFilter(const BidRequest & request,
     return true;
 }
 
+uint32_t
+ExchangeConnector::
+bidRequestFieldsRead() const
+{
+    return BidRequestFields::NONE;
+}
+
 std::unique_ptr<ExchangeConnector>
 ExchangeConnector::
 create(const std::string & exchange, ServiceBase & owner, const std::string & name)
@@ -65,6 +65,14 @@ struct ExchangeConnector: public ServiceBase {
                                   const std::string & message)> OnAuctionError;
     OnAuctionError onAuctionError;
 
+    /** Function returning the groups of top level fields of the bid
+        requests (see BidRequestFields) that the router reads before it
+        completes them, ie in its filters.  Set by the router along with the
+        callbacks above; returns BidRequestFields::ALL until then.
+    */
+    typedef boost::function<uint32_t ()> GetFilterFields;
+    GetFilterFields getFilterFields;
+
     /*************************************************************************/
     /* METHODS CALLED BY THE ROUTER TO CONTROL THE EXCHANGE CONNECTOR        */
     /*************************************************************************/
@@ -348,6 +356,17 @@ struct ExchangeConnector: public ServiceBase {
                                           const AgentConfig & config,
                                           const void * info) const;
 
+    /** Groups of top level fields of the bid requests (see
+        BidRequestFields) that the exchange connector reads itself before the
+        auction makes it through the filters: in the three functions above
+        and when it parses or adjusts the bid request.  Only matters to the
+        connectors that parse the bid requests lazily.
+
+        The default filters don't look at the request so the default
+        implementation returns BidRequestFields::NONE.
+    */
+    virtual uint32_t bidRequestFieldsRead() const;
+
 
 
     /*************************************************************************/
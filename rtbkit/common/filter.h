@@ -10,11 +10,14 @@
 #include "rtbkit/core/router/router_types.h"
 #include "jml/utils/compact_vector.h"
 #include "jml/arch/bitops.h"
+#include "jml/arch/exception.h"
+#include "jml/compiler/compiler.h"
 
 #include <vector>
 #include <string>
 #include <memory>
 #include <functional>
+#include <algorithm>
 
 
 namespace RTBKIT {
@@ -25,6 +28,118 @@ struct ExchangeConnector;
 struct AgentConfig;
 
 
+/******************************************************************************/
+/* CONFIG SET KERNELS                                                         */
+/******************************************************************************/
+
+/** Bulk bitwise operations over the words of a ConfigSet's bitfield.
+
+    Several implementations are available (scalar, SSE2 and AVX2) and the best
+    one supported by the cpu is selected once at startup. See
+    config_set_kernels.cc for the implementations.
+ */
+struct ConfigSetKernels
+{
+    typedef uint64_t Word;
+
+    // Small bitfields aren't worth the indirect call.
+    static constexpr size_t MinWords = 4;
+
+    const char* name;
+
+    void (*andWords)(Word* dst, const Word* src, size_t n);
+    void (*orWords)(Word* dst, const Word* src, size_t n);
+    void (*xorWords)(Word* dst, const Word* src, size_t n);
+    void (*notWords)(Word* dst, size_t n);
+    bool (*anyWords)(const Word* src, size_t n);
+    size_t (*countWords)(const Word* src, size_t n);
+
+    static const ConfigSetKernels scalar;
+    static const ConfigSetKernels sse2;
+
+    // Only set if avx2 support was compiled in; nullptr otherwise.
+    static const ConfigSetKernels* avx2;
+
+    // Kernels currently in use by all ConfigSet objects.
+    static const ConfigSetKernels* active;
+
+    // Picks the fastest kernels supported by the cpu. Called automatically at
+    // startup.
+    static const ConfigSetKernels& detect();
+
+    // Overrides the active kernels. Should only be used for benchmarking and
+    // testing purposes before any filtering takes place.
+    static void select(const ConfigSetKernels& kernels) { active = &kernels; }
+};
+
+
+/******************************************************************************/
+/* CONFIG STORAGE                                                             */
+/******************************************************************************/
+
+/** Default storage for the ConfigSet bitfield which is dynamically resized as
+    new configs are added. The first 8 words (512 configs) are stored inline.
+ */
+struct DynamicConfigStorage : public ML::compact_vector<uint64_t, 8>
+{
+    typedef uint64_t Word;
+
+    explicit DynamicConfigStorage(Word) {}
+
+    Word* words() { return empty() ? nullptr : &(*this)[0]; }
+    const Word* words() const { return empty() ? nullptr : &(*this)[0]; }
+};
+
+
+/** Fixed capacity storage for the ConfigSet bitfield which is always fully
+    initialized. This removes the resizing and the default value tail handling
+    from the bitwise operations at the cost of a fixed upper bound on the
+    number of configs and a larger memory footprint for small sets.
+
+    The storage is aligned on cache lines to play nice with the SIMD kernels.
+    Note that heap allocated instances (std::vector and friends) are not
+    guaranteed to respect this alignment so the kernels never rely on it.
+ */
+template<size_t Words>
+struct FixedConfigStorage
+{
+    typedef uint64_t Word;
+    typedef Word* iterator;
+    typedef const Word* const_iterator;
+
+    static constexpr size_t Capacity = Words;
+
+    explicit FixedConfigStorage(Word fill)
+    {
+        std::fill(bitfield, bitfield + Words, fill);
+    }
+
+    size_t size() const { return Words; }
+    bool empty() const { return false; }
+
+    void resize(size_t newSize, Word)
+    {
+        if (newSize <= Words) return;
+        throw ML::Exception("ConfigSet capacity exceeded: %lld > %lld words",
+                (long long) newSize, (long long) Words);
+    }
+
+    Word& operator[] (size_t i) { return bitfield[i]; }
+    const Word& operator[] (size_t i) const { return bitfield[i]; }
+
+    Word* words() { return bitfield; }
+    const Word* words() const { return bitfield; }
+
+    iterator begin() { return bitfield; }
+    iterator end() { return bitfield + Words; }
+    const_iterator begin() const { return bitfield; }
+    const_iterator end() const { return bitfield + Words; }
+
+private:
+    Word bitfield[Words] JML_ALIGNED(64);
+};
+
+
 /******************************************************************************/
 /* CONFIG SET                                                                 */
 /******************************************************************************/
@@ -38,15 +153,22 @@ struct AgentConfig;
     whether configs should be part of the set by default or not. In other words
     ConfigSet(true) indicades that all configs are part of the set by default.
 
+    The bitfield storage is pluggable. DynamicConfigStorage (the default)
+    grows on demand while FixedConfigStorage uses a fixed number of words and
+    never needs to be expanded. See the ConfigSet typedef below for how the
+    storage is selected at build time.
+
     Note that this class is easier reflects more a bitfield then it does a
     set. In other words, it uses bitfield nomenclature to manipulate the set.
  */
-struct ConfigSet
+template<typename Storage>
+struct ConfigSetT
 {
     typedef uint64_t Word;
     static constexpr size_t Div = sizeof(Word) * 8;
 
-    explicit ConfigSet(bool defaultValue = false) :
+    explicit ConfigSetT(bool defaultValue = false) :
+        bitfield(defaultValue ? ~Word(0) : 0),
         defaultValue(defaultValue ? ~Word(0) : 0)
     {}
 
@@ -94,6 +216,10 @@ struct ConfigSet
 
     size_t count() const
     {
+        if (bitfield.size() >= ConfigSetKernels::MinWords)
+            return ConfigSetKernels::active->countWords(
+                    bitfield.words(), bitfield.size());
+
         size_t total = 0;
 
         for (size_t i = 0; i < bitfield.size(); ++i) {
@@ -108,36 +234,60 @@ struct ConfigSet
     {
         if (bitfield.empty()) return !defaultValue;
 
+        if (bitfield.size() >= ConfigSetKernels::MinWords)
+            return !ConfigSetKernels::active->anyWords(
+                    bitfield.words(), bitfield.size());
+
         for (size_t i = 0; i < bitfield.size(); ++i) {
             if (bitfield[i]) return false;
         }
         return true;
     }
 
-#define RTBKIT_CONFIG_SET_OP(_op_)                                      \
-    ConfigSet& operator _op_ (const ConfigSet& other)                   \
+    // Whether the two sets have at least one config in common.
+    bool intersects(const ConfigSetT& other) const
+    {
+        size_t n = std::max(bitfield.size(), other.bitfield.size());
+
+        for (size_t i = 0; i < n; ++i) {
+            Word lhs = i < bitfield.size() ? bitfield[i] : defaultValue;
+            Word rhs = i < other.bitfield.size() ? other.bitfield[i] : other.defaultValue;
+            if (lhs & rhs) return true;
+        }
+
+        return defaultValue & other.defaultValue;
+    }
+
+#define RTBKIT_CONFIG_SET_OP(_op_, _kernel_)                            \
+    ConfigSetT& operator _op_ (const ConfigSetT& other)                 \
     {                                                                   \
         expand(other.size());                                           \
                                                                         \
-        for (size_t i = 0; i < other.bitfield.size(); ++i)              \
-            bitfield[i] _op_ other.bitfield[i];                         \
+        size_t n = other.bitfield.size();                               \
+        if (n >= ConfigSetKernels::MinWords)                            \
+            ConfigSetKernels::active->_kernel_(                         \
+                    bitfield.words(), other.bitfield.words(), n);       \
+        else {                                                          \
+            for (size_t i = 0; i < n; ++i)                              \
+                bitfield[i] _op_ other.bitfield[i];                     \
+        }                                                               \
                                                                         \
-        for (size_t i = other.bitfield.size(); i < bitfield.size(); ++i) \
+        for (size_t i = n; i < bitfield.size(); ++i)                    \
             bitfield[i] _op_ other.defaultValue;                        \
                                                                         \
         return *this;                                                   \
     }
 
-    RTBKIT_CONFIG_SET_OP(&=)
-    RTBKIT_CONFIG_SET_OP(|=)
-    RTBKIT_CONFIG_SET_OP(^=)
+    RTBKIT_CONFIG_SET_OP(&=, andWords)
+    RTBKIT_CONFIG_SET_OP(|=, orWords)
+    RTBKIT_CONFIG_SET_OP(^=, xorWords)
 
 #undef RTBKIT_CONFIG_SET_OP
 
 #define RTBKIT_CONFIG_SET_OP_CONST(_op_)                        \
-    ConfigSet operator _op_ (const ConfigSet& other) const      \
+    ConfigSetT operator _op_ (const ConfigSetT& other) const    \
     {                                                           \
-        ConfigSet tmp = *this;                                  \
+        ConfigSetT tmp = *this;                                 \
         tmp _op_ ## = other;                                    \
         return tmp;                                             \
     }
@@ -152,17 +302,24 @@ struct ConfigSet
     // The not(~) operator which doesn't have a analogue in set terminology.
     // There's a good reason why this isn't an operator overload but I can't
     // remember.
-    ConfigSet& negate()
+    ConfigSetT& negate()
     {
         defaultValue = ~defaultValue;
-        for (size_t i = 0; i < bitfield.size(); ++i)
-            bitfield[i] = ~bitfield[i];
+
+        if (bitfield.size() >= ConfigSetKernels::MinWords)
+            ConfigSetKernels::active->notWords(
+                    bitfield.words(), bitfield.size());
+        else {
+            for (size_t i = 0; i < bitfield.size(); ++i)
+                bitfield[i] = ~bitfield[i];
+        }
+
         return *this;
     }
 
-    ConfigSet negate() const
+    ConfigSetT negate() const
     {
-        return ConfigSet(*this).negate();
+        return ConfigSetT(*this).negate();
     }
 
 
@@ -203,7 +360,7 @@ struct ConfigSet
     }
 
 private:
-    ML::compact_vector<Word, 8> bitfield;
+    Storage bitfield;
     Word defaultValue;
 };
 
@@ -226,14 +383,17 @@ private:
     creatives are included by default or not. Internally, this uses bitfields to
     efficiently batch up creative manipulations in the filters.
 
+    Inline is the number of creatives stored inline before the matrix has to
+    allocate.
  */
-struct CreativeMatrix
+template<typename Set, size_t Inline = 16>
+struct CreativeMatrixT
 {
-    explicit CreativeMatrix(bool defaultValue = false) :
-        defaultValue(ConfigSet(defaultValue))
+    explicit CreativeMatrixT(bool defaultValue = false) :
+        defaultValue(Set(defaultValue))
     {}
 
-    explicit CreativeMatrix(ConfigSet defaultValue) :
+    explicit CreativeMatrixT(Set defaultValue) :
         defaultValue(defaultValue)
     {}
 
@@ -241,7 +401,7 @@ struct CreativeMatrix
 
     bool empty() const
     {
-        for (const ConfigSet& set : matrix) {
+        for (const Set& set : matrix) {
             if (!set.empty()) return false;
         }
         return true;
@@ -254,7 +414,7 @@ struct CreativeMatrix
     }
 
 
-    const ConfigSet& operator[] (size_t creative) const
+    const Set& operator[] (size_t creative) const
     {
         return matrix[creative];
     }
@@ -291,7 +451,7 @@ struct CreativeMatrix
     }
 
 #define RTBKIT_CREATIVE_MATRIX_OP(_op_)                                 \
-    CreativeMatrix& operator _op_ (const CreativeMatrix& other)         \
+    CreativeMatrixT& operator _op_ (const CreativeMatrixT& other)       \
     {                                                                   \
         expand(other.matrix.size());                                    \
                                                                         \
@@ -312,29 +472,37 @@ struct CreativeMatrix
 
     // The bit-wise not(~) operator. There's a good reason why this isn't a
     // operator overload but I can't remember it.
-    CreativeMatrix& negate()
+    CreativeMatrixT& negate()
     {
         defaultValue = defaultValue.negate();
-        for (ConfigSet& set : matrix) set.negate();
+        for (Set& set : matrix) set.negate();
         return *this;
     }
 
-    CreativeMatrix negate() const
+    CreativeMatrixT negate() const
     {
-        return CreativeMatrix(*this).negate();
+        return CreativeMatrixT(*this).negate();
     }
 
 
     // Returns a ConfigSet where a config will be present iff there's at least
     // one creative present for that config in the matrix.
-    ConfigSet aggregate() const
+    Set aggregate() const
     {
-        ConfigSet configs;
+        Set configs;
+        aggregate(configs, matrix.size());
+        return configs;
+    }
 
-        for (const ConfigSet& set : matrix)
+    // Ors into configs every creative of the matrix as if it was first
+    // expanded to the given number of creatives. Doesn't copy the matrix.
+    void aggregate(Set& configs, size_t creatives) const
+    {
+        for (const Set& set : matrix)
             configs |= set;
 
-        return configs;
+        if (creatives > matrix.size())
+            configs |= defaultValue;
     }
 
     std::string print() const
@@ -351,11 +519,28 @@ struct CreativeMatrix
     }
 
 private:
-    ML::compact_vector<ConfigSet, 16> matrix;
-    ConfigSet defaultValue;
+    ML::compact_vector<Set, Inline> matrix;
+    Set defaultValue;
 };
 
 
+/** RTBKIT_CONFIG_SET_FIXED_WORDS can be defined at build time (eg. in
+    local.mk) to switch all the filters to a fixed capacity bitfield which can
+    hold up to 64 * RTBKIT_CONFIG_SET_FIXED_WORDS configs.
+ */
+#if defined(RTBKIT_CONFIG_SET_FIXED_WORDS) && RTBKIT_CONFIG_SET_FIXED_WORDS
+
+typedef ConfigSetT< FixedConfigStorage<RTBKIT_CONFIG_SET_FIXED_WORDS> > ConfigSet;
+typedef CreativeMatrixT<ConfigSet, 2> CreativeMatrix;
+
+#else
+
+typedef ConfigSetT<DynamicConfigStorage> ConfigSet;
+typedef CreativeMatrixT<ConfigSet> CreativeMatrix;
+
+#endif
+
+
 /******************************************************************************/
 /* FILTER STATE                                                               */
 /******************************************************************************/
@@ -375,7 +560,9 @@ struct FilterState
             const ExchangeConnector* ex,
             const CreativeMatrix& activeConfigs) :
         request(br),
-        exchange(ex)
+        exchange(ex),
+        shardMask_(nullptr),
+        shardKey_(0)
     {
         if (activeConfigs.size())
             configs_ = activeConfigs[0];
@@ -393,6 +580,24 @@ struct FilterState
     // the creatives accordingly.
     void narrowConfigs(const ConfigSet& mask) { configs_ &= mask; }
 
+    // Restricts the state to the configs of a shard of the filter pool. The
+    // key identifies the shard's mask and must be unique for a given mask.
+    void setShard(const ConfigSet& mask, uint64_t key)
+    {
+        configs_ &= mask;
+        shardMask_ = &mask;
+        shardKey_ = key;
+    }
+
+    // Mask of the shard being filtered or null if unsharded. Filters can skip
+    // the work for any configs outside of it since their result only matters
+    // within the mask.
+    const ConfigSet* shardMask() const { return shardMask_; }
+
+    // Identifies the shard mask; 0 if unsharded. Meant to be mixed in the
+    // keys of anything that caches results computed under the mask.
+    uint64_t shardKey() const { return shardKey_; }
+
     // Current set of active creatives for a given impression.
     CreativeMatrix creatives(unsigned impId) const
     {
@@ -438,12 +643,19 @@ struct FilterState
 private:
     void updateConfigs()
     {
-        CreativeMatrix mask;
-        for (const CreativeMatrix& matrix : creatives_) mask |= matrix;
-        configs_ &= mask.aggregate();
+        size_t creatives = 0;
+        for (const CreativeMatrix& matrix : creatives_)
+            creatives = std::max(creatives, matrix.size());
+
+        ConfigSet mask;
+        for (const CreativeMatrix& matrix : creatives_)
+            matrix.aggregate(mask, creatives);
+        configs_ &= mask;
     }
 
     ConfigSet configs_;
+    const ConfigSet* shardMask_;
+    uint64_t shardKey_;
     ML::compact_vector<CreativeMatrix, 8> creatives_;
     FilterReasons filterReasons_;
 };
@@ -476,6 +688,15 @@ struct FilterBase
     virtual unsigned priority() const { return 0; }
 
 
+    /** Groups of top level fields of the bid request (see BidRequestFields)
+        that are read by the filter. Exchange connectors that parse the bid
+        requests lazily only parse those ahead of filtering.
+
+        Defaults to all the fields which is always safe.
+     */
+    virtual uint32_t requiredFields() const { return BidRequestFields::ALL; }
+
+
     /** Filters the given bid request such and a return the set of agent
         configuration that matches the given bid request. The filter should
         modified state to filter-out configs.
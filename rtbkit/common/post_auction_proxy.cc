@@ -23,13 +23,15 @@ namespace RTBKIT {
 PostAuctionProxy::
 PostAuctionProxy(ServiceBase& parent) :
     parent(&parent),
-    proxies(parent.getServices())
+    proxies(parent.getServices()),
+    ring(std::make_shared<PostAuctionRing>())
 {}
 
 PostAuctionProxy::
 PostAuctionProxy(std::shared_ptr<Datacratic::ServiceProxies> proxies) :
     parent(nullptr),
-    proxies(proxies)
+    proxies(proxies),
+    ring(std::make_shared<PostAuctionRing>())
 {}
 
 void
@@ -49,9 +51,31 @@ initZMQ()
 
     zmq.reset(new Datacratic::ZmqMultipleNamedClientBusProxy);
     zmq->init(proxies->config);
+    zmq->providersHandler = [=] (const std::map<std::string, Json::Value> & services) {
+        onServicesChanged(services);
+    };
     zmq->connectAllServiceProviders("rtbPostAuctionService", "events");
 }
 
+void
+PostAuctionProxy::
+onServicesChanged(const std::map<std::string, Json::Value> & services)
+{
+    auto newRing = std::make_shared<PostAuctionRing>(
+            PostAuctionRing::fromRegistrations(services));
+
+    std::lock_guard<ML::Spinlock> guard(ringLock);
+    ring = std::move(newRing);
+}
+
+std::shared_ptr<const PostAuctionRing>
+PostAuctionProxy::
+currentRing() const
+{
+    std::lock_guard<ML::Spinlock> guard(ringLock);
+    return ring;
+}
+
 void
 PostAuctionProxy::
 initHTTP()
@@ -78,6 +102,14 @@ isConnected() const
 {
     if (!zmq) return true;
 
+    auto ring = currentRing();
+    if (!ring->empty()) {
+        for (const auto & service : ring->services()) {
+            if (!zmq->isConnectedTo(service)) return false;
+        }
+        return true;
+    }
+
     for (size_t shard = 0; shard < shards; ++shard) {
         if (!zmq->isConnectedToShard(shard)) return false;
     }
@@ -87,28 +119,41 @@ isConnected() const
 
 void
 PostAuctionProxy::
-sendAuction(std::shared_ptr<SubmittedAuctionEvent> event)
+sendZMQ(const Id & auctionId, const std::string & topic, std::string str)
 {
-    size_t shard = event->auctionId.hash() % shards;
+    auto ring = currentRing();
 
-    if (!zmq) http[shard]->forwardAuction(event);
-    else {
-        string str = ML::DB::serializeToString(*event);
-        (void) zmq->sendMessageToShard(shard, "AUCTION", move(str));
+    if (ring->empty()) {
+        size_t shard = auctionId.hash() % shards;
+        (void) zmq->sendMessageToShard(shard, topic, move(str));
     }
+    else (void) zmq->trySendMessage(ring->owner(auctionId), topic, move(str));
 }
 
 void
 PostAuctionProxy::
-sendEvent(std::shared_ptr<PostAuctionEvent> event)
+sendAuction(std::shared_ptr<SubmittedAuctionEvent> event)
 {
+    if (zmq) {
+        sendZMQ(event->auctionId, "AUCTION", ML::DB::serializeToString(*event));
+        return;
+    }
+
     size_t shard = event->auctionId.hash() % shards;
+    http[shard]->forwardAuction(event);
+}
 
-    if (!zmq) http[shard]->forwardEvent(event);
-    else {
-        string str = ML::DB::serializeToString(*event);
-        (void) zmq->sendMessageToShard(shard, print(event->type), str);
+void
+PostAuctionProxy::
+sendEvent(std::shared_ptr<PostAuctionEvent> event)
+{
+    if (zmq) {
+        sendZMQ(event->auctionId, print(event->type), ML::DB::serializeToString(*event));
+        return;
     }
+
+    size_t shard = event->auctionId.hash() % shards;
+    http[shard]->forwardEvent(event);
 }
 
 
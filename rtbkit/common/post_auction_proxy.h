@@ -9,6 +9,10 @@
 #pragma once
 
 #include "rtbkit/common/auction_events.h"
+#include "rtbkit/common/post_auction_ring.h"
+#include "jml/arch/spinlock.h"
+
+#include <map>
 
 namespace Datacratic {
 
@@ -31,6 +35,12 @@ struct EventForwarder;
     Requires that the postAuctionShard configuration parameter be provided in
     the bootstrap.json to determine the number of active post auction shards. If
     not present, assumes that there's only one active post auction shard.
+
+    Post auction services that advertise ring tokens in their registration
+    are instead placed on a consistent hash ring (see PostAuctionRing) which
+    is rebuilt as they come and go.  Once there's at least one of them, the
+    auctions and events are routed on the ring and postAuctionShards is
+    ignored.
  */
 struct PostAuctionProxy
 {
@@ -48,14 +58,30 @@ struct PostAuctionProxy
     // Sends an event to the post auction loop.
     void sendEvent(std::shared_ptr<PostAuctionEvent> event);
 
+    // Ring the messages are currently routed on; empty if not in use.
+    std::shared_ptr<const PostAuctionRing> currentRing() const;
+
 private:
     void initZMQ();
     void initHTTP();
 
+    void onServicesChanged(const std::map<std::string, Json::Value> & services);
+
+    void sendZMQ(const Datacratic::Id & auctionId,
+                 const std::string & topic,
+                 std::string str);
+
     Datacratic::ServiceBase* parent;
     std::shared_ptr<Datacratic::ServiceProxies> proxies;
 
     size_t shards;
+
+    /** Replaced as a whole whenever the set of services changes so that the
+        senders only hold the lock long enough to grab a reference.
+    */
+    std::shared_ptr<const PostAuctionRing> ring;
+    mutable ML::Spinlock ringLock;
+
     std::unique_ptr<Datacratic::ZmqMultipleNamedClientBusProxy> zmq;
     std::vector< std::shared_ptr<EventForwarder> > http;
 };
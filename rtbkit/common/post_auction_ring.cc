@@ -0,0 +1,176 @@
+/** post_auction_ring.cc                                 -*- C++ -*-
+    Copyright (c) 2014 Datacratic.  All rights reserved.
+
+    Implementation of the post auction consistent hash ring.
+
+*/
+
+#include "post_auction_ring.h"
+#include "jml/arch/exception.h"
+#include "jml/arch/format.h"
+#include "jml/utils/exc_assert.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+using namespace Datacratic;
+
+namespace RTBKIT {
+
+/******************************************************************************/
+/* POST AUCTION RING                                                          */
+/******************************************************************************/
+
+std::vector<uint64_t>
+PostAuctionRing::
+makeTokens(const std::string & name, size_t count)
+{
+    std::vector<uint64_t> result;
+    result.reserve(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        string key = name + ":" + to_string(i);
+        result.push_back(CityHash64(key.c_str(), key.size()));
+    }
+
+    return result;
+}
+
+/** Tokens are written as hex strings since they don't all fit in the signed
+    integers that JSON parsers are happy with.
+*/
+Json::Value
+PostAuctionRing::
+toJson(const std::vector<uint64_t> & tokens)
+{
+    Json::Value json(Json::objectValue);
+
+    Json::Value & list = json["ringTokens"];
+    list = Json::Value(Json::arrayValue);
+    for (uint64_t token : tokens)
+        list.append(ML::format("%016llx", (unsigned long long) token));
+
+    return json;
+}
+
+std::vector<uint64_t>
+PostAuctionRing::
+tokensFromJson(const Json::Value & json)
+{
+    std::vector<uint64_t> result;
+
+    if (!json.isObject() || !json.isMember("ringTokens")) return result;
+
+    const Json::Value & list = json["ringTokens"];
+    ExcCheck(list.isArray(), "invalid ringTokens type");
+
+    for (const auto & token : list) {
+        string str = token.asString();
+
+        char * end = nullptr;
+        uint64_t value = strtoull(str.c_str(), &end, 16);
+        if (str.empty() || *end)
+            throw ML::Exception("invalid ring token: " + str);
+
+        result.push_back(value);
+    }
+
+    return result;
+}
+
+PostAuctionRing
+PostAuctionRing::
+fromRegistrations(const std::map<std::string, Json::Value> & registrations)
+{
+    PostAuctionRing ring;
+
+    for (const auto & entry : registrations) {
+        auto tokens = tokensFromJson(entry.second);
+        if (tokens.empty()) continue;
+        ring.add(entry.first, std::move(tokens));
+    }
+
+    return ring;
+}
+
+void
+PostAuctionRing::
+add(const std::string & name, std::vector<uint64_t> tokens)
+{
+    ExcCheck(!tokens.empty(), "service without ring tokens");
+
+    this->tokens[name] = std::move(tokens);
+    rebuild();
+}
+
+void
+PostAuctionRing::
+remove(const std::string & name)
+{
+    if (tokens.erase(name)) rebuild();
+}
+
+/** The names are taken in order and ties between tokens are broken by name
+    so that every proxy ends up with the same ring for the same services.
+*/
+void
+PostAuctionRing::
+rebuild()
+{
+    names.clear();
+    points.clear();
+
+    for (const auto & entry : tokens) {
+        uint32_t index = names.size();
+        names.push_back(entry.first);
+
+        for (uint64_t token : entry.second)
+            points.emplace_back(token, index);
+    }
+
+    std::sort(points.begin(), points.end());
+}
+
+std::vector<std::string>
+PostAuctionRing::
+services() const
+{
+    return names;
+}
+
+size_t
+PostAuctionRing::
+find(uint64_t h) const
+{
+    ExcAssert(!points.empty());
+
+    auto it = std::lower_bound(
+            points.begin(), points.end(), std::make_pair(h, uint32_t(0)));
+    if (it == points.end()) return 0;
+    return it - points.begin();
+}
+
+double
+PostAuctionRing::
+share(const std::string & name) const
+{
+    auto it = std::find(names.begin(), names.end(), name);
+    if (it == names.end()) return 0.0;
+    if (names.size() == 1) return 1.0;
+    uint32_t index = it - names.begin();
+
+    // Each point owns the range that ends at it, starting after the
+    // previous point; the first one also owns the wrap-around.
+    double owned = 0.0;
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (points[i].second != index) continue;
+
+        uint64_t start = i ? points[i - 1].first : points.back().first;
+        owned += uint64_t(points[i].first - start);
+    }
+
+    return owned / 18446744073709551616.0;
+}
+
+} // namespace RTBKIT
@@ -0,0 +1,99 @@
+/** post_auction_ring.h                                 -*- C++ -*-
+    Copyright (c) 2014 Datacratic.  All rights reserved.
+
+    Consistent hash ring of the post auction services.
+
+*/
+
+#pragma once
+
+#include "soa/types/id.h"
+#include "soa/jsoncpp/json.h"
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace RTBKIT {
+
+/******************************************************************************/
+/* POST AUCTION RING                                                          */
+/******************************************************************************/
+
+/** Assigns auctions to post auction services by consistent hashing of their
+    auction id.
+
+    Each service owns a set of tokens, points on a 64 bit ring, and with them
+    the ranges of the ring that end at each of its tokens.  An auction goes to
+    the owner of the range its hashed auction id falls into.  When a service
+    joins it only takes ranges from the others and when it leaves its ranges
+    are split among the others, so only about 1/N of the auctions change
+    owner either way.  Auctions still pending in a range that changes owner
+    aren't moved: the events for them end up unmatched.
+
+    The services advertise their tokens in their service provider
+    registration (see toJson()) so that every proxy builds the same ring.
+    Tokens are derived from the service name so a service that restarts
+    under the same name takes back the same ranges.
+*/
+
+struct PostAuctionRing
+{
+    enum { DefaultTokens = 64 };
+
+    /** Tokens of the service with the given name. */
+    static std::vector<uint64_t>
+    makeTokens(const std::string & name, size_t count = DefaultTokens);
+
+    /** Registration attributes advertising the given tokens. */
+    static Json::Value toJson(const std::vector<uint64_t> & tokens);
+
+    /** Tokens advertised in a registration; empty if there are none. */
+    static std::vector<uint64_t> tokensFromJson(const Json::Value & json);
+
+    /** Ring made of the services, keyed by name, that advertise tokens in
+        their registration.  The others are left out.
+    */
+    static PostAuctionRing
+    fromRegistrations(const std::map<std::string, Json::Value> & registrations);
+
+    void add(const std::string & name, std::vector<uint64_t> tokens);
+    void remove(const std::string & name);
+
+    bool empty() const { return points.empty(); }
+
+    /** Names of the services on the ring, in order. */
+    std::vector<std::string> services() const;
+
+    /** Name of the service that owns the given auction; the ring must not
+        be empty.
+    */
+    const std::string & owner(const Datacratic::Id & auctionId) const
+    {
+        return names[points[find(auctionId.mixedHash())].second];
+    }
+
+    /** Fraction of the ring owned by the given service. */
+    double share(const std::string & name) const;
+
+private:
+
+    /** Index of the point whose range holds h: the first one at or after
+        h, wrapping around.
+    */
+    size_t find(uint64_t h) const;
+
+    void rebuild();
+
+    std::map<std::string, std::vector<uint64_t> > tokens;
+
+    /** Tokens of all the services sorted by position with the index of
+        their owner in names.
+    */
+    std::vector<std::pair<uint64_t, uint32_t> > points;
+    std::vector<std::string> names;
+};
+
+} // namespace RTBKIT
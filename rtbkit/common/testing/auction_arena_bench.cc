@@ -0,0 +1,157 @@
+/* auction_arena_bench.cc
+   Copyright (c) 2013 Datacratic.  All rights reserved.
+
+   Compares auctions allocated from the heap with auctions allocated in an
+   AuctionArena under a sustained 20k QPS.  The exchange thread creates the
+   auctions, bids on them and finishes them; they are dropped from another
+   thread once they've been in flight for 50ms, like the router does.
+   Reports the cpu used by both threads and the growth of the RSS.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include "rtbkit/common/auction.h"
+#include "rtbkit/common/auction_arena.h"
+#include "jml/arch/format.h"
+#include "jml/arch/timers.h"
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <fstream>
+#include <iostream>
+#include <time.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+
+double threadCpu()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+/** Resident set size of the process in kB. */
+size_t rss()
+{
+    ifstream stream("/proc/self/status");
+    string line;
+    while (getline(stream, line)) {
+        if (line.compare(0, 6, "VmRSS:") == 0)
+            return std::stoul(line.substr(6));
+    }
+    return 0;
+}
+
+template<typename Create>
+void bench(const string & name, const Create & create)
+{
+    const double qps = 20000;
+    const double duration = 5.0;
+    const double inFlight = 0.05;
+    const size_t numAuctions = qps * duration;
+
+    auto request = std::make_shared<BidRequest>();
+    request->auctionId = Id("bench");
+    request->imp.resize(2);
+
+    Auction::Response response(Auction::Price(MicroUSD(1000)), 1);
+    response.agent = "agent";
+    response.meta = "{\"some\":\"metadata\"}";
+
+    std::mutex lock;
+    std::deque<pair<Date, std::shared_ptr<Auction> > > auctions;
+    bool done = false;
+    double dropCpu = 0;
+
+    auto drop = [&] ()
+        {
+            double start = threadCpu();
+
+            for (;;) {
+                std::shared_ptr<Auction> auction;
+                {
+                    std::unique_lock<std::mutex> guard(lock);
+                    if (auctions.empty() && done) break;
+                    if (!auctions.empty()
+                        && auctions.front().first <= Date::now()) {
+                        auction = std::move(auctions.front().second);
+                        auctions.pop_front();
+                    }
+                }
+
+                if (!auction) ML::sleep(0.001);
+            }
+
+            dropCpu = threadCpu() - start;
+        };
+
+    size_t rssBefore = rss();
+    std::thread dropper(drop);
+
+    Date start = Date::now();
+    double createCpu = 0;
+
+    for (size_t i = 0;  i < numAuctions;  ++i) {
+        Date next = start.plusSeconds(i / qps);
+        double wait = Date::now().secondsUntil(next);
+        if (wait > 0) ML::sleep(wait);
+
+        double cpuBefore = threadCpu();
+
+        std::shared_ptr<Auction> auction
+            = create(Auction::HandleAuction(), request, next,
+                     next.plusSeconds(inFlight));
+        for (unsigned j = 0;  j < 3;  ++j) {
+            response.creativeId = j;
+            auction->setResponse(j % 2, response);
+        }
+        auction->finish();
+
+        createCpu += threadCpu() - cpuBefore;
+
+        std::unique_lock<std::mutex> guard(lock);
+        auctions.emplace_back(next.plusSeconds(inFlight), std::move(auction));
+    }
+
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        done = true;
+    }
+    dropper.join();
+
+    cerr << ML::format("%-6s create %6.2fus/auction  drop %6.2fus/auction  "
+                       "rss +%6zdkB  pooled blocks %zd\n",
+                       name.c_str(),
+                       createCpu / numAuctions * 1000000.0,
+                       dropCpu / numAuctions * 1000000.0,
+                       rss() - rssBefore,
+                       AuctionArena::pooledBlocks());
+}
+
+BOOST_AUTO_TEST_CASE( auctionArenaBench )
+{
+    bench("heap", [] (Auction::HandleAuction handle,
+                      std::shared_ptr<BidRequest> request,
+                      Date start, Date expiry)
+          {
+              return std::make_shared<Auction>(nullptr, handle, request,
+                                               start, expiry);
+          });
+
+    bench("arena", [] (Auction::HandleAuction handle,
+                       std::shared_ptr<BidRequest> request,
+                       Date start, Date expiry)
+          {
+              return Auction::createInArena(nullptr, handle, request,
+                                            start, expiry);
+          });
+}
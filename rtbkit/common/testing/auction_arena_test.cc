@@ -0,0 +1,116 @@
+/* auction_arena_test.cc
+   Copyright (c) 2013 Datacratic.  All rights reserved.
+
+   Tests for the auction arena and the auctions allocated in it.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include "rtbkit/common/auction_arena.h"
+#include "rtbkit/common/auction.h"
+
+#include <string.h>
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+
+BOOST_AUTO_TEST_CASE( test_auction_arena )
+{
+    AuctionArena::clearPool();
+
+    size_t blocksUsed;
+    {
+        AuctionArena arena;
+
+        char * c = (char *)arena.allocate(1, 1);
+        void * d = arena.allocate(sizeof(double), alignof(double));
+        BOOST_CHECK_EQUAL((size_t)d % alignof(double), 0);
+        BOOST_CHECK_GT((char *)d, c);
+
+        // Allocations that don't fit in a block get their own chunk
+        void * big = arena.allocate(AuctionArena::BLOCK_SIZE * 2);
+        memset(big, 0xff, AuctionArena::BLOCK_SIZE * 2);
+        BOOST_CHECK_EQUAL((size_t)big % AuctionArena::MAX_ALIGNMENT, 0);
+
+        for (unsigned i = 0;  i < 1000;  ++i) {
+            void * p = arena.allocate(100);
+            BOOST_CHECK_EQUAL((size_t)p % AuctionArena::MAX_ALIGNMENT, 0);
+            memset(p, i, 100);
+        }
+
+        blocksUsed = arena.blocksUsed();
+        BOOST_CHECK_GT(blocksUsed, 1);
+        BOOST_CHECK_EQUAL(arena.bytesAllocated(),
+                          1 + sizeof(double) + AuctionArena::BLOCK_SIZE * 2
+                          + 1000 * 100);
+    }
+
+    // The blocks are recycled through the pool
+    BOOST_CHECK_EQUAL(AuctionArena::pooledBlocks(), blocksUsed);
+    {
+        AuctionArena arena;
+        arena.allocate(100);
+        BOOST_CHECK_EQUAL(AuctionArena::pooledBlocks(), blocksUsed - 1);
+    }
+    BOOST_CHECK_EQUAL(AuctionArena::pooledBlocks(), blocksUsed);
+
+    AuctionArena::setMaxPooledBlocks(1);
+    BOOST_CHECK_EQUAL(AuctionArena::pooledBlocks(), 0);
+    {
+        AuctionArena arena;
+        for (unsigned i = 0;  i < 100;  ++i)
+            arena.allocate(100);
+    }
+    BOOST_CHECK_EQUAL(AuctionArena::pooledBlocks(), 1);
+
+    AuctionArena::setMaxPooledBlocks(4096);
+    AuctionArena::clearPool();
+}
+
+BOOST_AUTO_TEST_CASE( test_auction_in_arena )
+{
+    auto request = std::make_shared<BidRequest>();
+    request->auctionId = Id("auction");
+    request->imp.resize(2);
+
+    int finished = 0;
+    auto onFinished = [&] (std::shared_ptr<Auction>) { ++finished; };
+
+    Date now = Date::now();
+    std::weak_ptr<AuctionArena> arena;
+
+    {
+        auto auction = Auction::createInArena(nullptr, onFinished, request,
+                                              now, now.plusSeconds(0.1));
+        arena = auction->arena;
+        BOOST_REQUIRE(auction->arena);
+        BOOST_CHECK_EQUAL(auction->id, request->auctionId);
+
+        Auction::Response response(Auction::Price(MicroUSD(1000)), 1);
+        response.agent = "agent";
+
+        BOOST_CHECK_EQUAL(auction->setResponse(1, response).val,
+                          Auction::WinLoss::PENDING);
+        BOOST_CHECK(auction->finish());
+        BOOST_CHECK_EQUAL(finished, 1);
+
+        const Auction::Data * data = auction->getCurrentData();
+        BOOST_CHECK(data->tooLate);
+        BOOST_CHECK_EQUAL(data->winningResponse(1).localStatus.val,
+                          Auction::WinLoss::WIN);
+
+        // The auction, its control block and the versions of the data
+        BOOST_CHECK_GT(auction->arena->bytesAllocated(),
+                       sizeof(Auction) + 3 * sizeof(Auction::Data));
+    }
+
+    // Going with the last reference to the auction
+    BOOST_CHECK(arena.expired());
+    BOOST_CHECK_GT(AuctionArena::pooledBlocks(), 0);
+}
@@ -4,7 +4,11 @@ $(eval $(call library,bid_request_synth,bid_request_synth.cc,arch utils jsoncpp)
 $(eval $(call test,bid_request_synth_test,bid_request_synth,boost))
 $(eval $(call test,currency_test,bid_request,boost))
 $(eval $(call test,filter_test,filter_registry,boost))
+$(eval $(call test,config_set_kernels_test,filter_registry,boost))
 $(eval $(call test,bids_test,rtb,boost))
+$(eval $(call test,auction_arena_test,rtb,boost))
+$(eval $(call test,post_auction_ring_test,rtb services,boost))
+$(eval $(call test,auction_arena_bench,rtb,boost manual))
 
 $(eval $(call library,custom_1_plugin,custom_1_plugin.cc,))
 $(eval $(call test,plugin_table_test,utils,boost))
@@ -0,0 +1,278 @@
+/** config_set_kernels_test.cc                                 -*- C++ -*-
+    Copyright (c) 2013 Datacratic.  All rights reserved.
+
+    Checks every set of ConfigSet kernels supported by the cpu against the
+    scalar ones and the ConfigSet storages against a plain vector of bools.
+
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "rtbkit/common/filter.h"
+#include "jml/arch/simd.h"
+#include "jml/arch/exception.h"
+
+#include <boost/test/unit_test.hpp>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace ML;
+using namespace RTBKIT;
+
+typedef ConfigSetKernels::Word Word;
+
+
+/******************************************************************************/
+/* UTILS                                                                      */
+/******************************************************************************/
+
+vector<const ConfigSetKernels*> supportedKernels()
+{
+    vector<const ConfigSetKernels*> result = { &ConfigSetKernels::scalar };
+
+#ifdef JML_INTEL_ISA
+    if (has_sse2()) result.push_back(&ConfigSetKernels::sse2);
+    if (ConfigSetKernels::avx2 && has_avx2())
+        result.push_back(ConfigSetKernels::avx2);
+#endif
+
+    return result;
+}
+
+/** Selects the given kernels for the lifetime of the object. */
+struct ScopedKernels
+{
+    ScopedKernels(const ConfigSetKernels& kernels) :
+        old(ConfigSetKernels::active)
+    {
+        ConfigSetKernels::select(kernels);
+    }
+
+    ~ScopedKernels() { ConfigSetKernels::select(*old); }
+
+private:
+    const ConfigSetKernels* old;
+};
+
+// Sparse, dense, all zeros and all ones words so that the any and count
+// kernels see every case.
+Word randomWord(mt19937_64& rng)
+{
+    switch (rng() % 4) {
+    case 0: return 0;
+    case 1: return ~Word(0);
+    case 2: return Word(1) << (rng() % 64);
+    default: return rng();
+    }
+}
+
+void fill(mt19937_64& rng, Word* words, size_t n)
+{
+    for (size_t i = 0; i < n; ++i) words[i] = randomWord(rng);
+}
+
+
+/******************************************************************************/
+/* KERNELS                                                                    */
+/******************************************************************************/
+
+/** Runs each kernel over every size up to a few vector widths and every word
+    offset within a vector, which covers the unaligned heads and the tails
+    that are done in scalar.
+ */
+BOOST_AUTO_TEST_CASE(kernelsTest)
+{
+    enum { MaxWords = 37, MaxOffset = 4, Rounds = 20 };
+
+    const ConfigSetKernels& ref = ConfigSetKernels::scalar;
+    mt19937_64 rng(0);
+
+    for (const ConfigSetKernels* kernels : supportedKernels()) {
+        BOOST_TEST_MESSAGE("kernels: " << kernels->name);
+
+        for (size_t n = 0; n <= MaxWords; ++n) {
+            for (size_t offset = 0; offset < MaxOffset; ++offset) {
+                for (size_t round = 0; round < Rounds; ++round) {
+                    vector<Word> dstBuf(n + MaxOffset), srcBuf(n + MaxOffset);
+                    Word* dst = dstBuf.data() + offset;
+                    Word* src = srcBuf.data() + (MaxOffset - 1 - offset);
+                    fill(rng, dst, n);
+                    fill(rng, src, n);
+
+                    vector<Word> expected(dst, dst + n), result;
+
+                    auto checkBinary = [&] (
+                            decltype(ref.andWords) refOp,
+                            decltype(ref.andWords) op,
+                            const char* name)
+                        {
+                            vector<Word> exp = expected, res = expected;
+                            refOp(exp.data(), src, n);
+
+                            copy(res.begin(), res.end(), dst);
+                            op(dst, src, n);
+                            res.assign(dst, dst + n);
+
+                            BOOST_CHECK_MESSAGE(res == exp,
+                                    kernels->name << "." << name
+                                    << " n=" << n << " offset=" << offset);
+                        };
+
+                    checkBinary(ref.andWords, kernels->andWords, "and");
+                    checkBinary(ref.orWords,  kernels->orWords,  "or");
+                    checkBinary(ref.xorWords, kernels->xorWords, "xor");
+
+                    copy(expected.begin(), expected.end(), dst);
+                    ref.notWords(expected.data(), n);
+                    kernels->notWords(dst, n);
+                    result.assign(dst, dst + n);
+                    BOOST_CHECK_MESSAGE(result == expected,
+                            kernels->name << ".not n=" << n << " offset=" << offset);
+
+                    BOOST_CHECK_EQUAL(kernels->anyWords(src, n), ref.anyWords(src, n));
+                    BOOST_CHECK_EQUAL(kernels->countWords(src, n), ref.countWords(src, n));
+                }
+
+                // A single bit in the last word is only seen by the tail.
+                if (!n) continue;
+                vector<Word> buf(n + MaxOffset, 0);
+                Word* words = buf.data() + offset;
+                words[n - 1] = Word(1) << 63;
+                BOOST_CHECK(kernels->anyWords(words, n));
+                BOOST_CHECK_EQUAL(kernels->countWords(words, n), 1);
+                BOOST_CHECK(!kernels->anyWords(words, n - 1));
+            }
+        }
+    }
+}
+
+
+/******************************************************************************/
+/* CONFIG SET                                                                 */
+/******************************************************************************/
+
+/** Checks the set operations of the given set type against a vector of bools
+    for random sets of up to the given number of configs.  Bits that are past
+    the end of a bitfield take the default value of the set.
+ */
+template<typename Set>
+void checkConfigSet(mt19937_64& rng, size_t configs)
+{
+    enum { MaxConfigs = 1024 };
+
+    auto randomSet = [&] (vector<bool>& ref) {
+        bool defaultValue = rng() % 2;
+        Set set(defaultValue);
+        ref.assign(MaxConfigs, defaultValue);
+
+        size_t size = rng() % (configs + 1);
+        for (size_t i = 0; i < size; ++i) {
+            bool value = rng() % 2;
+            set.set(i, value);
+            ref[i] = value;
+        }
+        return set;
+    };
+
+    auto check = [&] (const Set& set, const vector<bool>& ref, const char* op) {
+        BOOST_REQUIRE_LE(set.size(), MaxConfigs);
+
+        size_t count = 0;
+        vector<bool> seen(set.size(), false);
+        for (size_t i = set.next(); i < set.size(); i = set.next(i + 1))
+            seen[i] = true;
+
+        for (size_t i = 0; i < set.size(); ++i) {
+            BOOST_CHECK_MESSAGE(set.test(i) == ref[i] && seen[i] == ref[i],
+                    op << " configs=" << configs << " i=" << i);
+            count += ref[i];
+        }
+
+        BOOST_CHECK_EQUAL(set.count(), count);
+        BOOST_CHECK_EQUAL(set.empty(), set.size() ? !count : !set.test(0));
+    };
+
+    vector<bool> lhsRef, rhsRef;
+    Set lhs = randomSet(lhsRef);
+    Set rhs = randomSet(rhsRef);
+
+    check(lhs, lhsRef, "init");
+    check(rhs, rhsRef, "init");
+
+    vector<bool> ref(MaxConfigs);
+
+    for (size_t i = 0; i < MaxConfigs; ++i) ref[i] = lhsRef[i] && rhsRef[i];
+    check(lhs & rhs, ref, "and");
+
+    for (size_t i = 0; i < MaxConfigs; ++i) ref[i] = lhsRef[i] || rhsRef[i];
+    check(lhs | rhs, ref, "or");
+
+    for (size_t i = 0; i < MaxConfigs; ++i) ref[i] = lhsRef[i] != rhsRef[i];
+    check(lhs ^ rhs, ref, "xor");
+
+    for (size_t i = 0; i < MaxConfigs; ++i) ref[i] = lhsRef[i] && !rhsRef[i];
+    check(lhs & rhs.negate(), ref, "andNot");
+
+    for (size_t i = 0; i < MaxConfigs; ++i) ref[i] = !lhsRef[i];
+    check(lhs.negate(), ref, "not");
+}
+
+BOOST_AUTO_TEST_CASE(configSetKernelsTest)
+{
+    typedef ConfigSetT<DynamicConfigStorage> DynamicSet;
+    typedef ConfigSetT< FixedConfigStorage<16> > FixedSet;
+
+    mt19937_64 rng(0);
+
+    for (const ConfigSetKernels* kernels : supportedKernels()) {
+        BOOST_TEST_MESSAGE("kernels: " << kernels->name);
+        ScopedKernels scoped(*kernels);
+
+        // Sizes on each side of MinWords and of the vector widths.
+        for (size_t configs : { 1, 63, 64, 65, 191, 255, 256, 257, 320, 500,
+                                513, 1000, 1024 })
+        {
+            for (size_t round = 0; round < 10; ++round) {
+                checkConfigSet<DynamicSet>(rng, configs);
+                checkConfigSet<FixedSet>(rng, configs);
+            }
+        }
+    }
+}
+
+
+/******************************************************************************/
+/* FIXED STORAGE                                                              */
+/******************************************************************************/
+
+BOOST_AUTO_TEST_CASE(fixedConfigStorageTest)
+{
+    enum { Words = 5, Capacity = Words * 64 };
+    typedef ConfigSetT< FixedConfigStorage<Words> > Set;
+
+    Set set;
+    BOOST_CHECK_EQUAL(set.size(), Capacity);
+    BOOST_CHECK(set.empty());
+
+    set.set(Capacity - 1);
+    BOOST_CHECK(set.test(Capacity - 1));
+    BOOST_CHECK_EQUAL(set.count(), 1);
+    BOOST_CHECK_EQUAL(set.next(), Capacity - 1);
+
+    set.expand(Capacity);
+    BOOST_CHECK_EQUAL(set.size(), Capacity);
+
+    // Growing past the capacity throws and leaves the set untouched.
+    BOOST_CHECK_THROW(set.set(Capacity), ML::Exception);
+    BOOST_CHECK_THROW(set.reset(Capacity + 100), ML::Exception);
+    BOOST_CHECK_THROW(set.expand(Capacity + 1), ML::Exception);
+    BOOST_CHECK_EQUAL(set.size(), Capacity);
+    BOOST_CHECK_EQUAL(set.count(), 1);
+
+    // Testing past the end only looks at the default value.
+    BOOST_CHECK(!set.test(Capacity + 1));
+    BOOST_CHECK(Set(true).test(Capacity + 1));
+    BOOST_CHECK_EQUAL(Set(true).count(), Capacity);
+}
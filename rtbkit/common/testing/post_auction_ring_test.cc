@@ -0,0 +1,216 @@
+/* post_auction_ring_test.cc
+   Copyright (c) 2014 Datacratic.  All rights reserved.
+
+   Tests for the consistent hash ring of the post auction services.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include "rtbkit/common/post_auction_ring.h"
+#include "soa/service/service_base.h"
+
+#include <map>
+
+using namespace std;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+PostAuctionRing makeRing(size_t services)
+{
+    PostAuctionRing ring;
+    for (size_t i = 0; i < services; ++i) {
+        string name = "pal-" + to_string(i);
+        ring.add(name, PostAuctionRing::makeTokens(name));
+    }
+    return ring;
+}
+
+vector<string> owners(const PostAuctionRing & ring, size_t auctions)
+{
+    vector<string> result;
+    for (size_t i = 0; i < auctions; ++i)
+        result.push_back(ring.owner(Id(i + 1)));
+    return result;
+}
+
+const size_t Auctions = 100000;
+
+BOOST_AUTO_TEST_CASE( test_ring_balance )
+{
+    auto ring = makeRing(4);
+    BOOST_CHECK_EQUAL(ring.services().size(), 4);
+
+    map<string, size_t> counts;
+    for (const auto & owner : owners(ring, Auctions))
+        counts[owner]++;
+
+    double total = 0.0;
+    for (const auto & service : ring.services()) {
+        double share = ring.share(service);
+        total += share;
+
+        BOOST_CHECK_GT(share, 0.15);
+        BOOST_CHECK_LT(share, 0.35);
+
+        // The auctions follow the shares of the ring
+        double fraction = double(counts[service]) / Auctions;
+        BOOST_CHECK_CLOSE(fraction, share, 5.0);
+    }
+
+    BOOST_CHECK_CLOSE(total, 1.0, 0.001);
+
+    auto single = makeRing(1);
+    BOOST_CHECK_EQUAL(single.share("pal-0"), 1.0);
+    BOOST_CHECK_EQUAL(single.owner(Id("some-auction")), "pal-0");
+}
+
+BOOST_AUTO_TEST_CASE( test_ring_join_leave )
+{
+    auto before = owners(makeRing(4), Auctions);
+
+    // Joining only takes auctions from the others
+    auto joined = makeRing(5);
+    auto after = owners(joined, Auctions);
+
+    size_t moved = 0;
+    for (size_t i = 0; i < Auctions; ++i) {
+        if (before[i] == after[i]) continue;
+        BOOST_CHECK_EQUAL(after[i], "pal-4");
+        ++moved;
+    }
+    BOOST_CHECK_CLOSE(double(moved) / Auctions, joined.share("pal-4"), 5.0);
+
+    // Leaving only hands out the auctions of the one that left
+    auto left = joined;
+    left.remove("pal-1");
+    auto remaining = owners(left, Auctions);
+
+    for (size_t i = 0; i < Auctions; ++i) {
+        if (after[i] == "pal-1")
+            BOOST_CHECK_NE(remaining[i], "pal-1");
+        else BOOST_CHECK_EQUAL(remaining[i], after[i]);
+    }
+
+    // Removing what isn't there is a no-op
+    left.remove("pal-42");
+    BOOST_CHECK(owners(left, Auctions) == remaining);
+}
+
+BOOST_AUTO_TEST_CASE( test_ring_registrations )
+{
+    auto tokens = PostAuctionRing::makeTokens("pal-0", 8);
+    BOOST_CHECK_EQUAL(tokens.size(), 8);
+    BOOST_CHECK(PostAuctionRing::makeTokens("pal-0", 8) == tokens);
+
+    Json::Value json = PostAuctionRing::toJson(tokens);
+    json["serviceName"] = "pal-0";
+    BOOST_CHECK(PostAuctionRing::tokensFromJson(json) == tokens);
+
+    Json::Value plain;
+    plain["serviceName"] = "pal-1";
+    BOOST_CHECK(PostAuctionRing::tokensFromJson(plain).empty());
+
+    Json::Value bad = PostAuctionRing::toJson({ 1, 2 });
+    bad["ringTokens"][1] = "xyz";
+    BOOST_CHECK_THROW(PostAuctionRing::tokensFromJson(bad), ML::Exception);
+
+    // Services that don't advertise tokens are left out
+    map<string, Json::Value> registrations = {
+        { "pal-0", PostAuctionRing::toJson(PostAuctionRing::makeTokens("pal-0")) },
+        { "pal-1", plain },
+        { "pal-2", PostAuctionRing::toJson(PostAuctionRing::makeTokens("pal-2")) }
+    };
+
+    auto ring = PostAuctionRing::fromRegistrations(registrations);
+    BOOST_CHECK(ring.services() == vector<string>({ "pal-0", "pal-2" }));
+
+    // The same registrations give the same ring
+    auto expected = makeRing(3);
+    expected.remove("pal-1");
+    BOOST_CHECK(owners(ring, Auctions) == owners(expected, Auctions));
+
+    BOOST_CHECK(PostAuctionRing::fromRegistrations({}).empty());
+}
+
+/** Mirrors what the proxies do: watch the registrations of the post auction
+    services and rebuild the ring whenever they change.
+*/
+BOOST_AUTO_TEST_CASE( test_ring_membership )
+{
+    auto config = std::make_shared<InternalConfigurationService>();
+    const string path = "serviceClass/rtbPostAuctionService";
+
+    PostAuctionRing ring;
+    size_t changes = 0;
+
+    ConfigurationService::Watch watch;
+    std::function<void ()> update = [&] {
+        map<string, Json::Value> registrations;
+        for (const auto & child : config->getChildren(path, watch))
+            registrations[child] = config->getJson(path + "/" + child);
+        ring = PostAuctionRing::fromRegistrations(registrations);
+    };
+
+    watch.init([&] (const std::string &, ConfigurationService::ChangeType) {
+                ++changes;
+                update();
+            });
+
+    auto join = [&] (const string & name) {
+        config->setUnique(path + "/" + name,
+                          PostAuctionRing::toJson(PostAuctionRing::makeTokens(name)));
+    };
+
+    join("pal-0");
+    update();
+    BOOST_CHECK(ring.services() == vector<string>({ "pal-0" }));
+
+    join("pal-1");
+    join("pal-2");
+    BOOST_CHECK_EQUAL(changes, 2);
+    BOOST_CHECK(ring.services() == vector<string>({ "pal-0", "pal-1", "pal-2" }));
+    BOOST_CHECK(owners(ring, Auctions) == owners(makeRing(3), Auctions));
+
+    config->removePath(path + "/pal-1");
+    BOOST_CHECK_EQUAL(changes, 3);
+    BOOST_CHECK(ring.services() == vector<string>({ "pal-0", "pal-2" }));
+
+    // Changing a registration isn't a membership change
+    config->set(path + "/pal-2", PostAuctionRing::toJson(PostAuctionRing::makeTokens("pal-2")));
+    BOOST_CHECK_EQUAL(changes, 3);
+}
+
+/** A service that shares its name with another one gets registered under a
+    unique key and must remove that key, not the other one's, when it leaves.
+*/
+BOOST_AUTO_TEST_CASE( test_ring_unregister )
+{
+    auto proxies = std::make_shared<ServiceProxies>();
+    auto config = std::make_shared<InternalConfigurationService>();
+    proxies->config = config;
+
+    const string path = "serviceClass/rtbPostAuctionService";
+    auto tokens = PostAuctionRing::toJson(PostAuctionRing::makeTokens("pal-0"));
+
+    ServiceBase first("pal-0", proxies);
+    ServiceBase second("pal-0", proxies);
+
+    first.registerShardedServiceProvider("pal-0", { "rtbPostAuctionService" }, 0, tokens);
+    second.registerShardedServiceProvider("pal-0", { "rtbPostAuctionService" }, 0, tokens);
+
+    auto children = config->getChildren(path);
+    BOOST_REQUIRE_EQUAL(children.size(), 2);
+
+    second.unregisterServiceProvider("pal-0", { "rtbPostAuctionService" });
+    BOOST_CHECK(config->getChildren(path) == vector<string>({ "pal-0" }));
+
+    // Already gone
+    second.unregisterServiceProvider("pal-0", { "rtbPostAuctionService" });
+    BOOST_CHECK(config->getChildren(path) == vector<string>({ "pal-0" }));
+
+    first.unregisterServiceProvider("pal-0", { "rtbPostAuctionService" });
+    BOOST_CHECK(config->getChildren(path).empty());
+}
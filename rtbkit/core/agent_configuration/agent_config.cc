@@ -8,6 +8,7 @@
 #include "jml/arch/exception.h"
 #include "jml/utils/string_functions.h"
 #include <boost/lexical_cast.hpp>
+#include <algorithm>
 #include "rtbkit/common/auction.h"
 #include "rtbkit/core/router/router_types.h"
 #include "rtbkit/common/exchange_connector.h"
@@ -448,6 +449,7 @@ AgentConfig(std::string name)
       winFormat(BRF_FULL),
       lossFormat(BRF_LIGHTWEIGHT),
       errorFormat(BRF_LIGHTWEIGHT),
+      bidRequestFormat("json"),
       name(name)
 {
     addAugmentation("random");
@@ -781,6 +783,26 @@ createFromJson(const Json::Value & json)
         else if (it.memberName() == "errorFormat") {
             RTBKIT::fromJson(newConfig.errorFormat, *it);
         }
+        else if (it.memberName() == "bidRequestFormat") {
+            string s = lowercase(it->asString());
+            if (s != "json" && s != "projected" && s != "binary")
+                throw Exception("unknown bidRequestFormat " + s + ": accepted "
+                                "json, projected, binary");
+            newConfig.bidRequestFormat = s;
+        }
+        else if (it.memberName() == "bidRequestFields") {
+            static const Datacratic::DefaultDescription<BidRequest> desc;
+            newConfig.bidRequestFields.clear();
+            for (const auto & field: *it) {
+                string fieldName = field.asString();
+                desc.getField(fieldName);  // throws if there is no such field
+                newConfig.bidRequestFields.push_back(fieldName);
+            }
+            auto & fields = newConfig.bidRequestFields;
+            std::sort(fields.begin(), fields.end());
+            fields.erase(std::unique(fields.begin(), fields.end()),
+                         fields.end());
+        }
         else if (it.memberName() == "ext") {
             newConfig.ext = *it;
         }
@@ -930,6 +952,9 @@ toJson(bool includeCreatives) const
     result["winFormat"] = RTBKIT::toJson(winFormat);
     result["lossFormat"] = RTBKIT::toJson(lossFormat);
     result["errorFormat"] = RTBKIT::toJson(errorFormat);
+    result["bidRequestFormat"] = bidRequestFormat;
+    for (unsigned i = 0;  i < bidRequestFields.size();  ++i)
+        result["bidRequestFields"][i] = bidRequestFields[i];
 
     for (const auto& extension: extensions.list()) {
         result[extension->extensionName()] = extension->toJson();
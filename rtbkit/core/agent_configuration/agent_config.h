@@ -427,6 +427,18 @@ struct AgentConfig {
 
     /** Message formats */
     BidResultFormat winFormat, lossFormat, errorFormat;
+
+    /** Encoding of the bid requests sent to the agent: "json" for the
+        request as received from the exchange, "projected" for the
+        canonical JSON restricted to bidRequestFields (all of them if
+        empty) and "binary" for BidRequest::serializeToString().
+    */
+    std::string bidRequestFormat;
+
+    /** Top level canonical fields sent with the "projected" format, sorted.
+        The id is always sent.
+    */
+    std::vector<std::string> bidRequestFields;
     //
     Json::Value ext;
 
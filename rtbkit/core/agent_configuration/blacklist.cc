@@ -107,6 +107,7 @@ doExpiries()
             return info.expire(start);
         };
 
+    std::lock_guard<ML::Spinlock> guard(lock);
     entries.expire(onBlacklistFinished, start);
 }
 
@@ -115,10 +116,11 @@ Blacklist::
 matches(const BidRequest & bidRequest, const std::string & agentName,
         const AgentConfig & config) const
 {  
+    std::lock_guard<ML::Spinlock> guard(lock);
+
     bool blocked = false;
     const Id & exchangeId = bidRequest.userIds.exchangeId;
     if (!blocked && exchangeId) {
-        // TODO: read lock
         auto bit = entries.find(exchangeId);
         if (bit != entries.end()) {
             const BlacklistInfo & binfo = bit->second;
@@ -128,7 +130,6 @@ matches(const BidRequest & bidRequest, const std::string & agentName,
     }
     const Id & providerId = bidRequest.userIds.providerId;
     if (!blocked && providerId) {
-        // TODO: read lock
         auto bit = entries.find(providerId);
         if (bit != entries.end()) {
             const BlacklistInfo & binfo = bit->second;
@@ -163,6 +164,7 @@ add(const BidRequest & bidRequest, const std::string & agent,
             }
         };
     
+    std::lock_guard<ML::Spinlock> guard(lock);
     addToBlacklist(bidRequest.userIds.exchangeId);
     addToBlacklist(bidRequest.userIds.providerId);
 }
@@ -13,6 +13,8 @@
 #include "rtbkit/common/bid_request.h"
 #include "rtbkit/core/router/router_types.h"
 #include "soa/service/timeout_map.h"
+#include "jml/arch/spinlock.h"
+#include <mutex>
 
 
 namespace RTBKIT {
@@ -61,11 +63,17 @@ struct BlacklistInfo {
 /* BLACKLIST                                                                 */
 /*****************************************************************************/
 
-/** Indexed on user ID */
+/** Indexed on user ID.  Safe to use from multiple threads as the router
+    shards all share the same blacklist.
+*/
 struct Blacklist {
     void doExpiries();
 
-    size_t size() const { return entries.size(); }
+    size_t size() const
+    {
+        std::lock_guard<ML::Spinlock> guard(lock);
+        return entries.size();
+    }
     
     bool matches(const BidRequest & request,
                  const std::string & agentName,
@@ -77,6 +85,8 @@ struct Blacklist {
     
     typedef TimeoutMap<Id, BlacklistInfo> Entries;
     Entries entries;
+
+    mutable ML::Spinlock lock;
 };
 
 } // namespace RTBKIT
@@ -15,6 +15,7 @@
 #include <boost/regex.hpp>
 #include <boost/regex/icu.hpp>
 #include "soa/types/string.h"
+#include "city.h"
 #include <vector>
 #include <set>
 #include <iostream>
@@ -108,16 +109,25 @@ struct JsonPrint {
     }
 };
 
+/** Hash of the bytes of a string, for the strings that can be hashed in
+    place without being copied into a std::string first.  The std::string
+    and Utf8String versions give the same hash for the same bytes.
+*/
+inline uint64_t hashString(const char * data, size_t length)
+{
+    return CityHash64(data, length);
+}
+
 inline uint64_t hashString(const std::string & str)
 {
-    uint64_t res = std::hash<std::string>()(str);
+    uint64_t res = hashString(str.data(), str.size());
     //cerr << "hashString of " << str << " returned " << res << endl;
     return res;
 }
 
 inline uint64_t hashString(const Utf8String & str)
 {
-    return std::hash<std::string>()(std::string(str.rawData(), str.rawLength()));
+    return hashString(str.rawData(), str.rawLength());
 }
 
 
@@ -0,0 +1,125 @@
+/* auction_filter.h                                 -*- C++ -*-
+   Copyright (c) 2014 Datacratic.  All rights reserved.
+
+   Approximate membership filter of the auctions tracked by a matcher.
+*/
+
+#pragma once
+
+#include "soa/types/id.h"
+#include "jml/arch/exception.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace RTBKIT {
+
+/******************************************************************************/
+/* AUCTION FILTER                                                             */
+/******************************************************************************/
+
+/** Blocked counting Bloom filter of auction ids.
+
+    Tells cheaply whether an auction is definitely not tracked: if
+    mayContain() returns false then no entry with that auction id was
+    inserted and not yet erased.  It can return true for an auction that
+    isn't tracked though; the lookup then goes to the maps as usual.
+
+    Each auction id maps to a single 64 byte block, so a probe touches one
+    cache line, and sets Probes 4-bit counters within it.  Counters are
+    decremented as entries go away so the filter ages along with the maps
+    it fronts.  A counter that saturates stays saturated, which can only
+    cause false positives.
+
+    Insertions and erasures must mirror those of the maps exactly: one
+    insert() per entry added and one erase() per entry removed.  Should
+    they drift apart anyway, a counter that erase() finds at zero is
+    saturated rather than underflowed so that the damage is limited to
+    false positives instead of taking down the event loop.
+*/
+
+struct AuctionFilter
+{
+    enum {
+        BlockSize = 64,             ///< Bytes in a block, a cache line
+        Counters = BlockSize * 2,   ///< 4-bit counters in a block
+        Probes = 4,                 ///< Counters set per auction id
+        DefaultBlocks = 1 << 16     ///< 4MB, ~2.5% false positives at 1M entries
+    };
+
+    AuctionFilter(size_t numBlocks = DefaultBlocks) :
+        mask(numBlocks - 1), storage(numBlocks * BlockSize + BlockSize - 1)
+    {
+        if (!numBlocks || (numBlocks & mask))
+            throw ML::Exception("filter size must be a power of two");
+
+        uintptr_t start = reinterpret_cast<uintptr_t>(storage.data());
+        blocks = reinterpret_cast<uint8_t *>(
+                (start + BlockSize - 1) & ~uintptr_t(BlockSize - 1));
+    }
+
+    // The blocks point within storage
+    AuctionFilter(const AuctionFilter &) = delete;
+    AuctionFilter & operator = (const AuctionFilter &) = delete;
+
+    void insert(const Datacratic::Id & auctionId)
+    {
+        uint64_t h = auctionId.mixedHash();
+        uint8_t * block = blocks + (h & mask) * BlockSize;
+
+        for (unsigned i = 0; i < Probes; ++i) {
+            unsigned counter = probe(h, i);
+            unsigned value = get(block, counter);
+            if (value < 15) set(block, counter, value + 1);
+        }
+    }
+
+    void erase(const Datacratic::Id & auctionId)
+    {
+        uint64_t h = auctionId.mixedHash();
+        uint8_t * block = blocks + (h & mask) * BlockSize;
+
+        for (unsigned i = 0; i < Probes; ++i) {
+            unsigned counter = probe(h, i);
+            unsigned value = get(block, counter);
+            if (value == 0) set(block, counter, 15);
+            else if (value < 15) set(block, counter, value - 1);
+        }
+    }
+
+    bool mayContain(const Datacratic::Id & auctionId) const
+    {
+        uint64_t h = auctionId.mixedHash();
+        const uint8_t * block = blocks + (h & mask) * BlockSize;
+
+        for (unsigned i = 0; i < Probes; ++i)
+            if (!get(block, probe(h, i))) return false;
+        return true;
+    }
+
+private:
+
+    /** Counters are taken from the high bits, away from the block index. */
+    static unsigned probe(uint64_t h, unsigned i)
+    {
+        return (h >> (64 - 7 * (i + 1))) & (Counters - 1);
+    }
+
+    static unsigned get(const uint8_t * block, unsigned counter)
+    {
+        return (block[counter / 2] >> (4 * (counter & 1))) & 0xf;
+    }
+
+    static void set(uint8_t * block, unsigned counter, unsigned value)
+    {
+        uint8_t & byte = block[counter / 2];
+        unsigned shift = 4 * (counter & 1);
+        byte = (byte & ~(0xf << shift)) | (value << shift);
+    }
+
+    uint64_t mask;
+    std::vector<uint8_t> storage;
+    uint8_t * blocks;              ///< storage aligned on a cache line
+};
+
+} // namespace RTBKIT
@@ -123,7 +123,7 @@ private:
 
     void sendAuction(std::shared_ptr<SubmittedAuctionEvent> auction)
     {
-        send("auctions", *auction);
+        send("auctions", auction->toJsonEvent());
     }
 
     void sendEvent(std::shared_ptr<PostAuctionEvent> event)
@@ -34,13 +34,15 @@ struct EventMatcher : public EventRecorder
     EventMatcher(std::string prefix, std::shared_ptr<EventService> events) :
         EventRecorder(prefix, std::move(events)),
         auctionTimeout(DefaultAuctionTimeout),
-        winTimeout(DefaultWinTimeout)
+        winTimeout(DefaultWinTimeout),
+        compressSubmissions(false)
     {}
 
     EventMatcher(std::string prefix, std::shared_ptr<ServiceProxies> proxies) :
         EventRecorder(prefix, std::move(proxies)),
         auctionTimeout(DefaultAuctionTimeout),
-        winTimeout(DefaultWinTimeout)
+        winTimeout(DefaultWinTimeout),
+        compressSubmissions(false)
     {}
 
     virtual void start() {}
@@ -91,6 +93,14 @@ struct EventMatcher : public EventRecorder
         auctionTimeout = timeout;
     }
 
+    /** Compress the bid requests kept for the submitted auctions.  See
+        SubmissionInfo::setBidRequest().
+    */
+    virtual void setCompressSubmissions(bool compress)
+    {
+        compressSubmissions = compress;
+    }
+
 
     /************************************************************************/
     /* EVENT MATCHING                                                       */
@@ -112,6 +122,12 @@ struct EventMatcher : public EventRecorder
 
     virtual void initStatePersistence(const std::string & path) {}
 
+    /** Move the finished auctions that are still around after spillAfter
+        seconds out of memory to a leveldb database under path.  See
+        FinishedStore.
+    */
+    virtual void setFinishedSpill(const std::string & path, double spillAfter) {}
+
 
 protected:
 
@@ -145,6 +161,7 @@ protected:
 
     float auctionTimeout;
     float winTimeout;
+    bool compressSubmissions;
 
     std::shared_ptr<Banker> banker;
 
@@ -100,4 +100,36 @@ reconstitute(DB::Store_Reader & store)
 
 IMPL_SERIALIZE_RECONSTITUTE(FinishedInfo::Visit);
 
+void
+FinishedInfo::
+serialize(DB::Store_Writer & store) const
+{
+    unsigned char version = 1;
+    store << version << auctionTime << auctionId << adSpotId << spotIndex
+          << bidRequestStr << bidRequestStrFormat << augmentations << uids
+          << visitChannels << bidTime << bid << winTime
+          << (int)reportedStatus << winPrice << rawWinPrice << winMeta
+          << static_cast<const vector<CampaignEvent> &>(campaignEvents)
+          << visits << fromOldRouter;
+}
+
+void
+FinishedInfo::
+reconstitute(DB::Store_Reader & store)
+{
+    unsigned char version;
+    store >> version;
+    if (version != 1)
+        throw ML::Exception("invalid version");
+
+    int status;
+    store >> auctionTime >> auctionId >> adSpotId >> spotIndex
+          >> bidRequestStr >> bidRequestStrFormat >> augmentations >> uids
+          >> visitChannels >> bidTime >> bid >> winTime
+          >> status >> winPrice >> rawWinPrice >> winMeta
+          >> static_cast<vector<CampaignEvent> &>(campaignEvents)
+          >> visits >> fromOldRouter;
+    reportedStatus = (BidStatus)status;
+}
+
 } // namepsace RTBKIT
@@ -128,7 +128,12 @@ struct FinishedInfo {
     Json::Value toJson() const;
 
     bool fromOldRouter;
+
+    void serialize(ML::DB::Store_Writer & store) const;
+    void reconstitute(ML::DB::Store_Reader & store);
 };
 
+IMPL_SERIALIZE_RECONSTITUTE(FinishedInfo);
+
 
 } // namespace RTBKIT
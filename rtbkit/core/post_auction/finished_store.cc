@@ -0,0 +1,211 @@
+/** finished_store.cc                                 -*- C++ -*-
+    Copyright (c) 2014 Datacratic.  All rights reserved.
+
+    Implementation of the finished auction storage.
+
+*/
+
+#include "finished_store.h"
+#include "jml/db/persistent.h"
+#include "jml/arch/exception.h"
+#include "leveldb/db.h"
+#include "leveldb/write_batch.h"
+
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <sstream>
+
+using namespace std;
+using namespace Datacratic;
+using namespace ML;
+
+namespace RTBKIT {
+
+/******************************************************************************/
+/* FINISHED STORE                                                             */
+/******************************************************************************/
+
+FinishedStore::
+FinishedStore() :
+    spillAfter(0.0)
+{}
+
+FinishedStore::
+~FinishedStore()
+{}
+
+void
+FinishedStore::
+spillTo(const std::string & path, double spillAfter)
+{
+    if (size())
+        throw ML::Exception("can't start spilling a non-empty store");
+    if (spillAfter <= 0.0)
+        throw ML::Exception("invalid delay before spilling finished auctions");
+
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(path, ec);
+    if (ec)
+        throw ML::Exception("creating " + path + ": " + ec.message());
+
+    leveldb::Options options;
+    options.create_if_missing = true;
+
+    leveldb::Status status = leveldb::DestroyDB(path, options);
+    if (!status.ok())
+        throw ML::Exception("Destroying leveldb: " + status.ToString());
+
+    leveldb::DB * newDb;
+    status = leveldb::DB::Open(options, path, &newDb);
+    if (!status.ok())
+        throw ML::Exception("Opening leveldb: " + status.ToString());
+
+    db.reset(newDb);
+    this->spillAfter = spillAfter;
+}
+
+/** Keys start with the expiry in big-endian microseconds so that they're
+    ordered by expiry, and with it the sweeps only ever touch the front of
+    the database.
+*/
+std::string
+FinishedStore::
+expiryPrefix(Date expiry)
+{
+    uint64_t micros = std::max(expiry.secondsSinceEpoch(), 0.0) * 1000000.0;
+
+    std::string result(8, '\0');
+    for (int i = 7; i >= 0; --i, micros >>= 8)
+        result[i] = micros & 0xff;
+    return result;
+}
+
+std::string
+FinishedStore::
+diskKey(Date expiry, const Key & key)
+{
+    std::ostringstream stream;
+    {
+        DB::Store_Writer store(stream);
+        store << key.first << key.second;
+    }
+
+    return expiryPrefix(expiry) + stream.str();
+}
+
+FinishedStore::Key
+FinishedStore::
+parseDiskKey(const std::string & str)
+{
+    if (str.size() < 8)
+        throw ML::Exception("invalid finished store key");
+
+    std::istringstream stream(str.substr(8));
+    DB::Store_Reader store(stream);
+
+    Key key;
+    store >> key.first >> key.second;
+    return key;
+}
+
+FinishedInfo
+FinishedStore::
+get(const Key & key) const
+{
+    if (memory.count(key))
+        return memory.get(key).info;
+
+    auto it = disk.find(key);
+    ExcCheck(it != disk.end(), "key not present in the finished store.");
+
+    std::string value;
+    leveldb::Status status =
+        db->Get(leveldb::ReadOptions(), diskKey(it->second, key), &value);
+    if (!status.ok())
+        throw ML::Exception("Reading from leveldb: " + status.ToString());
+
+    return DB::reconstituteFromString<FinishedInfo>(value);
+}
+
+void
+FinishedStore::
+set(const Key & key, FinishedInfo info)
+{
+    if (memory.count(key)) {
+        memory.get(key).info = std::move(info);
+        return;
+    }
+
+    auto it = disk.find(key);
+    ExcCheck(it != disk.end(), "key not present in the finished store.");
+
+    leveldb::Status status = db->Put(
+            leveldb::WriteOptions(),
+            diskKey(it->second, key), DB::serializeToString(info));
+    if (!status.ok())
+        throw ML::Exception("Writing to leveldb: " + status.ToString());
+}
+
+bool
+FinishedStore::
+emplace(Key key, FinishedInfo info, Date expiry)
+{
+    if (disk.count(key)) return false;
+
+    Date timeout = expiry;
+    if (db) timeout = std::min(expiry, Date::now().plusSeconds(spillAfter));
+
+    return memory.emplace(
+            std::move(key), Entry{ std::move(info), expiry }, timeout);
+}
+
+size_t
+FinishedStore::
+expire(const std::function<void(const Key &)> & fn, Date now)
+{
+    size_t expired = 0;
+    leveldb::WriteBatch batch;
+
+    memory.expire([&] (const Key & key, const Entry & entry) {
+                if (entry.expiry <= now) {
+                    fn(key);
+                    ++expired;
+                    return;
+                }
+
+                batch.Put(diskKey(entry.expiry, key),
+                          DB::serializeToString(entry.info));
+                disk[key] = entry.expiry;
+            }, now);
+
+    if (!db) return expired;
+
+    // leveldb doesn't do range deletes so we walk the expired range to
+    // batch the deletion of its keys.  The values are never decoded.
+    std::string limit = expiryPrefix(now);
+
+    std::unique_ptr<leveldb::Iterator> it(db->NewIterator(leveldb::ReadOptions()));
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        if (it->key().compare(limit) >= 0) break;
+
+        std::string str = it->key().ToString();
+        Key key = parseDiskKey(str);
+
+        batch.Delete(str);
+        disk.erase(key);
+
+        fn(key);
+        ++expired;
+    }
+
+    if (!it->status().ok())
+        throw ML::Exception("Scanning leveldb: " + it->status().ToString());
+
+    leveldb::Status status = db->Write(leveldb::WriteOptions(), &batch);
+    if (!status.ok())
+        throw ML::Exception("Writing to leveldb: " + status.ToString());
+
+    return expired;
+}
+
+} // namespace RTBKIT
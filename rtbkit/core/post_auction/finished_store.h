@@ -0,0 +1,133 @@
+/** finished_store.h                                 -*- C++ -*-
+    Copyright (c) 2014 Datacratic.  All rights reserved.
+
+    Two-tier storage of the finished auctions.
+
+*/
+
+#pragma once
+
+#include "timeout_map.h"
+#include "finished_info.h"
+#include "soa/types/id.h"
+
+#include <unordered_map>
+#include <functional>
+#include <memory>
+#include <utility>
+
+/******************************************************************************/
+/* HASH                                                                       */
+/******************************************************************************/
+
+namespace std {
+
+template<>
+struct hash< std::pair<Datacratic::Id, Datacratic::Id> >
+{
+    size_t operator() (const std::pair<Datacratic::Id, Datacratic::Id>&) const;
+};
+
+} // namespace std
+
+
+namespace leveldb {
+
+class DB;
+
+} // namespace leveldb
+
+namespace RTBKIT {
+
+/******************************************************************************/
+/* FINISHED STORE                                                             */
+/******************************************************************************/
+
+/** Keeps the finished auctions until they expire.
+
+    Finished auctions are kept around for a long while (up to the win
+    timeout) in case a campaign event comes in, but the odds of one coming
+    in fall quickly once the auction is done.  So when spilling is enabled,
+    the entries still around spillAfter seconds after being inserted are
+    moved out of memory to a leveldb database where they are keyed by their
+    expiry time.  Lookups fall through to the database and expiring the
+    spilled entries is a sweep of the front of its key space.
+
+    Only the key and the expiry of the spilled entries are kept in memory,
+    which is what allows count() to answer without going to disk.  The
+    database only lives as long as the store: whatever was in it when the
+    store is opened is discarded.
+
+    Entries are returned by value since they may have been read from disk;
+    changes have to be written back with set().
+*/
+
+struct FinishedStore
+{
+    typedef std::pair<Id, Id> Key;
+
+    FinishedStore();
+    ~FinishedStore();
+
+    /** Move the entries older than spillAfter seconds to a leveldb database
+        created at path.  Must be called before anything is inserted.
+    */
+    void spillTo(const std::string & path, double spillAfter);
+
+    bool spilling() const { return !!db; }
+
+    size_t size() const { return memory.size() + disk.size(); }
+    size_t memorySize() const { return memory.size(); }
+    size_t diskSize() const { return disk.size(); }
+
+    bool count(const Key & key) const
+    {
+        return memory.count(key) || disk.count(key);
+    }
+
+    /** Return the entry with the given key, which must be present. */
+    FinishedInfo get(const Key & key) const;
+
+    /** Replace the entry with the given key, which must be present.  Its
+        expiry is left untouched.
+    */
+    void set(const Key & key, FinishedInfo info);
+
+    /** Insert an entry that expires at the given time.  Returns false if
+        there's already an entry with that key.
+    */
+    bool emplace(Key key, FinishedInfo info, Datacratic::Date expiry);
+
+    /** Remove the entries that expired before now, calling fn with the key
+        of each one of them, and spill the entries that are due to.  The
+        entries that expire from disk aren't read back.  Returns the number
+        of entries that expired.
+    */
+    size_t expire(const std::function<void(const Key &)> & fn,
+                  Datacratic::Date now = Datacratic::Date::now());
+
+private:
+
+    struct Entry
+    {
+        FinishedInfo info;
+        Datacratic::Date expiry;
+    };
+
+    /** Entries in memory, which time out when they expire or when they're
+        due to be spilled, whichever comes first.
+    */
+    TimeoutMap<Key, Entry> memory;
+
+    /** Expiry of each of the spilled entries. */
+    std::unordered_map<Key, Datacratic::Date> disk;
+
+    std::unique_ptr<leveldb::DB> db;
+    double spillAfter;
+
+    static std::string expiryPrefix(Datacratic::Date expiry);
+    static std::string diskKey(Datacratic::Date expiry, const Key & key);
+    static Key parseDiskKey(const std::string & str);
+};
+
+} // namespace RTBKIT
@@ -4,11 +4,13 @@ LIB_POST_AUCTION_SOURCES := \
         simple_event_matcher.cc \
 	sharded_event_matcher.cc \
 	events.cc \
+	submission_info.cc \
 	finished_info.cc \
+	finished_store.cc \
 	post_auction_service.cc
 
 LIB_POST_AUCTION_LINK := \
-	agent_configuration zeromq boost_thread logger opstats leveldb services banker gobanker rtb
+	agent_configuration zeromq boost_thread logger opstats leveldb services banker gobanker rtb utils boost_filesystem boost_system
 
 $(eval $(call library,post_auction,$(LIB_POST_AUCTION_SOURCES),$(LIB_POST_AUCTION_LINK)))
 
@@ -43,6 +43,9 @@ PostAuctionRunner() :
     shard(0),
     auctionTimeout(EventMatcher::DefaultAuctionTimeout),
     winTimeout(EventMatcher::DefaultWinTimeout),
+    compressSubmissions(false),
+    finishedSpillAfter(5 * 60),
+    ringTokens(0),
     bidderConfigurationFile("rtbkit/examples/bidder-config.json"),
     analyticsConfigurationFile(""),
     winLossPipeTimeout(PostAuctionService::DefaultWinLossPipeTimeout),
@@ -72,6 +75,15 @@ doOptions(int argc, char ** argv,
          "Timeout for storing win auction")
         ("auction-seconds", value<float>(&auctionTimeout),
          "Timeout to get late win auction")
+        ("compress-submissions", bool_switch(&compressSubmissions),
+         "Compress the bid requests kept while waiting for a win or loss")
+        ("finished-spill-dir", value<string>(&finishedSpillPath),
+         "Spill the older finished auctions to a leveldb database in this directory")
+        ("finished-spill-seconds", value<double>(&finishedSpillAfter),
+         "Time a finished auction stays in memory before being spilled")
+        ("ring-tokens", value<size_t>(&ringTokens),
+         "Share auctions with the other post auction loops on a consistent hash "
+         "ring with this many tokens instead of by shard index")
         ("winlossPipe-seconds", value<int>(&winLossPipeTimeout),
          "Timeout before sending error on WinLoss pipe")
         ("campaignEventPipe-seconds", value<int>(&campaignEventPipeTimeout),
@@ -127,10 +139,14 @@ init()
     postAuctionLoop = std::make_shared<PostAuctionService>(proxies, serviceName);
     postAuctionLoop->initBidderInterface(bidderConfig);
     postAuctionLoop->initAnalytics(analyticsConfig);
+    postAuctionLoop->setRingTokens(ringTokens);
     postAuctionLoop->init(shard);
 
     postAuctionLoop->setWinTimeout(winTimeout);
     postAuctionLoop->setAuctionTimeout(auctionTimeout);
+    postAuctionLoop->setCompressSubmissions(compressSubmissions);
+    if (!finishedSpillPath.empty())
+        postAuctionLoop->setFinishedSpill(finishedSpillPath, finishedSpillAfter);
     postAuctionLoop->setWinLossPipeTimeout(winLossPipeTimeout);
     postAuctionLoop->setCampaignEventPipeTimeout(campaignEventPipeTimeout);
 
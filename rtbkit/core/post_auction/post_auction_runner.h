@@ -31,6 +31,10 @@ struct PostAuctionRunner {
     size_t shard;
     float auctionTimeout;
     float winTimeout;
+    bool compressSubmissions;
+    std::string finishedSpillPath;
+    double finishedSpillAfter;
+    size_t ringTokens;
     std::string bidderConfigurationFile;
     std::string analyticsConfigurationFile;
 
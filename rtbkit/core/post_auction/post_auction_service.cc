@@ -14,6 +14,7 @@
 #include "soa/service/rest_request_params.h"
 #include "soa/service/rest_request_binding.h"
 #include "rtbkit/common/analytics.h"
+#include "rtbkit/common/post_auction_ring.h"
 
 using namespace std;
 using namespace Datacratic;
@@ -38,6 +39,9 @@ PostAuctionService(
 
       auctionTimeout(EventMatcher::DefaultAuctionTimeout),
       winTimeout(EventMatcher::DefaultWinTimeout),
+      compressSubmissions(false),
+      finishedSpillAfter(0.0),
+      ringTokens(0),
       winLossPipeTimeout(DefaultWinLossPipeTimeout),
       campaignEventPipeTimeout(DefaultCampaignEventPipeTimeout),
 
@@ -65,6 +69,9 @@ PostAuctionService(ServiceBase & parent, const std::string & serviceName)
 
       auctionTimeout(EventMatcher::DefaultAuctionTimeout),
       winTimeout(EventMatcher::DefaultWinTimeout),
+      compressSubmissions(false),
+      finishedSpillAfter(0.0),
+      ringTokens(0),
 
       loopMonitor(*this),
       configListener(getZmqContext()),
@@ -185,6 +192,9 @@ initMatcher(size_t shards)
 
     matcher->setWinTimeout(winTimeout);
     matcher->setAuctionTimeout(auctionTimeout);
+    matcher->setCompressSubmissions(compressSubmissions);
+    if (!finishedSpillPath.empty())
+        matcher->setFinishedSpill(finishedSpillPath, finishedSpillAfter);
 }
 
 
@@ -195,7 +205,13 @@ initConnections(size_t shard)
     using std::placeholders::_1;
     using std::placeholders::_2;
 
-    registerShardedServiceProvider(serviceName(), { "rtbPostAuctionService" }, shard);
+    Json::Value attributes;
+    if (ringTokens)
+        attributes = PostAuctionRing::toJson(
+                PostAuctionRing::makeTokens(serviceName(), ringTokens));
+
+    registerShardedServiceProvider(
+            serviceName(), { "rtbPostAuctionService" }, shard, attributes);
 
     if (analytics) {
         LOG(print) << "post auction logger on " << analytics->serviceName() << endl;
@@ -335,6 +351,9 @@ void
 PostAuctionService::
 shutdown()
 {
+    // Lets the proxies move our share of the auctions before we go away.
+    unregisterServiceProvider(serviceName(), { "rtbPostAuctionService" });
+
     matcher->shutdown();
     loopMonitor.shutdown();
     loop.shutdown();
@@ -104,6 +104,33 @@ struct PostAuctionService : public ServiceBase, public MonitorProvider
         if (matcher) matcher->setAuctionTimeout(timeout);
     }
 
+    void setCompressSubmissions(bool compress)
+    {
+        compressSubmissions = compress;
+        if (matcher) matcher->setCompressSubmissions(compress);
+    }
+
+    /** Spill the finished auctions still around after spillAfter seconds to
+        a leveldb database under path.  Must be set before any auction is
+        matched.
+    */
+    void setFinishedSpill(const std::string & path, double spillAfter)
+    {
+        finishedSpillPath = path;
+        finishedSpillAfter = spillAfter;
+        if (matcher) matcher->setFinishedSpill(path, spillAfter);
+    }
+
+    /** Place this service on the consistent hash ring of the post auction
+        services with the given number of tokens, which sets its share of
+        the auctions relative to the others.  0 keeps it out of the ring.
+        Must be called before init().
+    */
+    void setRingTokens(size_t tokens)
+    {
+        ringTokens = tokens;
+    }
+
     void setWinLossPipeTimeout(int timeout)
     {
         if (timeout < 0)
@@ -272,6 +299,10 @@ private:
 
     float auctionTimeout;
     float winTimeout;
+    bool compressSubmissions;
+    std::string finishedSpillPath;
+    double finishedSpillAfter;
+    size_t ringTokens;
 
     int winLossPipeTimeout;
     int campaignEventPipeTimeout;
@@ -68,6 +68,11 @@ init(size_t numShards)
 
     shards.reserve(numShards);
 
+    matchedWinLossEvents.setMaxProducers(numShards);
+    matchedCampaignEvents.setMaxProducers(numShards);
+    unmatchedEvents.setMaxProducers(numShards);
+    errorEvents.setMaxProducers(numShards);
+
     for (size_t i = 0; i < numShards; ++i) {
         Shard* shard = events_ ?
             new Shard(eventPrefix_, events_) :
@@ -167,6 +172,23 @@ setAuctionTimeout(float timeout)
     for (auto& shard : shards) shard->matcher.setAuctionTimeout(timeout);
 }
 
+void
+ShardedEventMatcher::
+setCompressSubmissions(bool compress)
+{
+    for (auto& shard : shards) shard->matcher.setCompressSubmissions(compress);
+}
+
+void
+ShardedEventMatcher::
+setFinishedSpill(const std::string & path, double spillAfter)
+{
+    for (size_t i = 0; i < shards.size(); ++i) {
+        std::string shardPath = path + "/" + std::to_string(i);
+        shards[i]->matcher.setFinishedSpill(shardPath, spillAfter);
+    }
+}
+
 
 void
 ShardedEventMatcher::
@@ -35,6 +35,8 @@ struct ShardedEventMatcher : public EventMatcher, public MessageLoop
     virtual void setBanker(const std::shared_ptr<Banker> & newBanker);
     virtual void setWinTimeout(float timeout);
     virtual void setAuctionTimeout(float timeout);
+    virtual void setCompressSubmissions(bool compress);
+    virtual void setFinishedSpill(const std::string & path, double spillAfter);
 
 
     /************************************************************************/
@@ -59,17 +61,20 @@ private:
         void init(size_t shard, ShardedEventMatcher* parent);
 
         SimpleEventMatcher matcher;
-        TypedMessageSink<std::shared_ptr<SubmittedAuctionEvent> > auctions;
-        TypedMessageSink<std::shared_ptr<PostAuctionEvent> > events;
+        TypedMessageBatchSink<std::shared_ptr<SubmittedAuctionEvent> > auctions;
+        TypedMessageBatchSink<std::shared_ptr<PostAuctionEvent> > events;
     };
 
     std::vector< std::unique_ptr<Shard> > shards;
     Shard& shard(const Id& auctionId);
 
-    TypedMessageSink<std::shared_ptr<MatchedWinLoss> > matchedWinLossEvents;
-    TypedMessageSink<std::shared_ptr<MatchedCampaignEvent> > matchedCampaignEvents;
-    TypedMessageSink<std::shared_ptr<UnmatchedEvent> > unmatchedEvents;
-    TypedMessageSink<std::shared_ptr<PostAuctionErrorEvent> > errorEvents;
+    /** Each shard gets its own lane in these so the results come back
+        without contention between the shards.
+    */
+    TypedMessageBatchSink<std::shared_ptr<MatchedWinLoss> > matchedWinLossEvents;
+    TypedMessageBatchSink<std::shared_ptr<MatchedCampaignEvent> > matchedCampaignEvents;
+    TypedMessageBatchSink<std::shared_ptr<UnmatchedEvent> > unmatchedEvents;
+    TypedMessageBatchSink<std::shared_ptr<PostAuctionErrorEvent> > errorEvents;
 
     static Logging::Category print;
     static Logging::Category error;
@@ -39,9 +39,9 @@ namespace RTBKIT {
 
 namespace {
 
-template<typename Value>
+template<typename Map, typename Value>
 bool findAuction(
-        TimeoutMap<pair<Id,Id>, Value> & pending,
+        Map & pending,
         const std::unordered_map<Id, Id>& spotIdMap,
         const Id & auctionId, Id & adSpotId, Value & val)
 {
@@ -97,10 +97,11 @@ expireSubmitted(Date start, const pair<Id, Id> & key, const SubmissionInfo & inf
 
     // Just making sure it doesn't leak if doBidResult throws.
     spotIdMap.erase(key.first);
+    liveAuctions.erase(key.first);
 
     recordHit("submittedAuctionExpiry");
 
-    if (!info.bidRequest) {
+    if (!info.hasBidRequest()) {
         recordHit("submittedAuctionExpiryWithoutBid");
 
         for(const auto& event : info.pendingWinEvents)
@@ -130,14 +131,14 @@ expireSubmitted(Date start, const pair<Id, Id> & key, const SubmissionInfo & inf
 }
 
 
-Date
+void
 SimpleEventMatcher::
-expireFinished(const pair<Id, Id> & key, const FinishedInfo & info)
+expireFinished(const pair<Id, Id> & key)
 {
     spotIdMap.erase(key.first);
+    liveAuctions.erase(key.first);
 
     recordHit("finishedAuctionExpiry");
-    return Date();
 }
 
 void
@@ -155,8 +156,10 @@ checkExpiredAuctions()
             now);
 
     recordLevel(finished.size(), "finishedSize");
+    if (finished.spilling())
+        recordLevel(finished.diskSize(), "finishedSpilledSize");
     finished.expire(
-            std::bind(&SimpleEventMatcher::expireFinished, this, _1, _2),
+            std::bind(&SimpleEventMatcher::expireFinished, this, _1),
             now);
 
     banker->logBidEvents(*this);
@@ -164,6 +167,14 @@ checkExpiredAuctions()
 
 
 
+void
+SimpleEventMatcher::
+setFinishedSpill(const std::string & path, double spillAfter)
+{
+    finished.spillTo(path, spillAfter);
+}
+
+
 void
 SimpleEventMatcher::
 doEvent(std::shared_ptr<PostAuctionEvent> event)
@@ -177,7 +188,12 @@ doEvent(std::shared_ptr<PostAuctionEvent> event)
             doWinLoss(std::move(event), false);
             break;
         case PAE_CAMPAIGN_EVENT:
-            doCampaignEvent(std::move(event));
+            if (liveAuctions.mayContain(event->auctionId))
+                doCampaignEvent(std::move(event));
+            else {
+                recordHit("delivery.EVENT.%s.messagesReceived", event->label);
+                recordHit("delivery.%s.auctionNotFound", event->label);
+            }
             break;
         default:
             THROW(error) << "postAuctionLoop.unknownEventType"
@@ -209,18 +225,19 @@ doAuction(std::shared_ptr<SubmittedAuctionEvent> event)
         if (submitted.count(key)) {
             submission = submitted.pop(key);
             spotIdMap.erase(key.first);
+            liveAuctions.erase(key.first);
 
             pendingWinEvents.swap(submission.pendingWinEvents);
             recordHit("auctionAlreadySubmitted");
         }
 
-        submission.bidRequest = event->bidRequest();
-        submission.bidRequestStrFormat = std::move(event->bidRequestStrFormat);
+        submission.setBidRequest(*event, compressSubmissions);
         submission.augmentations = std::move(event->augmentations);
         submission.bid = std::move(event->bidResponse);
 
         submitted.emplace(key, submission, lossTimeout);
         spotIdMap[key.first] = key.second;
+        liveAuctions.insert(key.first);
 
         string transId =
             makeBidId(auctionId, event->adSpotId, submission.bid.agent);
@@ -312,7 +329,7 @@ doWinLoss(std::shared_ptr<PostAuctionEvent> event, bool isReplay)
 
             info.forceWin(timestamp, price, winPrice, meta.toString());
 
-            finished.get(key) = info;
+            finished.set(key, info);
 
             doMatchedWinLoss(std::make_shared<MatchedWinLoss>(
                             MatchedWinLoss::LateWin,
@@ -350,24 +367,27 @@ doWinLoss(std::shared_ptr<PostAuctionEvent> event, bool isReplay)
         info.pendingWinEvents.push_back(event);
         submitted.emplace(key, info, Date::now().plusSeconds(auctionTimeout));
         spotIdMap[key.first] = key.second;
+        liveAuctions.insert(key.first);
 
         return;
     }
 
     SubmissionInfo info = submitted.pop(key);
     spotIdMap.erase(key.first);
+    liveAuctions.erase(key.first);
 
-    if (!info.bidRequest) {
+    if (!info.hasBidRequest()) {
         // We doubled up on a WIN without having got the auction yet
         info.pendingWinEvents.push_back(event);
         submitted.emplace(key, info, Date::now().plusSeconds(auctionTimeout));
         spotIdMap[key.first] = key.second;
+        liveAuctions.insert(key.first);
         return;
     }
 
    if(uids.empty()) {
         // If uids is empty in win message, try to get them form BR
-        uids  = info.bidRequest->userIds;
+        uids  = info.bidRequest()->userIds;
     }
 
     auto confidence = status == BS_WIN ?
@@ -466,7 +486,7 @@ doCampaignEvent(std::shared_ptr<PostAuctionEvent> event)
         // properly
         finishedInfo.addUids(uids);
 
-        finished.get(key) = finishedInfo;
+        finished.set(key, finishedInfo);
 
         doMatchedCampaignEvent(
                 std::make_shared<MatchedCampaignEvent>(label, finishedInfo));
@@ -519,7 +539,7 @@ doBidResult(
     string agent = submission.bid.agent;
 
     // Find the adspot ID
-    int adspot_num = submission.bidRequest->findAdSpotIndex(adSpotId);
+    int adspot_num = submission.spotIndex;
     if (adspot_num == -1) {
         doError("doBidResult.adSpotIdNotFound",
                 "adspot ID " + adSpotId.toString() +
@@ -580,13 +600,13 @@ doBidResult(
         auto transId = makeBidId(auctionId, adSpotId, agent);
         banker->winBid(account, transId, price, LineItems());
 
-        auto winLatency = Date::now().secondsSince(submission.bidRequest->timestamp);
+        auto winLatency = Date::now().secondsSince(submission.auctionTime);
         recordOutcome(winLatency * 1000.0, "winLatencyMs");
     }
 
     // Finally, place it in the finished queue
     FinishedInfo i;
-    i.auctionTime = submission.bidRequest->timestamp;
+    i.auctionTime = submission.auctionTime;
     i.auctionId = auctionId;
     i.adSpotId = adSpotId;
     i.spotIndex = adspot_num;
@@ -612,7 +632,8 @@ doBidResult(
         expiryInterval = auctionTimeout;
 
     Date expiryTime = Date::now().plusSeconds(expiryInterval);
-    finished.emplace(make_pair(auctionId, adSpotId), i, expiryTime);
+    if (finished.emplace(make_pair(auctionId, adSpotId), i, expiryTime))
+        liveAuctions.insert(auctionId);
     spotIdMap[auctionId] = adSpotId;
 }
 
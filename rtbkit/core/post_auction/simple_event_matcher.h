@@ -8,8 +8,9 @@
 #pragma once
 
 #include "timeout_map.h"
+#include "auction_filter.h"
 #include "event_matcher.h"
-#include "finished_info.h"
+#include "finished_store.h"
 #include "submission_info.h"
 #include "rtbkit/common/auction.h"
 // #include "soa/service/pending_list.h"
@@ -18,21 +19,6 @@
 #include <utility>
 
 
-/******************************************************************************/
-/* HASH                                                                       */
-/******************************************************************************/
-
-namespace std {
-
-template<>
-struct hash< std::pair<Datacratic::Id, Datacratic::Id> >
-{
-    size_t operator() (const std::pair<Datacratic::Id, Datacratic::Id>&) const;
-};
-
-} // namespace std
-
-
 namespace RTBKIT {
 
 /******************************************************************************/
@@ -65,6 +51,8 @@ struct SimpleEventMatcher : public EventMatcher
 
     // virtual void initStatePersistence(const std::string & path);
 
+    virtual void setFinishedSpill(const std::string & path, double spillAfter);
+
     static Logging::Category print;
     static Logging::Category error;
     static Logging::Category trace;
@@ -103,7 +91,7 @@ private:
     Date expireSubmitted(
             Date start, const std::pair<Id, Id> & key, const SubmissionInfo & info);
 
-    Date expireFinished(const std::pair<Id, Id> & key, const FinishedInfo & info);
+    void expireFinished(const std::pair<Id, Id> & key);
 
 
     /** List of auctions we're currently tracking as submitted.  Note that an
@@ -122,10 +110,10 @@ private:
         late WIN message for.
 
         We keep this list around for 5 minutes for those that were lost,
-        and one hour for those that were won.
+        and one hour for those that were won.  The older entries can be
+        spilled to disk; see setFinishedSpill().
     */
-    typedef TimeoutMap<std::pair<Id, Id>, FinishedInfo> Finished;
-    Finished finished;
+    FinishedStore finished;
 
     /** Maintains a map of auction id with the most recently seen spot id. Used
         to associate an event that doesn't have a spot id with an entry within
@@ -137,6 +125,14 @@ private:
         entry.
      */
     std::unordered_map<Id, Id> spotIdMap;
+
+    /** Auction ids of the entries of submitted and finished.  Campaign
+        events for the auctions it rules out are counted as not found
+        without going through the maps nor publishing an unmatched event.
+        Wins and losses always go through since they can legitimately come
+        in before their auction.
+    */
+    AuctionFilter liveAuctions;
 };
 
 } // RTBKIT
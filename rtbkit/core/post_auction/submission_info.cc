@@ -0,0 +1,90 @@
+/** submission_info.cc                                 -*- C++ -*-
+    Copyright (c) 2014 Datacratic.  All rights reserved.
+
+    Compact storage of the submitted auctions.
+
+*/
+
+#include "submission_info.h"
+#include "rtbkit/common/binary_bid_request.h"
+#include "jml/utils/lz4.h"
+#include "jml/arch/exception.h"
+
+#include <memory>
+
+using namespace std;
+using namespace ML;
+
+namespace RTBKIT {
+
+/*****************************************************************************/
+/* SUBMISSION INFO                                                           */
+/*****************************************************************************/
+
+void
+SubmissionInfo::
+setBidRequest(const SubmittedAuctionEvent & event, bool compress)
+{
+    auto br = event.bidRequest();
+    if (!br)
+        throw ML::Exception("submitted auction %s has no bid request",
+                            event.auctionId.toString().c_str());
+
+    auctionTime = br->timestamp;
+    spotIndex = br->findAdSpotIndex(event.adSpotId);
+    bidRequestStrFormat = event.bidRequestStrFormat;
+
+    // The router already sends the binary encoding; don't redo it
+    string encoded;
+    if (!event.bidRequestBinary.empty())
+        encoded = event.bidRequestBinary;
+    else BinaryBidRequest::encode(*br, encoded);
+
+    if (!compress) {
+        bidRequestData = std::move(encoded);
+        bidRequestSize = 0;
+        return;
+    }
+
+    int bound = LZ4_compressBound(encoded.size());
+    std::unique_ptr<char[]> buffer(new char[bound]);
+    int size = LZ4_compress(encoded.c_str(), buffer.get(), encoded.size());
+    if (size <= 0)
+        throw ML::Exception("couldn't compress the bid request of %s",
+                            event.auctionId.toString().c_str());
+
+    bidRequestData.assign(buffer.get(), size);
+    bidRequestSize = encoded.size();
+}
+
+std::shared_ptr<BidRequest>
+SubmissionInfo::
+bidRequest() const
+{
+    if (!hasBidRequest())
+        return nullptr;
+
+    if (!bidRequestSize)
+        return std::shared_ptr<BidRequest>(
+                BinaryBidRequest::decode(bidRequestData));
+
+    string encoded(bidRequestSize, '\0');
+    int size = LZ4_decompress_safe(bidRequestData.c_str(), &encoded[0],
+                                   bidRequestData.size(), bidRequestSize);
+    if (size != (int)bidRequestSize)
+        throw ML::Exception("couldn't decompress the kept bid request");
+
+    return std::shared_ptr<BidRequest>(BinaryBidRequest::decode(encoded));
+}
+
+Datacratic::UnicodeString
+SubmissionInfo::
+bidRequestStr() const
+{
+    auto br = bidRequest();
+    if (!br)
+        return Datacratic::UnicodeString();
+    return Datacratic::UnicodeString(br->toJsonStr());
+}
+
+} // namespace RTBKIT
@@ -25,16 +25,37 @@ namespace RTBKIT {
 
 struct SubmissionInfo {
     SubmissionInfo()
-        : fromOldRouter(false)
+        : spotIndex(-1), bidRequestSize(0), fromOldRouter(false)
     {
     }
 
-    std::shared_ptr<BidRequest> bidRequest;
-    std::string bidRequestStrFormat;
+    /** Keep the bid request of the given submitted auction along with what
+        the matching needs out of it.
 
-    Datacratic::UnicodeString bidRequestStr() const {
-        return Datacratic::UnicodeString(bidRequest->toJsonStr());
-    }
+        Submissions are kept for the whole auction timeout, so rather than
+        the parsed request, which weighs several times its encoding, we keep
+        the request encoded with BinaryBidRequest and decode it on demand.
+        If compress is set, the encoding is also compressed with LZ4, which
+        costs a bit of CPU on every match for another quarter or so less
+        memory.
+    */
+    void setBidRequest(const SubmittedAuctionEvent & event, bool compress);
+
+    /** Did we get the submitted auction yet?  Wins can get in before it. */
+    bool hasBidRequest() const { return !bidRequestData.empty(); }
+
+    /** Decode the bid request that was kept. */
+    std::shared_ptr<BidRequest> bidRequest() const;
+
+    /** Canonical JSON of the bid request, as it's forwarded downstream. */
+    Datacratic::UnicodeString bidRequestStr() const;
+
+    Date auctionTime;                 ///< Timestamp of the bid request
+    int spotIndex;                    ///< Index of the spot, -1 if unknown
+
+    std::string bidRequestData;       ///< Encoded bid request
+    uint32_t bidRequestSize;          ///< Size once uncompressed, 0 if not
+    std::string bidRequestStrFormat;
 
     JsonHolder augmentations;
     Auction::Response  bid;               ///< Bid we passed on
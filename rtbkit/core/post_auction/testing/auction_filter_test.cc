@@ -0,0 +1,101 @@
+/* auction_filter_test.cc
+   Copyright (c) 2014 Datacratic.  All rights reserved.
+
+   Tests for the membership filter of the tracked auctions.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include "rtbkit/core/post_auction/auction_filter.h"
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+size_t countContained(const AuctionFilter & filter, size_t first, size_t last)
+{
+    size_t count = 0;
+    for (size_t i = first; i < last; ++i)
+        if (filter.mayContain(Id(i))) ++count;
+    return count;
+}
+
+BOOST_AUTO_TEST_CASE( test_auction_filter_balance )
+{
+    const size_t N = 100000;
+    AuctionFilter filter;
+
+    BOOST_CHECK_EQUAL(countContained(filter, 1, N + 1), 0);
+
+    for (size_t i = 1; i <= N; ++i)
+        filter.insert(Id(i));
+
+    // No false negatives
+    BOOST_CHECK_EQUAL(countContained(filter, 1, N + 1), N);
+
+    // Few false positives for ids that were never inserted
+    size_t falsePositives = countContained(filter, N + 1, 2 * N + 1);
+    BOOST_CHECK_LT(falsePositives, N / 1000);
+
+    // Removing the odd ones leaves the even ones in
+    for (size_t i = 1; i <= N; i += 2)
+        filter.erase(Id(i));
+    for (size_t i = 2; i <= N; i += 2)
+        BOOST_CHECK(filter.mayContain(Id(i)));
+
+    // Duplicates need as many erasures as insertions
+    filter.insert(Id(2));
+    filter.erase(Id(2));
+    BOOST_CHECK(filter.mayContain(Id(2)));
+
+    for (size_t i = 2; i <= N; i += 2)
+        filter.erase(Id(i));
+
+    // Balanced insertions and erasures leave it empty
+    BOOST_CHECK_EQUAL(countContained(filter, 1, 2 * N + 1), 0);
+}
+
+BOOST_AUTO_TEST_CASE( test_auction_filter_saturation )
+{
+    // A single block so that the counters saturate quickly
+    AuctionFilter filter(1);
+
+    const size_t N = 1000;
+    for (size_t i = 1; i <= N; ++i)
+        filter.insert(Id(i));
+    for (size_t i = 1; i <= N; ++i)
+        BOOST_CHECK(filter.mayContain(Id(i)));
+
+    // Saturated counters can't tell how many went in so they stay set
+    for (size_t i = 1; i <= N; ++i)
+        filter.erase(Id(i));
+    BOOST_CHECK_EQUAL(countContained(filter, 1, N + 1), N);
+
+    // Same thing with a single auction inserted too many times
+    AuctionFilter single(1);
+    for (size_t i = 0; i < 20; ++i)
+        single.insert(Id("some-auction"));
+    for (size_t i = 0; i < 20; ++i)
+        single.erase(Id("some-auction"));
+    BOOST_CHECK(single.mayContain(Id("some-auction")));
+}
+
+BOOST_AUTO_TEST_CASE( test_auction_filter_unbalanced_erase )
+{
+    AuctionFilter filter(16);
+
+    // An erasure without its insertion only costs false positives
+    BOOST_CHECK_NO_THROW(filter.erase(Id("never-inserted")));
+    BOOST_CHECK(filter.mayContain(Id("never-inserted")));
+
+    filter.insert(Id("never-inserted"));
+    filter.erase(Id("never-inserted"));
+    BOOST_CHECK(filter.mayContain(Id("never-inserted")));
+
+    BOOST_CHECK_THROW(AuctionFilter(0), ML::Exception);
+    BOOST_CHECK_THROW(AuctionFilter(12), ML::Exception);
+}
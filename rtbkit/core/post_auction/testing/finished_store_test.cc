@@ -0,0 +1,173 @@
+/* finished_store_test.cc
+   Copyright (c) 2014 Datacratic.  All rights reserved.
+
+   Tests for the two-tier storage of the finished auctions.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+
+#include "rtbkit/core/post_auction/finished_store.h"
+#include "jml/db/persistent.h"
+#include "jml/utils/environment.h"
+
+#include <set>
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+Env_Option<string> tmpDir("TMP", "./tmp");
+
+FinishedInfo makeInfo(int i)
+{
+    FinishedInfo info;
+    info.auctionTime = Date::fromSecondsSinceEpoch(1400000000 + i);
+    info.auctionId = Id(i);
+    info.adSpotId = Id(i * 10);
+    info.spotIndex = i % 3;
+    info.bidRequestStr = UnicodeString("{\"id\":\"" + to_string(i) + "\"}");
+    info.bidRequestStrFormat = "datacratic";
+    info.uids.insert(Id("user-" + to_string(i)));
+    info.visitChannels.add("channel");
+    info.bidTime = info.auctionTime.plusSeconds(0.01);
+    info.setWin(info.auctionTime.plusSeconds(1), BS_WIN,
+                MicroUSD(100 + i), MicroUSD(200 + i), "meta");
+    info.addVisit(info.auctionTime.plusSeconds(10), "visit", info.visitChannels);
+    return info;
+}
+
+void checkSame(const FinishedInfo & info, const FinishedInfo & expected)
+{
+    BOOST_CHECK_EQUAL(info.auctionTime, expected.auctionTime);
+    BOOST_CHECK_EQUAL(info.auctionId, expected.auctionId);
+    BOOST_CHECK_EQUAL(info.adSpotId, expected.adSpotId);
+    BOOST_CHECK_EQUAL(info.spotIndex, expected.spotIndex);
+    BOOST_CHECK_EQUAL(info.bidRequestStr, expected.bidRequestStr);
+    BOOST_CHECK_EQUAL(info.bidRequestStrFormat, expected.bidRequestStrFormat);
+    BOOST_CHECK(info.uids == expected.uids);
+    BOOST_CHECK_EQUAL(info.visitChannels.toJson(), expected.visitChannels.toJson());
+    BOOST_CHECK_EQUAL(info.bidTime, expected.bidTime);
+    BOOST_CHECK_EQUAL(info.winToJson(), expected.winToJson());
+    BOOST_CHECK_EQUAL(info.visitsToJson(), expected.visitsToJson());
+
+    // Covers whatever isn't checked above
+    BOOST_CHECK_EQUAL(DB::serializeToString(info),
+                      DB::serializeToString(expected));
+}
+
+FinishedStore::Key makeKey(int i)
+{
+    return FinishedStore::Key(Id(i), Id(i * 10));
+}
+
+BOOST_AUTO_TEST_CASE( test_finished_info_serialization )
+{
+    FinishedInfo info = makeInfo(1);
+
+    string str = DB::serializeToString(info);
+    FinishedInfo back = DB::reconstituteFromString<FinishedInfo>(str);
+
+    BOOST_CHECK_EQUAL(back.winPrice, info.winPrice);
+    BOOST_CHECK_EQUAL(back.rawWinPrice, info.rawWinPrice);
+    BOOST_CHECK_EQUAL(back.visits.size(), 1);
+    checkSame(back, info);
+}
+
+BOOST_AUTO_TEST_CASE( test_finished_store_spill )
+{
+    string path = tmpDir.get() + "/finished_store_test";
+
+    FinishedStore store;
+    store.spillTo(path, 1.0);
+    BOOST_CHECK(store.spilling());
+
+    Date now = Date::now();
+    const int N = 10;
+
+    // The odd entries expire before they're due to be spilled
+    for (int i = 0; i < N; ++i) {
+        Date expiry = now.plusSeconds(i % 2 ? 0.5 : 100.0);
+        BOOST_CHECK(store.emplace(makeKey(i), makeInfo(i), expiry));
+    }
+    BOOST_CHECK(!store.emplace(makeKey(0), makeInfo(0), now.plusSeconds(100)));
+    BOOST_CHECK_EQUAL(store.memorySize(), N);
+
+    set<FinishedStore::Key> expired;
+    auto onExpire = [&] (const FinishedStore::Key & key) {
+        BOOST_CHECK(expired.insert(key).second);
+    };
+
+    BOOST_CHECK_EQUAL(store.expire(onExpire, now.plusSeconds(2)), N / 2);
+    BOOST_CHECK_EQUAL(expired.size(), N / 2);
+    for (int i = 1; i < N; i += 2) {
+        BOOST_CHECK(expired.count(makeKey(i)));
+        BOOST_CHECK(!store.count(makeKey(i)));
+    }
+
+    // The others are now on disk
+    BOOST_CHECK_EQUAL(store.memorySize(), 0);
+    BOOST_CHECK_EQUAL(store.diskSize(), N / 2);
+
+    for (int i = 0; i < N; i += 2) {
+        BOOST_REQUIRE(store.count(makeKey(i)));
+        checkSame(store.get(makeKey(i)), makeInfo(i));
+    }
+
+    // Changes to spilled entries are written back
+    FinishedInfo changed = store.get(makeKey(2));
+    changed.addVisit(now, "another visit", changed.visitChannels);
+    store.set(makeKey(2), changed);
+
+    BOOST_CHECK_EQUAL(store.get(makeKey(2)).visits.size(), 2);
+    checkSame(store.get(makeKey(2)), changed);
+    BOOST_CHECK_EQUAL(store.get(makeKey(4)).visits.size(), 1);
+
+    // Spilled keys are still taken
+    BOOST_CHECK(!store.emplace(makeKey(2), makeInfo(2), now.plusSeconds(100)));
+
+    // Nothing else is due yet
+    BOOST_CHECK_EQUAL(store.expire(onExpire, now.plusSeconds(50)), 0);
+    BOOST_CHECK_EQUAL(store.diskSize(), N / 2);
+
+    // Entries expire from disk without being read back
+    expired.clear();
+    BOOST_CHECK_EQUAL(store.expire(onExpire, now.plusSeconds(200)), N / 2);
+    BOOST_CHECK_EQUAL(expired.size(), N / 2);
+    for (int i = 0; i < N; i += 2)
+        BOOST_CHECK(expired.count(makeKey(i)));
+
+    BOOST_CHECK_EQUAL(store.size(), 0);
+    BOOST_CHECK(!store.count(makeKey(2)));
+
+    boost::filesystem::remove_all(path);
+}
+
+BOOST_AUTO_TEST_CASE( test_finished_store_memory )
+{
+    FinishedStore store;
+    BOOST_CHECK(!store.spilling());
+
+    Date now = Date::now();
+    BOOST_CHECK(store.emplace(makeKey(1), makeInfo(1), now.plusSeconds(10)));
+
+    FinishedInfo info = store.get(makeKey(1));
+    info.addVisit(now, "another visit", info.visitChannels);
+    store.set(makeKey(1), info);
+    BOOST_CHECK_EQUAL(store.get(makeKey(1)).visits.size(), 2);
+
+    // Without spilling the entries stay in memory until they expire
+    size_t calls = 0;
+    auto onExpire = [&] (const FinishedStore::Key &) { ++calls; };
+
+    BOOST_CHECK_EQUAL(store.expire(onExpire, now.plusSeconds(5)), 0);
+    BOOST_CHECK_EQUAL(store.memorySize(), 1);
+
+    BOOST_CHECK_EQUAL(store.expire(onExpire, now.plusSeconds(20)), 1);
+    BOOST_CHECK_EQUAL(calls, 1);
+    BOOST_CHECK_EQUAL(store.size(), 0);
+}
@@ -0,0 +1,197 @@
+/* post_auction_ring_proxy_test.cc
+   Copyright (c) 2014 Datacratic.  All rights reserved.
+
+   Routing of the post auction traffic over the ring, end to end: in-process
+   post auction services fed by a PostAuctionProxy.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include "rtbkit/core/post_auction/post_auction_service.h"
+#include "rtbkit/core/post_auction/simple_event_matcher.h"
+#include "rtbkit/core/banker/null_banker.h"
+#include "rtbkit/common/post_auction_proxy.h"
+#include "soa/service/zmq_endpoint.h"
+#include "soa/service/message_loop.h"
+
+#include <map>
+#include <thread>
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+typedef std::shared_ptr<PostAuctionService> ServicePtr;
+
+const size_t RingTokens = 16;
+
+ServicePtr
+startService(std::shared_ptr<ServiceProxies> proxies, const string & name)
+{
+    auto service = std::make_shared<PostAuctionService>(proxies, name);
+    service->setRingTokens(RingTokens);
+    service->init();
+    service->setBanker(std::make_shared<NullBanker>(true));
+    service->bindTcp();
+    service->start();
+    return service;
+}
+
+std::shared_ptr<SubmittedAuctionEvent> makeAuction(const Id & auctionId)
+{
+    BidRequest br;
+    br.auctionId = auctionId;
+    br.exchange = "mock";
+    br.timestamp = Date::now();
+
+    AdSpot spot;
+    spot.id = Id(1);
+    spot.formats.push_back(Format(300, 250));
+    br.imp.push_back(spot);
+
+    auto event = std::make_shared<SubmittedAuctionEvent>();
+    event->auctionId = auctionId;
+    event->adSpotId = spot.id;
+    event->lossTimeout = Date::now().plusSeconds(60);
+    event->bidRequestStr = br.toJsonStr();
+    event->bidRequestStrFormat = "datacratic";
+    event->bidResponse = Auction::Response(USD_CPM(2), 1, AccountKey("a.b.c"));
+    event->bidResponse.bidData = Bids::fromJson("{\"bids\":[{\"spotIndex\":0}]}");
+
+    return event;
+}
+
+std::shared_ptr<PostAuctionEvent> makeWin(const Id & auctionId)
+{
+    auto event = std::make_shared<PostAuctionEvent>();
+    event->type = PAE_WIN;
+    event->auctionId = auctionId;
+    event->adSpotId = Id(1);
+    event->winPrice = USD_CPM(1);
+    event->timestamp = Date::now();
+    event->account = AccountKey("a.b.c");
+    event->bidTimestamp = Date::now();
+    return event;
+}
+
+/** Waits up to a few seconds for the condition to hold. */
+bool waitFor(const std::function<bool ()> & condition)
+{
+    Date deadline = Date::now().plusSeconds(10);
+    while (!condition()) {
+        if (Date::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+size_t totalAuctions(const map<string, ServicePtr> & services)
+{
+    size_t total = 0;
+    for (const auto & entry : services)
+        total += entry.second->stats.auctions;
+    return total;
+}
+
+BOOST_AUTO_TEST_CASE( test_ring_proxy_routing )
+{
+    ZmqLogs::print.deactivate();
+    PostAuctionService::print.deactivate();
+    SimpleEventMatcher::print.deactivate();
+    MessageLoopLogs::print.deactivate();
+
+    auto proxies = std::make_shared<ServiceProxies>();
+    proxies->config = std::make_shared<InternalConfigurationService>();
+
+    map<string, ServicePtr> services;
+    for (string name : { "pal-0", "pal-1", "pal-2" })
+        services[name] = startService(proxies, name);
+
+    PostAuctionProxy proxy(proxies);
+    proxy.init();
+
+    BOOST_REQUIRE(waitFor([&] {
+                return proxy.currentRing()->services().size() == 3
+                    && proxy.isConnected();
+            }));
+
+    // The proxy has the same ring as the one built from the names
+    PostAuctionRing expected;
+    for (const auto & entry : services)
+        expected.add(entry.first,
+                     PostAuctionRing::makeTokens(entry.first, RingTokens));
+
+    const size_t N = 300;
+
+    map<string, size_t> owned;
+    for (size_t i = 1; i <= N; ++i) {
+        Id auctionId(i);
+        BOOST_CHECK_EQUAL(proxy.currentRing()->owner(auctionId),
+                          expected.owner(auctionId));
+        owned[expected.owner(auctionId)]++;
+        proxy.sendAuction(makeAuction(auctionId));
+    }
+
+    BOOST_REQUIRE(waitFor([&] { return totalAuctions(services) == N; }));
+
+    // Every service got its share, which makes the wins match up
+    for (const auto & entry : services) {
+        BOOST_CHECK_GT(owned[entry.first], 0);
+        BOOST_CHECK_EQUAL(entry.second->stats.auctions, owned[entry.first]);
+    }
+
+    for (size_t i = 1; i <= N; ++i)
+        proxy.sendEvent(makeWin(Id(i)));
+
+    BOOST_REQUIRE(waitFor([&] {
+                size_t wins = 0;
+                for (const auto & entry : services)
+                    wins += entry.second->stats.matchedWins;
+                return wins == N;
+            }));
+
+    for (const auto & entry : services) {
+        BOOST_CHECK_EQUAL(entry.second->stats.events, owned[entry.first]);
+        BOOST_CHECK_EQUAL(entry.second->stats.matchedWins, owned[entry.first]);
+        BOOST_CHECK_EQUAL(entry.second->stats.unmatchedEvents, 0);
+    }
+
+    // A service that shuts down leaves the ring and its share goes to the
+    // others.
+    auto gone = services["pal-1"];
+    gone->shutdown();
+    services.erase("pal-1");
+    expected.remove("pal-1");
+
+    BOOST_REQUIRE(waitFor([&] {
+                return proxy.currentRing()->services().size() == 2;
+            }));
+    BOOST_CHECK(proxy.currentRing()->services() == expected.services());
+
+    size_t goneAuctions = gone->stats.auctions;
+    size_t before = totalAuctions(services);
+
+    map<string, size_t> rebalanced;
+    for (size_t i = N + 1; i <= 2 * N; ++i) {
+        Id auctionId(i);
+        BOOST_CHECK_EQUAL(proxy.currentRing()->owner(auctionId),
+                          expected.owner(auctionId));
+        rebalanced[expected.owner(auctionId)]++;
+        proxy.sendAuction(makeAuction(auctionId));
+    }
+
+    BOOST_REQUIRE(waitFor([&] { return totalAuctions(services) == before + N; }));
+
+    BOOST_CHECK_EQUAL(gone->stats.auctions, goneAuctions);
+    for (const auto & entry : services) {
+        BOOST_CHECK_EQUAL(entry.second->stats.auctions,
+                          owned[entry.first] + rebalanced[entry.first]);
+    }
+
+    for (const auto & entry : services)
+        entry.second->shutdown();
+}
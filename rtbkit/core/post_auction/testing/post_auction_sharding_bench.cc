@@ -34,10 +34,13 @@ typedef std::shared_ptr<PostAuctionService> ServicePtr;
 struct Config
 {
     Config() :
-        shards(1), feeders(1), pauseMs(1), durationSec(10), lossTimeout(15)
+        shards(1), internalShards(1), ringTokens(0),
+        feeders(1), pauseMs(1), durationSec(10), lossTimeout(15)
     {}
 
     size_t shards;
+    size_t internalShards;
+    size_t ringTokens;
     size_t feeders;
     size_t pauseMs;
     size_t durationSec;
@@ -55,6 +58,8 @@ Config getConfig(int argc, char** argv)
     options_description opt;
     opt.add_options()
         ("shards,s", value<size_t>(&config.shards))
+        ("internalShards,i", value<size_t>(&config.internalShards))
+        ("ringTokens,r", value<size_t>(&config.ringTokens))
         ("feeders,f", value<size_t>(&config.feeders))
         ("pauseMs,p", value<size_t>(&config.pauseMs))
         ("durationSec,d", value<size_t>(&config.durationSec))
@@ -222,7 +227,8 @@ initService(const Config& config, size_t shard)
 {
     std::string name = "bob-" + std::to_string(shard);
     auto service = std::make_shared<PostAuctionService>(makeProxies(config), name);
-    service->init(shard);
+    service->setRingTokens(config.ringTokens);
+    service->init(shard, config.internalShards);
     service->setBanker(std::make_shared<NullBanker>());
     service->bindTcp();
     service->start();
@@ -329,6 +335,8 @@ int main(int argc, char* argv[])
     std::cerr << "\n\n"
         << printValue(config.durationSec) << " Duration\n"
         << printValue(config.shards) << " Shards\n"
+        << printValue(config.internalShards) << " Internal Shards\n"
+        << printValue(config.ringTokens) << " Ring Tokens\n"
         << printValue(config.feeders * (1000.0 / config.pauseMs) ) << " Request/sec\n"
         << std::endl;
 
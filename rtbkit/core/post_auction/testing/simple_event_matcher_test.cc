@@ -0,0 +1,200 @@
+/* simple_event_matcher_test.cc
+   Copyright (c) 2014 Datacratic.  All rights reserved.
+
+   Tests for the event matching of the post auction service.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include "rtbkit/core/post_auction/simple_event_matcher.h"
+#include "rtbkit/core/banker/null_banker.h"
+#include "rtbkit/common/binary_bid_request.h"
+#include "jml/arch/timers.h"
+
+#include <map>
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+
+/******************************************************************************/
+/* FIXTURE                                                                    */
+/******************************************************************************/
+
+struct Fixture
+{
+    Fixture() :
+        matcher("matcher", std::make_shared<NullEventService>()),
+        wins(0), losses(0), campaignEvents(0), errors(0)
+    {
+        matcher.setBanker(std::make_shared<NullBanker>(true));
+
+        matcher.onMatchedWinLoss = [&] (std::shared_ptr<MatchedWinLoss> event) {
+            if (event->type == MatchedWinLoss::Win) ++wins;
+            else ++losses;
+        };
+        matcher.onMatchedCampaignEvent = [&] (std::shared_ptr<MatchedCampaignEvent>) {
+            ++campaignEvents;
+        };
+        matcher.onUnmatchedEvent = [&] (std::shared_ptr<UnmatchedEvent> event) {
+            unmatched[event->reason]++;
+        };
+        matcher.onError = [&] (std::shared_ptr<PostAuctionErrorEvent>) {
+            ++errors;
+        };
+    }
+
+    void doAuction(int i, double lossTimeout)
+    {
+        BidRequest br;
+        br.auctionId = Id(i);
+        br.timestamp = Date::now();
+        br.exchange = "test";
+
+        AdSpot spot;
+        spot.id = Id(i * 10);
+        spot.formats.push_back(Format(300, 250));
+        br.imp.push_back(spot);
+
+        Bid bid;
+        bid.spotIndex = 0;
+        bid.price = MicroUSD(1000);
+        Bids bids;
+        bids.push_back(bid);
+
+        auto event = std::make_shared<SubmittedAuctionEvent>();
+        event->auctionId = br.auctionId;
+        event->adSpotId = spot.id;
+        event->lossTimeout = Date::now().plusSeconds(lossTimeout);
+        event->bidRequestBinary = BinaryBidRequest::encode(br);
+        event->bidRequestStrFormat = "datacratic";
+        event->bidResponse = Auction::Response(
+                Auction::Price(MicroUSD(1000)), 1, AccountKey("test:account"),
+                false, "agent", bids);
+
+        matcher.doAuction(event);
+    }
+
+    void doEvent(PostAuctionEventType type, int i)
+    {
+        auto event = std::make_shared<PostAuctionEvent>();
+        event->type = type;
+        event->auctionId = Id(i);
+        event->adSpotId = Id(i * 10);
+        event->timestamp = Date::now();
+        if (type == PAE_WIN) event->winPrice = MicroUSD(500);
+        if (type == PAE_CAMPAIGN_EVENT) event->label = "IMPRESSION";
+
+        matcher.doEvent(event);
+    }
+
+    size_t unmatchedCount() const
+    {
+        size_t count = 0;
+        for (const auto & entry : unmatched) count += entry.second;
+        return count;
+    }
+
+    SimpleEventMatcher matcher;
+
+    size_t wins;
+    size_t losses;
+    size_t campaignEvents;
+    size_t errors;
+    map<string, size_t> unmatched;
+};
+
+
+/******************************************************************************/
+/* TESTS                                                                      */
+/******************************************************************************/
+
+/** Every path that takes an entry out of submitted or finished must take it
+    out of the filter too.  If any of them leaks then campaign events for the
+    auctions that are gone still make it through the filter, which shows up
+    as unmatched events.
+*/
+BOOST_FIXTURE_TEST_CASE( test_filter_follows_matcher, Fixture )
+{
+    const int N = 100;
+    const int EarlyWin = N + 1;
+
+    matcher.setAuctionTimeout(1.0);
+    matcher.setWinTimeout(1.0);
+
+    for (int i = 1; i <= N; ++i)
+        doAuction(i, 1.0);
+
+    // Auction already submitted: popped and put back
+    doAuction(1, 1.0);
+
+    // Still in submitted
+    doEvent(PAE_CAMPAIGN_EVENT, 1);
+    BOOST_CHECK_EQUAL(unmatched["inFlight"], 1);
+
+    // Won: popped from submitted and put in finished
+    for (int i = 2; i <= N; i += 2)
+        doEvent(PAE_WIN, i);
+    BOOST_CHECK_EQUAL(wins, N / 2);
+
+    // Duplicate win, already in finished
+    doEvent(PAE_WIN, 2);
+    BOOST_CHECK_EQUAL(wins, N / 2);
+
+    doEvent(PAE_CAMPAIGN_EVENT, 2);
+    BOOST_CHECK_EQUAL(campaignEvents, 1);
+
+    // Win that comes in before its auction, parked in submitted
+    doEvent(PAE_WIN, EarlyWin);
+
+    // Expires the odd auctions from submitted into finished, the early win
+    // from submitted and the won auctions from finished.
+    ML::sleep(1.5);
+    matcher.checkExpiredAuctions();
+
+    BOOST_CHECK_EQUAL(losses, N / 2);
+    BOOST_CHECK_EQUAL(unmatched["really really late win"], 1);
+    size_t unmatchedBefore = unmatchedCount();
+
+    // Expires the inferred losses from finished
+    ML::sleep(1.5);
+    matcher.checkExpiredAuctions();
+
+    size_t errorsBefore = errors;
+
+    // Nothing is tracked anymore so the filter rules everything out
+    for (int i = 1; i <= EarlyWin; ++i)
+        doEvent(PAE_CAMPAIGN_EVENT, i);
+
+    BOOST_CHECK_EQUAL(unmatchedCount(), unmatchedBefore);
+    BOOST_CHECK_EQUAL(errors, errorsBefore);
+    BOOST_CHECK_EQUAL(campaignEvents, 1);
+}
+
+/** Campaign events that the filter lets through are still matched. */
+BOOST_FIXTURE_TEST_CASE( test_filter_lets_tracked_through, Fixture )
+{
+    const int N = 100;
+
+    for (int i = 1; i <= N; ++i) {
+        doAuction(i, 60.0);
+        doEvent(PAE_WIN, i);
+    }
+    BOOST_CHECK_EQUAL(wins, N);
+
+    for (int i = 1; i <= N; ++i)
+        doEvent(PAE_CAMPAIGN_EVENT, i);
+    BOOST_CHECK_EQUAL(campaignEvents, N);
+    BOOST_CHECK_EQUAL(unmatchedCount(), 0);
+
+    // Expiry hasn't kicked in yet
+    matcher.checkExpiredAuctions();
+    for (int i = 1; i <= N; ++i)
+        doEvent(PAE_CAMPAIGN_EVENT, i);
+    BOOST_CHECK_EQUAL(unmatched["duplicate"], N);
+}
@@ -0,0 +1,107 @@
+/* submission_info_test.cc
+   Copyright (c) 2014 Datacratic.  All rights reserved.
+
+   Tests for the compact storage of the submitted auctions.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include "rtbkit/core/post_auction/submission_info.h"
+#include "rtbkit/common/binary_bid_request.h"
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+
+std::shared_ptr<BidRequest> makeBidRequest()
+{
+    auto br = std::make_shared<BidRequest>();
+    br->auctionId = Id("submission-info-test");
+    br->timestamp = Date::fromSecondsSinceEpoch(1400000000.5);
+    br->exchange = "test";
+    br->url = Url("http://www.example.com/page");
+    br->userIds.add(Id("some-user"), ID_EXCHANGE);
+    br->userIds.add(Id("some-provider"), ID_PROVIDER);
+
+    for (int i = 1; i <= 3; ++i) {
+        AdSpot spot;
+        spot.id = Id(i * 11);
+        spot.formats.push_back(Format(300, 250 * i));
+        br->imp.push_back(spot);
+    }
+
+    return br;
+}
+
+/** Event as it reaches the post auction service: the bid request is only
+    there in its serialized form.
+*/
+SubmittedAuctionEvent makeEvent(const BidRequest & br, bool binary)
+{
+    SubmittedAuctionEvent event;
+    event.auctionId = br.auctionId;
+    event.adSpotId = br.imp[1].id;
+    event.bidRequestStrFormat = "datacratic";
+
+    if (binary)
+        event.bidRequestBinary = BinaryBidRequest::encode(br);
+    else event.bidRequestStr = UnicodeString(br.toJsonStr());
+
+    return event;
+}
+
+BOOST_AUTO_TEST_CASE( test_submission_info_bid_request )
+{
+    auto br = makeBidRequest();
+
+    for (bool binary : { false, true }) {
+        for (bool compress : { false, true }) {
+            BOOST_TEST_CHECKPOINT("binary=" << binary << " compress=" << compress);
+
+            SubmissionInfo info;
+            info.setBidRequest(makeEvent(*br, binary), compress);
+
+            BOOST_CHECK(info.hasBidRequest());
+            BOOST_CHECK_EQUAL(info.spotIndex, 1);
+            BOOST_CHECK_EQUAL(info.auctionTime, br->timestamp);
+            BOOST_CHECK_EQUAL(info.bidRequestStrFormat, "datacratic");
+            BOOST_CHECK_EQUAL(info.bidRequestSize != 0, compress);
+
+            auto decoded = info.bidRequest();
+            BOOST_REQUIRE(decoded);
+            BOOST_CHECK_EQUAL(decoded->auctionId, br->auctionId);
+            BOOST_CHECK_EQUAL(decoded->userIds.toJsonStr(),
+                              br->userIds.toJsonStr());
+            BOOST_CHECK_EQUAL(decoded->userIds.exchangeId, br->userIds.exchangeId);
+            BOOST_CHECK_EQUAL(decoded->userIds.providerId, br->userIds.providerId);
+
+            BOOST_REQUIRE_EQUAL(decoded->imp.size(), br->imp.size());
+            for (size_t i = 0; i < br->imp.size(); ++i) {
+                BOOST_CHECK_EQUAL(decoded->imp[i].id, br->imp[i].id);
+                BOOST_CHECK_EQUAL(decoded->imp[i].format(), br->imp[i].format());
+            }
+
+            // What's forwarded downstream is the same as before the
+            // request was kept encoded.
+            BOOST_CHECK_EQUAL(info.bidRequestStr(),
+                              UnicodeString(br->toJsonStr()));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_submission_info_no_bid_request )
+{
+    SubmissionInfo info;
+    BOOST_CHECK(!info.hasBidRequest());
+    BOOST_CHECK(!info.bidRequest());
+    BOOST_CHECK_EQUAL(info.bidRequestStr(), UnicodeString());
+
+    SubmittedAuctionEvent event;
+    event.auctionId = Id("no-bid-request");
+    BOOST_CHECK_THROW(info.setBidRequest(event, false), ML::Exception);
+}
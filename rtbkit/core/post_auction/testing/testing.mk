@@ -1,2 +1,7 @@
 $(eval $(call program,post_auction_redis_bench,post_auction redis))
 $(eval $(call program,post_auction_sharding_bench,post_auction boost_program_options))
+$(eval $(call test,submission_info_test,post_auction,boost))
+$(eval $(call test,finished_store_test,post_auction boost_filesystem,boost))
+$(eval $(call test,auction_filter_test,types,boost))
+$(eval $(call test,simple_event_matcher_test,post_auction banker,boost))
+$(eval $(call test,post_auction_ring_proxy_test,post_auction banker,boost))
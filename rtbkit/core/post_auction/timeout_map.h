@@ -5,16 +5,18 @@
    Map that maintains a timeout mechanism.
 
    Simpler version of the soa TimeoutMap which doesn't require linear scans to
-   expire elements. Should eventually replace the one in soa.
+   expire elements. Should eventually replace the one in soa. Shares the
+   hierarchical timing wheel of the soa version.
 
 */
 
 #pragma once
 
 #include "soa/types/date.h"
+#include "soa/service/timing_wheel.h"
 
-#include <set>
-#include <queue>
+#include <unordered_map>
+#include <vector>
 
 namespace RTBKIT {
 
@@ -25,6 +27,22 @@ namespace RTBKIT {
 template<typename Key, typename Value>
 struct TimeoutMap
 {
+    TimeoutMap() {}
+
+    TimeoutMap(const TimeoutMap& other) : map(other.map)
+    {
+        relink();
+    }
+
+    TimeoutMap& operator=(const TimeoutMap& other)
+    {
+        if (this == &other) return *this;
+
+        wheel.clear();
+        map = other.map;
+        relink();
+        return *this;
+    }
 
     size_t size() const
     {
@@ -56,7 +74,7 @@ struct TimeoutMap
                         std::move(key), Entry(std::move(value), timeout)));
         if (!ret.second) return false;
 
-        queue.emplace(ret.first->first, timeout);
+        link(*ret.first);
         return true;
     }
 
@@ -66,7 +84,7 @@ struct TimeoutMap
         ExcCheck(it != map.end(), "key not present in the timeout map.");
 
         it->second.timeout = timeout;
-        queue.emplace(key, timeout);
+        wheel.update(it->second, timeout);
     }
 
     Value pop(const Key& key)
@@ -75,68 +93,66 @@ struct TimeoutMap
         ExcCheck(it != map.end(), "key not present in the timeout map.");
 
         Value value = std::move(it->second.value);
+        wheel.erase(it->second);
         map.erase(it);
         return value;
     }
 
     bool erase(const Key& key)
     {
-        return map.erase(key);
+        auto it = map.find(key);
+        if (it == map.end()) return false;
+
+        wheel.erase(it->second);
+        map.erase(it);
+        return true;
     }
 
     template<typename Fn>
     size_t expire(const Fn& fn, Datacratic::Date now = Datacratic::Date::now())
     {
-        std::vector< std::pair<Key, Entry> > toExpire;
+        std::vector< std::pair<Key, Value> > toExpire;
         toExpire.reserve(1 << 4);
 
-        while (!queue.empty() && queue.top().timeout <= now) {
-            TimeoutEntry entry = std::move(queue.top());
-            queue.pop();
-
-            auto it = map.find(entry.key);
-            if (it == map.end()) continue;
-            if (it->second.timeout > now) continue;
-
-            toExpire.emplace_back(std::move(*it));
-            map.erase(it);
-        }
+        wheel.expire([&] (Entry& entry) {
+                    auto it = map.find(*entry.key);
+                    toExpire.emplace_back(
+                            std::move(it->first), std::move(it->second.value));
+                    map.erase(it);
+                }, now);
 
         for (auto& entry : toExpire)
-            fn(std::move(entry.first), std::move(entry.second.value));
+            fn(std::move(entry.first), std::move(entry.second));
 
         return toExpire.size();
     }
 
 private:
 
-    struct Entry
+    struct Entry : public Datacratic::TimingWheelHook
     {
         Value value;
         Datacratic::Date timeout;
+        const Key* key;
 
         Entry(Value value, Datacratic::Date timeout) :
-            value(std::move(value)), timeout(timeout)
+            value(std::move(value)), timeout(timeout), key(nullptr)
         {}
     };
 
-    struct TimeoutEntry
+    void link(std::pair<const Key, Entry>& item)
     {
-        Key key;
-        Datacratic::Date timeout;
-
-        TimeoutEntry(Key key, Datacratic::Date timeout) :
-            key(std::move(key)), timeout(timeout)
-        {}
+        item.second.key = &item.first;
+        wheel.insert(item.second, item.second.timeout);
+    }
 
-        bool operator<(const TimeoutEntry& other) const
-        {
-            return timeout > other.timeout;
-        }
-    };
+    void relink()
+    {
+        for (auto& item : map) link(item);
+    }
 
     std::unordered_map<Key, Entry> map;
-    std::priority_queue<TimeoutEntry> queue;
+    Datacratic::TimingWheel<Entry> wheel;
 };
 
 } // namespace RTBKIT
@@ -411,7 +411,7 @@ doAugmentation(std::shared_ptr<Entry>&& entry)
                 "AUGMENT", "1.0", *it,
                 entry->info->auction->id.toString(),
                 entry->info->auction->requestStrFormat,
-                entry->info->auction->requestStr,
+                entry->info->auction->requestStr(),
                 availableAgentsStr.str(),
                 Date::now());
 
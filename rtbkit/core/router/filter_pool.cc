@@ -7,12 +7,17 @@
 */
 
 #include "filter_pool.h"
+#include "filters/priority.h"
 #include "rtbkit/common/bid_request.h"
 #include "rtbkit/common/exchange_connector.h"
 #include "rtbkit/core/agent_configuration/agent_config.h"
 #include "soa/service/service_base.h"
 #include "jml/utils/exc_check.h"
 #include "jml/arch/tick_counter.h"
+#include "jml/utils/worker_task.h"
+
+#include <mutex>
+#include <numeric>
 
 
 using namespace std;
@@ -27,7 +32,13 @@ namespace RTBKIT {
 /******************************************************************************/
 
 FilterPool::
-FilterPool() : data(new Data()), events(nullptr) {}
+FilterPool() :
+    data(new Data()),
+    events(nullptr),
+    adaptiveOrdering(false),
+    perExchangeOrdering(false),
+    minOrderingSamples(0)
+{}
 
 
 void
@@ -38,6 +49,40 @@ init(EventRecorder* events)
 }
 
 
+void
+FilterPool::
+initShards(unsigned shards, unsigned threads)
+{
+    ExcCheckGreater(shards, 0, "Invalid number of filter shards");
+
+    if (shards > 1 && threads > 0)
+        shardWorkers.reset(new Worker_Task(threads));
+    else shardWorkers.reset();
+
+    GcLockBase::SharedGuard guard(gc);
+
+    Data* oldData = data.load();
+    unique_ptr<Data> newData;
+
+    do {
+        newData.reset(new Data(*oldData));
+        newData->setShards(shards);
+    } while (!setData(oldData, newData));
+
+    if (events) events->recordLevel(shards, "filters.shards");
+}
+
+
+void
+FilterPool::
+initAdaptiveOrdering(bool perExchange, size_t minSamples)
+{
+    adaptiveOrdering = true;
+    perExchangeOrdering = perExchange;
+    minOrderingSamples = minSamples;
+}
+
+
 bool
 FilterPool::
 setData(Data*& oldData, unique_ptr<Data>& newData)
@@ -103,45 +148,75 @@ recordReason(const Data* data, const FilterBase* f, FilterState & state){
 
 uint64_t
 FilterPool::
-recordTime(uint64_t start, const FilterBase* filter)
+recordTime(uint64_t start, const FilterBase* filter, int shard)
 {
     uint64_t now = ticks();
     double us = ((now - start) / ticks_per_second) * 1000000.0;
 
     events->recordLevel(us, "filters.timingUs.%s", filter->name());
+    if (shard >= 0)
+        events->recordLevel(us, "filters.shards.%d.timingUs.%s", shard, filter->name());
 
     return now;
 }
 
 
-FilterPool::ConfigList
+const std::vector<unsigned>*
 FilterPool::
-filter(const BidRequest& br, const ExchangeConnector* conn, const ConfigSet& mask)
+findOrder(const Data* current, const BidRequest& br) const
 {
-    GcLockBase::SharedGuard guard(gc, GcLockBase::RD_NO);
+    if (current->orders.empty()) return nullptr;
 
-    const Data* current = data.load();
-    ExcCheck(!current->filters.empty(), "No filters registered");
+    if (perExchangeOrdering) {
+        auto it = current->orders.find(br.exchange);
+        if (it != current->orders.end()) return &it->second;
+    }
 
-    FilterState state(br, conn, current->activeConfigs);
-    state.narrowConfigs(mask);
+    auto it = current->orders.find("");
+    return it != current->orders.end() ? &it->second : nullptr;
+}
+
+
+void
+FilterPool::
+filterShard(const Data* current, FilterState& state, bool sampleStats, int shard)
+{
+    if (state.configs().empty()) return;
+
+    const vector<unsigned>* order = findOrder(current, state.request);
+    const size_t numFilters = current->filters.size();
+
+    vector<FilterCost> sampledCosts;
+    if (sampleStats && adaptiveOrdering) sampledCosts.resize(numFilters);
 
     ConfigSet configs = state.configs();
 
-    bool sampleStats = events && (random() % 10 == 0);
-    uint64_t ticksStart = sampleStats ? ticks() : 0;
+    for (size_t i = 0; i < numFilters; ++i) {
+        FilterBase* filter = current->filters[order ? (*order)[i] : i].get();
+
+        uint64_t ticksStart = sampleStats ? ticks() : 0;
 
-    for (FilterBase* filter : current->filters) {
         filter->filter(state);
 
         const ConfigSet& filtered = state.configs();
 
         if (sampleStats) {
-            ticksStart = recordTime(ticksStart, filter);
-            recordDiff(current, filter, configs ^ filtered);
+            uint64_t ticksEnd = recordTime(ticksStart, filter, shard);
+
+            ConfigSet diff = configs ^ filtered;
+            recordDiff(current, filter, diff);
             if (!state.getFilterReasons().empty()) {
                 recordReason(current, filter, state);
             }
+
+            if (!sampledCosts.empty()) {
+                FilterCost& cost = sampledCosts[i];
+                cost.samples = 1;
+                cost.ticks = ticksEnd - ticksStart;
+                cost.input = configs.count();
+                cost.eliminated = diff.count();
+            }
+
             configs = filtered;
         }
         state.resetFilterReasons();
@@ -153,8 +228,82 @@ filter(const BidRequest& br, const ExchangeConnector* conn, const ConfigSet& mas
         }
     }
 
-    auto biddableSpots = state.biddableSpots();
-    configs = state.configs();
+    if (!sampledCosts.empty())
+        recordCosts(state.request.exchange, current, order, sampledCosts);
+}
+
+
+void
+FilterPool::
+filterSharded(
+        const Data* current,
+        const BidRequest& br,
+        const ExchangeConnector* conn,
+        const ConfigSet& mask,
+        bool sampleStats,
+        ConfigSet& configs,
+        BiddableSpotsMap& biddableSpots)
+{
+    struct ShardResult
+    {
+        ConfigSet configs;
+        BiddableSpotsMap biddableSpots;
+    };
+
+    const size_t numShards = current->shardMasks.size();
+    vector<ShardResult> results(numShards);
+
+    auto doShard = [&] (size_t shard) {
+        FilterState state(br, conn, current->activeConfigs);
+        state.narrowConfigs(mask);
+        state.setShard(current->shardMasks[shard], current->shardKeys[shard]);
+
+        if (state.configs().empty()) return;
+
+        filterShard(current, state, sampleStats, shard);
+
+        results[shard].biddableSpots = state.biddableSpots();
+        results[shard].configs = state.configs();
+    };
+
+    shardWorkers->do_group(size_t(0), numShards, doShard, -1, "filters");
+
+    // Shards are disjoint so merging is just a matter of union-ing everything.
+    for (ShardResult& result : results) {
+        configs |= result.configs;
+        for (auto& entry : result.biddableSpots)
+            biddableSpots[entry.first] = std::move(entry.second);
+    }
+}
+
+
+FilterPool::ConfigList
+FilterPool::
+filter(const BidRequest& br, const ExchangeConnector* conn, const ConfigSet& mask)
+{
+    GcLockBase::SharedGuard guard(gc, GcLockBase::RD_NO);
+
+    const Data* current = data.load();
+    ExcCheck(!current->filters.empty(), "No filters registered");
+
+    bool sampleStats = events && (random() % 10 == 0);
+
+    ConfigSet configs;
+    BiddableSpotsMap biddableSpots;
+
+    if (shardWorkers && current->shardMasks.size() > 1) {
+        filterSharded(
+                current, br, conn, mask, sampleStats, configs, biddableSpots);
+    }
+    else {
+        FilterState state(br, conn, current->activeConfigs);
+        state.narrowConfigs(mask);
+
+        filterShard(current, state, sampleStats, -1);
+
+        biddableSpots = state.biddableSpots();
+        configs = state.configs();
+    }
 
     ConfigList result;
     for (size_t i = configs.next(); i < configs.size(); i = configs.next(i + 1)) {
@@ -167,6 +316,160 @@ filter(const BidRequest& br, const ExchangeConnector* conn, const ConfigSet& mas
 }
 
 
+/******************************************************************************/
+/* FILTER POOL - ADAPTIVE ORDERING                                            */
+/******************************************************************************/
+
+void
+FilterPool::FilterCost::
+add(const FilterCost& other)
+{
+    samples += other.samples;
+    ticks += other.ticks;
+    input += other.input;
+    eliminated += other.eliminated;
+}
+
+void
+FilterPool::FilterCost::
+decay(double factor)
+{
+    samples *= factor;
+    ticks *= factor;
+    input *= factor;
+    eliminated *= factor;
+}
+
+double
+FilterPool::FilterCost::
+score() const
+{
+    if (!samples) return -1.0;
+    if (!input) return 0.0;
+
+    double ticksPerCall = std::max(ticks / samples, 1.0);
+    return (eliminated / input) / ticksPerCall;
+}
+
+void
+FilterPool::
+recordCosts(
+        const string& exchange,
+        const Data* current,
+        const vector<unsigned>* order,
+        const vector<FilterCost>& sampled)
+{
+    // Resolve the names outside of the lock.
+    vector<string> names(sampled.size());
+    for (size_t i = 0; i < sampled.size(); ++i) {
+        if (!sampled[i].samples) continue;
+        names[i] = current->filters[order ? (*order)[i] : i]->name();
+    }
+
+    std::lock_guard<ML::Spinlock> guard(costsLock);
+
+    FilterCosts& all = costs[""];
+    FilterCosts* perExchange = perExchangeOrdering ? &costs[exchange] : nullptr;
+
+    for (size_t i = 0; i < sampled.size(); ++i) {
+        if (!sampled[i].samples) continue;
+
+        all[names[i]].add(sampled[i]);
+        if (perExchange) (*perExchange)[names[i]].add(sampled[i]);
+    }
+}
+
+vector<unsigned>
+FilterPool::
+computeOrder(const Data* current, const FilterCosts& costs) const
+{
+    const auto& filters = current->filters;
+
+    double samples = 0;
+    vector<double> scores(filters.size(), -1.0);
+
+    for (size_t i = 0; i < filters.size(); ++i) {
+        auto it = costs.find(filters[i]->name());
+        if (it == costs.end()) continue;
+
+        scores[i] = it->second.score();
+        samples = std::max(samples, it->second.samples);
+    }
+
+    if (samples < minOrderingSamples) return {};
+
+    vector<unsigned> order(filters.size());
+    iota(order.begin(), order.end(), 0);
+
+    // Filters are sorted by priority so the pinned filters are all at the end.
+    size_t pinned = 0;
+    while (pinned < filters.size()
+            && filters[pinned]->priority() < Priority::AdaptiveLimit)
+        ++pinned;
+
+    // Unmeasured filters have a negative score and keep their priority order
+    // at the end of the reorderable filters.
+    stable_sort(order.begin(), order.begin() + pinned,
+            [&] (unsigned lhs, unsigned rhs) {
+                return scores[lhs] > scores[rhs];
+            });
+
+    return order;
+}
+
+void
+FilterPool::
+reorderFilters()
+{
+    if (!adaptiveOrdering) return;
+
+    std::unordered_map<string, FilterCosts> snapshot;
+    {
+        std::lock_guard<ML::Spinlock> guard(costsLock);
+        snapshot = costs;
+
+        // Older samples fade out so that we can follow the traffic mix.
+        for (auto& exchange : costs)
+            for (auto& filter : exchange.second)
+                filter.second.decay(0.5);
+    }
+
+    GcLockBase::SharedGuard guard(gc);
+
+    Data* oldData = data.load();
+    unique_ptr<Data> newData;
+
+    do {
+        newData.reset(new Data(*oldData));
+        newData->orders.clear();
+
+        for (const auto& entry : snapshot) {
+            auto order = computeOrder(newData.get(), entry.second);
+            if (order.empty()) continue;
+            newData->orders[entry.first] = std::move(order);
+        }
+    } while (!setData(oldData, newData));
+
+    if (!events) return;
+
+    events->recordHit("filters.reorder");
+
+    const Data* current = data.load();
+    for (const auto& entry : current->orders) {
+        string exchange = entry.first.empty() ? "all" : entry.first;
+
+        for (size_t i = 0; i < entry.second.size(); ++i) {
+            events->recordLevel(i, "filters.order.%s.%s",
+                    exchange, current->filters[entry.second[i]]->name());
+        }
+    }
+}
+
+
+/******************************************************************************/
+/* FILTER POOL - CONFIGURATION                                                */
+/******************************************************************************/
+
 void
 FilterPool::
 addFilter(const string& name)
@@ -247,42 +550,87 @@ initWithFiltersFromJson(const Json::Value & json)
 }
 
 
-unsigned
-FilterPool::
+void
+FilterPool::ConfigBatch::
 addConfig(const string& name, const AgentInfo& info)
 {
+    changes.push_back({ true, ConfigEntry(name, info) });
+}
+
+void
+FilterPool::ConfigBatch::
+removeConfig(const string& name)
+{
+    changes.push_back({ false, ConfigEntry(name) });
+}
+
+
+unordered_map<string, unsigned>
+FilterPool::
+applyConfigs(const ConfigBatch& batch)
+{
+    unordered_map<string, unsigned> indexes;
+    if (batch.empty()) return indexes;
+
     GcLockBase::SharedGuard guard(gc);
 
     unique_ptr<Data> newData;
     Data* oldData = data.load();
-    unsigned index;
 
     do {
+        indexes.clear();
         newData.reset(new Data(*oldData));
-        index = newData->addConfig(name, info);
+
+        for (const auto& change : batch.changes) {
+            const string& name = change.entry.name;
+
+            if (change.add)
+                indexes[name] = newData->addConfig(change.entry);
+            else {
+                newData->removeConfig(name);
+                indexes.erase(name);
+            }
+        }
     } while (!setData(oldData, newData));
 
-    if (events) events->recordHit("filters.addConfig");
+    if (events) {
+        size_t added = 0;
+        for (const auto& change : batch.changes) added += change.add;
 
-    return index;
+        events->recordCount(added, "filters.addConfig");
+        events->recordCount(batch.size() - added, "filters.removeConfig");
+        events->recordLevel(batch.size(), "filters.configBatchSize");
+    }
+
+    return indexes;
 }
 
 
-void
+unsigned
 FilterPool::
-removeConfig(const string& name)
+addConfig(const string& name, const AgentInfo& info)
 {
-    GcLockBase::SharedGuard guard(gc);
+    ConfigBatch batch;
+    batch.addConfig(name, info);
+    return applyConfigs(batch)[name];
+}
 
-    unique_ptr<Data> newData;
-    Data* oldData = data.load();
 
-    do {
-        newData.reset(new Data(*oldData));
-        newData->removeConfig(name);
-    } while (!setData(oldData, newData));
+void
+FilterPool::
+removeConfig(const string& name)
+{
+    ConfigBatch batch;
+    batch.removeConfig(name);
+    applyConfigs(batch);
+}
 
-    if (events) events->recordHit("filters.removeConfig");
+uint32_t
+FilterPool::
+requiredFields() const
+{
+    GcLockBase::SharedGuard guard(gc, GcLockBase::RD_NO);
+    return data.load()->requiredFields;
 }
 
 std::vector<string>
@@ -295,7 +643,7 @@ getFilterNames() const
     std::vector<string> filter_names;
     filter_names.reserve(current->filters.size());
 
-    for (FilterBase* filter : current->filters) {
+    for (const auto& filter : current->filters) {
         filter_names.push_back(filter->name());
     }
 
@@ -309,19 +657,31 @@ getFilterNames() const
 
 FilterPool::Data::
 Data(const Data& other) :
+    filters(other.filters),
+    requiredFields(other.requiredFields),
     configs(other.configs),
-    activeConfigs(other.activeConfigs)
-{
-    filters.reserve(other.filters.size());
-    for (FilterBase* filter : other.filters)
-        filters.push_back(filter->clone());
-}
+    activeConfigs(other.activeConfigs),
+    shards(other.shards),
+    shardMasks(other.shardMasks),
+    shardKeys(other.shardKeys),
+    orders(other.orders)
+{}
 
 
 FilterPool::Data::
 ~Data()
+{}
+
+FilterBase*
+FilterPool::Data::
+mutableFilter(size_t index)
 {
-    for (FilterBase* filter : filters) delete filter;
+    // The old versions of the data hold a reference to every filter that they
+    // share with us until they're reclaimed by the gc. Readers never take a
+    // reference of their own so a unique filter can't be in use.
+    auto& filter = filters[index];
+    if (!filter.unique()) filter.reset(filter->clone());
+    return filter.get();
 }
 
 ssize_t
@@ -336,24 +696,25 @@ findConfig(const string& name) const
 
 unsigned
 FilterPool::Data::
-addConfig(const string& name, const AgentInfo& info)
+addConfig(const ConfigEntry& entry)
 {
     // If our config already exists, we have to deregister it with the filters
     // before we can add the new config.
-    removeConfig(name);
+    removeConfig(entry.name);
 
     ssize_t index = findConfig("");
     if (index >= 0)
-        configs[index] = ConfigEntry(name, info);
+        configs[index] = entry;
     else {
         index = configs.size();
-        configs.emplace_back(name, info);
+        configs.push_back(entry);
+        updateShards();
     }
 
-    activeConfigs.setConfig(index, info.config->creatives.size());
+    activeConfigs.setConfig(index, entry.config->creatives.size());
 
-    for (FilterBase* filter : filters)
-        filter->addConfig(index, info.config);
+    for (size_t i = 0; i < filters.size(); ++i)
+        mutableFilter(i)->addConfig(index, entry.config);
 
     return index;
 }
@@ -367,13 +728,49 @@ removeConfig(const string& name)
 
     activeConfigs.resetConfig(index);
 
-    for (FilterBase* filter : filters)
-        filter->removeConfig(index, configs[index].config);
+    for (size_t i = 0; i < filters.size(); ++i)
+        mutableFilter(i)->removeConfig(index, configs[index].config);
 
     configs[index].reset();
 }
 
 
+void
+FilterPool::Data::
+setShards(unsigned shards)
+{
+    this->shards = shards;
+    updateShards();
+}
+
+void
+FilterPool::Data::
+updateShards()
+{
+    shardMasks.clear();
+    shardKeys.clear();
+    if (shards <= 1) return;
+
+    // Shards are made of whole ConfigSet words to avoid false sharing and to
+    // keep the bitfield operations of each shard on contiguous words.
+    const size_t div = ConfigSet::Div;
+    size_t words = (configs.size() + div - 1) / div;
+    if (words < 2) return;
+
+    size_t wordsPerShard = (words + shards - 1) / shards;
+
+    for (size_t first = 0; first < words; first += wordsPerShard) {
+        size_t last = std::min(words, first + wordsPerShard);
+
+        ConfigSet mask;
+        for (size_t cfg = first * div; cfg < last * div; ++cfg)
+            mask.set(cfg);
+        shardMasks.push_back(mask);
+        shardKeys.push_back((uint64_t(first) << 32) | last);
+    }
+}
+
+
 ssize_t
 FilterPool::Data::
 findFilter(const string& name) const
@@ -396,10 +793,15 @@ addFilter(FilterBase* filter)
         filter->addConfig(cfgId, configs[cfgId].config);
     }
 
-    filters.push_back(filter);
-    sort(filters.begin(), filters.end(), [] (FilterBase* lhs, FilterBase* rhs) {
+    filters.emplace_back(filter);
+    requiredFields |= filter->requiredFields();
+    sort(filters.begin(), filters.end(),
+            [] (const shared_ptr<FilterBase>& lhs, const shared_ptr<FilterBase>& rhs) {
                 return lhs->priority() < rhs->priority();
             });
+
+    // Indexes are no longer valid; wait for the next reorder.
+    orders.clear();
 }
 
 void
@@ -409,12 +811,14 @@ removeFilter(const string& name)
     ssize_t index = findFilter(name);
     if (index < 0) return;
 
-    delete filters[index];
+    filters.erase(filters.begin() + index);
 
-    for (size_t i = index; i < filters.size() - 1; ++i)
-        filters[i] = filters[i+1];
+    requiredFields = BidRequestFields::NONE;
+    for (const auto& filter : filters)
+        requiredFields |= filter->requiredFields();
 
-    filters.pop_back();
+    // Indexes are no longer valid; wait for the next reorder.
+    orders.clear();
 }
 
 } // namepsace RTBKit
@@ -10,11 +10,13 @@
 
 #include "rtbkit/common/filter.h"
 #include "soa/gc/gc_lock.h"
+#include "jml/arch/spinlock.h"
 
 #include <atomic>
 #include <vector>
 #include <memory>
 #include <string>
+#include <unordered_map>
 
 
 namespace Datacratic {
@@ -23,6 +25,12 @@ struct EventRecorder;
 
 } // namespace Datacratic
 
+namespace ML {
+
+class Worker_Task;
+
+} // namespace ML
+
 namespace RTBKIT {
 
 struct BidRequest;
@@ -44,8 +52,40 @@ struct FilterPool
 
     void init(EventRecorder* events = nullptr);
 
+    /** Splits the config space into the given number of shards made of
+        contiguous ConfigSet words and evaluates the filters of each shard in
+        parallel using a pool of the given number of threads. The thread
+        calling filter also takes part in the work. A value of 1 for shards
+        disables the sharding.
+
+        Must be called before any filtering takes place.
+     */
+    void initShards(unsigned shards, unsigned threads);
+
+    /** Enables the adaptive ordering of the filters. The cost and the
+        selectivity of each filter is sampled while filtering and
+        reorderFilters will then order the filters by the expected fraction of
+        configs eliminated per microsecond. If perExchange is set then a
+        different order is kept for each exchange. An order is only computed
+        once at least minSamples bid requests were sampled.
+
+        Filters with a priority of Priority::AdaptiveLimit or more are never
+        reordered.
+
+        Must be called before any filtering takes place.
+     */
+    void initAdaptiveOrdering(bool perExchange = true, size_t minSamples = 1000);
+
+    /** Recomputes the filter orders from the sampled stats and publishes them.
+        Does nothing unless initAdaptiveOrdering was called. Should be called
+        periodically.
+     */
+    void reorderFilters();
+
     struct ConfigEntry
     {
+        explicit ConfigEntry(std::string name = "") : name(std::move(name)) {}
+
         ConfigEntry(std::string name, const AgentInfo& info) :
             name(std::move(name)),
             config(info.config),
@@ -76,17 +116,55 @@ struct FilterPool
             const ConfigSet& mask = ConfigSet(true));
 
 
-    // \todo Need batch interfaces of these to alleviate overhead.
     void addFilter(const std::string& name);
     void removeFilter(const std::string& name);
     void initWithDefaultFilters();
     void initWithFiltersFromJson(const Json::Value & json);
 
 
-    // \todo Need batch interfaces to alleviate overhead.
+    /** Sequence of config changes which are applied in order to a single copy
+        of the filter data and published at once by applyConfigs.
+     */
+    struct ConfigBatch
+    {
+        void addConfig(const std::string& name, const AgentInfo& info);
+        void removeConfig(const std::string& name);
+
+        bool empty() const { return changes.empty(); }
+        size_t size() const { return changes.size(); }
+        void clear() { changes.clear(); }
+
+    private:
+        friend struct FilterPool;
+
+        struct Change
+        {
+            bool add;
+            ConfigEntry entry;
+        };
+
+        std::vector<Change> changes;
+    };
+
+    /** Applies all the changes of the batch and publishes the result with a
+        single copy-and-swap. Filters are shared between successive versions
+        of the filter data and only the filters that are modified get cloned,
+        at most once per batch.
+
+        Returns the index of every config that is still registered at the end
+        of the batch and was added by it, keyed by name.
+     */
+    std::unordered_map<std::string, unsigned>
+    applyConfigs(const ConfigBatch& batch);
+
     unsigned addConfig(const std::string& name, const AgentInfo& info);
     void removeConfig(const std::string& name);
 
+    /** Groups of top level fields of the bid request (see BidRequestFields)
+        read by the filters of the pool.
+     */
+    uint32_t requiredFields() const;
+
     // Added for test purposes
     std::vector<string> getFilterNames() const;
 
@@ -94,35 +172,111 @@ private:
 
     struct Data
     {
-        Data() {}
+        Data() : requiredFields(BidRequestFields::NONE), shards(1) {}
         Data(const Data& other);
         ~Data();
 
         ssize_t findConfig(const std::string& name) const;
-        unsigned addConfig(const std::string& name, const AgentInfo& info);
+        unsigned addConfig(const ConfigEntry& entry);
         void removeConfig(const std::string& name);
 
         ssize_t findFilter(const std::string& name) const;
         void addFilter(FilterBase* filter);
         void removeFilter(const std::string& name);
 
-        // \todo Use unique_ptr when moving to gcc 4.7
-        std::vector<FilterBase*> filters;
+        // Returns a filter that can be modified, cloning it if it's shared
+        // with another version of the data.
+        FilterBase* mutableFilter(size_t index);
+
+        void setShards(unsigned shards);
+        void updateShards();
+
+        // Filters are immutable once published and are shared between the
+        // versions of the data that didn't modify them.
+        std::vector< std::shared_ptr<FilterBase> > filters;
+
+        // Union of the requiredFields of the filters.
+        uint32_t requiredFields;
 
         std::vector<ConfigEntry> configs;
         CreativeMatrix activeConfigs;
+
+        // Mask of the configs covered by each shard. Empty if unsharded.
+        unsigned shards;
+        std::vector<ConfigSet> shardMasks;
+
+        // Non-zero key of each shard mask derived from the words it covers.
+        std::vector<uint64_t> shardKeys;
+
+        // Adaptive filter orders as indexes into filters keyed by exchange
+        // where the empty key is the order for all exchanges. Filters are run
+        // in priority order if there are no matching entries.
+        std::unordered_map<std::string, std::vector<unsigned> > orders;
+    };
+
+    struct FilterCost
+    {
+        FilterCost() : samples(0), ticks(0), input(0), eliminated(0) {}
+
+        double samples;
+        double ticks;
+        double input;
+        double eliminated;
+
+        void add(const FilterCost& other);
+        void decay(double factor);
+
+        // Expected fraction of configs eliminated per tick.
+        double score() const;
     };
 
+    // Filter name to cost.
+    typedef std::unordered_map<std::string, FilterCost> FilterCosts;
+
+    void recordCosts(
+            const std::string& exchange,
+            const Data* data,
+            const std::vector<unsigned>* order,
+            const std::vector<FilterCost>& costs);
+    std::vector<unsigned>
+    computeOrder(const Data* data, const FilterCosts& costs) const;
+
+    typedef std::unordered_map<unsigned, BiddableSpots> BiddableSpotsMap;
+
+    void filterShard(
+            const Data* current, FilterState& state,
+            bool sampleStats, int shard);
+    const std::vector<unsigned>*
+    findOrder(const Data* current, const BidRequest& br) const;
+    void filterSharded(
+            const Data* current,
+            const BidRequest& br,
+            const ExchangeConnector* conn,
+            const ConfigSet& mask,
+            bool sampleStats,
+            ConfigSet& configs,
+            BiddableSpotsMap& biddableSpots);
+
     bool setData(Data*&, std::unique_ptr<Data>&);
     void recordDiff(const Data* data, const FilterBase* f, const ConfigSet& diff);
     void recordReason(const Data* data, const FilterBase* f, FilterState & state);
-    uint64_t recordTime(uint64_t ticks, const FilterBase* filter);
+    uint64_t recordTime(uint64_t ticks, const FilterBase* filter, int shard = -1);
 
     std::atomic<Data*> data;
     std::vector< std::shared_ptr<AgentConfig> > configs;
     mutable Datacratic::GcLock gc;
 
     EventRecorder* events;
+
+    std::unique_ptr<ML::Worker_Task> shardWorkers;
+
+    bool adaptiveOrdering;
+    bool perExchangeOrdering;
+    size_t minOrderingSamples;
+
+    // Exchange to filter costs where the empty key aggregates all exchanges.
+    ML::Spinlock costsLock;
+    std::unordered_map<std::string, FilterCosts> costs;
 };
 
 } // namespace RTBKIT
@@ -0,0 +1,328 @@
+/** compiled_regex.cc                                 -*- C++ -*-
+    Copyright (c) 2013 Datacratic.  All rights reserved.
+
+    Implementation of the multi-regex utilities.
+
+*/
+
+#include "compiled_regex.h"
+#include "jml/arch/thread_specific.h"
+#include "jml/utils/exc_assert.h"
+
+#include <deque>
+#include <limits>
+#include <cctype>
+
+
+using namespace std;
+
+
+namespace RTBKIT {
+
+
+/******************************************************************************/
+/* REQUIRED LITERAL                                                           */
+/******************************************************************************/
+
+namespace {
+
+bool isUtf8Continuation(char c)
+{
+    return (uint8_t(c) & 0xC0) == 0x80;
+}
+
+// Returns the index of the character closing the bracket expression that
+// starts at pos or npos if the expression is never closed.
+size_t skipClass(const string& pattern, size_t pos)
+{
+    size_t i = pos + 1;
+    if (i < pattern.size() && pattern[i] == '^') ++i;
+    if (i < pattern.size() && pattern[i] == ']') ++i;
+
+    for (; i < pattern.size(); ++i) {
+        if (pattern[i] == '\\') ++i;
+        else if (pattern[i] == ']') return i;
+    }
+
+    return string::npos;
+}
+
+// Returns the index of the parenthesis closing the group that starts at pos
+// or npos if the group is never closed.
+size_t skipGroup(const string& pattern, size_t pos)
+{
+    size_t depth = 0;
+
+    for (size_t i = pos; i < pattern.size(); ++i) {
+        char c = pattern[i];
+
+        if (c == '\\') ++i;
+        else if (c == '[') {
+            i = skipClass(pattern, i);
+            if (i == string::npos) return i;
+        }
+        else if (c == '(') ++depth;
+        else if (c == ')' && --depth == 0) return i;
+    }
+
+    return string::npos;
+}
+
+// Escapes that are followed by arguments: hex, octal and control codes,
+// unicode properties and names, back-references. Where their arguments end
+// depends on the syntax so the scan stops there instead.
+bool hasArguments(char c)
+{
+    switch (c) {
+    case 'x': case 'o': case 'c': case 'u': case 'U': case 'N':
+    case 'p': case 'P': case 'k': case 'g':
+        return true;
+    default:
+        return isdigit(c);
+    }
+}
+
+// Alternations at the top level mean that there's no single required
+// literal. Flags like (?i) change what a literal means so we don't try.
+bool isAnalyzable(const string& pattern)
+{
+    size_t depth = 0;
+
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        char c = pattern[i];
+
+        if (c == '\\') {
+            if (i + 1 < pattern.size() && pattern[i + 1] == 'Q') return false;
+            ++i;
+        }
+        else if (c == '[') {
+            i = skipClass(pattern, i);
+            if (i == string::npos) return false;
+        }
+        else if (c == '(') {
+            if (i + 1 < pattern.size() && pattern[i + 1] == '?') return false;
+            ++depth;
+        }
+        else if (c == ')') {
+            if (!depth) return false;
+            --depth;
+        }
+        else if (c == '|' && !depth) return false;
+    }
+
+    return !depth;
+}
+
+} // namespace anonymous
+
+
+bool
+requiredLiteral(const string& pattern, string& literal, bool& pure)
+{
+    literal.clear();
+    pure = false;
+
+    if (pattern.empty() || !isAnalyzable(pattern)) return false;
+
+    bool isPure = true;
+    string current;
+    size_t lastAtom = string::npos; // start of the last atom in current.
+
+    auto endRun = [&] {
+        if (current.size() > literal.size()) literal = current;
+        current.clear();
+        lastAtom = string::npos;
+    };
+
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        char c = pattern[i];
+
+        switch (c) {
+
+        case '\\':
+            if (i + 1 >= pattern.size()) return false;
+
+            if (hasArguments(pattern[i + 1])) {
+                isPure = false;
+                endRun();
+                i = pattern.size();
+                break;
+            }
+
+            // Character classes (\d, \w) and anchors (\b).
+            if (isalnum(pattern[i + 1])) {
+                isPure = false;
+                endRun();
+            }
+            else {
+                lastAtom = current.size();
+                current += pattern[i + 1];
+            }
+            ++i;
+            break;
+
+        case '[':
+            isPure = false;
+            endRun();
+            i = skipClass(pattern, i);
+            break;
+
+        case '(':
+            isPure = false;
+            endRun();
+            i = skipGroup(pattern, i);
+            break;
+
+        case '*':
+        case '?':
+        case '{':
+            // The previous atom is optional so it's not part of the literal.
+            if (lastAtom != string::npos) current.resize(lastAtom);
+            isPure = false;
+            endRun();
+            if (c == '{') {
+                i = pattern.find('}', i);
+                if (i == string::npos) return false;
+            }
+            break;
+
+        case '+':
+            isPure = false;
+            endRun();
+            break;
+
+        case '.':
+        case '^':
+        case '$':
+            isPure = false;
+            endRun();
+            break;
+
+        default:
+            // Multi-byte utf-8 characters are a single atom.
+            if (!isUtf8Continuation(c)) lastAtom = current.size();
+            current += c;
+            break;
+        }
+
+        if (i == string::npos) return false;
+    }
+
+    endRun();
+
+    if (literal.empty()) return false;
+
+    pure = isPure;
+    return true;
+}
+
+
+/******************************************************************************/
+/* MULTI LITERAL MATCHER                                                      */
+/******************************************************************************/
+
+MultiLiteralMatcher::
+MultiLiteralMatcher() :
+    numLiterals(0), numClasses(1)
+{
+    classes.fill(0);
+}
+
+MultiLiteralMatcher::
+MultiLiteralMatcher(const vector<string>& literals) :
+    numLiterals(literals.size()), numClasses(1)
+{
+    classes.fill(0);
+    if (literals.empty()) return;
+
+    // Bytes that don't appear in any literal all share the class 0.
+    for (const string& literal : literals)
+        for (char c : literal)
+            if (!classes[uint8_t(c)]) classes[uint8_t(c)] = numClasses++;
+
+    const uint32_t None = numeric_limits<uint32_t>::max();
+
+    // Build the trie.
+    transitions.assign(numClasses, None);
+    vector< vector<uint32_t> > stateOutputs(1);
+
+    for (size_t id = 0; id < literals.size(); ++id) {
+        uint32_t state = 0;
+
+        for (char c : literals[id]) {
+            uint32_t& next = transitions[state * numClasses + classes[uint8_t(c)]];
+
+            if (next == None) {
+                next = stateOutputs.size();
+                stateOutputs.emplace_back();
+                transitions.resize(transitions.size() + numClasses, None);
+            }
+
+            state = transitions[state * numClasses + classes[uint8_t(c)]];
+        }
+
+        stateOutputs[state].push_back(id);
+    }
+
+    // Turn the trie into a DFA by following the failure links in breadth
+    // first order which guarantees that the fail state is complete.
+    vector<uint32_t> fail(stateOutputs.size(), 0);
+    deque<uint32_t> queue;
+
+    for (uint32_t cls = 0; cls < numClasses; ++cls) {
+        uint32_t& next = transitions[cls];
+        if (next == None) next = 0;
+        else queue.push_back(next);
+    }
+
+    while (!queue.empty()) {
+        uint32_t state = queue.front();
+        queue.pop_front();
+
+        const auto& failOutputs = stateOutputs[fail[state]];
+        stateOutputs[state].insert(
+                stateOutputs[state].end(), failOutputs.begin(), failOutputs.end());
+
+        for (uint32_t cls = 0; cls < numClasses; ++cls) {
+            uint32_t& next = transitions[state * numClasses + cls];
+            uint32_t failNext = transitions[fail[state] * numClasses + cls];
+
+            if (next == None) next = failNext;
+            else {
+                fail[next] = failNext;
+                queue.push_back(next);
+            }
+        }
+    }
+
+    // Flatten the outputs.
+    outputStart.reserve(stateOutputs.size() + 1);
+    for (const auto& entry : stateOutputs) {
+        outputStart.push_back(outputs.size());
+        outputs.insert(outputs.end(), entry.begin(), entry.end());
+    }
+    outputStart.push_back(outputs.size());
+
+    ExcAssertEqual(transitions.size(), stateOutputs.size() * numClasses);
+}
+
+
+/******************************************************************************/
+/* LITERAL MATCH BUFFER                                                       */
+/******************************************************************************/
+
+namespace {
+
+struct LiteralMatchBufferTag {};
+ML::Thread_Specific<vector<uint32_t>, LiteralMatchBufferTag> literalMatchBuffers;
+
+} // namespace anonymous
+
+vector<uint32_t>&
+literalMatchBuffer()
+{
+    return *literalMatchBuffers;
+}
+
+
+} // namespace RTBKIT
@@ -0,0 +1,94 @@
+/** compiled_regex.h                                 -*- C++ -*-
+    Copyright (c) 2013 Datacratic.  All rights reserved.
+
+    Utilities to evaluate a large number of regexes in a single pass over a
+    string. Each regex is reduced to a literal that any match must contain and
+    all the literals are compiled into a single Aho-Corasick automaton. Only
+    the regexes whose literal was found need to be evaluated afterwards.
+
+*/
+
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+namespace RTBKIT {
+
+
+/******************************************************************************/
+/* REQUIRED LITERAL                                                           */
+/******************************************************************************/
+
+/** Extracts the longest literal that has to appear in any string matched by
+    the given perl-style regex. The analysis is conservative: it gives up on
+    alternations, flags and escapes that it doesn't understand.
+
+    Returns false if no literal could be extracted in which case the regex has
+    to be evaluated for every string. If the regex is made of nothing but a
+    literal then pure is set and the regex doesn't need to be evaluated at all
+    once the literal is found.
+ */
+bool requiredLiteral(const std::string& pattern, std::string& literal, bool& pure);
+
+
+/******************************************************************************/
+/* MULTI LITERAL MATCHER                                                      */
+/******************************************************************************/
+
+/** Aho-Corasick automaton that finds all the occurences of a set of literals
+    in a single pass over a string.
+
+    The automaton is compiled into a DFA where the bytes are first mapped to
+    equivalence classes to keep the transition table small. The object is
+    immutable once compiled and can be used from multiple threads.
+ */
+struct MultiLiteralMatcher
+{
+    MultiLiteralMatcher();
+
+    // The id of each literal is its index in the vector.
+    explicit MultiLiteralMatcher(const std::vector<std::string>& literals);
+
+    size_t size() const { return numLiterals; }
+    size_t states() const { return outputStart.empty() ? 0 : outputStart.size() - 1; }
+
+    /** Calls onMatch with the id of the literal for every occurence of a
+        literal in the string. An id can be reported more then once.
+     */
+    template<typename Fn>
+    void match(const char* str, size_t len, Fn&& onMatch) const
+    {
+        if (transitions.empty()) return;
+
+        uint32_t state = 0;
+        for (size_t i = 0; i < len; ++i) {
+            state = transitions[state * numClasses + classes[uint8_t(str[i])]];
+
+            for (uint32_t j = outputStart[state]; j < outputStart[state + 1]; ++j)
+                onMatch(outputs[j]);
+        }
+    }
+
+private:
+    size_t numLiterals;
+
+    uint32_t numClasses;
+    std::array<uint16_t, 256> classes;
+
+    std::vector<uint32_t> transitions;
+    std::vector<uint32_t> outputStart;
+    std::vector<uint32_t> outputs;
+};
+
+/** Buffer owned by the calling thread in which the ids reported by a
+    MultiLiteralMatcher can be collected without allocating on every string.
+    The caller is expected to clear it before use.
+ */
+std::vector<uint32_t>& literalMatchBuffer();
+
+} // namespace RTBKIT
@@ -27,6 +27,7 @@ struct CreativeFormatFilter : public CreativeFilter<CreativeFormatFilter>
 {
     static constexpr const char* name = "CreativeFormat";
     unsigned priority() const { return Priority::CreativeFormat; }
+    uint32_t requiredFields() const { return BidRequestFields::NONE; }
 
     void addCreative(
             unsigned cfgIndex, unsigned crIndex, const Creative& creative)
@@ -87,6 +88,7 @@ struct CreativeLanguageFilter : public CreativeFilter<CreativeLanguageFilter>
 {
     static constexpr const char* name = "CreativeLanguage";
     unsigned priority() const { return Priority::CreativeLanguage; }
+    uint32_t requiredFields() const { return BidRequestFields::DEVICE; }
 
     void addCreative(
             unsigned cfgIndex, unsigned crIndex, const Creative& creative)
@@ -119,6 +121,7 @@ struct CreativeLocationFilter : public CreativeFilter<CreativeLocationFilter>
 {
     static constexpr const char* name = "CreativeLocation";
     unsigned priority() const { return Priority::CreativeLocation; }
+    uint32_t requiredFields() const { return BidRequestFields::DEVICE; }
 
     void addCreative(
             unsigned cfgIndex, unsigned crIndex, const Creative& creative)
@@ -153,6 +156,7 @@ struct CreativeExchangeNameFilter :
 {
     static constexpr const char* name = "CreativeExchangeName";
     unsigned priority() const { return Priority::CreativeExchangeName; }
+    uint32_t requiredFields() const { return BidRequestFields::NONE; }
 
 
     void addCreative(
@@ -186,6 +190,8 @@ struct CreativeExchangeFilter : public IterativeFilter<CreativeExchangeFilter>
 {
     static constexpr const char* name = "CreativeExchange";
     unsigned priority() const { return Priority::CreativeExchange; }
+    // What the exchange connector reads is up to the connector.
+    uint32_t requiredFields() const { return BidRequestFields::NONE; }
 
     void filter(FilterState& state) const
     {
@@ -243,6 +249,7 @@ struct CreativeSegmentsFilter : public CreativeFilter<CreativeSegmentsFilter>
     static constexpr const char* name = "CreativeSegments";
 
     unsigned priority() const { return Priority::CreativeSegments; }
+    uint32_t requiredFields() const { return BidRequestFields::SEGMENTS; }
 
     void addCreative(unsigned cfgIndex, unsigned crIndex,
                        const Creative& creative)
@@ -283,6 +290,7 @@ struct CreativePMPFilter : public CreativeFilter<CreativePMPFilter>
 {
     static constexpr const char* name = "CreativePMP";
     unsigned priority() const { return Priority::CreativePMP; }
+    uint32_t requiredFields() const { return BidRequestFields::NONE; }
 
 
     void addCreative(
@@ -0,0 +1,166 @@
+/** domain_trie.cc                                 -*- C++ -*-
+    Copyright (c) 2013 Datacratic.  All rights reserved.
+
+    Implementation of the domain suffix trie.
+
+*/
+
+#include "domain_trie.h"
+#include "jml/utils/exc_assert.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+using namespace std;
+
+
+namespace RTBKIT {
+
+
+/******************************************************************************/
+/* DOMAIN SUFFIX TRIE                                                         */
+/******************************************************************************/
+
+namespace {
+
+// Returns the start of the last label in [0, end).
+size_t labelStart(const char* str, size_t end)
+{
+    while (end > 0 && str[end - 1] != '.') --end;
+    return end;
+}
+
+} // namespace anonymous
+
+
+DomainSuffixTrie::
+DomainSuffixTrie() :
+    nodes(1, Node{ 0, 0, 0, Empty }),
+    slots(1, Empty),
+    slotMask(0)
+{}
+
+DomainSuffixTrie::
+DomainSuffixTrie(const vector<Domain>& domains) :
+    nodes(1, Node{ 0, 0, 0, Empty })
+{
+    // Every label can create a node so this is an upper bound. The table is
+    // kept at most half full to keep the probe sequences short.
+    size_t maxNodes = 0;
+    for (const Domain& domain : domains)
+        maxNodes += count(domain.name->begin(), domain.name->end(), '.') + 1;
+
+    size_t numSlots = 8;
+    while (numSlots < maxNodes * 2) numSlots *= 2;
+    slots.assign(numSlots, Empty);
+    slotMask = numSlots - 1;
+
+    for (const Domain& domain : domains) {
+        if (domain.configs->empty()) continue;
+
+        const char* name = domain.name->data();
+        size_t end = domain.name->size();
+        uint32_t node = Root;
+
+        while (true) {
+            size_t start = labelStart(name, end);
+            node = insertChild(node, name + start, end - start);
+
+            if (!start) break;
+            end = start - 1;
+        }
+
+        if (nodes[node].value == Empty) {
+            nodes[node].value = values.size();
+            values.push_back(*domain.configs);
+        }
+        else values[nodes[node].value] |= *domain.configs;
+    }
+}
+
+uint64_t
+DomainSuffixTrie::
+hashLabel(uint32_t parent, const char* label, size_t length)
+{
+    // FNV-1a seeded with the parent.
+    uint64_t hash = 14695981039346656037ULL ^ (uint64_t(parent) * 0x9E3779B97F4A7C15ULL);
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= uint8_t(label[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint32_t
+DomainSuffixTrie::
+findChild(uint32_t parent, const char* label, size_t length) const
+{
+    for (uint64_t slot = hashLabel(parent, label, length) & slotMask;;
+         slot = (slot + 1) & slotMask)
+    {
+        uint32_t id = slots[slot];
+        if (id == Empty) return Empty;
+
+        const Node& node = nodes[id];
+        if (node.parent == parent
+                && node.labelLength == length
+                && !memcmp(labels.data() + node.labelStart, label, length))
+            return id;
+    }
+}
+
+uint32_t
+DomainSuffixTrie::
+insertChild(uint32_t parent, const char* label, size_t length)
+{
+    uint64_t slot = hashLabel(parent, label, length) & slotMask;
+
+    for (;; slot = (slot + 1) & slotMask) {
+        uint32_t id = slots[slot];
+        if (id == Empty) break;
+
+        const Node& node = nodes[id];
+        if (node.parent == parent
+                && node.labelLength == length
+                && !memcmp(labels.data() + node.labelStart, label, length))
+            return id;
+    }
+
+    ExcAssertLess(nodes.size(), slots.size());
+
+    uint32_t id = nodes.size();
+    nodes.push_back(Node{ parent, uint32_t(labels.size()), uint32_t(length), Empty });
+    labels.append(label, length);
+    slots[slot] = id;
+
+    return id;
+}
+
+ConfigSet
+DomainSuffixTrie::
+match(const char* host, size_t length) const
+{
+    ConfigSet result;
+    if (values.empty()) return result;
+
+    size_t end = length;
+    uint32_t node = Root;
+
+    while (true) {
+        size_t start = labelStart(host, end);
+
+        node = findChild(node, host + start, end - start);
+        if (node == Empty) break;
+
+        uint32_t value = nodes[node].value;
+        if (value != Empty) result |= values[value];
+
+        if (!start) break;
+        end = start - 1;
+    }
+
+    return result;
+}
+
+} // namespace RTBKIT
@@ -0,0 +1,87 @@
+/** domain_trie.h                                 -*- C++ -*-
+    Copyright (c) 2013 Datacratic.  All rights reserved.
+
+    Suffix trie of domain names used to match a host against every domain it
+    belongs to without allocating.
+
+*/
+
+#pragma once
+
+#include "rtbkit/common/filter.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+namespace RTBKIT {
+
+
+/******************************************************************************/
+/* DOMAIN SUFFIX TRIE                                                         */
+/******************************************************************************/
+
+/** Trie of the labels of a set of domains in reverse order: "www.google.com"
+    is stored as com -> google -> www. A host matches a domain if the domain
+    is the host itself or any of the suffixes that start after a dot.
+
+    The children of every node live in a single open-addressed table keyed by
+    the parent node and the label so a lookup only hashes the labels of the
+    host in place and stops at the first label that isn't in the trie.
+
+    The trie is immutable once built and can be used from multiple threads.
+ */
+struct DomainSuffixTrie
+{
+    DomainSuffixTrie();
+
+    struct Domain
+    {
+        const std::string* name;
+        const ConfigSet* configs;
+    };
+
+    explicit DomainSuffixTrie(const std::vector<Domain>& domains);
+
+    /** Number of nodes excluding the root. */
+    size_t size() const { return nodes.size() - 1; }
+
+    /** Returns the union of the configs of every domain that the host
+        belongs to.
+     */
+    ConfigSet match(const char* host, size_t length) const;
+
+    ConfigSet match(const std::string& host) const
+    {
+        return match(host.data(), host.size());
+    }
+
+private:
+
+    enum { Root = 0, Empty = uint32_t(-1) };
+
+    struct Node
+    {
+        uint32_t parent;
+        uint32_t labelStart;
+        uint32_t labelLength;
+        uint32_t value; // Index in values or Empty.
+    };
+
+    static uint64_t hashLabel(uint32_t parent, const char* label, size_t length);
+
+    uint32_t findChild(uint32_t parent, const char* label, size_t length) const;
+    uint32_t insertChild(uint32_t parent, const char* label, size_t length);
+
+    std::vector<Node> nodes;
+    std::string labels;
+    std::vector<ConfigSet> values;
+
+    // Node ids indexed by hashLabel; sized to a power of two.
+    std::vector<uint32_t> slots;
+    uint64_t slotMask;
+};
+
+} // namespace RTBKIT
@@ -11,7 +11,10 @@
 
 LIB_FILTERS_SOURCES := \
 	static_filters.cc \
-        creative_filters.cc
+        creative_filters.cc \
+	compiled_regex.cc \
+	match_cache.cc \
+	domain_trie.cc
 
 LIB_FILTERS_LINK := \
 	arch utils filter_registry agent_configuration rtb
@@ -11,6 +11,10 @@
 #include "rtbkit/core/agent_configuration/agent_config.h"
 #include "rtbkit/core/agent_configuration/include_exclude.h"
 #include "rtbkit/common/filter.h"
+#include "compiled_regex.h"
+#include "domain_trie.h"
+
+#include <algorithm>
 
 
 namespace RTBKIT {
@@ -236,9 +240,15 @@ private:
 /* DOMAIN FILTER                                                              */
 /******************************************************************************/
 
+/** Matches a host against a set of domains where a domain matches the host
+    itself and all of its sub-domains. The domains are compiled into a suffix
+    trie which is rebuilt whenever the set of domains changes.
+ */
 template<typename Str>
 struct DomainFilter
 {
+    DomainFilter() : trie(std::make_shared<const DomainSuffixTrie>()) {}
+
     template<typename List>
     bool isEmpty(const List& list) const
     {
@@ -250,6 +260,7 @@ struct DomainFilter
     {
         for (const auto& value : list)
             addConfig(cfgIndex, value);
+        compile();
     }
 
     template<typename List>
@@ -257,20 +268,14 @@ struct DomainFilter
     {
         for (const auto& value : list)
             removeConfig(cfgIndex, value);
+        compile();
     }
 
     ConfigSet filter(const Url& host) const
     {
-        ConfigSet matches;
-
-        for (const auto& key : getKeys(host)) {
-            auto it = domainMap.find(key);
-            if (it == domainMap.end()) continue;
-
-            matches |= it->second;
-        }
-
-        return matches;
+        size_t length;
+        const char* data = host.hostData(length);
+        return trie->match(data, length);
     }
 
 private:
@@ -294,26 +299,28 @@ private:
 
     void removeConfig(unsigned cfgIndex, const Str& host)
     {
-        domainMap[host].reset(cfgIndex);
+        auto it = domainMap.find(host);
+        if (it == domainMap.end()) return;
+
+        it->second.reset(cfgIndex);
+        if (it->second.empty()) domainMap.erase(it);
     }
 
-    std::vector<std::string> getKeys(const Url& host) const
+    void compile()
     {
-        std::vector<std::string> keys;
-
-        std::string domain = host.host();
-        while (true) {
-            keys.push_back(domain);
+        std::vector<DomainSuffixTrie::Domain> domains;
+        domains.reserve(domainMap.size());
 
-            size_t pos = domain.find('.');
-            if (pos == std::string::npos) break;
-            domain = domain.substr(pos+1);
-        }
+        for (const auto& entry : domainMap)
+            domains.push_back({ &entry.first, &entry.second });
 
-        return keys;
+        trie = std::make_shared<const DomainSuffixTrie>(domains);
     }
 
     std::unordered_map<std::string, ConfigSet> domainMap;
+
+    // Shared between the clones of the filter since it's immutable.
+    std::shared_ptr<const DomainSuffixTrie> trie;
 };
 
 /******************************************************************************/
@@ -322,8 +329,8 @@ private:
 
 /** Generic include filter for regexes.
 
-    \todo We could add a TLS cache of all seen values such that we can avoid the
-    regex entirely.
+    Filters that see the same values over and over again can avoid the regexes
+    entirely by going through a FilterMatchCache (see match_cache.h).
  */
 template<typename Regex, typename Str>
 struct RegexFilter
@@ -348,12 +355,17 @@ struct RegexFilter
             removeConfig(cfgIndex, value);
     }
 
-    ConfigSet filter(const Str& str) const
+    /** Regexes whose configs are all outside the mask aren't evaluated. The
+        result is then only accurate within the mask.
+     */
+    ConfigSet filter(const Str& str, const ConfigSet* mask = nullptr) const
     {
         ConfigSet matches;
 
-        for (const auto& entry : data)
+        for (const auto& entry : data) {
+            if (mask && !entry.second.configs.intersects(*mask)) continue;
             matches |= entry.second.filter(str);
+        }
 
         return matches;
     }
@@ -410,6 +422,210 @@ private:
 };
 
 
+/******************************************************************************/
+/* COMPILED REGEX FILTER                                                      */
+/******************************************************************************/
+
+/** Drop-in replacement for RegexFilter which scales with the number of
+    distinct regexes. A literal that must be present in any match is extracted
+    from each regex and all the literals are compiled into a single
+    MultiLiteralMatcher. Filtering then does a single pass over the string and
+    only evaluates the regexes whose literal was found. Regexes that are plain
+    literals are never evaluated and the ones where no literal could be
+    extracted are always evaluated.
+
+    The compiled matcher is immutable and shared between the copies of the
+    filter so cloning the filter doesn't copy it. It's only rebuilt when a
+    regex is added or removed.
+ */
+template<typename Regex, typename Str>
+struct CompiledRegexFilter
+{
+    template<typename List>
+    bool isEmpty(const List& list) const
+    {
+        return list.empty();
+    }
+
+    template<typename List>
+    void addConfig(unsigned cfgIndex, const List& list)
+    {
+        bool changed = false;
+        for (const auto& value : list)
+            changed |= addConfig(cfgIndex, value);
+        if (changed) compile();
+    }
+
+    template<typename List>
+    void removeConfig(unsigned cfgIndex, const List& list)
+    {
+        bool changed = false;
+        for (const auto& value : list)
+            changed |= removeConfig(cfgIndex, value);
+        if (changed) compile();
+    }
+
+    /** Same as RegexFilter::filter(): regexes whose configs are all outside
+        the mask aren't evaluated.
+     */
+    ConfigSet filter(const Str& str, const ConfigSet* mask = nullptr) const
+    {
+        ConfigSet matches;
+
+        auto& candidates = literalMatchBuffer();
+        candidates.clear();
+
+        if (matcher) {
+            matcher->match(rawData(str), rawLength(str), [&] (uint32_t id) {
+                        candidates.push_back(id);
+                    });
+        }
+
+        std::sort(candidates.begin(), candidates.end());
+        auto last = std::unique(candidates.begin(), candidates.end());
+
+        for (auto it = candidates.begin(); it != last; ++it) {
+            const Pattern& pattern = patterns[*it];
+            if (mask && !pattern.configs.intersects(*mask)) continue;
+            if (pattern.pure || RTBKIT::matches(pattern.regex, str))
+                matches |= pattern.configs;
+        }
+
+        for (const Pattern& pattern : unfiltered) {
+            if (mask && !pattern.configs.intersects(*mask)) continue;
+            if (RTBKIT::matches(pattern.regex, str))
+                matches |= pattern.configs;
+        }
+
+        return matches;
+    }
+
+private:
+
+    typedef std::basic_string<typename Regex::value_type> KeyT;
+
+    struct Pattern
+    {
+        Pattern() : pure(false) {}
+
+        Regex regex;
+        ConfigSet configs;
+        bool pure;
+    };
+
+    struct Entry
+    {
+        Entry() : index(-1), filtered(false) {}
+
+        Pattern pattern;
+        std::string literal;
+
+        // Index in either patterns or unfiltered.
+        ssize_t index;
+        bool filtered;
+    };
+
+    // Returns true if the set of regexes changed.
+    bool addConfig(unsigned cfgIndex, const Regex& regex)
+    {
+        auto& entry = data[regex.str()];
+        entry.pattern.configs.set(cfgIndex);
+
+        if (entry.index >= 0) {
+            patternFor(entry).configs.set(cfgIndex);
+            return false;
+        }
+
+        entry.pattern.regex = regex;
+
+        // Literals are matched byte for byte so case-insensitive regexes
+        // always have to be evaluated.
+        entry.filtered =
+            !(regex.flags() & boost::regex_constants::icase) &&
+            requiredLiteral(source(regex), entry.literal, entry.pattern.pure);
+        return true;
+    }
+
+    bool addConfig(unsigned cfgIndex, const CachedRegex<Regex, Str>& regex)
+    {
+        return addConfig(cfgIndex, regex.base);
+    }
+
+    bool removeConfig(unsigned cfgIndex, const Regex& regex)
+    {
+        auto it = data.find(regex.str());
+        if (it == data.end()) return false;
+
+        it->second.pattern.configs.reset(cfgIndex);
+        if (it->second.pattern.configs.empty()) {
+            data.erase(it);
+            return true;
+        }
+
+        if (it->second.index >= 0)
+            patternFor(it->second).configs.reset(cfgIndex);
+        return false;
+    }
+
+    bool removeConfig(unsigned cfgIndex, const CachedRegex<Regex, Str>& regex)
+    {
+        return removeConfig(cfgIndex, regex.base);
+    }
+
+    Pattern& patternFor(const Entry& entry)
+    {
+        return entry.filtered ? patterns[entry.index] : unfiltered[entry.index];
+    }
+
+    void compile()
+    {
+        patterns.clear();
+        unfiltered.clear();
+
+        std::vector<std::string> literals;
+
+        for (auto& item : data) {
+            Entry& entry = item.second;
+
+            if (entry.filtered) {
+                entry.index = patterns.size();
+                patterns.push_back(entry.pattern);
+                literals.push_back(entry.literal);
+            }
+            else {
+                entry.index = unfiltered.size();
+                unfiltered.push_back(entry.pattern);
+            }
+        }
+
+        if (literals.empty()) matcher.reset();
+        else matcher = std::make_shared<const MultiLiteralMatcher>(literals);
+    }
+
+    static std::string source(const boost::regex& regex)
+    {
+        return regex.str();
+    }
+
+    static std::string source(const boost::u32regex& regex)
+    {
+        return jsonPrint(regex).asString();
+    }
+
+    static const char* rawData(const std::string& str) { return str.data(); }
+    static size_t rawLength(const std::string& str) { return str.size(); }
+
+    static const char* rawData(const Utf8String& str) { return str.rawData(); }
+    static size_t rawLength(const Utf8String& str) { return str.rawLength(); }
+
+    std::map<KeyT, Entry> data;
+
+    std::vector<Pattern> patterns;   // Indexed by literal id.
+    std::vector<Pattern> unfiltered; // Always evaluated.
+    std::shared_ptr<const MultiLiteralMatcher> matcher;
+};
+
+
 /******************************************************************************/
 /* LIST FILTER                                                                */
 /******************************************************************************/
@@ -633,4 +849,40 @@ private:
 };
 
 
+/******************************************************************************/
+/* SELECTABLE REGEX FILTER                                                    */
+/******************************************************************************/
+
+/** Include/exclude regex filter where the backend, RegexFilter or
+    CompiledRegexFilter, is picked when the filter is constructed.
+ */
+template<typename Regex, typename Str>
+struct SelectableRegexFilter
+{
+    explicit SelectableRegexFilter(bool compiled = false) :
+        compiled(compiled)
+    {}
+
+    bool isCompiled() const { return compiled; }
+
+    template<typename IE>
+    void setIncludeExclude(unsigned cfgIndex, bool value, const IE& ie)
+    {
+        if (compiled) compiledImpl.setIncludeExclude(cfgIndex, value, ie);
+        else basicImpl.setIncludeExclude(cfgIndex, value, ie);
+    }
+
+    ConfigSet filter(const Str& str, const ConfigSet* mask = nullptr) const
+    {
+        return compiled ?
+            compiledImpl.filter(str, mask) : basicImpl.filter(str, mask);
+    }
+
+private:
+    bool compiled;
+    IncludeExcludeFilter< RegexFilter<Regex, Str> > basicImpl;
+    IncludeExcludeFilter< CompiledRegexFilter<Regex, Str> > compiledImpl;
+};
+
+
 } // namespace RTBKIT
@@ -0,0 +1,286 @@
+/** match_cache.cc                                 -*- C++ -*-
+    Copyright (c) 2013 Datacratic.  All rights reserved.
+
+    Implementation of the filter match cache.
+
+*/
+
+#include "match_cache.h"
+#include "soa/service/service_base.h"
+#include "jml/arch/thread_specific.h"
+#include "jml/utils/exc_check.h"
+
+#include <mutex>
+#include <unordered_set>
+
+
+using namespace std;
+using namespace ML;
+
+
+namespace RTBKIT {
+
+
+/******************************************************************************/
+/* REGISTRY                                                                   */
+/******************************************************************************/
+
+namespace {
+
+struct Counters
+{
+    Counters() : hits(0), misses(0) {}
+    uint64_t hits;
+    uint64_t misses;
+};
+
+struct Registry
+{
+    Registry() : numCaches(0) {}
+
+    std::mutex lock;
+
+    // Stats slot of each cache name.
+    unsigned numCaches;
+    std::array<string, FilterMatchCacheTable::MaxCaches> names;
+
+    // Tables of the live threads and the counters of the dead ones.
+    unordered_set<FilterMatchCacheTable*> tables;
+    std::array<Counters, FilterMatchCacheTable::MaxCaches> retired;
+
+    // Snapshot of the counters taken by the last call to recordStats.
+    std::array<Counters, FilterMatchCacheTable::MaxCaches> recorded;
+
+    unsigned getId(const string& name)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+
+        for (unsigned i = 0; i < numCaches; ++i)
+            if (names[i] == name) return i;
+
+        ExcCheckLess(numCaches, names.size(), "Too many filter match caches");
+        names[numCaches] = name;
+        return numCaches++;
+    }
+
+    // Must be called with the lock held.
+    std::array<Counters, FilterMatchCacheTable::MaxCaches> sum() const
+    {
+        auto total = retired;
+
+        for (const FilterMatchCacheTable* table : tables) {
+            for (unsigned i = 0; i < numCaches; ++i) {
+                const auto& counters = table->counters[i];
+                total[i].hits += counters.hits.load(std::memory_order_relaxed);
+                total[i].misses += counters.misses.load(std::memory_order_relaxed);
+            }
+        }
+
+        return total;
+    }
+};
+
+Registry& registry()
+{
+    static Registry instance;
+    return instance;
+}
+
+std::atomic<size_t> capacityEpoch(0);
+std::atomic<uint64_t> generations(0);
+
+Thread_Specific<FilterMatchCacheTable> localTables;
+
+} // namespace anonymous
+
+
+/******************************************************************************/
+/* FILTER MATCH CACHE TABLE                                                   */
+/******************************************************************************/
+
+FilterMatchCacheTable::
+FilterMatchCacheTable() :
+    setMask(0), epoch(size_t(-1))
+{
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> guard(reg.lock);
+    reg.tables.insert(this);
+}
+
+FilterMatchCacheTable::
+~FilterMatchCacheTable()
+{
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> guard(reg.lock);
+
+    for (unsigned i = 0; i < reg.numCaches; ++i) {
+        reg.retired[i].hits += counters[i].hits.load();
+        reg.retired[i].misses += counters[i].misses.load();
+    }
+
+    reg.tables.erase(this);
+}
+
+void
+FilterMatchCacheTable::
+sync()
+{
+    size_t current = capacityEpoch.load(std::memory_order_relaxed);
+    if (epoch == current) return;
+    epoch = current;
+
+    // Round the number of sets up to a power of two to avoid a modulo.
+    size_t sets = 1;
+    while (sets * Ways < FilterMatchCache::capacity()) sets *= 2;
+
+    entries.clear();
+    entries.resize(sets * Ways);
+    hands.assign(sets, 0);
+    setMask = sets - 1;
+}
+
+const ConfigSet*
+FilterMatchCacheTable::
+find(uint64_t generation, uint64_t hash)
+{
+    Entry* set = &entries[(hash & setMask) * Ways];
+
+    for (size_t i = 0; i < Ways; ++i) {
+        Entry& entry = set[i];
+        if (entry.hash != hash || entry.generation != generation) continue;
+
+        entry.referenced = true;
+        return &entry.value;
+    }
+
+    return nullptr;
+}
+
+void
+FilterMatchCacheTable::
+insert(uint64_t generation, uint64_t hash, const ConfigSet& value)
+{
+    uint64_t setIndex = hash & setMask;
+    Entry* set = &entries[setIndex * Ways];
+    uint8_t& hand = hands[setIndex];
+
+    // Give a second chance to every entry that was used since the last time
+    // the hand went over it.
+    while (set[hand].referenced) {
+        set[hand].referenced = false;
+        hand = (hand + 1) % Ways;
+    }
+
+    Entry& entry = set[hand];
+    entry.generation = generation;
+    entry.hash = hash;
+    entry.value = value;
+
+    hand = (hand + 1) % Ways;
+}
+
+
+/******************************************************************************/
+/* FILTER MATCH CACHE                                                         */
+/******************************************************************************/
+
+std::atomic<size_t> FilterMatchCache::capacity_(4096);
+
+FilterMatchCache::
+FilterMatchCache(const string& name) :
+    id(registry().getId(name)),
+    generation(nextGeneration())
+{}
+
+FilterMatchCache::
+FilterMatchCache(const FilterMatchCache& other) :
+    id(other.id),
+    generation(nextGeneration())
+{}
+
+FilterMatchCache&
+FilterMatchCache::
+operator=(const FilterMatchCache& other)
+{
+    id = other.id;
+    generation = nextGeneration();
+    return *this;
+}
+
+uint64_t
+FilterMatchCache::
+nextGeneration()
+{
+    // 0 is reserved for the empty entries.
+    return ++generations;
+}
+
+FilterMatchCacheTable*
+FilterMatchCache::
+localTable()
+{
+    FilterMatchCacheTable* table = localTables.get();
+    table->sync();
+    return table;
+}
+
+void
+FilterMatchCache::
+setCapacity(size_t entries)
+{
+    capacity_ = entries;
+    capacityEpoch++;
+}
+
+vector<FilterMatchCache::Stats>
+FilterMatchCache::
+stats()
+{
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> guard(reg.lock);
+
+    auto total = reg.sum();
+
+    vector<Stats> result;
+    for (unsigned i = 0; i < reg.numCaches; ++i)
+        result.push_back({ reg.names[i], total[i].hits, total[i].misses });
+
+    return result;
+}
+
+void
+FilterMatchCache::
+recordStats(const EventRecorder& events)
+{
+    vector<Stats> deltas;
+    {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> guard(reg.lock);
+
+        auto total = reg.sum();
+
+        for (unsigned i = 0; i < reg.numCaches; ++i) {
+            deltas.push_back({
+                        reg.names[i],
+                        total[i].hits - reg.recorded[i].hits,
+                        total[i].misses - reg.recorded[i].misses });
+        }
+
+        reg.recorded = total;
+    }
+
+    for (const Stats& delta : deltas) {
+        const char* name = delta.name.c_str();
+        uint64_t lookups = delta.hits + delta.misses;
+
+        events.recordCount(delta.hits, "filters.cache.%s.hits", name);
+        events.recordCount(delta.misses, "filters.cache.%s.misses", name);
+
+        if (lookups) {
+            events.recordLevel(
+                    double(delta.hits) / lookups, "filters.cache.%s.hitRate", name);
+        }
+    }
+}
+
+} // namespace RTBKIT
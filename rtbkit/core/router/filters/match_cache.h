@@ -0,0 +1,173 @@
+/** match_cache.h                                 -*- C++ -*-
+    Copyright (c) 2013 Datacratic.  All rights reserved.
+
+    Thread-local cache of filter results keyed by the hash of the filtered
+    value. Most of the volume comes from a small number of sites so the same
+    urls and hosts are evaluated over and over again.
+
+*/
+
+#pragma once
+
+#include "rtbkit/common/filter.h"
+
+#include <array>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+
+namespace Datacratic {
+
+struct EventRecorder;
+
+} // namespace Datacratic
+
+
+namespace RTBKIT {
+
+
+/******************************************************************************/
+/* FILTER MATCH CACHE TABLE                                                   */
+/******************************************************************************/
+
+/** Per-thread table shared by all the caches. Entries are keyed by the
+    generation of the cache that inserted them which means that an entry can
+    never be returned to a different filter or to a different version of the
+    same filter.
+
+    The table is set-associative and uses the CLOCK algorithm within each set
+    to pick the entry to evict.
+ */
+struct FilterMatchCacheTable
+{
+    enum { Ways = 4, MaxCaches = 32 };
+
+    FilterMatchCacheTable();
+    ~FilterMatchCacheTable();
+
+    const ConfigSet* find(uint64_t generation, uint64_t hash);
+    void insert(uint64_t generation, uint64_t hash, const ConfigSet& value);
+
+    // Resizes the table if the global capacity changed since the last call.
+    void sync();
+
+    /** Only written by the thread that owns the table but read by the
+        thread aggregating the stats, hence the relaxed atomics.
+     */
+    struct Counters
+    {
+        Counters() : hits(0), misses(0) {}
+        std::atomic<uint64_t> hits;
+        std::atomic<uint64_t> misses;
+
+        static void inc(std::atomic<uint64_t>& counter)
+        {
+            counter.store(
+                    counter.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+        }
+    };
+
+    std::array<Counters, MaxCaches> counters;
+
+private:
+
+    struct Entry
+    {
+        Entry() : generation(0), hash(0), referenced(false) {}
+
+        uint64_t generation;
+        uint64_t hash;
+        bool referenced;
+        ConfigSet value;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<uint8_t> hands; // CLOCK hand of each set.
+    uint64_t setMask;
+    size_t epoch;
+};
+
+
+/******************************************************************************/
+/* FILTER MATCH CACHE                                                         */
+/******************************************************************************/
+
+/** Caches the result of a filter for a given value hash in a bounded
+    thread-local table.
+
+    Every instance gets a unique generation when it's constructed or copied
+    and the generation is bumped whenever the filter changes. Since the
+    FilterPool clones the filters before modifying them and publishing them,
+    a new version of the filter data never sees the entries of the old one.
+
+    Note that collisions of the 64 bit hash are not detected.
+ */
+struct FilterMatchCache
+{
+    explicit FilterMatchCache(const std::string& name);
+    FilterMatchCache(const FilterMatchCache& other);
+    FilterMatchCache& operator=(const FilterMatchCache& other);
+
+    /** Must be called whenever the result of the filter could change. */
+    void invalidate() { generation = nextGeneration(); }
+
+    /** Returns the cached value for the hash or calls compute to fill the
+        cache if it's missing.
+     */
+    template<typename Fn>
+    ConfigSet get(uint64_t hash, Fn&& compute) const
+    {
+        if (!capacity_.load(std::memory_order_relaxed)) return compute();
+
+        FilterMatchCacheTable* table = localTable();
+        auto& counters = table->counters[id];
+
+        if (const ConfigSet* value = table->find(generation, hash)) {
+            FilterMatchCacheTable::Counters::inc(counters.hits);
+            return *value;
+        }
+
+        FilterMatchCacheTable::Counters::inc(counters.misses);
+
+        ConfigSet value = compute();
+        table->insert(generation, hash, value);
+        return value;
+    }
+
+    /** Number of entries in the table of each thread. 0 disables caching.
+        Defaults to 4096.
+     */
+    static void setCapacity(size_t entries);
+    static size_t capacity() { return capacity_.load(); }
+
+    /** Records the hits, misses and hit rate of every cache since the last
+        call as filters.cache.<name>.*.
+     */
+    static void recordStats(const Datacratic::EventRecorder& events);
+
+    struct Stats
+    {
+        std::string name;
+        uint64_t hits;
+        uint64_t misses;
+    };
+
+    /** Cumulative stats of every cache summed over all the threads. */
+    static std::vector<Stats> stats();
+
+private:
+    static uint64_t nextGeneration();
+    static FilterMatchCacheTable* localTable();
+
+    static std::atomic<size_t> capacity_;
+
+    unsigned id;
+    uint64_t generation;
+
+    friend struct FilterMatchCacheTable;
+};
+
+} // namespace RTBKIT
@@ -46,6 +46,10 @@ struct Priority
     static constexpr unsigned LatLong              = 0xF200;
 
     static constexpr unsigned ExchangePost         = 0xFF00;
+
+    // Filters with a priority greater or equal to this value keep their
+    // position when the FilterPool adaptively reorders the filters.
+    static constexpr unsigned AdaptiveLimit        = 0xF000;
 };
 
 
@@ -16,6 +16,36 @@ using namespace ML;
 
 namespace RTBKIT {
 
+/******************************************************************************/
+/* REGEX FILTER BACKEND                                                       */
+/******************************************************************************/
+
+namespace {
+
+std::mutex regexBackendLock;
+std::unordered_set<std::string> compiledRegexFilters;
+
+} // namespace anonymous
+
+void
+RegexFilterBackend::
+setCompiled(const std::string& filter, bool value)
+{
+    std::lock_guard<std::mutex> guard(regexBackendLock);
+
+    if (value) compiledRegexFilters.insert(filter);
+    else compiledRegexFilters.erase(filter);
+}
+
+bool
+RegexFilterBackend::
+isCompiled(const std::string& filter)
+{
+    std::lock_guard<std::mutex> guard(regexBackendLock);
+    return compiledRegexFilters.count(filter);
+}
+
+
 /******************************************************************************/
 /* SEGMENT FILTER                                                             */
 /******************************************************************************/
@@ -9,6 +9,7 @@
 #pragma once
 
 #include "generic_filters.h"
+#include "match_cache.h"
 #include "priority.h"
 #include "rtbkit/common/exchange_connector.h"
 #include "jml/utils/compact_vector.h"
@@ -22,6 +23,22 @@
 namespace RTBKIT {
 
 
+/******************************************************************************/
+/* REGEX FILTER BACKEND                                                       */
+/******************************************************************************/
+
+/** Selects, by filter name, the regex filters that use CompiledRegexFilter
+    instead of evaluating every regex one by one. Only affects filters created
+    afterwards so this needs to be set before the filters are added to the
+    FilterPool (see Router::initFilters).
+ */
+struct RegexFilterBackend
+{
+    static void setCompiled(const std::string& filter, bool value = true);
+    static bool isCompiled(const std::string& filter);
+};
+
+
 /******************************************************************************/
 /* SEGMENTS FILTER                                                            */
 /******************************************************************************/
@@ -30,6 +47,7 @@ struct SegmentsFilter : public FilterBaseT<SegmentsFilter>
 {
     static constexpr const char* name = "Segments";
     unsigned priority() const { return Priority::Segments; }
+    uint32_t requiredFields() const { return BidRequestFields::SEGMENTS; }
 
     void setConfig(unsigned configIndex, const AgentConfig& config, bool value);
     void filter(FilterState& state) const;
@@ -64,6 +82,10 @@ struct UserPartitionFilter : public FilterBaseT<UserPartitionFilter>
 {
     static constexpr const char* name = "UserPartition";
     unsigned priority() const { return Priority::UserPartition; }
+    uint32_t requiredFields() const
+    {
+        return BidRequestFields::USER_IDS | BidRequestFields::DEVICE;
+    }
 
     void setConfig(unsigned cfgIndex, const AgentConfig& config, bool value);
     void filter(FilterState& state) const;
@@ -105,6 +127,7 @@ struct HourOfWeekFilter : public FilterBaseT<HourOfWeekFilter>
 
     static constexpr const char* name = "HourOfWeek";
     unsigned priority() const { return Priority::HourOfWeek; }
+    uint32_t requiredFields() const { return BidRequestFields::NONE; }
 
     void setConfig(unsigned configIndex, const AgentConfig& config, bool value)
     {
@@ -135,20 +158,28 @@ struct UrlFilter : public FilterBaseT<UrlFilter>
 {
     static constexpr const char* name = "Url";
     unsigned priority() const { return Priority::Url; }
+    uint32_t requiredFields() const { return BidRequestFields::SITE; }
+
+    UrlFilter() : impl(RegexFilterBackend::isCompiled(name)), cache(name) {}
 
     void setConfig(unsigned configIndex, const AgentConfig& config, bool value)
     {
         impl.setIncludeExclude(configIndex, value, config.urlFilter);
+        cache.invalidate();
     }
 
     void filter(FilterState& state) const
     {
-        state.narrowConfigs(impl.filter(state.request.url.toString()));
+        std::string url = state.request.url.toString();
+        state.narrowConfigs(
+                cache.get(hashString(url) ^ state.shardKey(), [&] {
+                            return impl.filter(url, state.shardMask());
+                        }));
     }
 
 private:
-    typedef RegexFilter<boost::regex, std::string> BaseFilter;
-    IncludeExcludeFilter<BaseFilter> impl;
+    SelectableRegexFilter<boost::regex, std::string> impl;
+    FilterMatchCache cache;
 };
 
 
@@ -160,19 +191,28 @@ struct HostFilter : public FilterBaseT<HostFilter>
 {
     static constexpr const char* name = "Host";
     unsigned priority() const { return Priority::Host; }
+    uint32_t requiredFields() const { return BidRequestFields::SITE; }
+
+    HostFilter() : cache(name) {}
 
     void setConfig(unsigned configIndex, const AgentConfig& config, bool value)
     {
         impl.setIncludeExclude(configIndex, value, config.hostFilter);
+        cache.invalidate();
     }
 
     void filter(FilterState& state) const
     {
-        state.narrowConfigs(impl.filter(state.request.url));
+        const Url& url = state.request.url;
+        size_t length;
+        const char* host = url.hostData(length);
+        state.narrowConfigs(
+                cache.get(hashString(host, length), [&] { return impl.filter(url); }));
     }
 
 private:
     IncludeExcludeFilter< DomainFilter<std::string> > impl;
+    FilterMatchCache cache;
 };
 
 
@@ -184,20 +224,28 @@ struct LanguageFilter : public FilterBaseT<LanguageFilter>
 {
     static constexpr const char* name = "Language";
     unsigned priority() const { return Priority::Language; }
+    uint32_t requiredFields() const { return BidRequestFields::DEVICE; }
+
+    LanguageFilter() : impl(RegexFilterBackend::isCompiled(name)), cache(name) {}
 
     void setConfig(unsigned configIndex, const AgentConfig& config, bool value)
     {
         impl.setIncludeExclude(configIndex, value, config.languageFilter);
+        cache.invalidate();
     }
 
     void filter(FilterState& state) const
     {
-        state.narrowConfigs(impl.filter(state.request.language.utf8String()));
+        std::string language = state.request.language.utf8String();
+        state.narrowConfigs(
+                cache.get(hashString(language) ^ state.shardKey(), [&] {
+                            return impl.filter(language, state.shardMask());
+                        }));
     }
 
 private:
-    typedef RegexFilter<boost::regex, std::string> BaseFilter;
-    IncludeExcludeFilter<BaseFilter> impl;
+    SelectableRegexFilter<boost::regex, std::string> impl;
+    FilterMatchCache cache;
 };
 
 
@@ -209,6 +257,9 @@ struct LocationFilter : public FilterBaseT<LocationFilter>
 {
     static constexpr const char* name = "Location";
     unsigned priority() const { return Priority::Location; }
+    uint32_t requiredFields() const { return BidRequestFields::DEVICE; }
+
+    LocationFilter() : impl(RegexFilterBackend::isCompiled(name)) {}
 
     void setConfig(unsigned configIndex, const AgentConfig& config, bool value)
     {
@@ -218,12 +269,11 @@ struct LocationFilter : public FilterBaseT<LocationFilter>
     void filter(FilterState& state) const
     {
         Datacratic::UnicodeString location = state.request.location.fullLocationString();
-        state.narrowConfigs(impl.filter(location));
+        state.narrowConfigs(impl.filter(location, state.shardMask()));
     }
 
 private:
-    typedef RegexFilter<boost::u32regex, Datacratic::UnicodeString> BaseFilter;
-    IncludeExcludeFilter<BaseFilter> impl;
+    SelectableRegexFilter<boost::u32regex, Datacratic::UnicodeString> impl;
 };
 
 
@@ -236,6 +286,8 @@ struct ExchangePreFilter : public IterativeFilter<ExchangePreFilter>
 {
     static constexpr const char* name = "ExchangePre";
     unsigned priority() const { return Priority::ExchangePre; }
+    // What the exchange connector reads is up to the connector.
+    uint32_t requiredFields() const { return BidRequestFields::NONE; }
 
     bool filterConfig(FilterState& state, const AgentConfig& config) const
     {
@@ -253,6 +305,8 @@ struct ExchangePostFilter : public IterativeFilter<ExchangePostFilter>
 {
     static constexpr const char* name = "ExchangePost";
     unsigned priority() const { return Priority::ExchangePost; }
+    // What the exchange connector reads is up to the connector.
+    uint32_t requiredFields() const { return BidRequestFields::NONE; }
 
     bool filterConfig(FilterState& state, const AgentConfig& config) const
     {
@@ -275,6 +329,7 @@ struct ExchangeNameFilter : public FilterBaseT<ExchangeNameFilter>
 {
     static constexpr const char* name = "ExchangeName";
     unsigned priority() const { return Priority::ExchangeName; }
+    uint32_t requiredFields() const { return BidRequestFields::NONE; }
 
 
     void setConfig(unsigned configIndex, const AgentConfig& config, bool value)
@@ -300,6 +355,7 @@ struct FoldPositionFilter : public FilterBaseT<FoldPositionFilter>
 {
     static constexpr const char* name = "FoldPosition";
     unsigned priority() const { return Priority::FoldPosition; }
+    uint32_t requiredFields() const { return BidRequestFields::NONE; }
 
     void setConfig(unsigned cfgIndex, const AgentConfig& config, bool value)
     {
@@ -327,6 +383,7 @@ struct RequiredIdsFilter : public FilterBaseT<RequiredIdsFilter>
 {
     static constexpr const char* name = "RequireIds";
     unsigned priority() const { return Priority::RequiredIds; }
+    uint32_t requiredFields() const { return BidRequestFields::USER_IDS; }
 
     void setConfig(unsigned cfgIndex, const AgentConfig& config, bool value)
     {
@@ -381,6 +438,7 @@ struct LatLongDevFilter : public RTBKIT::FilterBaseT<LatLongDevFilter>
     ConfigSet configs_with_filt;
 
     unsigned priority() const { return Priority::LatLong; } //low priority
+    uint32_t requiredFields() const { return BidRequestFields::DEVICE; }
 
     static constexpr float LONGITUDE_1DEGREE_KMS = 111.321;
     static constexpr float LATITUDE_1DEGREE_KMS = 111.0;
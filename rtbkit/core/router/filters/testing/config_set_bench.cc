@@ -0,0 +1,141 @@
+/** config_set_bench.cc                                 -*- C++ -*-
+    Copyright (c) 2013 Datacratic.  All rights reserved.
+
+    Micro-benchmark for the ConfigSet and CreativeMatrix bitfield layouts and
+    kernels.
+
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "rtbkit/common/filter.h"
+#include "jml/arch/timers.h"
+
+#include <boost/test/unit_test.hpp>
+#include <iostream>
+#include <random>
+
+using namespace std;
+using namespace ML;
+using namespace RTBKIT;
+
+
+/******************************************************************************/
+/* UTILS                                                                      */
+/******************************************************************************/
+
+// Large enough to hold 4096 configs.
+typedef ConfigSetT<DynamicConfigStorage> DynamicSet;
+typedef ConfigSetT< FixedConfigStorage<64> > FixedSet;
+
+typedef CreativeMatrixT<DynamicSet> DynamicMatrix;
+typedef CreativeMatrixT<FixedSet, 2> FixedMatrix;
+
+enum { Iterations = 100000, Creatives = 4 };
+
+template<typename Set>
+Set randomSet(mt19937& rng, size_t configs)
+{
+    Set set;
+    for (size_t i = 0; i < configs; ++i)
+        if (rng() % 2) set.set(i);
+    return set;
+}
+
+template<typename Matrix>
+Matrix randomMatrix(mt19937& rng, size_t configs)
+{
+    Matrix matrix;
+    for (size_t cr = 0; cr < Creatives; ++cr)
+        for (size_t i = 0; i < configs; ++i)
+            if (rng() % 2) matrix.set(cr, i);
+    return matrix;
+}
+
+void report(const string& name, size_t configs, const Timer& timer)
+{
+    double ns = timer.elapsed_wall() / Iterations * 1000000000.0;
+    cerr << name << " configs=" << configs
+        << " kernels=" << ConfigSetKernels::active->name
+        << ": " << ns << "ns/op" << endl;
+}
+
+
+/******************************************************************************/
+/* BENCHES                                                                    */
+/******************************************************************************/
+
+// Mimics what a filter does on each request: combine the include and exclude
+// sets and narrow the active configs.
+template<typename Set>
+void benchSet(const string& name, size_t configs)
+{
+    mt19937 rng(configs);
+    Set active(true);
+    active.expand(configs);
+    Set include = randomSet<Set>(rng, configs);
+    Set exclude = randomSet<Set>(rng, configs);
+
+    size_t sum = 0;
+    Timer timer;
+
+    for (size_t i = 0; i < Iterations; ++i) {
+        Set state = active;
+        Set matches = include;
+        matches &= exclude.negate();
+        state &= matches;
+        sum += state.empty();
+    }
+
+    report(name, configs, timer);
+    BOOST_CHECK_LE(sum, Iterations);
+}
+
+// Mimics FilterState::narrowAllCreatives and updateConfigs.
+template<typename Matrix, typename Set>
+void benchMatrix(const string& name, size_t configs)
+{
+    mt19937 rng(configs);
+    Matrix active = randomMatrix<Matrix>(rng, configs);
+    Matrix mask = randomMatrix<Matrix>(rng, configs);
+
+    size_t sum = 0;
+    Timer timer;
+
+    for (size_t i = 0; i < Iterations; ++i) {
+        Matrix state = active;
+        state &= mask;
+
+        Set configs;
+        state.aggregate(configs, Creatives);
+        sum += configs.count();
+    }
+
+    report(name, configs, timer);
+    BOOST_CHECK_GT(sum, 0);
+}
+
+void benchAll(const ConfigSetKernels& kernels)
+{
+    ConfigSetKernels::select(kernels);
+
+    for (size_t configs : { 64, 512, 4096 }) {
+        benchSet<DynamicSet>("set.dynamic", configs);
+        benchSet<FixedSet>("set.fixed", configs);
+        benchMatrix<DynamicMatrix, DynamicSet>("matrix.dynamic", configs);
+        benchMatrix<FixedMatrix, FixedSet>("matrix.fixed", configs);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( configSetBench )
+{
+    const ConfigSetKernels& detected = ConfigSetKernels::detect();
+
+    benchAll(ConfigSetKernels::scalar);
+    benchAll(ConfigSetKernels::sse2);
+    if (&detected != &ConfigSetKernels::sse2 && &detected != &ConfigSetKernels::scalar)
+        benchAll(detected);
+
+    ConfigSetKernels::select(detected);
+}
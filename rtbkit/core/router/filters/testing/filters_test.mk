@@ -9,5 +9,5 @@
 $(eval $(call test,generic_filters_test,static_filters,boost))
 $(eval $(call test,static_filters_test,static_filters,boost))
 $(eval $(call test,creative_filters_test,static_filters,boost))
-
-
+$(eval $(call test,config_set_bench,filter_registry,boost manual))
+$(eval $(call test,regex_filter_bench,static_filters bid_request,boost manual))
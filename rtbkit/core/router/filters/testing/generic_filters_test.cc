@@ -11,8 +11,11 @@
 
 #include "utils.h"
 #include "rtbkit/core/router/filters/generic_filters.h"
+#include "rtbkit/core/router/filters/match_cache.h"
+#include "jml/arch/timers.h"
 
 #include <boost/test/unit_test.hpp>
+#include <random>
 
 using namespace std;
 using namespace RTBKIT;
@@ -174,6 +177,98 @@ BOOST_AUTO_TEST_CASE(domainFilterTest)
     check(filter.filter(Url("random.net")),      { });
 }
 
+/** Reference implementation of the DomainFilter before the suffix trie. */
+struct LegacyDomainFilter
+{
+    void addConfig(unsigned cfgIndex, const string& host)
+    {
+        domainMap[host].set(cfgIndex);
+    }
+
+    ConfigSet filter(const Url& host) const
+    {
+        ConfigSet matches;
+
+        for (const auto& key : getKeys(host)) {
+            auto it = domainMap.find(key);
+            if (it == domainMap.end()) continue;
+
+            matches |= it->second;
+        }
+
+        return matches;
+    }
+
+private:
+
+    vector<string> getKeys(const Url& host) const
+    {
+        vector<string> keys;
+
+        string domain = host.host();
+        while (true) {
+            keys.push_back(domain);
+
+            size_t pos = domain.find('.');
+            if (pos == string::npos) break;
+            domain = domain.substr(pos+1);
+        }
+
+        return keys;
+    }
+
+    unordered_map<string, ConfigSet> domainMap;
+};
+
+BOOST_AUTO_TEST_CASE(domainFilterBench)
+{
+    enum { Configs = 1000, Hosts = 1000, Iterations = 20 };
+
+    mt19937 rng(0);
+    vector<string> labels = {
+        "www", "m", "news", "sport", "blog", "cdn", "static", "shop", "mail"
+    };
+    vector<string> tlds = { "com", "net", "org", "co.uk", "fr", "de", "ca" };
+
+    auto randomDomain = [&] {
+        string domain = "site" + to_string(rng() % 500) + "." + tlds[rng() % tlds.size()];
+        for (size_t i = rng() % 3; i > 0; --i)
+            domain = labels[rng() % labels.size()] + "." + domain;
+        return domain;
+    };
+
+    DomainFilter<string> filter;
+    LegacyDomainFilter legacy;
+
+    for (size_t cfg = 0; cfg < Configs; ++cfg) {
+        string domain = randomDomain();
+        filter.addConfig(cfg, makeList<string>({ domain }));
+        legacy.addConfig(cfg, domain);
+    }
+
+    vector<Url> hosts;
+    for (size_t i = 0; i < Hosts; ++i)
+        hosts.emplace_back("http://" + randomDomain() + "/index.html");
+
+    for (const Url& host : hosts)
+        BOOST_CHECK_EQUAL(filter.filter(host).print(), legacy.filter(host).print());
+
+    auto bench = [&] (const string& name, const std::function<ConfigSet (const Url&)>& fn) {
+        size_t matches = 0;
+
+        ML::Timer timer;
+        for (size_t it = 0; it < Iterations; ++it)
+            for (const Url& host : hosts)
+                matches += fn(host).count();
+
+        double ns = timer.elapsed_wall() / (Iterations * Hosts) * 1000000000.0;
+        cerr << name << ": " << ns << "ns/host (" << matches << " matches)" << endl;
+    };
+
+    bench("legacy", [&] (const Url& host) { return legacy.filter(host); });
+    bench("trie  ", [&] (const Url& host) { return filter.filter(host); });
+}
+
 BOOST_AUTO_TEST_CASE(regexFilterTest)
 {
     using boost::regex;
@@ -219,6 +314,137 @@ BOOST_AUTO_TEST_CASE(regexFilterTest)
     check(filter.filter("d"),   { });
 }
 
+BOOST_AUTO_TEST_CASE(compiledRegexFilterTest)
+{
+    using boost::regex;
+    CompiledRegexFilter<regex, string> filter;
+
+    title("compiled-regex-1");
+    filter.addConfig(0, makeList({ regex("a"), regex("b")}));
+    filter.addConfig(1, makeList({ regex("a|b") }));
+    filter.addConfig(2, makeList({ regex("a"), regex("c")}));
+    filter.addConfig(3, makeList({ regex("^ab+")}));
+    filter.addConfig(4, makeList({ regex("foo\\.net/(x|y)?qux"), regex("[q]z")}));
+
+    check(filter.filter("a"),   { 0, 1, 2});
+    check(filter.filter("b"),   { 0, 1 });
+    check(filter.filter("c"),   { 2 });
+    check(filter.filter("abb"), { 0, 1, 2, 3 });
+    check(filter.filter("d"),   { });
+    check(filter.filter("foo.net/yqux"), { 4 });
+    check(filter.filter("foo.net/zqux"), { });
+    check(filter.filter("fooxnet/qux"),  { });
+    check(filter.filter("qz"),  { 4 });
+
+    title("compiled-regex-2");
+    filter.removeConfig(3, makeList({ regex("^ab+")}));
+    filter.removeConfig(4, makeList({ regex("foo\\.net/(x|y)?qux"), regex("[q]z")}));
+
+    check(filter.filter("a"),   { 0, 1, 2});
+    check(filter.filter("abb"), { 0, 1, 2 });
+    check(filter.filter("foo.net/yqux"), { });
+    check(filter.filter("qz"),  { });
+
+    title("compiled-regex-3");
+    filter.removeConfig(0, makeList({ regex("a"), regex("b")}));
+
+    check(filter.filter("a"),   { 1, 2});
+    check(filter.filter("b"),   { 1 });
+    check(filter.filter("c"),   { 2 });
+    check(filter.filter("d"),   { });
+
+    title("compiled-regex-4");
+    filter.removeConfig(1, makeList({ regex("a|b") }));
+    filter.removeConfig(2, makeList({ regex("a"), regex("c")}));
+
+    check(filter.filter("a"),   { });
+    check(filter.filter("c"),   { });
+
+    // None of these have a literal so they're all evaluated.
+    title("compiled-regex-5");
+    filter.addConfig(5, makeList({ regex("^[xy]+$"), regex("z?") }));
+    filter.addConfig(6, makeList({ regex("[0-9]") }));
+
+    check(filter.filter("xy"),  { 5 });
+    check(filter.filter("x1"),  { 5, 6 });
+    check(filter.filter(""),    { 5 });
+}
+
+/** Sharded filtering only needs results within the shard's mask and the
+    regexes of the configs outside of it are skipped.
+ */
+template<typename Filter>
+void checkMaskedRegexFilter(const std::string& name)
+{
+    using boost::regex;
+    Filter filter;
+
+    title(name);
+    filter.addConfig(0, makeList({ regex("a"), regex("b")}));
+    filter.addConfig(1, makeList({ regex("a|b") }));
+    filter.addConfig(2, makeList({ regex("a"), regex("c")}));
+    filter.addConfig(3, makeList({ regex("^ab+")}));
+    filter.addConfig(70, makeList({ regex("c|d") }));
+
+    ConfigSet low;
+    for (size_t cfg = 0; cfg < 64; ++cfg) low.set(cfg);
+
+    ConfigSet high;
+    for (size_t cfg = 64; cfg < 128; ++cfg) high.set(cfg);
+
+    check(filter.filter("a", &low) & low,   { 0, 1, 2 });
+    check(filter.filter("abb", &low) & low, { 0, 1, 2, 3 });
+    check(filter.filter("d", &low) & low,   { });
+    check(filter.filter("c", &high) & high, { 70 });
+    check(filter.filter("a", &high) & high, { });
+
+    // Only the regexes of the configs in the mask contribute.
+    check(filter.filter("c", &low), { 2 });
+    check(filter.filter("abb", &high), { });
+}
+
+BOOST_AUTO_TEST_CASE(maskedRegexFilterTest)
+{
+    checkMaskedRegexFilter< RegexFilter<boost::regex, string> >("masked-regex");
+    checkMaskedRegexFilter< CompiledRegexFilter<boost::regex, string> >(
+            "masked-compiled-regex");
+}
+
+BOOST_AUTO_TEST_CASE(requiredLiteralTest)
+{
+    auto checkLiteral = [] (
+            const string& pattern, bool found, const string& literal, bool pure)
+        {
+            string result;
+            bool resultPure;
+            BOOST_CHECK_EQUAL(requiredLiteral(pattern, result, resultPure), found);
+            BOOST_CHECK_EQUAL(result, literal);
+            BOOST_CHECK_EQUAL(resultPure, pure);
+        };
+
+    checkLiteral("abc", true, "abc", true);
+    checkLiteral("a\\.b", true, "a.b", true);
+    checkLiteral("^http://www\\.bob\\.com", true, "http://www.bob.com", false);
+    checkLiteral("colou?r", true, "colo", false);
+    checkLiteral("(foo|bar)baz", true, "baz", false);
+    checkLiteral("\\d+xyz", true, "xyz", false);
+    checkLiteral("a|b", false, "", false);
+    checkLiteral("(?i)abc", false, "", false);
+    checkLiteral(".*", false, "", false);
+
+    // Escapes with arguments end the analysis.
+    checkLiteral("\\x41b", false, "", false);
+    checkLiteral("\\0123", false, "", false);
+    checkLiteral("a\\cXyz", true, "a", false);
+    checkLiteral("abc\\x{41}def", true, "abc", false);
+    checkLiteral("ab\\u0041cd", true, "ab", false);
+    checkLiteral("ab\\N{LATIN SMALL LETTER A}cd", true, "ab", false);
+    checkLiteral("ab\\p{L}cd", true, "ab", false);
+    checkLiteral("(a)bc\\1de", true, "bc", false);
+    checkLiteral("ab\\k<n>cd", true, "ab", false);
+    checkLiteral("ab\\g1cd", true, "ab", false);
+}
+
 BOOST_AUTO_TEST_CASE(segmentListTest)
 {
     SegmentListFilter filter;
@@ -313,3 +539,60 @@ BOOST_AUTO_TEST_CASE(includeExcludeFilterTest)
     doCheck(filter.filter(4), { 1, 2 });
     doCheck(filter.filter(5), { 1, 2 });
 }
+
+BOOST_AUTO_TEST_CASE(matchCacheTest)
+{
+    FilterMatchCache cache("test");
+
+    size_t computed = 0;
+    auto compute = [&] (size_t cfg) {
+        return [&, cfg] {
+            computed++;
+            ConfigSet configs;
+            configs.set(cfg);
+            return configs;
+        };
+    };
+
+    auto lookups = [] {
+        for (const auto& stats : FilterMatchCache::stats())
+            if (stats.name == "test") return stats;
+        return FilterMatchCache::Stats();
+    };
+
+    title("cache-1");
+    check(cache.get(1, compute(1)), { 1 });
+    check(cache.get(1, compute(2)), { 1 });
+    check(cache.get(2, compute(2)), { 2 });
+    BOOST_CHECK_EQUAL(computed, 2);
+    BOOST_CHECK_EQUAL(lookups().hits, 1);
+    BOOST_CHECK_EQUAL(lookups().misses, 2);
+
+    title("cache-2");
+    FilterMatchCache copy(cache);
+    check(copy.get(1, compute(3)), { 3 });
+    check(cache.get(1, compute(3)), { 1 });
+    BOOST_CHECK_EQUAL(computed, 3);
+
+    title("cache-3");
+    cache.invalidate();
+    check(cache.get(1, compute(4)), { 4 });
+    check(cache.get(1, compute(5)), { 4 });
+    BOOST_CHECK_EQUAL(computed, 4);
+
+    title("cache-4");
+    size_t capacity = FilterMatchCache::capacity();
+    FilterMatchCache::setCapacity(0);
+    check(cache.get(1, compute(6)), { 6 });
+    FilterMatchCache::setCapacity(capacity);
+    check(cache.get(1, compute(7)), { 7 });
+    check(cache.get(1, compute(8)), { 7 });
+    BOOST_CHECK_EQUAL(computed, 6);
+
+    title("cache-5");
+    FilterMatchCache::setCapacity(FilterMatchCacheTable::Ways);
+    for (size_t i = 0; i < 100; ++i) cache.get(i, compute(i));
+    check(cache.get(99, compute(100)), { 99 });
+    check(cache.get(0, compute(100)), { 100 });
+    FilterMatchCache::setCapacity(capacity);
+}
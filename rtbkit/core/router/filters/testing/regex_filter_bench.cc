@@ -0,0 +1,155 @@
+/** regex_filter_bench.cc                                 -*- C++ -*-
+    Copyright (c) 2013 Datacratic.  All rights reserved.
+
+    Compares the regex filter backends on the urls of the datacratic auction
+    corpus with a large number of generated patterns.
+
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "rtbkit/core/router/filters/generic_filters.h"
+#include "rtbkit/common/bid_request.h"
+#include "jml/utils/filter_streams.h"
+#include "jml/arch/timers.h"
+
+#include <boost/test/unit_test.hpp>
+#include <iostream>
+#include <random>
+#include <set>
+
+using namespace std;
+using namespace ML;
+using namespace RTBKIT;
+using namespace Datacratic;
+
+
+/******************************************************************************/
+/* UTILS                                                                      */
+/******************************************************************************/
+
+vector<string> loadUrls()
+{
+    filter_istream stream("rtbkit/core/router/testing/20000-datacratic-auctions.xz");
+
+    vector<string> urls;
+    string line;
+
+    while (getline(stream, line)) {
+        if (line.empty()) continue;
+
+        unique_ptr<BidRequest> br(BidRequest::parse("datacratic", line));
+        if (!br->url.empty()) urls.push_back(br->url.toString());
+    }
+
+    return urls;
+}
+
+string escape(const string& str)
+{
+    string result;
+    for (char c : str) {
+        if (!isalnum(c)) result += '\\';
+        result += c;
+    }
+    return result;
+}
+
+/** Generates patterns that look like what agents configure: mostly hosts and
+    path fragments taken from the corpus with a sprinkling of regex operators.
+    One in a hundred patterns has no usable literal and is always evaluated.
+ */
+vector<string> makePatterns(const vector<string>& urls, size_t count)
+{
+    mt19937 rng(0);
+    set<string> patterns;
+
+    while (patterns.size() < count) {
+        Url url(urls[rng() % urls.size()]);
+        string host = escape(url.host());
+        string path = url.path();
+
+        if (rng() % 100 == 0) {
+            patterns.insert("(" + host + "|" + escape(path) + ")$");
+            continue;
+        }
+
+        switch (rng() % 8) {
+        case 0: patterns.insert("^https?://(www\\.)?" + host); break;
+        case 1: patterns.insert(host + "/.*"); break;
+        case 2: patterns.insert("[0-9]+\\." + host); break;
+
+        case 3:
+            if (path.size() > 4)
+                patterns.insert(escape(path.substr(0, path.size() / 2)) + "\\w*");
+            break;
+
+        case 4: patterns.insert("\\d{3}" + to_string(rng() % 1000)); break;
+        default: patterns.insert(host); break;
+        }
+    }
+
+    return vector<string>(patterns.begin(), patterns.end());
+}
+
+template<typename Filter>
+double bench(
+        const Filter& filter,
+        const vector<string>& urls,
+        vector<ConfigSet>& results)
+{
+    results.clear();
+    results.reserve(urls.size());
+
+    Timer timer;
+    for (const string& url : urls)
+        results.push_back(filter.filter(url));
+
+    return timer.elapsed_wall();
+}
+
+
+/******************************************************************************/
+/* BENCH                                                                      */
+/******************************************************************************/
+
+BOOST_AUTO_TEST_CASE( regexFilterBench )
+{
+    vector<string> urls = loadUrls();
+    cerr << "urls=" << urls.size() << endl;
+    BOOST_REQUIRE(!urls.empty());
+
+    for (size_t count : { 100, 1000, 2000 }) {
+        vector<string> patterns = makePatterns(urls, count);
+
+        RegexFilter<boost::regex, string> basic;
+        CompiledRegexFilter<boost::regex, string> compiled;
+
+        Timer setupTimer;
+        for (size_t i = 0; i < patterns.size(); ++i) {
+            vector<boost::regex> list = { boost::regex(patterns[i]) };
+            compiled.addConfig(i, list);
+        }
+        double setup = setupTimer.elapsed_wall();
+
+        for (size_t i = 0; i < patterns.size(); ++i) {
+            vector<boost::regex> list = { boost::regex(patterns[i]) };
+            basic.addConfig(i, list);
+        }
+
+        vector<ConfigSet> basicResults, compiledResults;
+        double basicTime = bench(basic, urls, basicResults);
+        double compiledTime = bench(compiled, urls, compiledResults);
+
+        for (size_t i = 0; i < urls.size(); ++i)
+            BOOST_CHECK_EQUAL(basicResults[i].print(), compiledResults[i].print());
+
+        cerr << "patterns=" << patterns.size()
+            << " basic=" << (basicTime / urls.size() * 1000000.0) << "us"
+            << " compiled=" << (compiledTime / urls.size() * 1000000.0) << "us"
+            << " speedup=" << (basicTime / compiledTime)
+            << " compile=" << (setup * 1000.0) << "ms"
+            << endl;
+    }
+}
@@ -6,6 +6,7 @@
 */
 
 #include <atomic>
+#include <cmath>
 #include "router.h"
 #include "soa/service/zmq_utils.h"
 #include "jml/arch/backtrace.h"
@@ -13,6 +14,7 @@
 #include "jml/arch/exception_handler.h"
 #include "soa/jsoncpp/writer.h"
 #include <boost/foreach.hpp>
+#include <boost/thread/locks.hpp>
 #include "jml/arch/atomic_ops.h"
 #include "jml/utils/set_utils.h"
 #include "jml/utils/environment.h"
@@ -22,9 +24,11 @@
 #include <boost/tuple/tuple.hpp>
 #include "jml/utils/pair_utils.h"
 #include "jml/utils/exc_assert.h"
+#include "jml/utils/exc_check.h"
 #include "jml/db/persistent.h"
 #include "jml/utils/json_parsing.h"
 #include "profiler.h"
+#include "filters/static_filters.h"
 #include "rtbkit/core/banker/banker.h"
 #include "rtbkit/core/banker/null_banker.h"
 #include <boost/algorithm/string.hpp>
@@ -124,10 +128,12 @@ Router(ServiceBase & parent,
       postAuctionEndpoint(*this),
       configBuffer(1024),
       exchangeBuffer(64),
-      startBiddingBuffer(65536),
       submittedBuffer(65536),
       auctionGraveyard(65536),
       doBidBuffer(65536),
+      mainLoopWakeupPending(false),
+      eventDrivenLoop(false),
+      busyPollSeconds(0.00005),
       augmentationLoop(*this),
       loopMonitor(*this),
       loadStabilizer(loopMonitor),
@@ -137,6 +143,7 @@ Router(ServiceBase & parent,
       budgetErrorRate(0.0),
       connectPostAuctionLoop(connectPostAuctionLoop),
       enableBidProbability(enableBidProbability),
+      binaryPostAuctionEvents(false),
       allAgents(new AllAgentInfo()),
       configListener(getZmqContext()),
       initialized(false),
@@ -158,6 +165,7 @@ Router(ServiceBase & parent,
       augmentationWindow(augmentationWindow)
 {
     monitorProviderClient.addProvider(this);
+    setNumShards(1);
 }
 
 Router::
@@ -177,10 +185,12 @@ Router(std::shared_ptr<ServiceProxies> services,
       postAuctionEndpoint(*this),
       configBuffer(1024),
       exchangeBuffer(64),
-      startBiddingBuffer(65536),
       submittedBuffer(65536),
       auctionGraveyard(65536),
       doBidBuffer(65536),
+      mainLoopWakeupPending(false),
+      eventDrivenLoop(false),
+      busyPollSeconds(0.00005),
       augmentationLoop(*this),
       loopMonitor(*this),
       loadStabilizer(loopMonitor),
@@ -190,6 +200,7 @@ Router(std::shared_ptr<ServiceProxies> services,
       budgetErrorRate(0.0),
       connectPostAuctionLoop(connectPostAuctionLoop),
       enableBidProbability(enableBidProbability),
+      binaryPostAuctionEvents(false),
       allAgents(new AllAgentInfo()),
       configListener(getZmqContext()),
       initialized(false),
@@ -212,6 +223,7 @@ Router(std::shared_ptr<ServiceProxies> services,
 
 {
     monitorProviderClient.addProvider(this);
+    setNumShards(1);
 }
 
 void
@@ -250,6 +262,7 @@ initExchange(const std::string & type,
     addExchangeNoConnect(item);
 
     exchangeBuffer.push(item);
+    signalMainLoop();
 }
 
 void
@@ -272,6 +285,8 @@ initFilters(const Json::Value & config) {
         Json::Value extraFilterLibs;
         Json::Value filterDeactivate;
         Json::Value filterActivate;
+        Json::Value filterShards;
+        Json::Value adaptiveOrdering;
 
         for (const std::string & field : config.getMemberNames()) {
 
@@ -303,6 +318,34 @@ initFilters(const Json::Value & config) {
                     throw Exception("Filter-activate must be an array");
                 }
             }
+            else if (field == "shards") {
+                filterShards = config[field];
+                if ( (filterShards != Json::Value::null) && (!filterShards.isObject()) ) {
+                    throw Exception("Filter shards must be an object");
+                }
+            }
+            else if (field == "compiledRegexFilters") {
+                const Json::Value & compiled = config[field];
+                if (!compiled.isArray()) {
+                    throw Exception("compiledRegexFilters must be an array");
+                }
+                for (unsigned i = 0; i < compiled.size(); ++i)
+                    RegexFilterBackend::setCompiled(compiled[i].asString());
+            }
+            else if (field == "matchCache") {
+                const Json::Value & cache = config[field];
+                if (!cache.isObject()) {
+                    throw Exception("matchCache must be an object");
+                }
+                FilterMatchCache::setCapacity(
+                        cache.get("capacity", unsigned(FilterMatchCache::capacity())).asUInt());
+            }
+            else if (field == "adaptiveOrdering") {
+                adaptiveOrdering = config[field];
+                if ( (adaptiveOrdering != Json::Value::null) && (!adaptiveOrdering.isObject()) ) {
+                    throw Exception("Filter adaptiveOrdering must be an object");
+                }
+            }
             else
                 throw Exception("Unknown field " + field + " in filter config file");
         }
@@ -347,6 +390,18 @@ initFilters(const Json::Value & config) {
             }
         }
 
+        if (filterShards != Json::Value::null) {
+            unsigned count = filterShards.get("count", 1).asUInt();
+            unsigned threads = filterShards.get("threads", count - 1).asUInt();
+            filters.initShards(count, threads);
+        }
+
+        if (adaptiveOrdering != Json::Value::null) {
+            filters.initAdaptiveOrdering(
+                    adaptiveOrdering.get("perExchange", true).asBool(),
+                    adaptiveOrdering.get("minSamples", 1000).asUInt());
+        }
+
     } else {
         filters.initWithDefaultFilters();
     }
@@ -401,6 +456,7 @@ init()
                                          std::shared_ptr<const AgentConfig> config)
         {
             configBuffer.push(make_pair(agent, config));
+            signalMainLoop();
         };
 
     onSubmittedAuction = [=] (std::shared_ptr<Auction> auction,
@@ -542,6 +598,13 @@ start(boost::function<void ()> onStop)
     augmentationLoop.start();
     runThread.reset(new boost::thread(runfn));
 
+    if (shards.size() > 1) {
+        for (auto & shard : shards) {
+            Shard * toRun = shard.get();
+            shard->thread.reset(new boost::thread([=] () { this->runShard(*toRun); }));
+        }
+    }
+
     if (connectPostAuctionLoop) {
         postAuctionEndpoint.init();
     }
@@ -575,6 +638,148 @@ start(boost::function<void ()> onStop)
     loopMonitor.start();
 }
 
+void
+Router::
+setEventDrivenLoop(bool enabled, double busyPollSeconds)
+{
+    ExcCheck(!runThread, "main loop mode must be set before starting");
+    ExcCheckGreaterEqual(busyPollSeconds, 0.0, "invalid busy poll duration");
+
+    this->eventDrivenLoop = enabled;
+    this->busyPollSeconds = busyPollSeconds;
+}
+
+void
+Router::
+signalMainLoop()
+{
+    if (!mainLoopWakeupPending.exchange(true))
+        wakeupMainLoop.signal();
+}
+
+Router::Shard::
+Shard(unsigned index)
+    : index(index),
+      startBiddingBuffer(65536),
+      bidBuffer(65536),
+      agentBidBuffer(65536),
+      wakeupPending(false)
+{
+}
+
+void
+Router::
+setNumShards(size_t numShards)
+{
+    ExcCheck(!runThread, "number of shards must be set before starting");
+    ExcCheckGreater(numShards, 0, "router needs at least one shard");
+
+    shards.clear();
+    for (size_t i = 0;  i < numShards;  ++i)
+        shards.emplace_back(new Shard(i));
+}
+
+void
+Router::
+signalShard(Shard & shard)
+{
+    if (shards.size() == 1) {
+        signalMainLoop();
+        return;
+    }
+
+    if (!shard.wakeupPending.exchange(true))
+        shard.wakeup.signal();
+}
+
+size_t
+Router::
+numInFlight() const
+{
+    size_t result = 0;
+    for (auto & shard : shards) {
+        std::lock_guard<std::mutex> guard(shard->lock);
+        result += shard->inFlight.size();
+    }
+    return result;
+}
+
+std::shared_ptr<Auction>
+Router::
+findInFlightAuction(const Id & auctionId) const
+{
+    const Shard & shard = *shards[auctionId.hash() % shards.size()];
+
+    std::lock_guard<std::mutex> guard(shard.lock);
+    auto it = shard.inFlight.find(auctionId);
+    if (it == shard.inFlight.end()) return nullptr;
+    return it->second.auction;
+}
+
+void
+Router::
+processShard(Shard & shard)
+{
+    // The main loop can only change the agents in between two items so that
+    // config changes don't have to wait for a whole batch.
+    typedef boost::shared_lock<ML::RWLock> AgentsGuard;
+    typedef std::lock_guard<std::mutex> ShardGuard;
+
+    std::shared_ptr<AugmentationInfo> info;
+    while (shard.startBiddingBuffer.tryPop(info)) {
+        AgentsGuard agentsGuard(agentsLock);
+        ShardGuard guard(shard.lock);
+        doStartBidding(shard, info);
+    }
+
+    std::vector<std::string> message;
+    while (shard.agentBidBuffer.tryPop(message)) {
+        AgentsGuard agentsGuard(agentsLock);
+        ShardGuard guard(shard.lock);
+        doBid(shard, message);
+    }
+
+    BidMessage bid;
+    while (shard.bidBuffer.tryPop(bid)) {
+        AgentsGuard agentsGuard(agentsLock);
+        ShardGuard guard(shard.lock);
+        doBidImpl(shard, bid);
+    }
+}
+
+void
+Router::
+runShard(Shard & shard)
+{
+    zmq_pollitem_t items [] = {
+        { 0, shard.wakeup.fd(), ZMQ_POLLIN, 0 }
+    };
+
+    while (!shutdown_) {
+        // Sleep until there's work or until the next auction expires.
+        double timeout = Date::now().secondsUntil(shard.inFlight.earliest);
+        long timeoutMs = ceil(std::max(0.0, std::min(0.05, timeout)) * 1000.0);
+
+        int rc = zmq_poll(items, 1, timeoutMs);
+        if (rc == -1 && zmq_errno() != EINTR) {
+            cerr << "zeromq error: " << zmq_strerror(zmq_errno()) << endl;
+        }
+
+        if (items[0].revents & ZMQ_POLLIN) {
+            shard.wakeup.read();
+            shard.wakeupPending = false;
+        }
+
+        processShard(shard);
+
+        if (Date::now() >= shard.inFlight.earliest) {
+            boost::shared_lock<ML::RWLock> agentsGuard(agentsLock);
+            std::lock_guard<std::mutex> guard(shard.lock);
+            checkExpiredAuctions(shard);
+        }
+    }
+}
+
 size_t
 Router::
 numNonIdle() const
@@ -582,7 +787,7 @@ numNonIdle() const
     size_t numInFlight, numAwaitingAugmentation;
     {
         Guard guard(lock);
-        numInFlight = inFlight.size();
+        numInFlight = this->numInFlight();
         numAwaitingAugmentation = augmentationLoop.numAugmenting();
     }
 
@@ -679,6 +884,14 @@ run()
 
     Date lastSleep = Date::now();
 
+    // With more than one shard the in flight auctions are expired by the
+    // shard threads.
+    auto nextExpiry = [&] () -> Date
+        {
+            if (shards.size() > 1) return Date::positiveInfinity();
+            return shards[0]->inFlight.earliest;
+        };
+
     while (!shutdown_) {
         beforeSleep = getTime();
         totalActive += beforeSleep - afterSleep;
@@ -686,7 +899,43 @@ run()
 
         int rc = 0;
 
-        {
+        if (eventDrivenLoop) {
+            double atStart = getTime();
+
+            // Every producer signals wakeupMainLoop so there's nothing to do
+            // until one of the items is ready.
+            double busyUntil = atStart + busyPollSeconds;
+            do {
+                rc = zmq_poll(items, 2, 0);
+            } while (rc == 0 && getTime() < busyUntil);
+
+            recordTime("spinPoll", atStart);
+
+            // Expiries are checked whenever one is due so that they can't be
+            // starved by a steady stream of messages.
+            if (rc == 0 || Date::now() >= nextExpiry()) {
+                double atStart = getTime();
+                checkExpiredAuctions();
+                recordTime("checkExpiredAuctions", atStart);
+            }
+
+            if (rc == 0) {
+                ++numTimesCouldSleep;
+
+                // Wake up in time for the next expiry and the periodic work.
+                double deadline = std::min(
+                        nextExpiry().secondsSinceEpoch(),
+                        std::min(lastPings + 1.0, lastTimestamp + 1.0));
+                double timeout = deadline - getTime();
+                long timeoutMs = std::max(0L, std::min(50L, long(ceil(timeout * 1000.0))));
+
+                double pollStart = getTime();
+                rc = zmq_poll(items, 2, timeoutMs);
+                recordTime("sleepPoll", pollStart);
+            }
+        }
+
+        else {
             double atStart = getTime();
 
             for (unsigned i = 0;  i < 20 && rc == 0;  ++i)
@@ -695,7 +944,7 @@ run()
             recordTime("spinPoll", atStart);
         }
 
-        if (rc == 0) {
+        if (rc == 0 && !eventDrivenLoop) {
             ++numTimesCouldSleep;
 
             {
@@ -734,25 +983,29 @@ run()
             cerr << "zeromq error: " << zmq_strerror(zmq_errno()) << endl;
         }
 
-        {
-            double atStart = getTime();
-            std::shared_ptr<AugmentationInfo> info;
-            while (startBiddingBuffer.tryPop(info)) {
-                doStartBidding(info);
-            }
-
-            recordTime("doStartBidding", atStart);
+        // Consume the wakeup before draining the buffers so that anything
+        // pushed while we're draining signals us again.
+        if (items[1].revents & ZMQ_POLLIN) {
+            wakeupMainLoop.read();
+            mainLoopWakeupPending = false;
         }
 
         {
             double atStart = getTime();
 
+            // Bids coming from the bidder interface are handed to the shard
+            // that owns the auction.
             BidMessage message;
             while (doBidBuffer.tryPop(message)) {
-                doBidImpl(message);
+                Shard & shard = shardFor(message.auctionId);
+                shard.bidBuffer.push(std::move(message));
+                if (shards.size() > 1) signalShard(shard);
             }
 
-            recordTime("doBid", atStart);
+            if (shards.size() == 1)
+                processShard(*shards[0]);
+
+            recordTime("processShard", atStart);
         }
 
         {
@@ -773,10 +1026,14 @@ run()
         {
             double atStart = getTime();
 
+            // Config updates tend to come in bursts so they're all applied to
+            // the filters in one go.
+            FilterPool::ConfigBatch batch;
             std::pair<std::string, std::shared_ptr<const AgentConfig> > config;
             while (configBuffer.tryPop(config)) {
-                doConfig(config.first, config.second);
+                doConfig(config.first, config.second, batch);
             }
+            applyConfigs(batch);
 
             recordTime("doConfig", atStart);
         }
@@ -811,10 +1068,6 @@ run()
             recordTime(message.at(1), atStart);
         }
 
-        if (items[1].revents & ZMQ_POLLIN) {
-            wakeupMainLoop.read();
-        }
-
         double now = ML::wall_time();
 
         if (now - lastPings > 1.0) {
@@ -852,6 +1105,8 @@ run()
                                        dutyCycleHistory.end() - 100);
 
             checkDeadAgents();
+            filters.reorderFilters();
+            FilterMatchCache::recordStats(*this);
 
             double total = 0.0;
             for (auto it = times.begin(); it != times.end();  ++it)
@@ -916,6 +1171,13 @@ shutdown()
     if (runThread)
         runThread->join();
     runThread.reset();
+
+    for (auto & shard : shards) {
+        if (!shard->thread) continue;
+        shard->wakeup.signal();
+        shard->thread->join();
+        shard->thread.reset();
+    }
     if (cleanupThread)
         cleanupThread->join();
     cleanupThread.reset();
@@ -1022,6 +1284,7 @@ handleAgentMessage(const std::vector<std::string> & message)
                 bidder->sendMessage(nullptr, address, "NEEDCONFIG");
                 return;
             }
+            std::unique_lock<ML::RWLock> guard(agentsLock);
             agents[configName].address = address;
             return;
         }
@@ -1032,14 +1295,26 @@ handleAgentMessage(const std::vector<std::string> & message)
         }
 
         AgentInfo & info = agents[address];
-        info.gotHeartbeat(Date::now());
+        {
+            std::unique_lock<ML::RWLock> guard(agentsLock);
+            info.gotHeartbeat(Date::now());
+        }
 
         if (!info.configured) {
             throw ML::Exception("message to unconfigured agent");
         }
 
         if (request[0] == 'B' && request == "BID") {
-            doBid(message);
+            if (shards.size() == 1) {
+                Shard & shard = *shards[0];
+                std::lock_guard<std::mutex> guard(shard.lock);
+                doBid(shard, message);
+            }
+            else {
+                Shard & shard = shardFor(Id(message.at(2)));
+                shard.agentBidBuffer.push(message);
+                signalShard(shard);
+            }
             return;
         }
 
@@ -1167,7 +1442,7 @@ checkDeadAgents()
 
                     this->recordHit("accounts.%s.lostBids", account);
 
-                    bidder->sendBidLostMessage(info.config, it->first, inFlight[id].auction);
+                    bidder->sendBidLostMessage(info.config, it->first, findInFlightAuction(id));
 
                     toExpire.push_back(id);
                 }
@@ -1223,18 +1498,23 @@ checkDeadAgents()
         }
     }
 
-    for (auto it = deadAgents.begin(), end = deadAgents.end();
-         it != end;  ++it) {
-        cerr << "WARNING: dead agent doesn't clean up its state properly"
-             << endl;
-        // TODO: undo all bids in progress
-        filters.removeConfig((*it)->first);
-        agents.erase(*it);
+    FilterPool::ConfigBatch batch;
+
+    {
+        std::unique_lock<ML::RWLock> guard(agentsLock);
+
+        for (auto it = deadAgents.begin(), end = deadAgents.end();
+             it != end;  ++it) {
+            cerr << "WARNING: dead agent doesn't clean up its state properly"
+                 << endl;
+            // TODO: undo all bids in progress
+            batch.removeConfig((*it)->first);
+            agents.erase(*it);
+        }
     }
 
-    if (!deadAgents.empty())
-        // Broadcast that we have different agents
-        updateAllAgents();
+    // Broadcast that we have different agents
+    applyConfigs(batch);
 
     //cerr << "dead agents took " << Date::now().secondsSince(start) << "s"
     //     << endl;
@@ -1246,6 +1526,27 @@ checkExpiredAuctions()
 {
     //recentlySubmitted.clear();
 
+    if (shards.size() == 1) {
+        Shard & shard = *shards[0];
+        std::lock_guard<std::mutex> guard(shard.lock);
+        checkExpiredAuctions(shard);
+    }
+
+    {
+        RouterProfiler profiler(dutyCycleCurrent.nsExpireBlacklist);
+        blacklist.doExpiries();
+    }
+
+    if (doDebug) {
+        RouterProfiler profiler(dutyCycleCurrent.nsExpireDebug);
+        expireDebugInfo();
+    }
+}
+
+void
+Router::
+checkExpiredAuctions(Shard & shard)
+{
     Date start = Date::now();
 
     {
@@ -1262,11 +1563,12 @@ checkExpiredAuctions()
                          end = auctionInfo.bidders.end();
                      it != end;  ++it) {
                     string agent = it->first;
-                    if (!agents.count(agent)) continue;
+                    auto agentIt = agents.find(agent);
+                    if (agentIt == agents.end()) continue;
 
-                    if (agents[agent].expireBidInFlight(auctionId)) {
-                        AgentInfo & info = this->agents[agent];
-                        ++info.stats->tooLate;
+                    AgentInfo & info = agentIt->second;
+                    if (info.expireBidInFlight(auctionId)) {
+                        ML::atomic_inc(info.stats->tooLate);
 
                         this->recordHit("accounts.%s.EXPIRED",
                                         info.config->account.toString('.'));
@@ -1302,17 +1604,7 @@ checkExpiredAuctions()
                 return Date();
             };
 
-        inFlight.expire(onExpiredInFlight, start);
-    }
-
-    {
-        RouterProfiler profiler(dutyCycleCurrent.nsExpireBlacklist);
-        blacklist.doExpiries();
-    }
-
-    if (doDebug) {
-        RouterProfiler profiler(dutyCycleCurrent.nsExpireDebug);
-        expireDebugInfo();
+        shard.inFlight.expire(onExpiredInFlight, start);
     }
 }
 
@@ -1326,8 +1618,13 @@ returnErrorResponse(const std::vector<std::string> & message,
     if (analytics) analytics->logErrorMessage(error,message);
     logMessageToAnalytics("ERROR", error, message);
     const auto& agent = message[0];
-    AgentInfo & info = this->agents[agent];
-    bidder->sendErrorMessage(info.config, agent, error, message);
+
+    // Can be called by the shards so the agent can't be added here.
+    std::shared_ptr<const AgentConfig> config;
+    auto it = agents.find(agent);
+    if (it != agents.end()) config = it->second.config;
+
+    bidder->sendErrorMessage(config, agent, error, message);
 }
 
 void
@@ -1337,7 +1634,7 @@ returnInvalidBid(
         const std::shared_ptr<Auction> &auction,
         const char *reason, const char *message, ...) {
 
-    auto& agentInfo = agents[agent];
+    auto& agentInfo = agents.at(agent);
     const auto& agentConfig = agentInfo.config;
     this->recordHit("bidErrors.%s", reason);
     this->recordHit("accounts.%s.bidErrors.total",
@@ -1346,7 +1643,7 @@ returnInvalidBid(
                     agentConfig->account.toString('.'),
                     reason);
 
-    ++agentInfo.stats->invalid;
+    ML::atomic_inc(agentInfo.stats->invalid);
 
     va_list ap;
     va_start(ap, message);
@@ -1374,7 +1671,7 @@ returnInvalidBid(
         const std::shared_ptr<Auction> &auction,
         const std::string &reason, const char *message, ...) {
 
-    auto& agentInfo = agents[agent];
+    auto& agentInfo = agents.at(agent);
     const auto& agentConfig = agentInfo.config;
     this->recordHit("bidErrors.%s", reason);
     this->recordHit("accounts.%s.bidErrors.total",
@@ -1383,7 +1680,7 @@ returnInvalidBid(
                     agentConfig->account.toString('.'),
                     reason);
 
-    ++agentInfo.stats->invalid;
+    ML::atomic_inc(agentInfo.stats->invalid);
 
     va_list ap;
     va_start(ap, message);
@@ -1411,7 +1708,7 @@ doStats(const std::vector<std::string> & message)
     Json::Value result(Json::objectValue);
 
     result["numAugmenting"] = augmentationLoop.numAugmenting();
-    result["numInFlight"] = inFlight.size();
+    result["numInFlight"] = numInFlight();
     result["blacklistUsers"] = blacklist.size();
 
     result["numAgents"] = agents.size();
@@ -1479,8 +1776,9 @@ augmentAuction(const std::shared_ptr<AugmentationInfo> & info)
             }
 
             // Send it off to be farmed out to the bidders
-            startBiddingBuffer.push(info);
-            wakeupMainLoop.signal();
+            Shard & shard = shardFor(info->auction->id);
+            shard.startBiddingBuffer.push(info);
+            signalShard(shard);
         };
 
     augmentationLoop.augment(info, Date::now().plusSeconds(augmentationWindow.count()),
@@ -1501,7 +1799,7 @@ preprocessAuction(const std::shared_ptr<Auction> & auction)
             = Date::now().plusSeconds(secondsUntilLossAssumed_);
     Date lossTimeout = auction->lossAssumed;
 
-    //cerr << "AUCTION " << auction->id << " " << auction->requestStr << endl;
+    //cerr << "AUCTION " << auction->id << " " << auction->requestStr() << endl;
 
     //cerr << "url = " << auction->request->url << endl;
 
@@ -1623,6 +1921,10 @@ preprocessAuction(const std::shared_ptr<Auction> & auction)
     this->recordLevel(validGroups.size(), "potentialBiddersPerRequest");
 
     if (validGroups.empty()) {
+        // The rest of a lazily parsed request is never needed
+        if (!auction->request->isComplete())
+            recordHit("lazyParsing.skipped");
+
         // Now we need to end the auction
         //inFlight.erase(auctionId);
         if (!auction->finish()) {
@@ -1633,6 +1935,11 @@ preprocessAuction(const std::shared_ptr<Auction> & auction)
         return std::shared_ptr<AugmentationInfo>();
     }
 
+    // From here on anything can read the request so a lazily parsed one
+    // needs to be completed.
+    if (!completeRequest(auction))
+        return std::shared_ptr<AugmentationInfo>();
+
     auto info = std::make_shared<AugmentationInfo>(auction, lossTimeout);
     info->potentialGroups.swap(validGroups);
 
@@ -1644,25 +1951,48 @@ preprocessAuction(const std::shared_ptr<Auction> & auction)
     return info;
 }
 
+bool
+Router::
+completeRequest(const std::shared_ptr<Auction> & auction)
+{
+    if (auction->request->isComplete()) return true;
+
+    try {
+        auction->completeRequest();
+    } catch (const std::exception & exc) {
+        recordHit("lazyParsing.error");
+        if (!auction->finish())
+            recordHit("tooLateToFinish");
+        return false;
+    }
+
+    recordHit("lazyParsing.completed");
+    return true;
+}
+
 void
 Router::
 doStartBidding(const std::vector<std::string> & message)
 {
     std::shared_ptr<AugmentationInfo> augInfo
         = sharedPtrFromMessage<AugmentationInfo>(message.at(2));
-    doStartBidding(augInfo);
+
+    Shard & shard = shardFor(augInfo->auction->id);
+    shard.startBiddingBuffer.push(augInfo);
+    signalShard(shard);
 }
 
 void
 Router::
-doStartBidding(const std::shared_ptr<AugmentationInfo> & augInfo)
+doStartBidding(Shard & shard,
+               const std::shared_ptr<AugmentationInfo> & augInfo)
 {
     //static const char *fName = "Router::doStartBidding:";
     RouterProfiler profiler(dutyCycleCurrent.nsStartBidding);
 
     try {
         Id auctionId = augInfo->auction->id;
-        if (inFlight.count(auctionId)) {
+        if (shard.inFlight.count(auctionId)) {
             throwException("doStartBidding.alreadyInFlight",
                            "auction with ID %s already in progress",
                            auctionId.toString().c_str());
@@ -1679,7 +2009,7 @@ doStartBidding(const std::shared_ptr<AugmentationInfo> & augInfo)
 
         auto groupAgents = augInfo->potentialGroups;
 
-        AuctionInfo & auctionInfo = addAuction(augInfo->auction,
+        AuctionInfo & auctionInfo = addAuction(shard, augInfo->auction,
                                                augInfo->lossTimeout);
         auto auction = augInfo->auction;
 
@@ -1703,8 +2033,9 @@ doStartBidding(const std::shared_ptr<AugmentationInfo> & augInfo)
 
             for (unsigned i = 0;  i < bidders.size();  ++i) {
                 PotentialBidder & bidder = bidders[i];
-                if (!agents.count(bidder.agent)) continue;
-                AgentInfo & info = agents[bidder.agent];
+                auto agentIt = agents.find(bidder.agent);
+                if (agentIt == agents.end()) continue;
+                AgentInfo & info = agentIt->second;
                 const AgentConfig & config = *bidder.config;
 
                 auto doFilterStat = [&] (const char * reason)
@@ -1730,7 +2061,7 @@ doStartBidding(const std::shared_ptr<AugmentationInfo> & augInfo)
 
                 /* Check if we have too many in flight. */
                 if (info.numBidsInFlight() >= info.config->maxInFlight) {
-                    ++info.stats->tooManyInFlight;
+                    ML::atomic_inc(info.stats->tooManyInFlight);
                     bidder.inFlightProp = PotentialBidder::NULL_PROP;
                     doFilterStat("dynamic.tooManyInFlight");
                     continue;
@@ -1858,13 +2189,14 @@ doStartBidding(const std::shared_ptr<AugmentationInfo> & augInfo)
             PotentialBidder & winner = bidders[best];
             string agent = winner.agent;
 
-            if (!agents.count(agent)) {
+            auto agentIt = agents.find(agent);
+            if (agentIt == agents.end()) {
                 //cerr << "!!!AGENT IS GONE" << endl;
                 continue;  // agent is gone
             }
-            AgentInfo & info = agents[agent];
+            AgentInfo & info = agentIt->second;
 
-            ++info.stats->auctions;
+            ML::atomic_inc(info.stats->auctions);
 
             Json::Value aggregatedAug;
             for (const auto& aug : augList) {
@@ -1907,7 +2239,7 @@ doStartBidding(const std::shared_ptr<AugmentationInfo> & augInfo)
         else {
             /* No bidders; don't bother with the bid */
             ML::atomic_inc(numNoBidders);
-            inFlight.erase(auctionId);
+            shard.inFlight.erase(auctionId);
             //cerr << fName << "About to call finish " << endl;
             if (!auction->finish()) {
                 recordHit("tooLateToFinish");
@@ -1925,7 +2257,7 @@ doStartBidding(const std::shared_ptr<AugmentationInfo> & augInfo)
 
 AuctionInfo &
 Router::
-addAuction(std::shared_ptr<Auction> auction, Date lossTimeout)
+addAuction(Shard & shard, std::shared_ptr<Auction> auction, Date lossTimeout)
 {
     const Id & id = auction->id;
 
@@ -1933,7 +2265,7 @@ addAuction(std::shared_ptr<Auction> auction, Date lossTimeout)
 
     try {
         AuctionInfo & result
-            = inFlight.insert(id, AuctionInfo(auction, lossTimeout),
+            = shard.inFlight.insert(id, AuctionInfo(auction, lossTimeout),
                               getCurrentTime().plusSeconds(bidMemoryWindow));
         return result;
     } catch (const std::exception & exc) {
@@ -1956,7 +2288,7 @@ static bool failBid(double proportion)
 
 void
 Router::
-doBid(const std::vector<std::string> & message)
+doBid(Shard & shard, const std::vector<std::string> & message)
 {
     if (message.size() < 5 || message.size() > 6) {
         returnErrorResponse(message, "BID message has 4-5 parts");
@@ -1985,8 +2317,8 @@ doBid(const std::vector<std::string> & message)
         bids = Bids::fromJson(biddata);
     }
     catch (const std::exception & exc) {
-        auto it = inFlight.find(auctionId);
-        if (it == inFlight.end()) {
+        auto it = shard.inFlight.find(auctionId);
+        if (it == shard.inFlight.end()) {
             recordHit("bidError.unknownAuction");
             returnErrorResponse(message, "unknown auction");
             return;
@@ -2000,12 +2332,13 @@ doBid(const std::vector<std::string> & message)
     }
     bidMessage.bids = std::move(bids);
 
-    doBidImpl(bidMessage, message);
+    doBidImpl(shard, bidMessage, message);
 }
 
 void
 Router::
-doBidImpl(const BidMessage &message, const std::vector<std::string> &originalMessage)
+doBidImpl(Shard & shard, const BidMessage &message,
+          const std::vector<std::string> &originalMessage)
 {
     Date dateGotBid = Date::now();
 
@@ -2017,8 +2350,8 @@ doBidImpl(const BidMessage &message, const std::vector<std::string> &originalMes
     ExcAssert(!message.agents.empty());
 
     const auto& auctionId = message.auctionId;
-    auto it = inFlight.find(auctionId);
-    if (it == inFlight.end()) {
+    auto it = shard.inFlight.find(auctionId);
+    if (it == shard.inFlight.end()) {
         recordHit("bidError.unknownAuction");
         returnErrorResponse(originalMessage, "unknown auction");
         return;
@@ -2027,7 +2360,8 @@ doBidImpl(const BidMessage &message, const std::vector<std::string> &originalMes
     AuctionInfo & auctionInfo = it->second;
 
     for (const auto &agent: message.agents) {
-        if (!agents.count(agent)) {
+        auto agentIt = agents.find(agent);
+        if (agentIt == agents.end()) {
             returnErrorResponse(originalMessage, "unknown agent");
             return;
         }
@@ -2040,7 +2374,7 @@ doBidImpl(const BidMessage &message, const std::vector<std::string> &originalMes
             return;
         }
 
-        AgentInfo & info = agents[agent];
+        AgentInfo & info = agentIt->second;
         /* One less in flight. */
         if (!info.expireBidInFlight(auctionId)) {
             recordHit("bidError.agentNotBidding");
@@ -2061,7 +2395,7 @@ doBidImpl(const BidMessage &message, const std::vector<std::string> &originalMes
     const auto& agent = message.agents[0];
     auto biddersIt = auctionInfo.bidders.find(agent);
     auto & config = *biddersIt->second.agentConfig;
-    AgentInfo & info = agents[agent];
+    AgentInfo & info = agents.at(agent);
     const auto& agentConfig = info.config;
 
     const auto& bids = message.bids;
@@ -2140,7 +2474,7 @@ doBidImpl(const BidMessage &message, const std::vector<std::string> &originalMes
         if (!creative.compatible(imp[spotIndex])) {
 #if 1
             cerr << "creative not compatible with spot: " << endl;
-            cerr << "auction: " << auctionInfo.auction->requestStr
+            cerr << "auction: " << auctionInfo.auction->requestStr()
                 << endl;
             cerr << "config: " << config.toJson().toStringNoNewLine() << endl;
             cerr << "bid: " << bidsString << endl;
@@ -2175,6 +2509,7 @@ doBidImpl(const BidMessage &message, const std::vector<std::string> &originalMes
         Amount price = message.wcm.evaluate(bid, bid.price);
 
         if (!monitorClient.getStatus(slowModeTolerance)) {
+            std::unique_lock<ML::Spinlock> slowModeGuard(slowModeLock);
             Date now = Date::now();
             if ((uint32_t) slowModeLastAuction.secondsSinceEpoch()
                     < (uint32_t) now.secondsSinceEpoch()) {
@@ -2208,7 +2543,7 @@ doBidImpl(const BidMessage &message, const std::vector<std::string> &originalMes
 
         if (!banker->authorizeBid(config.account, auctionKey, price) || failBid(budgetErrorRate))
         {
-            ++info.stats->noBudget;
+            ML::atomic_inc(info.stats->noBudget);
 
             bidder->sendNoBudgetMessage(agentConfig, agent, auctionInfo.auction);
 
@@ -2269,20 +2604,20 @@ doBidImpl(const BidMessage &message, const std::vector<std::string> &originalMes
 
         switch (localResult.val) {
         case Auction::WinLoss::PENDING: {
-            ++info.stats->bids;
-            info.stats->totalBid += bid.price;
+            ML::atomic_inc(info.stats->bids);
+            info.stats->addBid(bid.price);
             break; // response will be sent later once local winning bid known
         }
         case Auction::WinLoss::LOSS:
-            ++info.stats->bids;
-            info.stats->totalBid += bid.price;
+            ML::atomic_inc(info.stats->bids);
+            info.stats->addBid(bid.price);
             // fall through
         case Auction::WinLoss::TOOLATE:
         case Auction::WinLoss::INVALID: {
             if (localResult.val == Auction::WinLoss::TOOLATE)
-                ++info.stats->tooLate;
+                ML::atomic_inc(info.stats->tooLate);
             else if (localResult.val == Auction::WinLoss::INVALID)
-                ++info.stats->invalid;
+                ML::atomic_inc(info.stats->invalid);
 
             banker->cancelBid(config.account, auctionKey);
 
@@ -2359,7 +2694,7 @@ doBidImpl(const BidMessage &message, const std::vector<std::string> &originalMes
             debugAuction(auctionId, "FINISH TOO LATE", originalMessage);
             recordHit("accounts.%s.FINISH_TOOLATE", agentConfig->account.toString('.'));
         }
-        inFlight.erase(auctionId);
+        shard.inFlight.erase(auctionId);
         //cerr << "couldn't finish auction " << auctionInfo.auction->id
         //<< " after bid " << message << endl;
     }
@@ -2473,14 +2808,14 @@ doSubmitted(std::shared_ptr<Auction> auction)
                                "auction should not be invalid");
             case Auction::WinLoss::LOSS:
                 bidStatus = BS_LOSS;
-                ++info.stats->losses;
+                ML::atomic_inc(info.stats->losses);
                 msg = "LOSS";
                 bidder->sendLossMessage(agentConfig, response.agent, auctionId.toString());
                 recordHit("accounts.%s.LOCAL_LOSS", agentConfig->account.toString('.'));
                 break;
             case Auction::WinLoss::TOOLATE:
                 bidStatus = BS_TOOLATE;
-                ++info.stats->tooLate;
+                ML::atomic_inc(info.stats->tooLate);
                 msg = "TOOLATE";
                 bidder->sendTooLateMessage(agentConfig, response.agent, auction);
                 recordHit("accounts.%s.TOOLATE", agentConfig->account.toString('.'));
@@ -2557,17 +2892,13 @@ onNewAuction(std::shared_ptr<Auction> auction)
 
     //cerr << "AUCTION GOT THROUGH" << endl;
 
-    if (logAuctions) {
-        if (analytics) analytics->logAuctionMessage(auction->id, auction->requestStr);
+    if (logAuctions && analytics) {
+        // The log wants the whole request, filtered or not
+        if (!completeRequest(auction)) return;
+        analytics->logAuctionMessage(auction->id, auction->requestStr());
     }
     logMessageToAnalytics("AUCTION", auction->id);
 
-    const BidRequest & request = *auction->request;
-    int numFields = 0;
-    if (!request.url.empty()) ++numFields;
-    if (request.userIds.exchangeId) ++numFields;
-    if (request.userIds.providerId) ++numFields;
-
     auto info = preprocessAuction(auction);
 
     if (info) {
@@ -2595,6 +2926,7 @@ onAuctionDone(std::shared_ptr<Auction> auction)
 
     debugAuction(auction->id, "SENT SUBMITTED");
     submittedBuffer.push(auction);
+    signalMainLoop();
 }
 
 void
@@ -2604,7 +2936,7 @@ onAuctionError(const std::string & channel,
                const std::string & message)
 {
     if (auction) {
-//         cout << channel << " " << auction->requestStr << " " << message << endl;
+//         cout << channel << " " << auction->requestStr() << " " << message << endl;
         logMessageToAnalytics(channel, auction->id, message);
     }
     else {
@@ -2657,9 +2989,22 @@ void
 Router::
 doConfig(const std::string & agent,
          std::shared_ptr<const AgentConfig> config)
+{
+    FilterPool::ConfigBatch batch;
+    doConfig(agent, config, batch);
+    applyConfigs(batch);
+}
+
+void
+Router::
+doConfig(const std::string & agent,
+         std::shared_ptr<const AgentConfig> config,
+         FilterPool::ConfigBatch & batch)
 {
     RouterProfiler profiler(dutyCycleCurrent.nsConfig);
 
+    std::unique_lock<ML::RWLock> guard(agentsLock);
+
     if (!config) {
         auto it = agents.find(agent);
         // It might happen that we don't find the agent if for example we received
@@ -2667,7 +3012,7 @@ doConfig(const std::string & agent,
         // configuration to the ACS.
         if (it != std::end(agents)) {
             cerr << "agent " << agent << " lost configuration" << endl;
-            filters.removeConfig(agent);
+            batch.removeConfig(agent);
             agents.erase(it);
         }
     } else {
@@ -2690,17 +3035,39 @@ doConfig(const std::string & agent,
         //cerr << "configured " << agent << " strategy : " << info.config->strategy << " campaign "
         //     <<  info.config->campaign << endl;
 
-        string bidRequestFormat = "jsonRaw";
-        info.setBidRequestFormat(bidRequestFormat);
+        info.setBidRequestFormat(newConfig->bidRequestFormat,
+                                 newConfig->bidRequestFields);
 
         configure(agent, *newConfig);
         info.configured = true;
         bidder->sendMessage(config, agent, "GOTCONFIG");
 
-        info.filterIndex = filters.addConfig(agent, info);
+        batch.addConfig(agent, info);
+    }
+}
+
+void
+Router::
+applyConfigs(FilterPool::ConfigBatch & batch)
+{
+    if (batch.empty()) return;
+
+    RouterProfiler profiler(dutyCycleCurrent.nsConfig);
+
+    auto indexes = filters.applyConfigs(batch);
+    batch.clear();
+
+    {
+        std::unique_lock<ML::RWLock> guard(agentsLock);
+
+        for (const auto & entry : indexes) {
+            auto it = agents.find(entry.first);
+            if (it != agents.end())
+                it->second.filterIndex = entry.second;
+        }
     }
 
-    // Broadcast that we have a new agent or it has a new configuration
+    // Broadcast that we have new agents or new configurations
     updateAllAgents();
 }
 
@@ -2947,7 +3314,9 @@ submitToPostAuctionService(std::shared_ptr<Auction> auction,
         event->lossTimeout = auction->lossAssumed;
         event->augmentations = auction->agentAugmentations[bid.agent];
         event->bidRequest(auction->request);
-        event->bidRequestStr = auction->requestStr;
+        if (binaryPostAuctionEvents)
+            event->bidRequestBinary = auction->requestSerialized();
+        else event->bidRequestStr = auction->requestStr();
         event->bidRequestStrFormat = auction->requestStrFormat ;
         event->bidResponse = bid;
 
@@ -25,6 +25,7 @@
 #include "soa/gc/gc_lock.h"
 #include "jml/utils/ring_buffer.h"
 #include "jml/arch/wakeup_fd.h"
+#include "jml/arch/rwlock.h"
 #include "jml/utils/smart_ptr_utils.h"
 #include <unordered_set>
 #include <thread>
@@ -183,6 +184,35 @@ struct Router : public ServiceBase,
     */
     void unsafeDisableSlowMode();
 
+    /** Makes the main loop block until there's work to do or until the next
+        in flight auction expires instead of sleeping for a fixed amount of
+        time whenever it's idle. Before blocking, the loop busy polls for up
+        to busyPollSeconds which trades cpu for latency under load; 0 blocks
+        right away.
+
+        Must be called before start.
+    */
+    void setEventDrivenLoop(bool enabled, double busyPollSeconds = 0.00005);
+
+    /** Splits the in flight auctions between the given number of shards.
+        Each shard starts the bidding, handles the bids and expires the
+        auctions that hash to it in its own thread; with a single shard
+        (the default) all of this happens in the main loop.
+
+        Must be called before start.
+    */
+    void setNumShards(size_t numShards);
+
+    /** Sends the bid requests to the post auction service encoded with
+        BinaryBidRequest instead of as JSON.  Post auction services that
+        predate the encoding can't read the events that carry it so this
+        must only be enabled once all of them have been upgraded.
+    */
+    void setBinaryPostAuctionEvents(bool enabled)
+    {
+        binaryPostAuctionEvents = enabled;
+    }
+
     /** Start the router running in a separate thread.  The given function
         will be called when the thread is stopped. */
     virtual void
@@ -227,6 +257,8 @@ struct Router : public ServiceBase,
                                        std::shared_ptr<Auction> auction,
                                        const std::string message) {
                         this->onAuctionError(channel, auction, message); };
+        exchange.getFilterFields = [=] () {
+                        return this->filters.requiredFields(); };
     }
 
     /** Register the exchange with the router and make it take ownership of it */
@@ -432,15 +464,31 @@ public:
     typedef std::map<std::string, AgentInfo> Agents;
     Agents agents;
 
+    /** Only the main loop modifies agents and it must hold this lock in
+        write mode to do so.  The shards hold it in read mode while they
+        process an auction.
+    */
+    mutable ML::RWLock agentsLock;
+
     ML::RingBufferSRMW<std::pair<std::string, std::shared_ptr<const AgentConfig> > > configBuffer;
     ML::RingBufferSRMW<std::shared_ptr<ExchangeConnector> > exchangeBuffer;
-    ML::RingBufferSRMW<std::shared_ptr<AugmentationInfo> > startBiddingBuffer;
     ML::RingBufferSRMW<std::shared_ptr<Auction> > submittedBuffer;
-    ML::RingBufferSWMR<std::shared_ptr<Auction> > auctionGraveyard;
+    ML::RingBufferSRMW<std::shared_ptr<Auction> > auctionGraveyard;
     ML::RingBufferSRMW<BidMessage> doBidBuffer;
 
     ML::Wakeup_Fd wakeupMainLoop;
 
+    /** Wakes up the main loop after something was pushed in one of its
+        buffers. Only the first signal since the main loop last woke up makes
+        a system call.
+    */
+    void signalMainLoop();
+    std::atomic<bool> mainLoopWakeupPending;
+
+    /** See setEventDrivenLoop. */
+    bool eventDrivenLoop;
+    double busyPollSeconds;
+
     FilterPool filters;
 
     AugmentationLoop augmentationLoop;
@@ -451,11 +499,57 @@ public:
 
     /** List of auctions we're currently tracking as active. */
     typedef TimeoutMap<Id, AuctionInfo> InFlight;
-    InFlight inFlight;
+
+    /** Part of the in flight auctions along with the queues of the work
+        that needs to be done on them.  An auction is owned by the shard
+        selected by the hash of its id for its whole life.
+    */
+    struct Shard {
+        Shard(unsigned index);
+
+        unsigned index;
+
+        /** Held by the loop that runs the shard while it works on the in
+            flight auctions so that the main loop can look at them.
+        */
+        mutable std::mutex lock;
+        InFlight inFlight;
+
+        ML::RingBufferSRMW<std::shared_ptr<AugmentationInfo> > startBiddingBuffer;
+        ML::RingBufferSRMW<BidMessage> bidBuffer;
+        ML::RingBufferSRMW<std::vector<std::string> > agentBidBuffer;
+
+        ML::Wakeup_Fd wakeup;
+        std::atomic<bool> wakeupPending;
+
+        std::unique_ptr<boost::thread> thread;
+    };
+
+    std::vector<std::unique_ptr<Shard> > shards;
+
+    Shard & shardFor(const Id & auctionId)
+    {
+        return *shards[auctionId.hash() % shards.size()];
+    }
+
+    /** Wakes up whichever loop runs the shard. */
+    void signalShard(Shard & shard);
+
+    /** Loop of the shard when it runs in its own thread. */
+    void runShard(Shard & shard);
+
+    /** Does all the work that was queued up for the shard. */
+    void processShard(Shard & shard);
+
+    /** Total number of in flight auctions over all the shards. */
+    size_t numInFlight() const;
+
+    /** Returns the in flight auction with the given id or null. */
+    std::shared_ptr<Auction> findInFlightAuction(const Id & auctionId) const;
 
     /** Add the given auction to our data structures. */
     AuctionInfo &
-    addAuction(std::shared_ptr<Auction> auction, Date timeout);
+    addAuction(Shard & shard, std::shared_ptr<Auction> auction, Date timeout);
 
     DutyCycleEntry dutyCycleCurrent;
     std::vector<DutyCycleEntry> dutyCycleHistory;
@@ -468,6 +562,8 @@ public:
 
     void checkExpiredAuctions();
 
+    void checkExpiredAuctions(Shard & shard);
+
     void returnErrorResponse(const std::vector<std::string> & message,
                              const std::string & error);
 
@@ -488,6 +584,12 @@ public:
     std::shared_ptr<AugmentationInfo>
     preprocessAuction(const std::shared_ptr<Auction> & auction);
 
+    /** Completes a lazily parsed request before anything reads the fields
+        that were left out.  Returns false, having finished the auction, if
+        the rest of the request couldn't be parsed.
+    */
+    bool completeRequest(const std::shared_ptr<Auction> & auction);
+
     /** Send the auction for augmentation.  Once that is done, doStartBidding
         will be called.
     */
@@ -499,7 +601,8 @@ public:
     void doStartBidding(const std::vector<std::string> & message);
 
     /** Ditto but taking the augmented auction directly. */
-    void doStartBidding(const std::shared_ptr<AugmentationInfo> & augInfo);
+    void doStartBidding(Shard & shard,
+                        const std::shared_ptr<AugmentationInfo> & augInfo);
 
     /** Auction has been submitted.  Do the final cleanup here and send
         it off to the post auction loop. */
@@ -508,9 +611,9 @@ public:
     //std::unordered_set<Id> recentlySubmitted;  // DEBUG
 
     /** An agent bid on an auction.  Arrange for this bid to be recorded. */
-    void doBid(const std::vector<std::string> & message);
+    void doBid(Shard & shard, const std::vector<std::string> & message);
 
-    void doBidImpl(const BidMessage &message,
+    void doBidImpl(Shard & shard, const BidMessage &message,
                    const std::vector<std::string> &originalMessage = std::vector<std::string>());
 
     /** An agent responded to a ping message.  Arrange for the ping time
@@ -540,6 +643,18 @@ public:
     void doConfig(const std::string & agent,
                   std::shared_ptr<const AgentConfig> config);
 
+    /** Same as above but the filter changes are only recorded in the batch
+        and take effect once the batch is passed to applyConfigs.
+    */
+    void doConfig(const std::string & agent,
+                  std::shared_ptr<const AgentConfig> config,
+                  FilterPool::ConfigBatch & batch);
+
+    /** Applies a batch of config changes to the filters with a single update
+        and broadcasts the new set of agents.
+    */
+    void applyConfigs(FilterPool::ConfigBatch & batch);
+
     /* Add a given agent (with the given configuration) to the exchange */
     void configureAgentOnExchange(std::shared_ptr<ExchangeConnector> const & exchange,
                                   std::string const & agent,
@@ -566,6 +681,7 @@ public:
     double budgetErrorRate;
     bool connectPostAuctionLoop;
     bool enableBidProbability;
+    bool binaryPostAuctionEvents;
 
 
     /*************************************************************************/
@@ -793,6 +909,8 @@ public:
     std::atomic<bool> slowModePeriodicSpentReached;    
     Amount slowModeAuthorizedMoneyLimit;
     uint64_t accumulatedBidMoneyInThisPeriod;
+    /// Protects the slow mode spending, which is updated by every shard.
+    ML::Spinlock slowModeLock;
 
     /* MONITOR PROVIDER */
     /* Post service health status to Monitor */
@@ -64,7 +64,11 @@ RouterRunner() :
     analyticsPublisherOn(false),
     analyticsPublisherConnections(1),
     augmentationWindowms(5),
-    dableSlowMode(false)
+    dableSlowMode(false),
+    eventDrivenLoop(false),
+    busyPollUs(50),
+    numShards(1),
+    binaryPostAuctionEvents(false)
 {
 }
 
@@ -118,7 +122,16 @@ doOptions(int argc, char ** argv,
          ("augmenter-timeout",value<int>(&augmentationWindowms),
          "configure the augmenter  timeout (in milliseconds)")
         ("no slow mode", value<bool>(&dableSlowMode)->zero_tokens(),
-         "disable the slow mode.");
+         "disable the slow mode.")
+        ("event-loop", bool_switch(&eventDrivenLoop),
+         "block the main loop until there's work to do instead of sleeping")
+        ("busy-poll-us", value<int>(&busyPollUs),
+         "microseconds to busy poll before blocking with --event-loop (default 50)")
+        ("router-shards", value<int>(&numShards),
+         "number of threads handling the in flight auctions (default 1: main loop)")
+        ("binary-post-auction-events", bool_switch(&binaryPostAuctionEvents),
+         "send binary bid requests to the post auction service; "
+         "all post auction services must be upgraded first");
 
     options_description all_opt = opts;
     all_opt
@@ -183,6 +196,9 @@ init()
                                       USD_CPM(maxBidPrice),
                                       slowModeTimeout, amountSlowModeMoneyLimit, augmentationWindow);
     router->slowModeTolerance = slowModeTolerance;
+    router->setEventDrivenLoop(eventDrivenLoop, busyPollUs / 1000000.0);
+    router->setNumShards(numShards);
+    router->setBinaryPostAuctionEvents(binaryPostAuctionEvents);
     router->initBidderInterface(bidderConfig);
     if (dableSlowMode) {
        router->unsafeDisableSlowMode();
@@ -56,6 +56,10 @@ struct RouterRunner {
     int analyticsPublisherConnections;
     int augmentationWindowms;
     bool dableSlowMode;
+    bool eventDrivenLoop;
+    int busyPollUs;
+    int numShards;
+    bool binaryPostAuctionEvents;
 
     void doOptions(int argc, char ** argv,
                    const boost::program_options::options_description & opts
@@ -91,7 +91,7 @@ submitAuction(const std::shared_ptr<Auction> & auction,
     postAuctionLoop.injectSubmittedAuction(auction->id,
                                            adSpotId,
                                            auction->request,
-                                           auction->requestStr,
+                                           auction->requestStr(),
                                            auction->requestStrFormat,
                                            agentAugmentations,
                                            response,
@@ -135,7 +135,7 @@ numNonIdle() const
 {
     size_t numInFlight, numAwaitingAugmentation;
     {
-        numInFlight = router.inFlight.size();
+        numInFlight = router.numInFlight();
         numAwaitingAugmentation = router.augmentationLoop.numAugmenting();
     }
 
@@ -106,39 +106,69 @@ toJson(bool includeConfig, bool includeStats) const
     result["configured"] = configured;
     result["lastHeartbeat"]
         = status->lastHeartbeat.print(4);
-    result["numInFlight"] = status->numBidsInFlight;
+    result["numInFlight"] = status->numBidsInFlight.load();
     if (config && includeConfig) result["config"] = config->toJson(false);
     if (stats && includeStats) result["stats"] = stats->toJson();
     
     return result;
 }
 
-const std::string &
+std::string
 AgentInfo::
 encodeBidRequest(const BidRequest & br) const
 {
-    throw ML::Exception("encodeBidRequest not there yet");
+    switch (bidRequestFormat) {
+    case BRF_JSON_RAW:
+    case BRF_JSON_NORM:  return br.toJsonStr(bidRequestFields);
+    case BRF_BINARY_V1:  return br.serializeToString();
+    default:
+        throw ML::Exception("unknown bid request format");
+    }
 }
 
 const std::string &
 AgentInfo::
 encodeBidRequest(const Auction & auction) const
 {
-    return auction.requestStr;
+    switch (bidRequestFormat) {
+    case BRF_JSON_RAW:   return auction.requestStr();
+    case BRF_JSON_NORM:  return auction.requestProjection(bidRequestFields);
+    case BRF_BINARY_V1:  return auction.requestSerialized();
+    default:
+        throw ML::Exception("unknown bid request format");
+    }
 }
 
 const std::string &
 AgentInfo::
 getBidRequestEncoding(const Auction & auction) const
 {
-    return auction.requestStrFormat;
+    static const std::string canonical = "datacratic";
+    static const std::string binary = "datacratic-binary";
+
+    switch (bidRequestFormat) {
+    case BRF_JSON_RAW:   return auction.requestStrFormat;
+    case BRF_JSON_NORM:  return canonical;
+    case BRF_BINARY_V1:  return binary;
+    default:
+        throw ML::Exception("unknown bid request format");
+    }
 }
 
 void
 AgentInfo::
-setBidRequestFormat(const std::string & val)
+setBidRequestFormat(const std::string & val,
+                    const std::vector<std::string> & fields)
 {
-    // TODO
+    if (val == "json" || val == "jsonRaw")
+        bidRequestFormat = BRF_JSON_RAW;
+    else if (val == "projected" || val == "jsonNorm")
+        bidRequestFormat = BRF_JSON_NORM;
+    else if (val == "binary")
+        bidRequestFormat = BRF_BINARY_V1;
+    else throw ML::Exception("unknown bid request format " + val);
+
+    bidRequestFields = fields;
 }
 
 AgentStats::
@@ -178,9 +208,12 @@ toJson() const
     result["tooLate"] = tooLate;
     result["invalid"] = invalid;
     result["noBudget"] = noBudget;
-    result["totalBid"] = totalBid.toJson();
-    result["totalBidOnWins"] = totalBidOnWins.toJson();
-    result["totalSpent"] = totalSpent.toJson();
+    {
+        std::lock_guard<ML::Spinlock> guard(poolLock);
+        result["totalBid"] = totalBid.toJson();
+        result["totalBidOnWins"] = totalBidOnWins.toJson();
+        result["totalSpent"] = totalSpent.toJson();
+    }
     result["tooManyInFlight"] = tooManyInFlight;
     result["requiredIdMissing"] = requiredIdMissing;
     result["notEnoughTime"] = notEnoughTime;
@@ -219,6 +252,14 @@ toJson() const
     return result;
 }
 
+void
+AgentStats::
+addBid(const Amount & price)
+{
+    std::lock_guard<ML::Spinlock> guard(poolLock);
+    totalBid += price;
+}
+
 Json::Value
 FormatInfo::
 toJson() const
@@ -14,6 +14,10 @@
 #include <set>
 #include "rtbkit/common/currency.h"
 #include "rtbkit/common/bids.h"
+#include "jml/arch/spinlock.h"
+#include <atomic>
+#include <array>
+#include <mutex>
 
 
 namespace RTBKIT {
@@ -89,6 +93,13 @@ struct AgentStats {
 
     uint64_t requiredAugmentorIsMissing;
     uint64_t augmentorValueIsNull;
+
+    /** Adds to totalBid. The shards bid concurrently and a CurrencyPool
+        can't be updated atomically so the pools are guarded by poolLock.
+    */
+    void addBid(const Amount & price);
+
+    mutable ML::Spinlock poolLock;
 };
 
 
@@ -101,7 +112,65 @@ struct AgentStatus {
 
     bool dead;
     Date lastHeartbeat;
-    size_t numBidsInFlight;
+    std::atomic<size_t> numBidsInFlight;
+};
+
+
+/** Auctions in which an agent is participating, along with the time at which
+    it was asked to bid.
+
+    Every router shard updates the auctions that it owns so the map is split
+    in stripes that each have their own lock, which keeps the shards from
+    contending with each other. The total lives in the AgentStatus.
+*/
+struct AgentBidsInFlight {
+    enum { NumStripes = 16 };
+
+    // Returns true if it was successfully inserted
+    bool insert(const Id & id, Date date)
+    {
+        Stripe & stripe = stripeFor(id);
+        std::lock_guard<ML::Spinlock> guard(stripe.lock);
+        return stripe.bids.insert(std::make_pair(id, date)).second;
+    }
+
+    bool erase(const Id & id)
+    {
+        Stripe & stripe = stripeFor(id);
+        std::lock_guard<ML::Spinlock> guard(stripe.lock);
+        return stripe.bids.erase(id);
+    }
+
+    /** Calls fn on a copy of each stripe so that fn can do anything,
+        including erasing entries, without holding a lock.
+    */
+    template<typename Fn>
+    void forEach(const Fn & fn) const
+    {
+        for (const Stripe & stripe : stripes) {
+            std::map<Id, Date> bids;
+            {
+                std::lock_guard<ML::Spinlock> guard(stripe.lock);
+                bids = stripe.bids;
+            }
+
+            for (const auto & entry : bids)
+                fn(entry.first, entry.second);
+        }
+    }
+
+private:
+    struct Stripe {
+        mutable ML::Spinlock lock;
+        std::map<Id, Date> bids;
+    };
+
+    Stripe & stripeFor(const Id & id)
+    {
+        return stripes[id.hash() % NumStripes];
+    }
+
+    std::array<Stripe, NumStripes> stripes;
 };
 
 /// Information about a agent
@@ -111,7 +180,8 @@ struct AgentInfo {
           configured(false),
           status(new AgentStatus()),
           stats(new AgentStats()),
-          throttleProbability(1.0)
+          throttleProbability(1.0),
+          bidsInFlight(new AgentBidsInFlight())
     {
     }
 
@@ -120,6 +190,9 @@ struct AgentInfo {
         BRF_JSON_NORM, ///< Send normalized JSON bid requests
         BRF_BINARY_V1  ///< Send binary bid requests
     } bidRequestFormat;
+
+    /** Fields sent with BRF_JSON_NORM; all of them if empty. */
+    std::vector<std::string> bidRequestFields;
     
     bool configured;
     unsigned filterIndex;
@@ -134,13 +207,25 @@ struct AgentInfo {
     /** Encode the given bid request ready to be sent to the given
         agent in its configured format.
     */
-    const std::string & encodeBidRequest(const BidRequest & br) const;
+    std::string encodeBidRequest(const BidRequest & br) const;
 
+    /** Encode the request of the auction in the agent's format. The encoding
+        is cached in the auction so that it's only done once per format and
+        shared with every agent that uses the same one.
+    */
     const std::string & encodeBidRequest(const Auction & auction) const;
+
+    /** Source name under which BidRequest::parse decodes the output of
+        encodeBidRequest.
+    */
     const std::string & getBidRequestEncoding(const Auction & auction) const;
 
-    /** Set the bid request format. */
-    void setBidRequestFormat(const std::string & val);
+    /** Set the bid request format from the names accepted by AgentConfig,
+        along with the fields sent with the projected format.
+    */
+    void setBidRequestFormat(const std::string & val,
+                             const std::vector<std::string> & fields
+                                 = std::vector<std::string>());
 
     /** Structure in which we record the information on ping timings. */
     struct PingInfo {
@@ -198,37 +283,33 @@ struct AgentInfo {
     template<typename Fn>
     void forEachInFlight(const Fn & fn) const
     {
-        for (auto it = bidsInFlight.begin(), end = bidsInFlight.end();
-             it != end;  ++it) {
-            fn(it->first, it->second);
-        }
+        bidsInFlight->forEach(fn);
     }
 
+    /** Safe to call from any thread. */
     size_t numBidsInFlight() const
     {
-        // DEBUG
-        if (status->numBidsInFlight != bidsInFlight.size())
-            throw ML::Exception("numBidsInFlight is wrong");
         return status->numBidsInFlight;
     }
     
     bool expireBidInFlight(const Id & id)
     {
-        bool result = bidsInFlight.erase(id);
-        status->numBidsInFlight = bidsInFlight.size();
+        bool result = bidsInFlight->erase(id);
+        if (result) status->numBidsInFlight--;
         return result;
     }
 
     // Returns true if it was successfully inserted
     bool trackBidInFlight(const Id & id, Date date = Date::now())
     {
-        bool result = bidsInFlight.insert(std::make_pair(id, date)).second;
-        status->numBidsInFlight = bidsInFlight.size();
+        bool result = bidsInFlight->insert(id, date);
+        if (result) status->numBidsInFlight++;
         return result;
     }
 
 private:
-    std::map<Id, Date> bidsInFlight;  /// Auctions in which we're participating
+    /// Auctions in which we're participating
+    std::shared_ptr<AgentBidsInFlight> bidsInFlight;
     //std::set<std::pair<Id, Id> > awaitingResult;  ///< Auctions which are awaiting a win/loss result
 };
 
@@ -6,7 +6,10 @@
 
 LIB_FILTERS_SOURCES := \
 	filters/static_filters.cc \
-        filters/creative_filters.cc
+        filters/creative_filters.cc \
+	filters/compiled_regex.cc \
+	filters/match_cache.cc \
+	filters/domain_trie.cc
 
 LIB_FILTERS_LINK := \
 	arch utils filter_registry agent_configuration rtb
@@ -0,0 +1,188 @@
+/* router_lazy_parsing_test.cc
+   Copyright (c) 2016 Datacratic.  All rights reserved.
+
+   Requests parsed lazily by the exchange connector are complete by the time
+   the router logs them and sends them to the agents.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include "rtbkit/common/analytics.h"
+#include "rtbkit/common/testing/exchange_source.h"
+#include "rtbkit/plugins/exchange/openrtb_exchange_connector.h"
+#include "rtbkit/testing/bid_stack.h"
+#include "soa/service/http_header.h"
+
+#include <mutex>
+
+using namespace std;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+
+/******************************************************************************/
+/* RECORDING ANALYTICS                                                        */
+/******************************************************************************/
+
+/** Keeps the requests that the router logs. */
+struct RecordingAnalytics : public Analytics {
+
+    RecordingAnalytics(const string & serviceName,
+                       shared_ptr<ServiceProxies> proxies)
+        : Analytics(serviceName, proxies)
+    {
+    }
+
+    virtual void logAuctionMessage(const Id & auctionId,
+                                   const string & auctionRequest)
+    {
+        lock_guard<mutex> guard(lock);
+        logged.push_back(auctionRequest);
+    }
+
+    static mutex lock;
+    static vector<string> logged;
+};
+
+mutex RecordingAnalytics::lock;
+vector<string> RecordingAnalytics::logged;
+
+namespace {
+
+struct AtInit {
+    AtInit()
+    {
+        PluginInterface<Analytics>::registerPlugin("recording",
+            [] (const string & serviceName,
+                shared_ptr<ServiceProxies> proxies) -> Analytics *
+            {
+                return new RecordingAnalytics(serviceName, proxies);
+            });
+    }
+} atInit;
+
+/** Only id, imp, at and tmax are parsed upfront; none of the default filters
+    look at cur or ext so those are left for later.
+*/
+const string LazyRequest =
+    "{\"id\":\"lazy-1\","
+    "\"imp\":[{\"id\":\"1\",\"banner\":{\"w\":728,\"h\":90}}],"
+    "\"site\":{\"id\":\"s1\",\"page\":\"http://www.example.com/page\"},"
+    "\"device\":{\"ua\":\"Mozilla/5.0 test\",\"ip\":\"192.168.1.1\","
+                "\"language\":\"fr\",\"geo\":{\"country\":\"CA\"}},"
+    "\"user\":{\"id\":\"user-1\"},"
+    "\"cur\":[\"USD\"],"
+    "\"ext\":{\"lazy\":\"yes\"},"
+    "\"at\":2,\"tmax\":100}";
+
+string httpRequest(const string & payload)
+{
+    return ML::format(
+            "POST /auctions HTTP/1.1\r\n"
+            "Content-Length: %zd\r\n"
+            "Content-Type: application/json\r\n"
+            "x-openrtb-version: 2.1\r\n"
+            "\r\n"
+            "%s",
+            payload.size(), payload.c_str());
+}
+
+/** Checks the fields of the request that were left out of the lazy parse
+    along with the ones that weren't.
+*/
+void checkComplete(const Json::Value & json)
+{
+    BOOST_CHECK_EQUAL(json["url"].asString(), "http://www.example.com/page");
+    BOOST_CHECK_EQUAL(json["userAgent"].asString(), "Mozilla/5.0 test");
+    BOOST_CHECK_EQUAL(json["ipAddress"].asString(), "192.168.1.1");
+    BOOST_CHECK_EQUAL(json["language"].asString(), "fr");
+    BOOST_CHECK_EQUAL(json["location"]["countryCode"].asString(), "CA");
+    BOOST_CHECK(json.isMember("userIds"));
+    BOOST_CHECK(json.isMember("user"));
+    BOOST_CHECK_EQUAL(json["bidCurrency"].size(), 1);
+    BOOST_CHECK_EQUAL(json["ext"]["lazy"].asString(), "yes");
+}
+
+} // file scope
+
+
+/******************************************************************************/
+/* TESTS                                                                      */
+/******************************************************************************/
+
+BOOST_AUTO_TEST_CASE( test_lazy_request_complete_when_logged )
+{
+    BidStack stack;
+    auto proxies = stack.proxies;
+
+    stack.logAuctions = true;
+    stack.analyticsConfig["pluginName"] = "recording";
+
+    Json::Value routerConfig;
+    routerConfig[0]["exchangeType"] = "openrtb";
+    routerConfig[0]["lazyBidRequestParsing"] = true;
+
+    Json::Value bidderConfig;
+    bidderConfig["type"] = "agents";
+
+    AgentConfig config;
+    config.account = { "campaign", "strategy" };
+    config.creatives.push_back(Creative::sampleLB);
+
+    std::mutex lock;
+    std::vector<std::shared_ptr<BidRequest> > received;
+
+    auto agent = std::make_shared<TestAgent>(proxies, "bobby");
+    agent->config = config;
+    agent->onBidRequest = [&] (double timestamp,
+                               const Id & id,
+                               std::shared_ptr<BidRequest> br,
+                               Bids bids,
+                               double timeLeftMs,
+                               const Json::Value & augmentations,
+                               const WinCostModel & wcm)
+        {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                received.push_back(br);
+            }
+            __sync_fetch_and_add(&agent->numBidRequests, 1);
+            Bid & bid = bids[0];
+            bid.bid(bid.availableCreatives[0], USD_CPM(1));
+            agent->doBid(id, bids, Json::Value(), wcm);
+        };
+    stack.addAgent(agent);
+
+    stack.runThen(
+        routerConfig, bidderConfig, USD_CPM(10), 0,
+        [&] (const Json::Value & json)
+    {
+        const auto & bids = json["workers"][0]["bids"];
+        NetworkAddress address(bids["url"].asString());
+        ExchangeSource exchangeConnection(address);
+
+        exchangeConnection.write(httpRequest(LazyRequest));
+        auto response = exchangeConnection.read();
+
+        HttpHeader header;
+        header.parse(response);
+        BOOST_CHECK_EQUAL(header.resource, "200");
+    });
+
+    BOOST_REQUIRE_EQUAL(agent->numBidRequests, 1);
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        BOOST_REQUIRE_EQUAL(received.size(), 1);
+        checkComplete(received[0]->toJson());
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(RecordingAnalytics::lock);
+        BOOST_REQUIRE_EQUAL(RecordingAnalytics::logged.size(), 1);
+        checkComplete(Json::parse(RecordingAnalytics::logged[0]));
+    }
+}
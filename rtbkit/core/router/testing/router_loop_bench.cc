@@ -0,0 +1,162 @@
+/** router_loop_bench.cc                                 -*- C++ -*-
+    Copyright (c) 2013 Datacratic.  All rights reserved.
+
+    Compares the latency and cpu usage of the two ways the router's main loop
+    can wait for work: the legacy spin-poll plus sleep and the event driven
+    wait. Events are pushed in a ring buffer at a fixed rate by another thread
+    exactly like the exchange threads feed the router.
+
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include "jml/utils/ring_buffer.h"
+#include "jml/arch/wakeup_fd.h"
+#include "jml/arch/timers.h"
+
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cmath>
+#include <time.h>
+#include <poll.h>
+
+using namespace std;
+using namespace ML;
+
+
+/******************************************************************************/
+/* UTILS                                                                      */
+/******************************************************************************/
+
+double now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+double threadCpu()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+struct Loop
+{
+    Loop() : buffer(65536), pending(false), shutdown(false) {}
+
+    RingBufferSRMW<double> buffer;
+    Wakeup_Fd wakeup;
+    atomic<bool> pending;
+    atomic<bool> shutdown;
+
+    void push(double sent)
+    {
+        buffer.push(sent);
+        if (!pending.exchange(true)) wakeup.signal();
+    }
+
+    /** Mirrors the wait logic of Router::run. zmq_poll boils down to a
+        poll when there are only file descriptors so we use it directly.
+     */
+    void run(bool eventDriven, double busyPoll, vector<double>& latencies)
+    {
+        pollfd items[] = { { wakeup.fd(), POLLIN, 0 } };
+
+        while (!shutdown) {
+            int rc = 0;
+
+            if (eventDriven) {
+                double busyUntil = now() + busyPoll;
+                do {
+                    rc = poll(items, 1, 0);
+                } while (rc == 0 && now() < busyUntil);
+
+                if (rc == 0) rc = poll(items, 1, 50);
+            }
+            else {
+                for (unsigned i = 0;  i < 20 && rc == 0;  ++i)
+                    rc = poll(items, 1, 0);
+
+                if (rc == 0) {
+                    ML::sleep(0.0005);
+                    rc = poll(items, 1, 50);
+                }
+            }
+
+            if (items[0].revents & POLLIN) {
+                pending = false;
+                wakeup.read();
+            }
+
+            double sent;
+            while (buffer.tryPop(sent))
+                latencies.push_back(now() - sent);
+        }
+    }
+};
+
+void bench(const string& name, bool eventDriven, double busyPoll, double qps)
+{
+    const double duration = 2.0;
+
+    Loop loop;
+    vector<double> latencies;
+    latencies.reserve(qps * duration * 2);
+
+    double cpu = 0;
+    thread consumer([&] {
+                double start = threadCpu();
+                loop.run(eventDriven, busyPoll, latencies);
+                cpu = threadCpu() - start;
+            });
+
+    // Pace the events but avoid sleeping right before one is due.
+    double start = now();
+    for (size_t i = 0; i < qps * duration; ++i) {
+        double due = start + i / qps;
+        double wait = due - now();
+        if (wait > 0.0002) ML::sleep(wait - 0.0001);
+        while (now() < due);
+
+        loop.push(now());
+    }
+
+    ML::sleep(0.1);
+    loop.shutdown = true;
+    loop.wakeup.signal();
+    consumer.join();
+
+    double elapsed = now() - start;
+
+    sort(latencies.begin(), latencies.end());
+    auto pct = [&] (double p) {
+        return latencies[min<size_t>(latencies.size() - 1, p * latencies.size())] * 1000000.0;
+    };
+
+    cerr << ML::format("%-14s qps=%6.0f p50=%8.1fus p99=%8.1fus max=%8.1fus cpu=%5.1f%%\n",
+            name.c_str(), qps, pct(0.5), pct(0.99), pct(1.0),
+            cpu / elapsed * 100.0);
+
+    BOOST_CHECK_EQUAL(latencies.size(), size_t(qps * duration));
+}
+
+
+/******************************************************************************/
+/* BENCH                                                                      */
+/******************************************************************************/
+
+BOOST_AUTO_TEST_CASE( routerLoopBench )
+{
+    for (double qps : { 1000.0, 10000.0, 50000.0 }) {
+        bench("legacy", false, 0, qps);
+        bench("event", true, 0, qps);
+        bench("event-busy50", true, 0.00005, qps);
+    }
+}
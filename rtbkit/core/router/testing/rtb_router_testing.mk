@@ -11,5 +11,7 @@ $(eval $(call test,pending_list_test,types leveldb,boost))
 #$(eval $(call test,augmentation_test,rtb_router bid_request augmentor_base,boost))
 
 $(eval $(call test,router_analytics_test,boost_program_options rtb_router,boost))
+$(eval $(call test,router_lazy_parsing_test,openrtb_exchange bid_test_utils bidding_agent rtb_router agents_bidder,boost))
 
 .PHONY: $(LIB)/libzmq_analytics.so
+$(eval $(call test,router_loop_bench,arch utils,boost manual))
@@ -62,6 +62,10 @@ struct MockExchangeConnector : public HttpExchangeConnector {
         return request;
     }
 
+    std::string payloadRequestFormat() const {
+        return "datacratic";
+    }
+
     double getTimeAvailableMs(HttpAuctionHandler & handler,
                               const HttpHeader & header,
                               const std::string & payload) {
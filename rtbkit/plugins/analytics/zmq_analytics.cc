@@ -61,7 +61,7 @@ void ZmqAnalytics::logMarkMessage(const Router & router,
                            ML::format("active: %zd augmenting, %zd inFlight, "
                                       "%zd agents",
                                       router.augmentationLoop.numAugmenting(),
-                                      router.inFlight.size(),                                             
+                                      router.numInFlight(),                                             
                                       router.agents.size())
                            );
 }
@@ -9,6 +9,7 @@
 #include "jml/utils/json_parsing.h"
 #include "rtbkit/openrtb/openrtb.h"
 #include "rtbkit/openrtb/openrtb_parsing.h"
+#include <cstring>
 
 using namespace std;
 
@@ -135,6 +136,122 @@ parseBidRequest(ML::Parse_Context & context)
     return std::move(req);
 }
 
+namespace {
+
+/** Groups of fields of RTBKIT::BidRequest that are built from each top level
+    member of an OpenRTB bid request.  The members that aren't listed (id,
+    imp, at, tmax and allimps) are always parsed.  Unknown fields anywhere
+    in the request end up in unparseable, which is therefore only complete
+    once all the members have been parsed.
+*/
+struct LazyMember {
+    const char * name;
+    uint32_t fields;
+};
+
+const LazyMember lazyMembers[] = {
+    { "site",   BidRequestFields::SITE | BidRequestFields::SEGMENTS },
+    { "app",    BidRequestFields::SITE | BidRequestFields::SEGMENTS },
+    { "device", BidRequestFields::DEVICE | BidRequestFields::USER_IDS },
+    // user.tz goes into the location
+    { "user",   BidRequestFields::USER | BidRequestFields::USER_IDS
+                | BidRequestFields::SEGMENTS | BidRequestFields::DEVICE },
+    { "wseat",  BidRequestFields::SEGMENTS },
+    { "cur",    BidRequestFields::CURRENCY },
+    { "bcat",   BidRequestFields::RESTRICTIONS },
+    { "badv",   BidRequestFields::RESTRICTIONS },
+    { "regs",   BidRequestFields::REGS },
+    { "ext",    BidRequestFields::EXT },
+    { "unparseable", BidRequestFields::NONE }
+};
+
+/** Groups of fields that depend on the given known member. */
+uint32_t lazyMemberFields(const char * member)
+{
+    for (const auto & m : lazyMembers) {
+        if (strcmp(m.name, member) == 0)
+            return m.fields | BidRequestFields::UNPARSEABLE;
+    }
+    return BidRequestFields::NONE;
+}
+
+} // file scope
+
+uint32_t
+OpenRTBBidRequestParser::
+parsedFields(uint32_t fields)
+{
+    // Unknown members are only parsed along with all the others
+    if (fields & BidRequestFields::UNPARSEABLE)
+        return BidRequestFields::ALL;
+
+    uint32_t result = BidRequestFields::ALL & ~BidRequestFields::UNPARSEABLE;
+    for (const auto & m : lazyMembers) {
+        if (!(m.fields & fields))
+            result &= ~m.fields;
+    }
+    return result;
+}
+
+OpenRTB::BidRequest
+OpenRTBBidRequestParser::
+parseBidRequest(ML::Parse_Context & context, uint32_t fields)
+{
+    StreamingJsonParsingContext jsonContext(context);
+
+    OpenRTB::BidRequest req;
+
+    // Same as what desc.parseJson() does, but skipping the members that
+    // aren't needed.  Unknown members further down go to req.unparseable.
+    jsonContext.onUnknownFieldHandlers.push_back(
+            [&] (const ValueDescription *)
+            {
+                desc.onUnknownField(&req, jsonContext);
+            });
+
+    auto onMember = [&] ()
+        {
+            const char * name = jsonContext.fieldNamePtr();
+            auto field = desc.hasField(&req, name);
+            uint32_t needs = field
+                ? lazyMemberFields(name)
+                : (uint32_t)BidRequestFields::UNPARSEABLE;
+            if (needs && !(needs & fields)) {
+                jsonContext.skip();
+                return;
+            }
+
+            if (!field) {
+                desc.onUnknownField(&req, jsonContext);
+                return;
+            }
+            field->description->parseJson(
+                    reinterpret_cast<char *>(&req) + field->offset,
+                    jsonContext);
+        };
+
+    if (!jsonContext.isObject())
+        jsonContext.exception("expected an OpenRTB bid request");
+    jsonContext.forEachMember(std::ref(onMember));
+
+    jsonContext.onUnknownFieldHandlers.pop_back();
+
+    return std::move(req);
+}
+
+RTBKIT::BidRequest *
+OpenRTBBidRequestParser::
+parseBidRequest(ML::Parse_Context & context,
+                const std::string & provider,
+                const std::string & exchange,
+                uint32_t fields)
+{
+    auto br = parseBidRequest(context, fields);
+    auto result = createBidRequestHelper(br, provider, exchange);
+    result->parsedFields = parsedFields(fields);
+    return result;
+}
+
 RTBKIT::BidRequest *
 OpenRTBBidRequestParser::
 createBidRequestHelper(OpenRTB::BidRequest & br,
@@ -44,6 +44,25 @@ struct OpenRTBBidRequestParser
                                         const std::string & provider,
                                         const std::string & exchange);
 
+    /** Parse only the top level members of the request that are needed to
+        fill in the given BidRequestFields; the others are skipped.
+    */
+    OpenRTB::BidRequest parseBidRequest(ML::Parse_Context & context,
+                                        uint32_t fields);
+
+    /** Same as above, but the result is converted.  Its parsedFields tell
+        which fields are valid, which may be more than those asked for.
+    */
+    RTBKIT::BidRequest* parseBidRequest(ML::Parse_Context & context,
+                                        const std::string & provider,
+                                        const std::string & exchange,
+                                        uint32_t fields);
+
+    /** Groups of fields (see BidRequestFields) that are complete once the
+        members needed for the given fields have been parsed.
+    */
+    static uint32_t parsedFields(uint32_t fields);
+
     static std::unique_ptr<OpenRTBBidRequestParser>
         openRTBBidRequestParserFactory(const std::string & version);
 
@@ -0,0 +1,129 @@
+/* binary_bid_request_bench.cc
+   Copyright (c) 2013 Datacratic Inc.  All rights reserved.
+
+   Compares the throughput and the size of the binary encoding of the
+   sample bid requests with their canonical JSON.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "rtbkit/plugins/bid_request/openrtb_bid_request_parser.h"
+#include "rtbkit/common/binary_bid_request.h"
+#include "rtbkit/common/bid_request.h"
+#include "jml/utils/filter_streams.h"
+#include "jml/arch/timers.h"
+#include "jml/arch/format.h"
+
+#include <iostream>
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+
+vector<string> samples = {
+    "rtbkit/plugins/bid_request/testing/openrtb1_req.json",
+    "rtbkit/plugins/bid_request/testing/openrtb2_req.json",
+    "rtbkit/plugins/bid_request/testing/openrtb3_req.json",
+    "rtbkit/plugins/bid_request/testing/openrtb4_req.json",
+    "rtbkit/plugins/bid_request/testing/openrtb_wseat_req.json",
+    "rtbkit/plugins/bid_request/testing/openrtb_banner.json",
+    "rtbkit/plugins/bid_request/testing/openrtb_expandable_creative.json",
+    "rtbkit/plugins/bid_request/testing/openrtb_mobile.json",
+    "rtbkit/plugins/bid_request/testing/openrtb_video.json",
+    "rtbkit/plugins/bid_request/testing/rubicon_banner1.json",
+    "rtbkit/plugins/bid_request/testing/rubicon_banner2.json",
+    "rtbkit/plugins/bid_request/testing/rubicon_banner3.json",
+    "rtbkit/plugins/bid_request/testing/rubicon_banner4.json",
+    "rtbkit/plugins/bid_request/testing/rubicon_desktop.json",
+    "rtbkit/plugins/bid_request/testing/rubicon_mobile_app.json",
+    "rtbkit/plugins/bid_request/testing/rubicon_mobile_web.json",
+    "rtbkit/plugins/bid_request/testing/rubicon_test1.json"
+};
+
+string loadFile(const string & filename)
+{
+    ML::filter_istream stream(filename);
+
+    string result;
+
+    while (stream) {
+        string line;
+        getline(stream, line);
+        result += line + "\n";
+    }
+
+    return result;
+}
+
+template<typename Input, typename Fn>
+void bench(const string & name, const vector<Input> & inputs, Fn && fn)
+{
+    const size_t rounds = 2000;
+
+    size_t bytes = 0;
+    ML::Timer timer;
+
+    for (size_t i = 0;  i < rounds;  ++i) {
+        for (const Input & input: inputs)
+            bytes += fn(input);
+    }
+
+    double elapsed = timer.elapsed_wall();
+    double requests = rounds * inputs.size();
+
+    cerr << ML::format("%-14s %8.2fus/request %8.0f requests/s "
+                       "%7.1f bytes/request\n",
+                       name.c_str(),
+                       elapsed / requests * 1000000.0,
+                       requests / elapsed,
+                       bytes / requests);
+}
+
+BOOST_AUTO_TEST_CASE( binaryBidRequestBench )
+{
+    auto parser = OpenRTBBidRequestParser::openRTBBidRequestParserFactory("2.2");
+
+    vector<std::shared_ptr<BidRequest> > requests;
+    vector<string> json, binary;
+
+    for (const string & filename: samples) {
+        string payload = loadFile(filename);
+        ML::Parse_Context context(filename, payload.c_str(), payload.size());
+        requests.emplace_back(
+                parser->parseBidRequest(context, "openrtb", "openrtb"));
+        json.push_back(requests.back()->toJsonStr());
+        binary.push_back(BinaryBidRequest::encode(*requests.back()));
+    }
+
+    bench("json encode", requests,
+          [] (const std::shared_ptr<BidRequest> & br)
+          {
+              return br->toJsonStr().size();
+          });
+
+    string buffer;
+    bench("binary encode", requests,
+          [&] (const std::shared_ptr<BidRequest> & br)
+          {
+              BinaryBidRequest::encode(*br, buffer);
+              return buffer.size();
+          });
+
+    bench("json decode", json,
+          [] (const string & str)
+          {
+              std::unique_ptr<BidRequest> br(BidRequest::parse("datacratic", str));
+              return str.size();
+          });
+
+    bench("binary decode", binary,
+          [] (const string & str)
+          {
+              std::unique_ptr<BidRequest> br(BinaryBidRequest::decode(str));
+              return str.size();
+          });
+}
@@ -0,0 +1,130 @@
+/* binary_bid_request_test.cc
+   Copyright (c) 2013 Datacratic Inc.  All rights reserved.
+
+   Tests for the binary encoding of bid requests.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "rtbkit/plugins/bid_request/openrtb_bid_request_parser.h"
+#include "rtbkit/common/binary_bid_request.h"
+#include "rtbkit/common/bid_request.h"
+#include "jml/utils/filter_streams.h"
+#include "jml/db/compact_size_types.h"
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+vector<string> samples = {
+    "rtbkit/plugins/bid_request/testing/openrtb1_req.json",
+    "rtbkit/plugins/bid_request/testing/openrtb2_req.json",
+    "rtbkit/plugins/bid_request/testing/openrtb3_req.json",
+    "rtbkit/plugins/bid_request/testing/openrtb4_req.json",
+    "rtbkit/plugins/bid_request/testing/openrtb_wseat_req.json",
+    "rtbkit/plugins/bid_request/testing/openrtb_banner.json",
+    "rtbkit/plugins/bid_request/testing/openrtb_expandable_creative.json",
+    "rtbkit/plugins/bid_request/testing/openrtb_mobile.json",
+    "rtbkit/plugins/bid_request/testing/openrtb_video.json",
+    "rtbkit/plugins/bid_request/testing/openrtb_2_2_req_imp.json",
+    "rtbkit/plugins/bid_request/testing/openrtb_2_2_req_video.json",
+    "rtbkit/plugins/bid_request/testing/rubicon_banner1.json",
+    "rtbkit/plugins/bid_request/testing/rubicon_banner2.json",
+    "rtbkit/plugins/bid_request/testing/rubicon_banner3.json",
+    "rtbkit/plugins/bid_request/testing/rubicon_banner4.json",
+    "rtbkit/plugins/bid_request/testing/rubicon_desktop.json",
+    "rtbkit/plugins/bid_request/testing/rubicon_mobile_app.json",
+    "rtbkit/plugins/bid_request/testing/rubicon_mobile_web.json",
+    "rtbkit/plugins/bid_request/testing/rubicon_test1.json"
+};
+
+std::string loadFile(const std::string & filename)
+{
+    ML::filter_istream stream(filename);
+
+    string result;
+
+    while (stream) {
+        string line;
+        getline(stream, line);
+        result += line + "\n";
+    }
+
+    return result;
+}
+
+std::unique_ptr<BidRequest> parseSample(const std::string & filename)
+{
+    string payload = loadFile(filename);
+    ML::Parse_Context context(filename, payload.c_str(), payload.size());
+    auto parser = OpenRTBBidRequestParser::openRTBBidRequestParserFactory("2.2");
+    return std::unique_ptr<BidRequest>(
+            parser->parseBidRequest(context, "openrtb", "openrtb"));
+}
+
+BOOST_AUTO_TEST_CASE( test_binary_round_trip )
+{
+    for (const string & filename: samples) {
+        BOOST_TEST_CHECKPOINT(filename);
+
+        auto br = parseSample(filename);
+
+        // Members that the canonical JSON doesn't carry
+        br->auctionType = AuctionType::FIRST_PRICE;
+        br->timeAvailableMs = 42.5;
+        br->userAgentIPHash = Id(1234567);
+        br->badv.push_back(Utf8String("badadvertiser.com"));
+        br->segments.add("weighted", std::make_shared<SegmentList>(
+                                 vector<pair<int, float> >{ {-3, 0.5}, {7, 2.0} }));
+
+        string encoded = br->serializeToString();
+        BOOST_CHECK(BinaryBidRequest::isEncoded(encoded));
+
+        BidRequest decoded = BidRequest::createFromString(encoded);
+        BOOST_CHECK_EQUAL(decoded.toJsonStr(), br->toJsonStr());
+
+        BOOST_CHECK_EQUAL(decoded.auctionType.val, AuctionType::FIRST_PRICE);
+        BOOST_CHECK_EQUAL(decoded.timeAvailableMs, 42.5);
+        BOOST_CHECK_EQUAL(decoded.userAgentIPHash, br->userAgentIPHash);
+        BOOST_CHECK_EQUAL(decoded.badv.size(), br->badv.size());
+        BOOST_CHECK_EQUAL(decoded.blockedCategories.size(),
+                          br->blockedCategories.size());
+        BOOST_CHECK_EQUAL((bool)decoded.regs, (bool)br->regs);
+        BOOST_CHECK_EQUAL(decoded.segments.get("weighted").toJsonStr(),
+                          br->segments.get("weighted").toJsonStr());
+
+        // The encoding is deterministic
+        BOOST_CHECK_EQUAL(BinaryBidRequest::encode(decoded), encoded);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_binary_compatibility )
+{
+    auto br = parseSample(samples[0]);
+    string encoded = BinaryBidRequest::encode(*br);
+
+    // Records written by a later version are skipped
+    string withUnknown = encoded + "\x64\x03" "abc";
+    std::unique_ptr<BidRequest> decoded(BinaryBidRequest::decode(withUnknown));
+    BOOST_CHECK_EQUAL(decoded->toJsonStr(), br->toJsonStr());
+
+    // A later version of the layout is refused
+    string later = encoded;
+    later[1] = BinaryBidRequest::VERSION + 1;
+    BOOST_CHECK_THROW(BinaryBidRequest::decode(later), ML::Exception);
+
+    // As is truncated data
+    BOOST_CHECK_THROW(BinaryBidRequest::decode(encoded.substr(0, encoded.size() - 1)),
+                      ML::Exception);
+
+    // And counts larger than what's left, before anything is reserved
+    string huge = encoded.substr(0, 2);
+    char buf[16];
+    char * p = buf;
+    ML::DB::encode_compact(p, buf + sizeof(buf), 1ULL << 40);
+    huge.append(buf, p);
+    BOOST_CHECK_THROW(BinaryBidRequest::decode(huge), ML::Exception);
+}
@@ -310,6 +310,39 @@ BOOST_AUTO_TEST_CASE( test_openrtb_round_trip )
     }
 }
 
+/* The compiled field tables must parse exactly like the fields map. */
+BOOST_AUTO_TEST_CASE( test_openrtb_parser_backends )
+{
+    DefaultDescription<OpenRTB::BidRequest> desc;
+
+    auto parse = [&] (const string & filename, const string & reqStr,
+                      StructureDescriptionBase::ParserBackend backend)
+        {
+            StructureDescriptionBase::setParserBackend(backend);
+
+            OpenRTB::BidRequest req;
+            StreamingJsonParsingContext context;
+            context.init(filename, reqStr.c_str(), reqStr.size());
+            desc.parseJson(&req, context);
+
+            std::ostringstream stream;
+            StreamJsonPrintingContext printContext(stream);
+            desc.printJson(&req, printContext);
+            return stream.str();
+        };
+
+    vector<string> files = samples;
+    files.insert(files.end(), samples2_2.begin(), samples2_2.end());
+
+    for (auto & f: files) {
+        string reqStr = loadFile(f);
+        BOOST_CHECK_EQUAL(parse(f, reqStr, StructureDescriptionBase::PB_MAP),
+                          parse(f, reqStr, StructureDescriptionBase::PB_COMPILED));
+    }
+
+    StructureDescriptionBase::setParserBackend(StructureDescriptionBase::PB_COMPILED);
+}
+
 BOOST_AUTO_TEST_CASE( benchmark_openrtb_round_trip )
 {
     vector<string> reqs;
@@ -338,35 +371,47 @@ BOOST_AUTO_TEST_CASE( benchmark_openrtb_parsing )
     cerr << "benchmarking OpenRTB parsing" << endl;
 
     vector<string> reqs;
+    size_t bytes = 0;
 
-    for (auto s: samples)
+    for (auto s: samples) {
         reqs.push_back(loadFile(s));
-
-    int done = 0;
-    
-    Date before = Date::now();
+        bytes += reqs.back().size();
+    }
 
     DefaultDescription<OpenRTB::BidRequest> desc;
 
-    for (unsigned i = 0;  i < 1000;  ++i) {
-        
-        for (unsigned i = 0;  i < reqs.size();  ++i, ++done) {
-            
-            
-            OpenRTB::BidRequest req;
-            
-            {
-                StreamingJsonParsingContext context;
-                context.init(samples[i], reqs[i].c_str(), reqs[i].size());
-                desc.parseJson(&req, context);
+    auto bench = [&] (const string & name,
+                      StructureDescriptionBase::ParserBackend backend)
+        {
+            StructureDescriptionBase::setParserBackend(backend);
+
+            int done = 0;
+
+            Date before = Date::now();
+
+            for (unsigned i = 0;  i < 1000;  ++i) {
+
+                for (unsigned i = 0;  i < reqs.size();  ++i, ++done) {
+
+                    OpenRTB::BidRequest req;
+
+                    {
+                        StreamingJsonParsingContext context;
+                        context.init(samples[i], reqs[i].c_str(), reqs[i].size());
+                        desc.parseJson(&req, context);
+                    }
+                }
             }
-        }
-    }
 
-    double elapsed = Date::now().secondsSince(before);
-    
-    cerr << "did " << done << " in " << elapsed << "s at "
-         << done / elapsed << "/s" << endl;
+            double elapsed = Date::now().secondsSince(before);
+
+            cerr << name << ": did " << done << " in " << elapsed << "s at "
+                 << done / elapsed << "/s, "
+                 << bytes * 1000 / elapsed / 1000000 << "MB/s" << endl;
+        };
+
+    bench("map", StructureDescriptionBase::PB_MAP);
+    bench("compiled", StructureDescriptionBase::PB_COMPILED);
 }
 
 BOOST_AUTO_TEST_CASE( benchmark_openrtb_conversion )
@@ -522,3 +567,62 @@ BOOST_AUTO_TEST_CASE( id_provider ) {
         }
     }
 }
+
+BOOST_AUTO_TEST_CASE( test_lazy_parsing )
+{
+    std::vector<uint32_t> fieldSets = {
+        BidRequestFields::NONE,
+        BidRequestFields::SEGMENTS,
+        BidRequestFields::DEVICE | BidRequestFields::USER_IDS,
+        BidRequestFields::SITE | BidRequestFields::RESTRICTIONS,
+        BidRequestFields::EXT,
+        BidRequestFields::UNPARSEABLE,
+        BidRequestFields::ALL
+    };
+
+    for (auto s: samples) {
+        string payload = loadFile(s);
+
+        auto parse = [&] ()
+            {
+                ML::Parse_Context context(s, payload.c_str(), payload.size());
+                return OpenRTBBidRequestParser
+                    ::openRTBBidRequestParserFactory("2.2")
+                    ->parseBidRequest(context, "test", "test");
+            };
+
+        std::unique_ptr<BidRequest> full(parse());
+
+        for (uint32_t fields: fieldSets) {
+            ML::Parse_Context context(s, payload.c_str(), payload.size());
+            std::unique_ptr<BidRequest> lazy(
+                    OpenRTBBidRequestParser
+                    ::openRTBBidRequestParserFactory("2.2")
+                    ->parseBidRequest(context, "test", "test", fields));
+
+            BOOST_CHECK_EQUAL(lazy->parsedFields & fields, fields);
+            BOOST_CHECK_EQUAL(lazy->parsedFields,
+                              OpenRTBBidRequestParser::parsedFields(fields));
+            BOOST_CHECK_EQUAL(lazy->imp.size(), full->imp.size());
+
+            // What was asked for is already there
+            if (fields & BidRequestFields::SEGMENTS)
+                BOOST_CHECK_EQUAL(lazy->segments.toJson(),
+                                  full->segments.toJson());
+            if (fields & BidRequestFields::USER_IDS)
+                BOOST_CHECK_EQUAL(lazy->userIds.toJson(),
+                                  full->userIds.toJson());
+            if (fields & BidRequestFields::SITE)
+                BOOST_CHECK_EQUAL(lazy->url.toString(),
+                                  full->url.toString());
+
+            // And the rest shows up once completed
+            lazy->parseRest = [&] (const string &) { return parse(); };
+            lazy->complete(payload);
+            BOOST_CHECK(lazy->isComplete());
+
+            lazy->timestamp = full->timestamp;
+            BOOST_CHECK_EQUAL(lazy->toJsonStr(), full->toJsonStr());
+        }
+    }
+}
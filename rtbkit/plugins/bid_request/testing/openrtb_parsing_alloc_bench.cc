@@ -0,0 +1,160 @@
+/* openrtb_parsing_alloc_bench.cc
+   Copyright (c) 2013 Datacratic Inc.  All rights reserved.
+
+   Counts the memory allocations made to parse the sample OpenRTB requests,
+   going through a Json::Value tree, streaming straight from the payload
+   buffer and converting the result into an RTBKIT::BidRequest.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "rtbkit/plugins/bid_request/openrtb_bid_request_parser.h"
+#include "rtbkit/openrtb/openrtb_parsing.h"
+#include "rtbkit/common/bid_request.h"
+#include "soa/types/json_parsing.h"
+#include "jml/utils/filter_streams.h"
+#include "jml/arch/timers.h"
+#include "jml/arch/format.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+
+/*****************************************************************************/
+/* ALLOCATION COUNTING                                                       */
+/*****************************************************************************/
+
+namespace {
+
+size_t numAllocations = 0;
+size_t bytesAllocated = 0;
+
+} // file scope
+
+void * operator new (size_t size)
+{
+    ++numAllocations;
+    bytesAllocated += size;
+    if (void * result = malloc(size ? size : 1))
+        return result;
+    throw std::bad_alloc();
+}
+
+void operator delete (void * ptr) noexcept
+{
+    free(ptr);
+}
+
+void * operator new [] (size_t size)
+{
+    return operator new (size);
+}
+
+void operator delete [] (void * ptr) noexcept
+{
+    operator delete (ptr);
+}
+
+
+/*****************************************************************************/
+/* BENCH                                                                     */
+/*****************************************************************************/
+
+vector<string> samples = {
+    "rtbkit/plugins/bid_request/testing/openrtb1_req.json",
+    "rtbkit/plugins/bid_request/testing/openrtb2_req.json",
+    "rtbkit/plugins/bid_request/testing/openrtb3_req.json",
+    "rtbkit/plugins/bid_request/testing/openrtb4_req.json",
+    "rtbkit/plugins/bid_request/testing/openrtb_wseat_req.json",
+    "rtbkit/plugins/bid_request/testing/openrtb_banner.json",
+    "rtbkit/plugins/bid_request/testing/openrtb_expandable_creative.json",
+    "rtbkit/plugins/bid_request/testing/openrtb_mobile.json",
+    "rtbkit/plugins/bid_request/testing/openrtb_video.json",
+    "rtbkit/plugins/bid_request/testing/rubicon_banner1.json",
+    "rtbkit/plugins/bid_request/testing/rubicon_banner2.json",
+    "rtbkit/plugins/bid_request/testing/rubicon_banner3.json",
+    "rtbkit/plugins/bid_request/testing/rubicon_banner4.json",
+    "rtbkit/plugins/bid_request/testing/rubicon_desktop.json",
+    "rtbkit/plugins/bid_request/testing/rubicon_mobile_app.json",
+    "rtbkit/plugins/bid_request/testing/rubicon_mobile_web.json",
+    "rtbkit/plugins/bid_request/testing/rubicon_test1.json"
+};
+
+string loadFile(const string & filename)
+{
+    ML::filter_istream stream(filename);
+
+    string result;
+
+    while (stream) {
+        string line;
+        getline(stream, line);
+        result += line + "\n";
+    }
+
+    return result;
+}
+
+template<typename Fn>
+void bench(const string & name, const vector<string> & payloads, Fn && fn)
+{
+    const size_t rounds = 1000;
+
+    size_t allocationsBefore = numAllocations;
+    size_t bytesBefore = bytesAllocated;
+    ML::Timer timer;
+
+    for (size_t i = 0;  i < rounds;  ++i) {
+        for (const string & payload : payloads)
+            fn(payload);
+    }
+
+    double elapsed = timer.elapsed_wall();
+    double requests = rounds * payloads.size();
+
+    cerr << ML::format("%-12s %8.1f allocs/request %9.1f bytes/request "
+                       "%8.2fus/request\n",
+                       name.c_str(),
+                       (numAllocations - allocationsBefore) / requests,
+                       (bytesAllocated - bytesBefore) / requests,
+                       elapsed / requests * 1000000.0);
+}
+
+BOOST_AUTO_TEST_CASE( openrtbParsingAllocBench )
+{
+    vector<string> payloads;
+    for (const string & filename : samples)
+        payloads.push_back(loadFile(filename));
+
+    DefaultDescription<OpenRTB::BidRequest> desc;
+
+    // Parse into a Json::Value first, which is what the parser avoids
+    bench("tree", payloads, [&] (const string & payload) {
+                Json::Value json = Json::parse(payload);
+                StructuredJsonParsingContext context(json);
+                OpenRTB::BidRequest request;
+                desc.parseJson(&request, context);
+            });
+
+    // Parse straight from the payload buffer
+    bench("streaming", payloads, [&] (const string & payload) {
+                StreamingJsonParsingContext context(
+                        "payload", payload.c_str(), payload.size());
+                OpenRTB::BidRequest request;
+                desc.parseJson(&request, context);
+            });
+
+    // What the exchange connectors do for every request
+    bench("conversion", payloads, [&] (const string & payload) {
+                std::unique_ptr<BidRequest> request(
+                        BidRequest::parse("openrtb", payload));
+            });
+}
@@ -720,7 +720,7 @@ void HttpBidderInterface::injectBids(const std::string &agent, Id auctionId,
      if (!router->doBidBuffer.tryPush(std::move(message))) {
          throw ML::Exception("Main router loop can not keep up with HttpBidderInterface");
      }
-     router->wakeupMainLoop.signal();
+     router->signalMainLoop();
 }
 
 void HttpBidderInterface::submitBids(AgentBids &info) {
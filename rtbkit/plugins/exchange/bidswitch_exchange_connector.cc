@@ -328,8 +328,7 @@ parseBidRequest(HttpAuctionHandler & connection,
     }
 
     // Parse the bid request
-    ML::Parse_Context context("Bid Request", payload.c_str(), payload.size());
-    res.reset(OpenRTBBidRequestParser::openRTBBidRequestParserFactory("2.2")->parseBidRequest(context, exchangeName(), exchangeName()));
+    res.reset(parseOpenRTBBidRequest(payload, "2.2"));
 
     //Parsing "ssp" filed
     if (res!=nullptr){
@@ -107,6 +107,11 @@ struct BidSwitchExchangeConnector: public OpenRTBExchangeConnector {
                              const AgentConfig & config,
                              const void * info) const;
 
+    virtual uint32_t bidRequestFieldsRead() const
+    {
+        return BidRequestFields::EXT | BidRequestFields::SITE;
+    }
+
     // BidSwitch win price decoding function.
     static float decodeWinPrice(const std::string & sharedSecret,
                                 const std::string & winPriceStr);
@@ -137,6 +142,7 @@ struct BidSwitchWSeatFilter : public FilterBaseT<BidSwitchWSeatFilter>
 {
     static constexpr const char* name = "bidswitch-wseat";
     unsigned priority() const { return 10; }
+    uint32_t requiredFields() const { return BidRequestFields::SEGMENTS; }
 
     std::unordered_map<std::string, ConfigSet> data;
     ConfigSet defaultSet;
@@ -157,7 +157,8 @@ void
 HttpAuctionHandler::
 onGotTransport()
 {
-    transport().activities.limit(5);
+    if (debugOn())
+        transport().activities.limit(5);
     //transport().activities.clear();
 
     addActivityS("gotTransport");
@@ -171,14 +172,121 @@ onGotTransport()
 
     HttpConnectionHandler::onGotTransport();
 
+    if (!requestState)
+        requestState.reset(new RequestState());
+    bindRequestParser();
+
     startReading();
+
+    // The previous handler on this connection may have left a request that
+    // was pipelined behind its own
+    requestState->parser.resume();
+    handleRequestDone();
+}
+
+void
+HttpAuctionHandler::
+bindRequestParser()
+{
+    RequestState * state = requestState.get();
+    HttpRequestParser & parser = state->parser;
+
+    parser.setPauseAfterRequest(true);
+    parser.setMaxBodySize(endpoint->maxBodySize);
+
+    parser.onRequestStart = [=] (const char * verb, size_t verbSize,
+                                 const char * resource, size_t resourceSize,
+                                 const char * version, size_t versionSize)
+        {
+            this->firstData = Date::now();
+            this->readState = HEADER;
+            state->header.startRequest(verb, verbSize,
+                                       resource, resourceSize,
+                                       version, versionSize);
+            state->payload.clear();
+        };
+
+    parser.onHeader = [=] (const char * name, size_t nameSize,
+                           const char * value, size_t valueSize)
+        {
+            state->header.addHeader(name, nameSize, value, valueSize);
+        };
+
+    parser.onHeadersDone = [=] ()
+        {
+            HttpHeader & header = state->header;
+            header.finishHeaders();
+            if (header.contentLength == -1 && !header.isChunked)
+                header.contentLength = 0;
+
+            this->addActivityS("header parsing OK");
+            this->readState = header.isChunked ? CHUNK_BODY : PAYLOAD;
+            this->handleHttpHeader(header);
+        };
+
+    parser.onData = [=] (const char * data, size_t size)
+        {
+            state->payload.append(data, size);
+        };
+
+    parser.onDone = [=] (bool requireClose)
+        {
+            this->addActivityS("got HTTP payload");
+            this->readState = DONE;
+            state->requestDone = true;
+            state->closeAfterResponse = requireClose;
+        };
+
+    parser.onBodyTooLarge = [=] (uint64_t size)
+        {
+            this->addActivityS("HTTP body too large");
+            this->readState = DONE;
+            this->sendBodyTooLarge(size);
+        };
+}
+
+void
+HttpAuctionHandler::
+handleData(const std::string & data)
+{
+    if (!requestState)
+        throw Exception("HttpAuctionHandler got data without request state");
+
+    requestState->parser.feed(data.c_str(), data.size());
+    handleRequestDone();
+}
+
+void
+HttpAuctionHandler::
+handleRequestDone()
+{
+    if (!requestState->requestDone)
+        return;
+    requestState->requestDone = false;
+
+    // Note that the request state may be handed over to the next handler
+    // from within this call
+    handleHttpPayload(requestState->header, requestState->payload);
+}
+
+std::shared_ptr<ConnectionHandler>
+HttpAuctionHandler::
+makeNewHandlerShared()
+{
+    auto handler = HttpConnectionHandler::makeNewHandlerShared();
+
+    auto next = std::dynamic_pointer_cast<HttpAuctionHandler>(handler);
+    if (next)
+        next->requestState = std::move(requestState);
+
+    return handler;
 }
 
 void
 HttpAuctionHandler::
 handleDisconnect()
 {
-    doEvent("auctionDisconnection");
+    doEvent(AUCTION_DISCONNECTION);
 
     disconnected = true;
 
@@ -206,7 +314,7 @@ handleTimeout(Date date, size_t cookie)
     }
 
     if (auction_->finish()) {
-        doEvent("auctionTimeout");
+        doEvent(AUCTION_TIMEOUT);
         if (this->endpoint->onTimeout)
             this->endpoint->onTimeout(auction, date);
     }
@@ -237,7 +345,7 @@ onDisassociate()
        anything. */
     if (auction && !auction->tooLate()) {
         auction->isZombie = true;
-        doEvent("disconnectWithActiveAuction");
+        doEvent(DISCONNECT_WITH_ACTIVE_AUCTION);
         //transport().activities.dump();
         //cerr << "disassociation of HttpAuctionHandler " << this
         //     << " when auction not finished"
@@ -257,6 +365,38 @@ onCleanup()
     onDisassociate();
 }
 
+const char * const
+HttpAuctionHandler::eventNames[NUM_EVENTS] = {
+    "auctionReceived",
+    "auctionBodyLength",
+    "auctionEarlyDrop.notEnabled",
+    "auctionEarlyDrop.randomEarlyDrop",
+    "auctionEarlyDrop.timeLeftMs",
+    "auctionStartLatencyMs",
+    "auctionTimeAvailableMs",
+    "auctionNetworkLatencyMs",
+    "auctionTotalStartLatencyMs",
+    "auctionStart",
+    "auctionAlreadyExpired",
+    "auctionTimeout",
+    "auctionResponseSent",
+    "auctionTotalTimeMs",
+    "auctionDisconnection",
+    "disconnectWithActiveAuction",
+};
+
+void
+HttpAuctionHandler::
+doEvent(Event event,
+        StatEventType type,
+        float value,
+        const char * units,
+        std::initializer_list<int> extra)
+{
+    endpoint->recordInterned(endpoint->auctionEvents[event],
+                             type, value, extra);
+}
+
 void
 HttpAuctionHandler::
 doEvent(const char * eventName,
@@ -299,8 +439,8 @@ handleHttpPayload(const HttpHeader & header,
 
     ML::atomic_add(endpoint->numRequests, 1);
 
-    doEvent("auctionReceived");
-    doEvent("auctionBodyLength", ET_OUTCOME, payload.size(), "bytes");
+    doEvent(AUCTION_RECEIVED);
+    doEvent(AUCTION_BODY_LENGTH, ET_OUTCOME, payload.size(), "bytes");
 
     incNumServingRequest();
     servingRequest = true;
@@ -314,7 +454,7 @@ handleHttpPayload(const HttpHeader & header,
     Date now = Date::now();
 
     if (!endpoint->isEnabled(now)) {
-        doEvent("auctionEarlyDrop.notEnabled");
+        doEvent(AUCTION_EARLY_DROP_NOT_ENABLED);
         dropAuction("endpoint not enabled");
         return;
     }
@@ -323,7 +463,7 @@ handleHttpPayload(const HttpHeader & header,
     if (acceptProbability < 1.0
         && random() % 1000000 > 1000000 * acceptProbability) {
         // early drop...
-        doEvent("auctionEarlyDrop.randomEarlyDrop");
+        doEvent(AUCTION_EARLY_DROP_RANDOM);
         if(!endpoint->disableAcceptProbability) {
             dropAuction("random early drop");
             return;
@@ -333,11 +473,11 @@ handleHttpPayload(const HttpHeader & header,
     double timeAvailableMs = getTimeAvailableMs(header, payload);
     double networkTimeMs = getRoundTripTimeMs(header);
 
-    doEvent("auctionStartLatencyMs",
+    doEvent(AUCTION_START_LATENCY,
             ET_OUTCOME,
             now.secondsSince(endpoint->getStartTime()) * 1000.0, "ms");
 
-    doEvent("auctionTimeAvailableMs",
+    doEvent(AUCTION_TIME_AVAILABLE,
             ET_OUTCOME,
             timeAvailableMs, "ms");
 
@@ -346,12 +486,15 @@ handleHttpPayload(const HttpHeader & header,
         // Do an early drop of the bid request without even creating an
         // auction
 
-        doEvent("auctionEarlyDrop.timeLeftMs",
+        doEvent(AUCTION_EARLY_DROP_TIME_LEFT,
                 ET_OUTCOME,
                 timeAvailableMs, "ms");
 
-        doEvent(ML::format("auctionEarlyDrop.peer.%s",
-                               transport().getPeerName().c_str()).c_str());
+        std::string & peerEvent = requestState->peerEarlyDropEvent;
+        if (peerEvent.empty())
+            peerEvent = endpoint->internEvent("auctionEarlyDrop.peer."
+                                              + transport().getPeerName());
+        endpoint->recordInterned(peerEvent);
 
         dropAuction(ML::format("timeleft of %f is too low",
                                timeAvailableMs));
@@ -403,11 +546,29 @@ handleHttpPayload(const HttpHeader & header,
             return;
         }
 
-        auction.reset(new Auction(endpoint,
-                                  handleAuction, bidRequest,
-                                  bidRequest->toJsonStr(),
-                                  "datacratic",
-                                  firstData, expiry));
+        // Most auctions are dropped by the filters so the request is only
+        // stringified if it's sent somewhere.
+        string payloadFormat = endpoint->payloadRequestFormat();
+        if (payloadFormat.empty()) {
+            if (endpoint->auctionArena)
+                auction = Auction::createInArena(endpoint,
+                                                 handleAuction, bidRequest,
+                                                 firstData, expiry);
+            else auction.reset(new Auction(endpoint,
+                                           handleAuction, bidRequest,
+                                           firstData, expiry));
+        }
+        else {
+            if (endpoint->auctionArena)
+                auction = Auction::createInArena(endpoint,
+                                                 handleAuction, bidRequest,
+                                                 payload, payloadFormat,
+                                                 firstData, expiry);
+            else auction.reset(new Auction(endpoint,
+                                           handleAuction, bidRequest,
+                                           payload, payloadFormat,
+                                           firstData, expiry));
+        }
 
         auction->requestOriginal = payload;
         endpoint->adjustAuction(auction);
@@ -423,8 +584,8 @@ handleHttpPayload(const HttpHeader & header,
         static std::mutex lock;
         std::unique_lock<std::mutex> guard(lock);
         cerr << "bytes before = " << payload.size() << " after "
-             << auction->requestStr.size() << " ratio "
-             << 100.0 * auction->requestStr.size() / payload.size()
+             << auction->requestStr().size() << " ratio "
+             << 100.0 * auction->requestStr().size() / payload.size()
              << "%" << endl;
         string s = bidRequest->serializeToString();
         cerr << "serialized bytes before = " << payload.size() << " after "
@@ -440,22 +601,23 @@ handleHttpPayload(const HttpHeader & header,
         return;
     }
 
-    doEvent("auctionNetworkLatencyMs",
+    doEvent(AUCTION_NETWORK_LATENCY,
             ET_OUTCOME,
             (firstData.secondsSince(auction->request->timestamp)) * 1000.0,
             "ms");
 
-    doEvent("auctionTotalStartLatencyMs",
+    doEvent(AUCTION_TOTAL_START_LATENCY,
             ET_OUTCOME,
             (now.secondsSince(auction->request->timestamp)) * 1000.0,
             "ms");
 
-    doEvent("auctionStart");
+    doEvent(AUCTION_START);
 
-    addActivity("gotAuction %s", auction->id.toString().c_str());
+    if (debugOn())
+        addActivity("gotAuction %s", auction->id.toString().c_str());
     
     if (now > expiry) {
-        doEvent("auctionAlreadyExpired");
+        doEvent(AUCTION_ALREADY_EXPIRED);
 
         string msg = format("auction started after time already elapsed: "
                             "%s vs %s, available time = %.1fms, "
@@ -476,8 +638,8 @@ handleHttpPayload(const HttpHeader & header,
     scheduleTimerAbsolute(expiry, 1);
     hasTimer = true;
     
-    addActivity("gotTimer for %s",
-                expiry.print(4).c_str());
+    if (debugOn())
+        addActivity("gotTimer for %s", expiry.print(4).c_str());
 
     auction->doneParsing = Date::now();
 
@@ -514,8 +676,9 @@ sendResponse()
     if (!auction->tooLate())
         throw Exception("auction is not finished");
 
-    addActivity("sendResponse (lock took %.2fms)",
-                Date::now().secondsSince(before) * 1000);
+    if (debugOn())
+        addActivity("sendResponse (lock took %.2fms)",
+                    Date::now().secondsSince(before) * 1000);
     
     cancelTimer();
 
@@ -547,14 +710,16 @@ sendResponse()
                      << (auction ? auction->id.toString() : "NO AUCTION")
                      << endl;
 
-            this->doEvent("auctionResponseSent");
-            this->doEvent("auctionTotalTimeMs",
+            this->doEvent(AUCTION_RESPONSE_SENT);
+            this->doEvent(AUCTION_TOTAL_TIME,
                           ET_OUTCOME,
                           Date::now().secondsSince(this->firstData) * 1000.0,
                           "ms",
                           { 90, 95, 98, 99 });
 
-            if (random() % 1000 == 0) {
+            if ((this->requestState
+                 && this->requestState->closeAfterResponse)
+                || random() % 1000 == 0) {
                 this->transport().closeWhenHandlerFinished();
             }
             else {
@@ -579,7 +744,9 @@ dropAuction(const std::string & reason)
 {
     auto onSendFinished = [=] ()
         {
-            if (random() % 1000 == 0) {
+            if ((this->requestState
+                 && this->requestState->closeAfterResponse)
+                || random() % 1000 == 0) {
                 this->transport().closeWhenHandlerFinished();
             }
             else {
@@ -601,6 +768,20 @@ sendErrorResponse(const std::string & error,
     endpoint->onAuctionError("EXCHANGE_ERROR", auction, error + ": " + details);
 }
 
+void
+HttpAuctionHandler::
+sendBodyTooLarge(uint64_t size)
+{
+    string error = ML::format("BODY_TOO_LARGE: body of %llu bytes exceeds "
+                              "the limit of %llu bytes",
+                              (unsigned long long) size,
+                              (unsigned long long) endpoint->maxBodySize);
+
+    putResponseOnWire(HttpResponse(413, "none", error),
+                      [=] () { this->transport().closeWhenHandlerFinished(); });
+    endpoint->onAuctionError("EXCHANGE_ERROR", auction, error);
+}
+
 std::string
 HttpAuctionHandler::
 status() const
@@ -620,7 +801,11 @@ HttpResponse
 HttpAuctionHandler::
 getResponse() const
 {
-    return endpoint->getResponse(*this, this->header, *auction);
+    // The header of the request lives in our request state, which is only
+    // gone once the connection was handed over to the next handler.
+    const HttpHeader & requestHeader
+        = requestState ? requestState->header : this->header;
+    return endpoint->getResponse(*this, requestHeader, *auction);
 }
 
 std::shared_ptr<BidRequest>
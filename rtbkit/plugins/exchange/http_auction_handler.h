@@ -9,6 +9,7 @@
 
 #include "jml/utils/filter_streams.h"
 #include "soa/service/http_endpoint.h"
+#include "soa/service/http_parsers.h"
 #include "soa/service/stats_events.h"
 #include "rtbkit/common/auction.h"
 
@@ -71,6 +72,34 @@ struct HttpAuctionHandler
     bool disconnected;
     bool servingRequest;  ///< Are we currently, actively serving a request?
 
+    /** Parsing state of the requests on our connection.  It is handed
+        over from one handler to the next on a keep-alive connection, so
+        that the buffers of the parser, the header and the payload are
+        reused from one request to the next and that the requests pipelined
+        behind the current one are kept.
+    */
+    struct RequestState {
+        RequestState()
+            : requestDone(false), closeAfterResponse(false)
+        {
+        }
+
+        HttpRequestParser parser;
+        HttpHeader header;
+        std::string payload;
+        bool requestDone;          ///< A full request is waiting in header/payload
+        bool closeAfterResponse;   ///< Client asked for the connection to close
+        std::string peerEarlyDropEvent;  ///< Interned on the first early drop
+    };
+
+    std::unique_ptr<RequestState> requestState;
+
+    /** Parse the request straight from the read buffer. */
+    virtual void handleData(const std::string & data);
+
+    /** Hands our request state over to the new handler. */
+    virtual std::shared_ptr<ConnectionHandler> makeNewHandlerShared();
+
     virtual void handleHttpPayload(const HttpHeader & header,
                                    const std::string & payload);
 
@@ -104,6 +133,38 @@ struct HttpAuctionHandler
                  const char * units = "",
                  std::initializer_list<int> extra = DefaultOutcomePercentiles);
 
+    /** Events recorded while serving each request.  The connector interns
+        their names once, so recording them doesn't build any string.
+    */
+    enum Event {
+        AUCTION_RECEIVED,
+        AUCTION_BODY_LENGTH,
+        AUCTION_EARLY_DROP_NOT_ENABLED,
+        AUCTION_EARLY_DROP_RANDOM,
+        AUCTION_EARLY_DROP_TIME_LEFT,
+        AUCTION_START_LATENCY,
+        AUCTION_TIME_AVAILABLE,
+        AUCTION_NETWORK_LATENCY,
+        AUCTION_TOTAL_START_LATENCY,
+        AUCTION_START,
+        AUCTION_ALREADY_EXPIRED,
+        AUCTION_TIMEOUT,
+        AUCTION_RESPONSE_SENT,
+        AUCTION_TOTAL_TIME,
+        AUCTION_DISCONNECTION,
+        DISCONNECT_WITH_ACTIVE_AUCTION,
+        NUM_EVENTS
+    };
+
+    /** Name of each of the events above. */
+    static const char * const eventNames[NUM_EVENTS];
+
+    void doEvent(Event event,
+                 StatEventType type = ET_COUNT,
+                 float value = 1.0,
+                 const char * units = "",
+                 std::initializer_list<int> extra = DefaultOutcomePercentiles);
+
     void incNumServingRequest();
     
     /** Function called once the auction is finished.  It causes the
@@ -153,6 +214,15 @@ struct HttpAuctionHandler
 
     static long created;
     static long destroyed;
+
+private:
+    void bindRequestParser();
+    void handleRequestDone();
+
+    /** Answer a request whose body is over the endpoint's maxBodySize with
+        a 413 and close the connection, as its body is never read.
+    */
+    void sendBodyTooLarge(uint64_t size);
 };
 
 
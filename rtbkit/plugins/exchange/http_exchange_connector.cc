@@ -64,18 +64,26 @@ postConstructorInit()
     absoluteTimeMax = 50.0;
     disableAcceptProbability = false;
     disableExceptionPrinting = false;
+    auctionArena = false;
+    lazyBidRequestParsing = false;
+    maxBodySize = 1 << 20;
 
     numServingRequest = 0;
 
+    for (unsigned i = 0;  i < HttpAuctionHandler::NUM_EVENTS;  ++i)
+        auctionEvents.push_back(internEvent(HttpAuctionHandler::eventNames[i]));
+
     // Link up events
+    std::string newConnectionEvent = internEvent("auctionNewConnection");
     onTransportOpen = [=] (TransportBase *)
         {
-            this->recordHit("auctionNewConnection");
+            this->recordInterned(newConnectionEvent, ET_HIT);
         };
 
+    std::string closedConnectionEvent = internEvent("auctionClosedConnection");
     onTransportClose = [=] (TransportBase *)
         {
-            this->recordHit("auctionClosedConnection");
+            this->recordInterned(closedConnectionEvent, ET_HIT);
         };
 
     handlerFactory = [=] () { return new HttpAuctionHandler(); };
@@ -110,6 +118,17 @@ configure(const Json::Value & parameters)
     getParam(parameters, absoluteTimeMax, "absoluteTimeMax");
     getParam(parameters, disableAcceptProbability, "disableAcceptProbability");
     getParam(parameters, disableExceptionPrinting, "disableExceptionPrinting");
+    getParam(parameters, auctionArena, "auctionArena");
+    getParam(parameters, lazyBidRequestParsing, "lazyBidRequestParsing");
+    getParam(parameters, maxBodySize, "maxBodySize");
+    getParam(parameters, reusePortAccept, "reusePortAccept");
+
+    if (parameters.isMember("activitySampling"))
+        setActivitySampling(parameters["activitySampling"].asDouble());
+
+    // The bid request pipeline could read any field of the request
+    if (!parameters["pipeline"].isNull())
+        lazyBidRequestParsing = false;
 
     if (parameters.isMember("realTimePolling"))
         realTimePolling(parameters["realTimePolling"].asBool());
@@ -141,7 +160,8 @@ configureHttp(int numThreads,
               const std::string & auctionVerb,
               int realTimePriority,
               bool realTimePolling,
-              double absoluteTimeMax)
+              double absoluteTimeMax,
+              bool reusePortAccept)
 {
     this->numThreads = numThreads;
     this->realTimePriority = realTimePriority;
@@ -153,6 +173,7 @@ configureHttp(int numThreads,
     this->auctionVerb = auctionVerb;
     this->realTimePolling(realTimePolling);
     this->absoluteTimeMax = absoluteTimeMax;
+    this->reusePortAccept = reusePortAccept;
 
     configurePipeline(Json::nullValue);
 }
@@ -269,6 +290,22 @@ adjustAuction(std::shared_ptr<Auction>& auction) const
 {
 }
 
+std::string
+HttpExchangeConnector::
+payloadRequestFormat() const
+{
+    return std::string();
+}
+
+uint32_t
+HttpExchangeConnector::
+eagerBidRequestFields() const
+{
+    if (!lazyBidRequestParsing)
+        return BidRequestFields::ALL;
+    return getFilterFields() | bidRequestFieldsRead();
+}
+
 double
 HttpExchangeConnector::
 getTimeAvailableMs(HttpAuctionHandler & connection,
@@ -62,7 +62,12 @@ struct HttpExchangeConnector
 
     void configurePipeline(const Json::Value& config);
 
-    /** Configure just the HTTP part of the server. */
+    /** Configure just the HTTP part of the server.
+
+        If reusePortAccept is true, each of the numThreads event threads
+        listens on its own SO_REUSEPORT socket and accepts connections
+        directly, instead of a single thread accepting them all.
+    */
     void configureHttp(int numThreads,
                        const PortRange & listenPort,
                        const std::string & bindHost = "*",
@@ -72,7 +77,8 @@ struct HttpExchangeConnector
                        const std::string & auctionVerb = "POST",
                        int realTimePriority = -1,
                        bool realTimePolling = false,
-                       double absoluteTimeMax = 50.0);
+                       double absoluteTimeMax = 50.0,
+                       bool reusePortAccept = false);
 
     /** Start the exchange connector running */
     virtual void start();
@@ -165,6 +171,29 @@ struct HttpExchangeConnector
     virtual void
     adjustAuction(std::shared_ptr<Auction>& auction) const;
 
+    /** Return the format of the payloads, as understood by
+     *  BidRequest::parse, if the agents can be sent the payload as is
+     *  instead of a serialization of the parsed bid request. Connectors
+     *  that return a format must leave the bid request untouched once it's
+     *  parsed.
+     *
+     *  The default implementation returns an empty string which means that
+     *  the bid request is serialized when it's first needed.
+     */
+    virtual std::string
+    payloadRequestFormat() const;
+
+    /** Return the groups of top level fields of the bid requests (see
+     *  BidRequestFields) that parseBidRequest must parse before the auction
+     *  is injected: those read by the router's filters and by the connector
+     *  itself if lazyBidRequestParsing is set, all of them otherwise.
+     *
+     *  Connectors that can parse lazily leave the other fields to
+     *  BidRequest::complete(), which the router calls once the auction has
+     *  made it through the filters.
+     */
+    uint32_t eagerBidRequestFields() const;
+
 
     /** Return the available time for the bid request in milliseconds.  This
         method should not parse the bid request, as when shedding load
@@ -311,6 +340,9 @@ protected:
     double absoluteTimeMax;
     bool disableAcceptProbability;
     bool disableExceptionPrinting;
+    bool auctionArena;  ///< Allocate the auctions in an AuctionArena
+    bool lazyBidRequestParsing;  ///< Only parse what the filters read
+    uint64_t maxBodySize;  ///< Larger requests get a 413; 0 for no limit
 
     /// The ping time to known hosts in milliseconds
     std::unordered_map<std::string, float> pingTimesByHostMs;
@@ -324,6 +356,9 @@ private:
     std::shared_ptr<HttpAuctionLogger> logger;
     std::shared_ptr<BidRequestPipeline> pipeline;
 
+    /// Interned names of the HttpAuctionHandler::Event events
+    std::vector<std::string> auctionEvents;
+
     Lock handlersLock;
     std::set<std::shared_ptr<HttpAuctionHandler> > handlers;
     void finishedWithHandler(std::shared_ptr<HttpAuctionHandler> handler);
@@ -232,8 +232,7 @@ parseBidRequest(HttpAuctionHandler & connection,
     // Parse the bid request
     // TODO Check with MoPub if they send the x-openrtb-version header
     // and if they support 2.2 now.
-    ML::Parse_Context context("Bid Request", payload.c_str(), payload.size());
-    res.reset(OpenRTBBidRequestParser::openRTBBidRequestParserFactory("2.1")->parseBidRequest(context, exchangeName(), exchangeName()));
+    res.reset(parseOpenRTBBidRequest(payload, "2.1"));
 
     // get restrictions enforced by MoPub.
     //1) blocked category
@@ -88,6 +88,11 @@ struct MoPubExchangeConnector: public OpenRTBExchangeConnector {
                              const AgentConfig & config,
                              const void * info) const;
 
+    virtual uint32_t bidRequestFieldsRead() const
+    {
+        return BidRequestFields::RESTRICTIONS;
+    }
+
     // MoPub win price decoding function.
     static float decodeWinPrice(const std::string & sharedSecret,
                                 const std::string & winPriceStr);
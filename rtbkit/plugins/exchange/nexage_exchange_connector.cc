@@ -195,8 +195,7 @@ parseBidRequest(HttpAuctionHandler & connection,
     // Parse the bid request
     // Nexage used not to send x-openrtb-version but they're now at 2.2
     // source : http://www.nexage.com/resource-center/openrtb-2-2-technical-reference/
-    ML::Parse_Context context("Bid Request", payload.c_str(), payload.size());
-    res.reset(OpenRTBBidRequestParser::openRTBBidRequestParserFactory("2.2")->parseBidRequest(context, exchangeName(), exchangeName()));
+    res.reset(parseOpenRTBBidRequest(payload, "2.2"));
 
     return res;
 }
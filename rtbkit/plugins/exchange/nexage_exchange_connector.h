@@ -91,6 +91,11 @@ struct NexageExchangeConnector: public OpenRTBExchangeConnector {
                                           const AgentConfig & config,
                                           const void * info) const;
 
+    virtual uint32_t bidRequestFieldsRead() const
+    {
+        return BidRequestFields::RESTRICTIONS;
+    }
+
   private:
     virtual void setSeatBid(Auction const & auction,
                             int spotNum,
@@ -95,6 +95,37 @@ OpenRTBExchangeConnector(const std::string & name,
 {
 }
 
+BidRequest *
+OpenRTBExchangeConnector::
+parseOpenRTBBidRequest(const std::string & payload,
+                       const std::string & version) const
+{
+    ML::Parse_Context context("Bid Request", payload.c_str(), payload.size());
+    auto parser = OpenRTBBidRequestParser::openRTBBidRequestParserFactory(version);
+
+    uint32_t fields = eagerBidRequestFields();
+    if (fields == BidRequestFields::ALL)
+        return parser->parseBidRequest(context, exchangeName(), exchangeName());
+
+    std::unique_ptr<BidRequest> result(
+            parser->parseBidRequest(context, exchangeName(), exchangeName(),
+                                    fields));
+
+    // Most requests are dropped by the filters so the rest of the payload
+    // is only parsed for those that aren't.
+    std::string exchange = exchangeName();
+    result->parseRest = [=] (const std::string & payload)
+        {
+            ML::Parse_Context context("Bid Request",
+                                      payload.c_str(), payload.size());
+            return OpenRTBBidRequestParser
+                ::openRTBBidRequestParserFactory(version)
+                ->parseBidRequest(context, exchange, exchange);
+        };
+
+    return result.release();
+}
+
 std::shared_ptr<BidRequest>
 OpenRTBExchangeConnector::
 parseBidRequest(HttpAuctionHandler & connection,
@@ -153,10 +184,7 @@ parseBidRequest(HttpAuctionHandler & connection,
     std::shared_ptr<BidRequest> result;
     try {
         JML_TRACE_EXCEPTIONS(!disableExceptionPrinting);
-        ML::Parse_Context context("Bid Request", payload.c_str(), payload.size());
-        result.reset(OpenRTBBidRequestParser::openRTBBidRequestParserFactory(openRtbVersion)->parseBidRequest(context,
-                                                                                              exchangeName(),
-                                                                                              exchangeName()));
+        result.reset(parseOpenRTBBidRequest(payload, openRtbVersion));
         result->protocolVersion = openRtbVersion;
     }
     catch(ML::Exception const & e) {
@@ -65,6 +65,13 @@ private:
                    const Auction & auction) const;
 protected:
 
+    /** Parses an OpenRTB bid request of the given version.  With lazy
+        parsing only the fields of eagerBidRequestFields() are parsed and
+        the rest is left for BidRequest::complete().
+    */
+    BidRequest * parseOpenRTBBidRequest(const std::string & payload,
+                                        const std::string & version) const;
+
     virtual void setSeatBid(Auction const & auction,
                             int spotNum,
                             OpenRTB::BidResponse & response) const;
@@ -79,6 +79,7 @@ struct CreativeIdsExchangeFilter
     : public IterativeCreativeFilter<CreativeIdsExchangeFilter>
 {
     static constexpr const char *name = "CreativeIdsExchangeFilter";
+    uint32_t requiredFields() const { return BidRequestFields::NONE; }
 
     bool filterCreative(FilterState &state, const AdSpot &spot,
                         const AgentConfig &config, const Creative &creative) const
@@ -179,6 +180,12 @@ struct RTBKitExchangeConnector : public OpenRTBExchangeConnector {
     virtual void
     adjustAuction(std::shared_ptr<Auction>& auction) const;
 
+    // The extensions are checked when parsing and adjusting the auction
+    virtual uint32_t bidRequestFieldsRead() const
+    {
+        return BidRequestFields::EXT;
+    }
+
 protected:
 
     virtual void
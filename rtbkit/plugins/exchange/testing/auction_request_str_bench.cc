@@ -0,0 +1,102 @@
+/* auction_request_str_bench.cc
+   Copyright (c) 2013 Datacratic.  All rights reserved.
+
+   Measures the cpu used per request on the exchange thread to build the
+   Auction from the recorded auction corpus when the stringified request is
+   produced eagerly, like it used to be, and when it's produced on demand.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include "rtbkit/plugins/exchange/http_auction_handler.h"
+#include "rtbkit/common/auction.h"
+#include "rtbkit/common/bid_request.h"
+#include "jml/arch/format.h"
+
+#include <iostream>
+#include <time.h>
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+
+double threadCpu()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+template<typename Fn>
+void bench(const string & name, const vector<string> & payloads, Fn && fn)
+{
+    const size_t rounds = 200;
+
+    double start = threadCpu();
+    for (size_t i = 0;  i < rounds;  ++i) {
+        for (const string & payload : payloads)
+            fn(payload);
+    }
+    double elapsed = threadCpu() - start;
+
+    cerr << ML::format("%-20s %8.2fus/request\n",
+            name.c_str(), elapsed / (rounds * payloads.size()) * 1000000.0);
+}
+
+BOOST_AUTO_TEST_CASE( auctionRequestStrBench )
+{
+    string filename = "rtbkit/plugins/exchange/testing/rubicon-samples.txt.gz";
+
+    vector<string> payloads;
+    HttpAuctionLogger::parse(filename, [&] (const string & request) {
+                size_t body = request.find("\r\n\r\n");
+                if (body != string::npos)
+                    payloads.push_back(request.substr(body + 4));
+            });
+
+    BOOST_REQUIRE(!payloads.empty());
+
+    Date start = Date::now();
+    Date expiry = start.plusSeconds(0.1);
+    Auction::HandleAuction noop;
+
+    auto parse = [] (const string & payload) {
+        return shared_ptr<BidRequest>(BidRequest::parse("openrtb", payload));
+    };
+
+    bench("parse only", payloads, [&] (const string & payload) {
+                parse(payload);
+            });
+
+    // What HttpAuctionHandler used to do for every request.
+    bench("eager", payloads, [&] (const string & payload) {
+                auto request = parse(payload);
+                Auction auction(nullptr, noop, request,
+                                request->toJsonStr(), "datacratic",
+                                start, expiry);
+                auction.requestSerialized();
+            });
+
+    // Auctions that no agent is interested in.
+    bench("lazy", payloads, [&] (const string & payload) {
+                Auction auction(nullptr, noop, parse(payload), start, expiry);
+            });
+
+    // Auctions that are sent to an agent.
+    bench("lazy materialized", payloads, [&] (const string & payload) {
+                Auction auction(nullptr, noop, parse(payload), start, expiry);
+                auction.requestStr();
+            });
+
+    // Connectors that pass the payload through as is.
+    bench("payload", payloads, [&] (const string & payload) {
+                Auction auction(nullptr, noop, parse(payload),
+                                payload, "openrtb", start, expiry);
+                auction.requestStr();
+            });
+}
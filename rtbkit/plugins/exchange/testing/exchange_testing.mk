@@ -17,3 +17,4 @@ $(eval $(call test,creative_ids_exchange_filter_test,static_filters rtbkit_excha
 $(eval $(call test,spotx_exchange_connector_test,spotx_exchange bid_test_utils bidding_agent rtb_router agents_bidder,boost))
 
 $(eval $(call test,creative_configuration_test,exchange agent_configuration bid_request jsoncpp types,boost))
+$(eval $(call test,auction_request_str_bench,exchange openrtb_bid_request,boost manual))
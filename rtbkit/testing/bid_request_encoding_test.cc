@@ -0,0 +1,107 @@
+/* bid_request_encoding_test.cc
+   Copyright (c) 2013 Datacratic Inc.  All rights reserved.
+
+   Tests for the per agent encodings of the bid requests sent by the router.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include "rtbkit/core/router/router_types.h"
+#include "rtbkit/core/agent_configuration/agent_config.h"
+#include "rtbkit/common/auction.h"
+#include "rtbkit/common/bid_request.h"
+
+using namespace std;
+using namespace ML;
+using namespace Datacratic;
+using namespace RTBKIT;
+
+string bidRequest = "{\"!!CV\":\"0.1\",\"exchange\":\"abcd\",\"id\":\"8b703eb9-5ebf-4001-15e8-10d6000003a0\",\"ipAddress\":\"76.aa.xx.yy\",\"language\":\"en\",\"protocolVersion\":\"0.3\",\"provider\":\"xxx1\",\"imp\":[{\"formats\":[\"160x600\"],\"id\":\"22202919\",\"position\":\"NONE\",\"reservePrice\":0}],\"timestamp\":1336313462.550589,\"url\":\"http://emedtv.com/search.html\",\"userAgent\":\"Mozilla/5.0 (compatible; MSIE 9.0; Windows NT 6.1; WOW64; Trident/5.0)\",\"userIds\":{\"prov\":\"7d837be6-94de-11e1-841f-68b599c88614\",\"xchg\":\"PV08FEPS1KQAAGcrbUsAAABY\"}}";
+
+AgentConfig makeConfig(const Json::Value & extra)
+{
+    Json::Value config = Json::parse(
+            R"JSON(
+            {
+                "account": ["dummy_account"],
+                "creatives": [ { "width": 300, "height": 250, "id": 1 } ]
+            }
+            )JSON");
+
+    for (auto it = extra.begin(), end = extra.end();  it != end;  ++it)
+        config[it.memberName()] = *it;
+
+    return AgentConfig::createFromJson(config);
+}
+
+AgentInfo makeInfo(const AgentConfig & config)
+{
+    AgentInfo info;
+    info.setBidRequestFormat(config.bidRequestFormat, config.bidRequestFields);
+    return info;
+}
+
+BOOST_AUTO_TEST_CASE( test_bid_request_format_config )
+{
+    AgentConfig config = makeConfig(Json::Value());
+    BOOST_CHECK_EQUAL(config.bidRequestFormat, "json");
+    BOOST_CHECK(config.bidRequestFields.empty());
+
+    config = makeConfig(Json::parse(
+                    "{\"bidRequestFormat\":\"Projected\","
+                    "\"bidRequestFields\":[\"url\",\"imp\",\"url\"]}"));
+    BOOST_CHECK_EQUAL(config.bidRequestFormat, "projected");
+    BOOST_CHECK(config.bidRequestFields == vector<string>({ "imp", "url" }));
+
+    AgentConfig copy = AgentConfig::createFromJson(config.toJson());
+    BOOST_CHECK_EQUAL(copy.bidRequestFormat, "projected");
+    BOOST_CHECK(copy.bidRequestFields == config.bidRequestFields);
+
+    BOOST_CHECK_THROW(makeConfig(Json::parse("{\"bidRequestFormat\":\"xml\"}")),
+                      ML::Exception);
+    BOOST_CHECK_THROW(makeConfig(Json::parse("{\"bidRequestFields\":[\"nope\"]}")),
+                      ML::Exception);
+}
+
+BOOST_AUTO_TEST_CASE( test_bid_request_encodings )
+{
+    std::shared_ptr<BidRequest> request(BidRequest::parse("rtbkit", bidRequest));
+    Date now = Date::now();
+    Auction auction(nullptr, Auction::HandleAuction(), request,
+                    now, now.plusSeconds(0.1));
+
+    AgentInfo json = makeInfo(makeConfig(Json::Value()));
+    BOOST_CHECK_EQUAL(json.getBidRequestEncoding(auction), "datacratic");
+    BOOST_CHECK_EQUAL(&json.encodeBidRequest(auction), &auction.requestStr());
+
+    // Agents using the same projection share the same encoding.
+    Json::Value projected = Json::parse(
+            "{\"bidRequestFormat\":\"projected\","
+            "\"bidRequestFields\":[\"url\",\"imp\"]}");
+    AgentInfo proj1 = makeInfo(makeConfig(projected));
+    AgentInfo proj2 = makeInfo(makeConfig(projected));
+    BOOST_CHECK_EQUAL(&proj1.encodeBidRequest(auction),
+                      &proj2.encodeBidRequest(auction));
+
+    std::unique_ptr<BidRequest> decoded(
+            BidRequest::parse(proj1.getBidRequestEncoding(auction),
+                              proj1.encodeBidRequest(auction)));
+    BOOST_CHECK_EQUAL(decoded->auctionId, request->auctionId);
+    BOOST_CHECK_EQUAL(decoded->url.toString(), request->url.toString());
+    BOOST_CHECK_EQUAL(decoded->imp.size(), 1);
+    BOOST_CHECK_EQUAL(decoded->userAgent, UnicodeString());
+    BOOST_CHECK_EQUAL(proj1.encodeBidRequest(*request),
+                      proj1.encodeBidRequest(auction));
+
+    AgentInfo binary
+        = makeInfo(makeConfig(Json::parse("{\"bidRequestFormat\":\"binary\"}")));
+    BOOST_CHECK_EQUAL(&binary.encodeBidRequest(auction),
+                      &auction.requestSerialized());
+
+    decoded.reset(BidRequest::parse(binary.getBidRequestEncoding(auction),
+                                    binary.encodeBidRequest(auction)));
+    BOOST_CHECK_EQUAL(decoded->toJsonStr(), request->toJsonStr());
+}
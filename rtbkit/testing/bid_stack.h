@@ -19,6 +19,10 @@ namespace RTBKIT {
 struct BidStack {
     std::shared_ptr<ServiceProxies> proxies;
     bool enforceAgents;
+    bool logAuctions;
+
+    // analytics plugin given to the router, if any
+    Json::Value analyticsConfig;
 
     // components
     struct Services {
@@ -33,6 +37,7 @@ struct BidStack {
     BidStack()
      : proxies(new ServiceProxies())
      , enforceAgents(true)
+     , logAuctions(false)
     { }
 
     void run(Json::Value const & routerConfig,
@@ -71,9 +76,12 @@ struct BidStack {
         services.acs->start();
 
         // We need a router for our exchange connector to work
-        services.router.reset(new Router(proxies, "router"));
+        services.router.reset(new Router(proxies, "router", 2.0, true, true,
+                                         logAuctions));
         services.router->unsafeDisableMonitor();
         services.router->initBidderInterface(bidderConfig);
+        if (!analyticsConfig.isNull())
+            services.router->initAnalytics(analyticsConfig);
         services.router->init();
 
         // Set a null banker that blindly approves all bids so that we can
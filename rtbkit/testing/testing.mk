@@ -11,6 +11,7 @@ $(eval $(call vowsjs_test,bid_request_js_segments_test,bid_request))
 $(eval $(call test,agent_configuration_test,rtb_router bidding_agent,boost))
 $(eval $(call test,augmentation_list_test,rtb,boost))
 $(eval $(call test,historical_bid_request_test,bid_request,boost))
+$(eval $(call test,bid_request_encoding_test,rtb_router,boost))
 
 $(eval $(call library,integration_test_utils,generic_exchange_connector.cc mock_exchange.cc,rtb_router bid_test_utils exchange))
 
@@ -112,33 +112,6 @@ setTransport(TransportBase * transport)
     transport_ = transport;
 }
 
-void
-ConnectionHandler::
-addActivity(const std::string & activity)
-{
-    if (!transport_ || !transport().debug) return;
-    transport().addActivity(activity);
-}
-
-void
-ConnectionHandler::
-addActivityS(const char * act)
-{
-    if (!transport_ || !transport().debug) return;
-    transport().addActivity(act);
-}
-
-void
-ConnectionHandler::
-addActivity(const char * fmt, ...)
-{
-    if (!transport_ || !transport().debug) return;
-    va_list ap;
-    va_start(ap, fmt);
-    ML::Call_Guard cleanupAp([&] () { va_end(ap); });
-    transport().addActivity(ML::vformat(fmt, ap));
-}
-
 void
 ConnectionHandler::
 checkMagic() const
@@ -194,13 +194,34 @@ struct ConnectionHandler {
     */
     //virtual int handlerReturnCode() const = 0;
 
+    /** Are activities being recorded for this connection?  Callers that
+        need to do work to build an activity should check this first.
+        Always false when TRANSPORT_ACTIVITIES_ENABLED is 0.
+    */
+    bool debugOn() const
+    {
+        return transport_ && transport_->debugOn();
+    }
+
     /** Add an activity to the stream of activities for debugging. */
-    void addActivity(const std::string & activity);
+    void addActivity(const std::string & activity)
+    {
+        if (!debugOn()) return;
+        transport_->addActivity(activity);
+    }
 
     /** Add an activity to the stream of activities for debugging. */
-    void addActivityS(const char * activity);
+    void addActivityS(const char * activity)
+    {
+        if (!debugOn()) return;
+        transport_->addActivityS(activity);
+    }
 
-    void addActivity(const char * fmt, ...);
+    /** Add a printf-style activity.  Nothing is formatted unless activities
+        are being recorded for this connection; the arguments themselves are
+        still evaluated, so guard expensive ones with debugOn().
+    */
+    void addActivity(const char * fmt, ...) JML_FORMAT_STRING(2, 3);
 
     void checkMagic() const;
 
@@ -227,6 +248,18 @@ private:
     int magic;
 };
 
+inline void
+ConnectionHandler::
+addActivity(const char * fmt, ...)
+{
+    if (!debugOn()) return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    ML::Call_Guard cleanupAp([&] () { va_end(ap); });
+    transport_->addActivity(ML::vformat(fmt, ap));
+}
+
 
 /*****************************************************************************/
 /* PASSIVE CONNECTION HANDLER                                                */
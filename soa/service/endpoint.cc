@@ -45,7 +45,8 @@ EndpointBase(const std::string & name)
       name_(name),
       threadsActive_(0),
       numTransports(0), shutdown_(false), disallowTimers_(false),
-      pollingMode_(MIN_CONTEXT_SWITCH_POLLING)
+      pollingMode_(MIN_CONTEXT_SWITCH_POLLING),
+      activitySampleThreshold_(0)
 {
     Epoller::init(16384);
     auto wakeupData = make_shared<EpollData>(EpollData::EpollDataType::WAKEUP,
@@ -63,6 +64,26 @@ EndpointBase::
     shutdown();
 }
 
+void
+EndpointBase::
+setActivitySampling(double fraction)
+{
+    if (fraction < 0.0 || fraction > 1.0)
+        throw ML::Exception("activity sampling fraction %f not in [0, 1]",
+                            fraction);
+
+    activitySampleThreshold_.store(fraction * (RAND_MAX + 1.0),
+                                   std::memory_order_relaxed);
+}
+
+double
+EndpointBase::
+activitySampling() const
+{
+    return activitySampleThreshold_.load(std::memory_order_relaxed)
+        / (RAND_MAX + 1.0);
+}
+
 void
 EndpointBase::
 setPollingMode(enum PollingMode mode)
@@ -271,6 +292,10 @@ notifyNewTransport(const std::shared_ptr<TransportBase> & transport)
 
     if (transportMapping.count(transport))
         throw ML::Exception("active set already contains connection");
+    long threshold = activitySampleThreshold_.load(std::memory_order_relaxed);
+    if (threshold && random() < threshold)
+        transport->debug = true;
+
     auto epollData
         = make_shared<EpollData>(EpollData::EpollDataType::TRANSPORT,
                                  transport->epollFd_);
@@ -471,6 +496,10 @@ handleEpollEvent(epoll_event & event)
         }
         break;
     }
+    case EpollData::EpollDataType::ACCEPT:
+        // the acceptor restarts the polling itself unless it is closing
+        epollDataPtr->onAccept();
+        break;
     case EpollData::EpollDataType::WAKEUP:
         // wakeup for shutdown
         return Epoller::SHUTDOWN;
@@ -96,6 +96,9 @@ struct EndpointBase : public Epoller {
 
     int threadsActive() const { return threadsActive_; }
 
+    /** Number of event threads started by spinup(). */
+    int numEventThreads() const { return eventThreadList.size(); }
+
     /** Dump the state of the endpoint for debugging. */
     virtual void dumpState() const;
     
@@ -124,6 +127,15 @@ struct EndpointBase : public Epoller {
 
     const std::string & name() const { return name_; }
 
+    /** Record the activities of the given fraction of the connections
+        opened from now on (0 records none, 1 records all of them), on top
+        of those recorded because DEBUG_TRANSPORTS is set.  Can be called
+        while the endpoint is running.
+    */
+    void setActivitySampling(double fraction);
+
+    double activitySampling() const;
+
     /** Set this endpoint up to handle events in realtime. */
     void makeRealTime(int priority = 1);
 
@@ -150,13 +162,15 @@ struct EndpointBase : public Epoller {
             INVALID,
             TRANSPORT,
             TIMER,
-            WAKEUP
+            WAKEUP,
+            ACCEPT
         };
 
         EpollData(EpollData::EpollDataType fdType, int fd)
             : fdType(fdType), fd(fd), transport(nullptr)
         {
-            if (fdType != TRANSPORT && fdType != TIMER && fdType != WAKEUP) {
+            if (fdType != TRANSPORT && fdType != TIMER && fdType != WAKEUP
+                && fdType != ACCEPT) {
                 throw ML::Exception("no such fd type");
             }
         }
@@ -166,6 +180,7 @@ struct EndpointBase : public Epoller {
 
         std::shared_ptr<TransportBase> transport; /* TRANSPORT */
         OnTimer onTimer;                          /* TIMER */
+        std::function<void ()> onAccept;          /* ACCEPT; restarts polling */
         std::string name;
     };
 
@@ -289,6 +304,10 @@ private:
 
     std::map<std::string, int> numTransportsByHost;
 
+    /* New connections for which random() is below this record activities.
+       Can be changed while connections are being accepted. */
+    std::atomic<long> activitySampleThreshold_;
+
     std::vector<double> totalSleepTime;
     std::vector<rusage> resourceUsage;
     mutable std::mutex usageLock;
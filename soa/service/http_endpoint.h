@@ -128,7 +128,7 @@ struct HttpConnectionHandler : public PassiveConnectionHandler {
         is used after a response is sent to set the connection up for a
         new request.
     */
-    std::shared_ptr<ConnectionHandler> makeNewHandlerShared();
+    virtual std::shared_ptr<ConnectionHandler> makeNewHandlerShared();
 
     //virtual void handleNewConnection();
     virtual void handleData(const std::string & data);
@@ -10,6 +10,8 @@
 #include "jml/db/persistent.h"
 #include "jml/utils/vector_utils.h"
 #include <boost/lexical_cast.hpp>
+#include <algorithm>
+#include <string.h>
 
 using namespace std;
 using namespace ML;
@@ -109,6 +111,52 @@ toBinary() const
 /* HTTP HEADER                                                               */
 /*****************************************************************************/
 
+HttpHeader::
+HttpHeader(const HttpHeader & other)
+    : verb(other.verb), resource(other.resource), version(other.version),
+      queryParams(other.queryParams),
+      contentType(other.contentType), contentLength(other.contentLength),
+      isChunked(other.isChunked), headers(other.headers),
+      knownData(other.knownData), headerName_(other.headerName_)
+{
+    copySeenHeaders(other);
+}
+
+HttpHeader &
+HttpHeader::
+operator = (const HttpHeader & other)
+{
+    if (this == &other)
+        return *this;
+
+    verb = other.verb;
+    resource = other.resource;
+    version = other.version;
+    queryParams = other.queryParams;
+    contentType = other.contentType;
+    contentLength = other.contentLength;
+    isChunked = other.isChunked;
+    headers = other.headers;
+    knownData = other.knownData;
+    headerName_ = other.headerName_;
+    copySeenHeaders(other);
+
+    return *this;
+}
+
+void
+HttpHeader::
+copySeenHeaders(const HttpHeader & other)
+{
+    seenHeaders_.clear();
+    seenHeaders_.reserve(other.seenHeaders_.size());
+    for (const std::string * name: other.seenHeaders_) {
+        auto it = headers.find(*name);
+        if (it != headers.end())
+            seenHeaders_.push_back(&it->first);
+    }
+}
+
 void
 HttpHeader::
 swap(HttpHeader & other)
@@ -121,6 +169,8 @@ swap(HttpHeader & other)
     knownData.swap(other.knownData);
     std::swap(isChunked, other.isChunked);
     std::swap(version, other.version);
+    // The seen headers point into the nodes of the maps, which were swapped
+    seenHeaders_.swap(other.seenHeaders_);
 }
 
 namespace {
@@ -174,6 +224,20 @@ expectUrlEncodedString(ML::Parse_Context & context,
     return result;
 }
 
+void
+parseQueryParams(ML::Parse_Context & context, RestParams & queryParams)
+{
+    do {
+        string key = expectUrlEncodedString(context, "=& ");
+        if (context.match_literal('=')) {
+            string value = expectUrlEncodedString(context, "& ");
+            queryParams.push_back(make_pair(key, value));
+        } else {
+            queryParams.push_back(make_pair(key, ""));
+        }
+    } while (context.match_literal('&'));
+}
+
 } // file scope
 
 void
@@ -192,17 +256,8 @@ parse(const std::string & headerAndData, bool checkBodyLength)
         parsed.verb = context.expect_text(" \n");
         context.expect_literal(' ');
         parsed.resource = context.expect_text(" ?");
-        if (context.match_literal('?')) {
-            do {
-                string key = expectUrlEncodedString(context, "=& ");
-                if (context.match_literal('=')) {
-                    string value = expectUrlEncodedString(context, "& ");
-                    queryParams.push_back(make_pair(key, value));
-                } else {
-                    queryParams.push_back(make_pair(key, ""));
-                }
-            } while (context.match_literal('&'));
-        }
+        if (context.match_literal('?'))
+            parseQueryParams(context, queryParams);
         context.expect_literal(' ');
         parsed.version = context.expect_text('\r');
         context.expect_eol();
@@ -264,6 +319,86 @@ parse(const std::string & headerAndData, bool checkBodyLength)
     }
 }
 
+void
+HttpHeader::
+startRequest(const char * verbData, size_t verbSize,
+             const char * resourceData, size_t resourceSize,
+             const char * versionData, size_t versionSize)
+{
+    verb.assign(verbData, verbSize);
+
+    const char * query
+        = (const char *)memchr(resourceData, '?', resourceSize);
+    const char * resourceEnd = resourceData + resourceSize;
+    resource.assign(resourceData, query ? query : resourceEnd);
+
+    queryParams.clear();
+    if (query && query + 1 < resourceEnd) {
+        ML::Parse_Context context("request query", query + 1, resourceEnd);
+        parseQueryParams(context, queryParams);
+    }
+
+    version.assign(versionData, versionSize);
+
+    contentType.clear();
+    contentLength = -1;
+    isChunked = false;
+    knownData.clear();
+    seenHeaders_.clear();
+}
+
+void
+HttpHeader::
+addHeader(const char * name, size_t nameSize,
+          const char * value, size_t valueSize)
+{
+    headerName_.assign(name, nameSize);
+    for (char & c: headerName_)
+        c = tolower(c);
+
+    if (headerName_ == "content-length") {
+        contentLength = 0;
+        for (size_t i = 0;  i < valueSize;  ++i) {
+            if (!isdigit(value[i]))
+                throw ML::Exception("invalid content-length");
+            contentLength = contentLength * 10 + (value[i] - '0');
+        }
+    }
+    else if (headerName_ == "content-type")
+        contentType.assign(value, valueSize);
+    else if (headerName_ == "transfer-encoding") {
+        if (valueSize != 7 || strncasecmp(value, "chunked", 7) != 0)
+            throw ML::Exception("unknown transfer-encoding");
+        isChunked = true;
+    }
+    else {
+        auto it = headers.find(headerName_);
+        if (it == headers.end())
+            it = headers.insert(make_pair(headerName_,
+                                          string(value, valueSize))).first;
+        else it->second.assign(value, valueSize);
+        seenHeaders_.push_back(&it->first);
+    }
+}
+
+void
+HttpHeader::
+finishHeaders()
+{
+    std::sort(seenHeaders_.begin(), seenHeaders_.end());
+    seenHeaders_.erase(std::unique(seenHeaders_.begin(), seenHeaders_.end()),
+                       seenHeaders_.end());
+    if (seenHeaders_.size() == headers.size())
+        return;
+
+    for (auto it = headers.begin();  it != headers.end();) {
+        if (std::binary_search(seenHeaders_.begin(), seenHeaders_.end(),
+                               &it->first))
+            ++it;
+        else headers.erase(it++);
+    }
+}
+
 int HttpHeader::responseCode() const
 {
     return boost::lexical_cast<int>(resource);
@@ -57,10 +57,33 @@ struct HttpHeader {
     {
     }
 
+    /** The copies point the headers seen by the incremental filling into
+        their own map.  Moves keep the nodes of the map, and so the
+        pointers.
+    */
+    HttpHeader(const HttpHeader & other);
+    HttpHeader(HttpHeader && other) = default;
+    HttpHeader & operator = (const HttpHeader & other);
+    HttpHeader & operator = (HttpHeader && other) = default;
+
     void swap(HttpHeader & other);
 
     void parse(const std::string & headerAndData, bool checkBodyLength = true);
 
+    /** Incremental filling of the header from the callbacks of an
+        HttpRequestParser.  The storage held from the previous request is
+        reused, so that a header kept for a connection stops allocating
+        once the requests coming through it have the same headers.
+    */
+    void startRequest(const char * verbData, size_t verbSize,
+                      const char * resourceData, size_t resourceSize,
+                      const char * versionData, size_t versionSize);
+    void addHeader(const char * name, size_t nameSize,
+                   const char * value, size_t valueSize);
+
+    /** Remove the headers left over from the previous request. */
+    void finishHeaders();
+
     std::string verb;       // GET, PUT, etc
     std::string resource;   // after the get
     std::string version;    // after the get
@@ -95,6 +118,13 @@ struct HttpHeader {
 
     // If some portion of the data is known, it's put in here
     std::string knownData;
+
+private:
+    // Scratch space used by the incremental filling
+    std::string headerName_;
+    std::vector<const std::string *> seenHeaders_;  ///< Keys of headers
+
+    void copySeenHeaders(const HttpHeader & other);
 };
 
 std::ostream & operator << (std::ostream & stream, const HttpHeader & header);
@@ -395,3 +395,348 @@ finalizeParsing()
     }
     clear();
 }
+
+
+/****************************************************************************/
+/* HTTP REQUEST PARSER                                                      */
+/****************************************************************************/
+
+namespace {
+
+bool
+matchToken(const char * data, const char * end, const char * token)
+{
+    size_t len = ::strlen(token);
+    return (size_t(end - data) == len
+            && ::strncasecmp(data, token, len) == 0);
+}
+
+} // file scope
+
+void
+HttpRequestParser::
+clear()
+    noexcept
+{
+    paused_ = false;
+    stage_ = REQUEST_LINE;
+    buffer_.clear();
+    headerSize_ = 0;
+    remainingBody_ = 0;
+    bodySize_ = 0;
+    useChunkedEncoding_ = false;
+    requireClose_ = false;
+}
+
+void
+HttpRequestParser::
+feed(const char * bufferData)
+{
+    feed(bufferData, strlen(bufferData));
+}
+
+void
+HttpRequestParser::
+feed(const char * bufferData, size_t bufferSize)
+{
+    if (paused_) {
+        buffer_.append(bufferData, bufferSize);
+    }
+    else if (buffer_.size() > 0) {
+        buffer_.append(bufferData, bufferSize);
+        size_t consumed = parse(buffer_.c_str(), buffer_.size());
+        buffer_.erase(0, consumed);
+    }
+    else {
+        /* the common case: we parse straight from the caller's buffer and
+           only keep what is left over */
+        size_t consumed = parse(bufferData, bufferSize);
+        buffer_.assign(bufferData + consumed, bufferSize - consumed);
+    }
+}
+
+void
+HttpRequestParser::
+resume()
+{
+    if (!paused_) {
+        return;
+    }
+    paused_ = false;
+
+    if (buffer_.size() > 0) {
+        size_t consumed = parse(buffer_.c_str(), buffer_.size());
+        buffer_.erase(0, consumed);
+    }
+}
+
+size_t
+HttpRequestParser::
+parse(const char * data, size_t size)
+{
+    const char * current = data;
+    const char * end = data + size;
+
+    /* returns the end of the line starting at "current", without its line
+       ending, and sets "next" to the start of the following line */
+    auto findLine = [&] (const char * & next) -> const char * {
+        const char * eol
+            = (const char *) ::memchr(current, '\n', end - current);
+        if (!eol) {
+            return nullptr;
+        }
+        next = eol + 1;
+        if (eol > current && eol[-1] == '\r') {
+            eol--;
+        }
+        return eol;
+    };
+
+    auto checkHeaderSize = [&] (size_t lineSize) {
+        headerSize_ += lineSize;
+        if (headerSize_ > MaxHeaderSize) {
+            throw ML::Exception("HTTP header exceeds 16kb");
+        }
+    };
+
+    while (current < end && !paused_) {
+        const char * next(nullptr);
+
+        if (stage_ == REJECTED) {
+            current = end;
+        }
+        else if (stage_ == REQUEST_LINE || stage_ == HEADERS) {
+            const char * eol = findLine(next);
+            if (!eol) {
+                if (headerSize_ + (end - current) > MaxHeaderSize) {
+                    throw ML::Exception("HTTP header exceeds 16kb");
+                }
+                break;
+            }
+            checkHeaderSize(next - current);
+
+            if (stage_ == REQUEST_LINE) {
+                /* empty lines preceding a request are ignored */
+                if (eol > current) {
+                    parseRequestLine(current, eol);
+                    stage_ = HEADERS;
+                }
+            }
+            else if (eol == current) {
+                finishHeaders();
+            }
+            else {
+                parseHeader(current, eol);
+            }
+            current = next;
+        }
+        else if (stage_ == BODY || stage_ == CHUNK_BODY) {
+            uint64_t chunkSize = min(uint64_t(end - current), remainingBody_);
+            if (onData && chunkSize > 0) {
+                onData(current, chunkSize);
+            }
+            current += chunkSize;
+            remainingBody_ -= chunkSize;
+            if (remainingBody_ == 0) {
+                if (stage_ == BODY) {
+                    finishRequest();
+                }
+                else {
+                    stage_ = CHUNK_END;
+                }
+            }
+        }
+        else {
+            const char * eol = findLine(next);
+            if (!eol) {
+                break;
+            }
+
+            if (stage_ == CHUNK_HEADER) {
+                /* chunk extensions are ignored */
+                const char * sizeEnd
+                    = (const char *) ::memchr(current, ';', eol - current);
+                if (!sizeEnd) {
+                    sizeEnd = eol;
+                }
+                while (sizeEnd > current
+                       && (sizeEnd[-1] == ' ' || sizeEnd[-1] == '\t')) {
+                    sizeEnd--;
+                }
+                if (sizeEnd == current) {
+                    throw ML::Exception("missing chunk size");
+                }
+                remainingBody_ = ML::antoi(current, sizeEnd, 16);
+                bodySize_ += remainingBody_;
+                if (maxBodySize_ > 0 && bodySize_ > maxBodySize_) {
+                    rejectBody(bodySize_);
+                }
+                else {
+                    stage_ = remainingBody_ > 0 ? CHUNK_BODY : TRAILERS;
+                }
+            }
+            else if (stage_ == CHUNK_END) {
+                if (eol != current) {
+                    throw ML::Exception("expected end of chunk");
+                }
+                stage_ = CHUNK_HEADER;
+            }
+            else {
+                /* trailers are ignored */
+                if (eol == current) {
+                    finishRequest();
+                }
+            }
+            current = next;
+        }
+    }
+
+    return current - data;
+}
+
+void
+HttpRequestParser::
+parseRequestLine(const char * data, const char * end)
+{
+    const char * verbEnd = (const char *) ::memchr(data, ' ', end - data);
+    if (!verbEnd || verbEnd == data) {
+        throw ML::Exception("invalid request line");
+    }
+
+    const char * resource = verbEnd + 1;
+    const char * resourceEnd
+        = (const char *) ::memchr(resource, ' ', end - resource);
+    if (!resourceEnd || resourceEnd == resource) {
+        throw ML::Exception("invalid request line");
+    }
+
+    const char * version = resourceEnd + 1;
+    if (end - version < 8 || ::memcmp(version, "HTTP/", 5) != 0) {
+        throw ML::Exception("version must start with 'HTTP/'");
+    }
+
+    /* HTTP/1.0 connections are closed unless asked otherwise */
+    requireClose_ = matchToken(version, end, "HTTP/1.0");
+
+    if (onRequestStart) {
+        onRequestStart(data, verbEnd - data,
+                       resource, resourceEnd - resource,
+                       version, end - version);
+    }
+}
+
+void
+HttpRequestParser::
+parseHeader(const char * data, const char * end)
+{
+    if (*data == ' ' || *data == '\t') {
+        throw ML::Exception("obsolete header line folding");
+    }
+
+    const char * nameEnd = (const char *) ::memchr(data, ':', end - data);
+    if (!nameEnd || nameEnd == data) {
+        throw ML::Exception("invalid header line");
+    }
+
+    const char * value = nameEnd + 1;
+    while (value < end && (*value == ' ' || *value == '\t')) {
+        value++;
+    }
+    const char * valueEnd = end;
+    while (valueEnd > value && (valueEnd[-1] == ' ' || valueEnd[-1] == '\t')) {
+        valueEnd--;
+    }
+
+    if (matchToken(data, nameEnd, "Content-Length")) {
+        if (value == valueEnd) {
+            throw ML::Exception("empty content-length");
+        }
+        uint64_t length(0);
+        for (const char * ptr = value; ptr < valueEnd; ptr++) {
+            if (*ptr < '0' || *ptr > '9') {
+                throw ML::Exception("invalid content-length");
+            }
+            length = length * 10 + (*ptr - '0');
+        }
+        remainingBody_ = length;
+    }
+    else if (matchToken(data, nameEnd, "Transfer-Encoding")) {
+        if (!matchToken(value, valueEnd, "chunked")) {
+            throw ML::Exception("unknown transfer-encoding");
+        }
+        useChunkedEncoding_ = true;
+    }
+    else if (matchToken(data, nameEnd, "Connection")) {
+        if (matchToken(value, valueEnd, "close")) {
+            requireClose_ = true;
+        }
+        else if (matchToken(value, valueEnd, "keep-alive")) {
+            requireClose_ = false;
+        }
+    }
+
+    if (onHeader) {
+        onHeader(data, nameEnd - data, value, valueEnd - value);
+    }
+}
+
+void
+HttpRequestParser::
+finishHeaders()
+{
+    if (!useChunkedEncoding_ && maxBodySize_ > 0
+        && remainingBody_ > maxBodySize_) {
+        rejectBody(remainingBody_);
+        return;
+    }
+
+    if (onHeadersDone) {
+        onHeadersDone();
+    }
+
+    if (useChunkedEncoding_) {
+        remainingBody_ = 0;
+        stage_ = CHUNK_HEADER;
+    }
+    else if (remainingBody_ > 0) {
+        stage_ = BODY;
+    }
+    else {
+        finishRequest();
+    }
+}
+
+void
+HttpRequestParser::
+finishRequest()
+{
+    bool requireClose = requireClose_;
+
+    stage_ = REQUEST_LINE;
+    headerSize_ = 0;
+    remainingBody_ = 0;
+    bodySize_ = 0;
+    useChunkedEncoding_ = false;
+    requireClose_ = false;
+    paused_ = pauseAfterRequest_;
+
+    if (onDone) {
+        onDone(requireClose);
+    }
+}
+
+void
+HttpRequestParser::
+rejectBody(uint64_t size)
+{
+    /* the rest of the connection can't be parsed without reading the body */
+    stage_ = REJECTED;
+    remainingBody_ = 0;
+
+    if (!onBodyTooLarge) {
+        throw ML::Exception("HTTP body of %llu bytes exceeds %llu bytes",
+                            (unsigned long long) size,
+                            (unsigned long long) maxBodySize_);
+    }
+    onBodyTooLarge(size);
+}
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <functional>
+#include <string>
 
 
 namespace Datacratic {
@@ -125,4 +126,148 @@ private:
     bool requireClose_;
 };
 
+
+/****************************************************************************/
+/* HTTP REQUEST PARSER                                                      */
+/****************************************************************************/
+
+/* HttpRequestParser is the counterpart of HttpResponseParser for HTTP/1.1
+ * requests. The request line, the headers and the body are reported as
+ * views into the data being fed, which are only valid during the callback,
+ * so that a server can handle requests straight from its read buffer. Only
+ * the bytes of an incomplete line or of an incomplete request that follows
+ * a paused one are copied, into a buffer that is kept from one request to
+ * the next.
+ *
+ * Requests pipelined on a keep-alive connection are parsed one after the
+ * other. When "setPauseAfterRequest" is enabled, the parser stops after
+ * each request and keeps the data that follows it until resume() is
+ * called, which lets a server answer the requests in order.
+ */
+
+struct HttpRequestParser {
+    /* Type of callback used when a request is starting, passing the verb,
+     * the resource (including its query string) and the HTTP version */
+    typedef std::function<void (const char *, size_t,
+                                const char *, size_t,
+                                const char *, size_t)> OnRequestStart;
+
+    /* Type of callback used to report a header, passing its name and its
+     * value with the surrounding whitespace removed. */
+    typedef std::function<void (const char *, size_t,
+                                const char *, size_t)> OnHeader;
+
+    /* Type of callback used when all the headers of the request have been
+     * reported. */
+    typedef std::function<void ()> OnHeadersDone;
+
+    /* Type of callback used when to report a chunk of the request body. Only
+       invoked when the body is larger than 0 byte. */
+    typedef std::function<void (const char *, size_t)> OnData;
+
+    /* Type of callback used when to report the end of a request, indicating
+     * whether the client requires the connection to be closed after the
+     * response. */
+    typedef std::function<void (bool)> OnDone;
+
+    /* Type of callback used to report a body larger than the maximum set
+     * with "setMaxBodySize", passing the size announced so far. */
+    typedef std::function<void (uint64_t)> OnBodyTooLarge;
+
+    /* Maximum size of the request line and the headers of a request */
+    static constexpr size_t MaxHeaderSize = 16384;
+
+    HttpRequestParser()
+        noexcept
+        : pauseAfterRequest_(false), maxBodySize_(0)
+    {
+        clear();
+    }
+
+    /* Feed the parsing with a 0-ended data chunk. Slightly slower than the
+       explicitly sized version, but useful for testing. Avoid in production
+       code. */
+    void feed(const char * data);
+
+    /* Feed the parsing with a data chunk of a specified size. Must not be
+       invoked from one of the callbacks. */
+    void feed(const char * data, size_t size);
+
+    /* Indicates whether to stop parsing after each request, until resume()
+       is called. */
+    void setPauseAfterRequest(bool pause)
+    { pauseAfterRequest_ = pause; }
+
+    /* Maximum size of the body of a request, 0 for no limit. A request
+       with a larger Content-Length, or whose chunks add up to more, is
+       reported to "onBodyTooLarge" before any of its body is read, after
+       which the parser drops all the data fed to it. Without a callback an
+       exception is thrown instead. */
+    void setMaxBodySize(uint64_t size)
+    { maxBodySize_ = size; }
+
+    /* Whether the parser is paused after a request. */
+    bool paused() const
+    { return paused_; }
+
+    /* Resume the parsing after a request, starting with the data that was
+       fed while the parser was paused. */
+    void resume();
+
+    /* Number of bytes fed that are waiting for more data or for resume(). */
+    size_t buffered() const
+    { return buffer_.size(); }
+
+    /* Returns the number of bytes remaining to parse from the current body
+     * or chunk. */
+    uint64_t remainingBody() const
+    {
+        return remainingBody_;
+    }
+
+    OnRequestStart onRequestStart;
+    OnHeader onHeader;
+    OnHeadersDone onHeadersDone;
+    OnData onData;
+    OnDone onDone;
+    OnBodyTooLarge onBodyTooLarge;
+
+private:
+    enum Stage {
+        REQUEST_LINE,
+        HEADERS,
+        BODY,
+        CHUNK_HEADER,
+        CHUNK_BODY,
+        CHUNK_END,
+        TRAILERS,
+        REJECTED
+    };
+
+    void clear() noexcept;
+
+    /* parse as much of the given data as possible, returning the number of
+       bytes consumed */
+    size_t parse(const char * data, size_t size);
+
+    void parseRequestLine(const char * data, const char * end);
+    void parseHeader(const char * data, const char * end);
+    void finishHeaders();
+    void finishRequest();
+    void rejectBody(uint64_t size);
+
+    bool pauseAfterRequest_;
+    bool paused_;
+    uint64_t maxBodySize_;
+
+    Stage stage_;
+    std::string buffer_;
+    size_t headerSize_;
+
+    uint64_t remainingBody_;
+    uint64_t bodySize_;  // total size of the chunks of the current request
+    bool useChunkedEncoding_;
+    bool requireClose_;
+};
+
 }
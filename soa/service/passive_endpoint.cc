@@ -10,6 +10,8 @@
 #include "jml/arch/futex.h"
 #include "soa/service//passive_endpoint.h"
 #include <poll.h>
+#include <sys/socket.h>
+#include <fcntl.h>
 #include <boost/date_time/gregorian/gregorian.hpp>
 
 using namespace std;
@@ -25,7 +27,7 @@ namespace Datacratic {
 
 PassiveEndpoint::
 PassiveEndpoint(const std::string & name)
-    : EndpointBase(name)
+    : EndpointBase(name), reusePortAccept(false)
 {
 }
 
@@ -55,9 +57,66 @@ init(PortRange const & portRange, const std::string & hostname, int num_threads,
 /* ACCEPTOR FOR SOCKETTRANSPORT                                              */
 /*****************************************************************************/
 
+namespace {
+
+int openListenSocket(bool reusePort)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == -1)
+        throw Exception(errno, "socket");
+
+    // Avoid already bound messages for the minute after a server has exited
+    int tr = 1;
+    int res = setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &tr, sizeof(int));
+    if (res != -1 && reusePort)
+        res = setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &tr, sizeof(int));
+
+    if (res == -1) {
+        int err = errno;
+        close(fd);
+        throw Exception("error setsockopt %s: %s",
+                        reusePort ? "SO_REUSEPORT" : "SO_REUSEADDR",
+                        strerror(err));
+    }
+
+    return fd;
+}
+
+struct NameEntry {
+    NameEntry(const string & name)
+        : name_(name), date_(Date::now())
+        {}
+
+    string name_;
+    Date date_;
+};
+
+} // file scope
+
+/** Cache of the names of the peers, to avoid doing a lookup for each
+    connection.  Owned by a single thread.
+*/
+struct AcceptorT<SocketTransport>::NameCache {
+    unordered_map<string, NameEntry> addr2Name;
+};
+
+struct AcceptorT<SocketTransport>::ListenSocket {
+    ListenSocket(int fd)
+        : fd(fd),
+          epollData(new EndpointBase::EpollData
+                    (EndpointBase::EpollData::EpollDataType::ACCEPT, fd))
+    {
+    }
+
+    int fd;
+    std::shared_ptr<EndpointBase::EpollData> epollData;
+    NameCache names;
+};
+
 AcceptorT<SocketTransport>::
 AcceptorT()
-    : fd(-1), endpoint(0), listening_(false)
+    : fd(-1), endpoint(0), listening_(false), shutdown(false),
+      acceptsInProgress(0)
 {
 }
 
@@ -78,19 +137,17 @@ listen(PortRange const & portRange,
     closePeer();
     
     this->endpoint = endpoint;
-    this->nameLookup = nameLookup;
+    // The connections are accepted from the event threads, which can't
+    // afford to block on a reverse lookup: peers go by their address.
+    this->nameLookup = nameLookup && !endpoint->reusePortAccept;
 
-    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (endpoint->reusePortAccept)
+        return listenReusePort(portRange, hostname, backlog);
 
-    // Avoid already bound messages for the minute after a server has exited
-    int tr = 1;
-    int res = setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &tr, sizeof(int));
+    fd = openListenSocket(false);
 
-    if (res == -1) {
-        close(fd);
-        fd = -1;
-        throw Exception("error setsockopt SO_REUSEADDR: %s", strerror(errno));
-    }
+    int tr = 1;
+    int res;
 
     const char * hostNameToUse
         = (hostname == "*" ? "0.0.0.0" : hostname.c_str());
@@ -153,10 +210,238 @@ listen(PortRange const & portRange,
     return port;
 }
 
+int
+AcceptorT<SocketTransport>::
+listenReusePort(PortRange const & portRange,
+                const std::string & hostname,
+                int backlog)
+{
+    int numSockets = std::max(endpoint->numEventThreads(), 1);
+
+    const char * hostNameToUse
+        = (hostname == "*" ? "0.0.0.0" : hostname.c_str());
+
+    vector<int> fds;
+    auto closeAll = [&] ()
+        {
+            for (int fd: fds)
+                close(fd);
+            fds.clear();
+        };
+
+    int port = portRange.bindPort
+        ([&](int port)
+         {
+             addr = ACE_INET_Addr(port, hostNameToUse, AF_INET);
+
+             // Skip the ports that are in use, including by the
+             // SO_REUSEPORT sockets of another process that we would
+             // otherwise share the port with
+             if (port != 0) {
+                 int probe = openListenSocket(false);
+                 int res = ::bind(probe,
+                                  reinterpret_cast<sockaddr *>(addr.get_addr()),
+                                  addr.get_addr_size());
+                 int err = errno;
+                 close(probe);
+                 if (res == -1 && err != EADDRINUSE)
+                     throw Exception("listen: bind returned %s",
+                                     strerror(err));
+                 if (res == -1)
+                     return false;
+             }
+
+             for (int i = 0;  i < numSockets;  ++i) {
+                 int fd = openListenSocket(true);
+                 fds.push_back(fd);
+
+                 int res = ::bind(fd,
+                                  reinterpret_cast<sockaddr *>(addr.get_addr()),
+                                  addr.get_addr_size());
+                 if (res == -1) {
+                     int err = errno;
+                     closeAll();
+                     if (err != EADDRINUSE)
+                         throw Exception("listen: bind returned %s",
+                                         strerror(err));
+                     return false;
+                 }
+
+                 // The other sockets go to the port we were given
+                 if (addr.get_port_number() == 0) {
+                     sockaddr_in inAddr;
+                     socklen_t inAddrLen = sizeof(inAddr);
+                     res = ::getsockname(fd, (sockaddr *) &inAddr, &inAddrLen);
+                     if (res == -1) {
+                         closeAll();
+                         throw Exception(errno, "getsockname");
+                     }
+                     addr.set(&inAddr, inAddrLen);
+                 }
+             }
+             return true;
+         });
+
+    if (port == -1) {
+        throw Exception("couldn't bind to any port in range [%d,%d]", portRange.first,
+                                                            portRange.last);
+    }
+    port = addr.get_port_number();
+
+    for (int fd: fds) {
+        int res = ::listen(fd, backlog);
+        if (res != -1)
+            res = fcntl(fd, F_SETFL, O_NONBLOCK);
+        if (res == -1) {
+            int err = errno;
+            closeAll();
+            throw Exception("error on listen: %s", strerror(err));
+        }
+    }
+
+    shutdown = false;
+
+    for (int fd: fds) {
+        auto socket = std::make_shared<ListenSocket>(fd);
+        ListenSocket * socketPtr = socket.get();
+        socket->epollData->onAccept = [=] ()
+            {
+                this->acceptFromEventThread(*socketPtr);
+            };
+        listenSockets.push_back(socket);
+        endpoint->startPolling(socket->epollData);
+    }
+
+    listening_ = true;
+    ML::futex_wake(listening_);
+
+    return port;
+}
+
+void
+AcceptorT<SocketTransport>::
+acceptFromEventThread(ListenSocket & socket)
+{
+    ML::atomic_inc(acceptsInProgress);
+
+    if (!shutdown) {
+        try {
+            // Accept a bounded number of connections per wakeup so that
+            // this thread gets back to the transports it is serving
+            for (unsigned i = 0;  i < 64;  ++i) {
+                sockaddr_in connAddr;
+                socklen_t connAddrLen = sizeof(connAddr);
+                int res = accept(socket.fd, (sockaddr *)&connAddr,
+                                 &connAddrLen);
+
+                if (res == -1 && errno == EINTR)
+                    continue;
+                if (res == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                    break;
+                if (res == -1) {
+                    endpoint->acceptError(format("accept: %s",
+                                                 strerror(errno)));
+                    break;
+                }
+
+                newConnection(res, connAddr, connAddrLen, socket.names);
+            }
+        } catch (const std::exception & exc) {
+            endpoint->acceptError(exc.what());
+        }
+
+        endpoint->restartPolling(socket.epollData.get());
+    }
+
+    ML::atomic_dec(acceptsInProgress);
+    ML::futex_wake(acceptsInProgress);
+}
+
+void
+AcceptorT<SocketTransport>::
+newConnection(int connFd, sockaddr_in & connAddr, socklen_t connAddrLen,
+              NameCache & names)
+{
+    auto & addr2Name = names.addr2Name;
+
+    ACE_INET_Addr addr2(&connAddr, connAddrLen);
+
+#if 0
+    ptime now = second_clock::universal_time();
+
+    cerr << boost::this_thread::get_id() << ":"<<to_iso_extended_string(now) << ":accept succeeded from "
+         << addr2.get_host_addr() << ":" << addr2.get_port_number()
+         << " (" << addr2.get_host_name() << ")"
+         << " for endpoint " << endpoint->name() << " res = " << connFd
+         << " pointer " << endpoint << endl;
+#endif
+    std::shared_ptr<SocketTransport> newTransport
+        (new SocketTransport(this->endpoint));
+
+    newTransport->peer_ = ACE_SOCK_Stream(connFd);
+    string peerName = addr2.get_host_addr();
+    if (nameLookup) {
+        auto it = addr2Name.find(peerName);
+        if (it == addr2Name.end()) {
+            string addr = peerName;
+            peerName = addr2.get_host_name();
+            addr2Name.insert({addr, NameEntry(peerName)});
+        }
+        else {
+            peerName = it->second.name_;
+        }
+    }
+
+    if (peerName == "<unknown>")
+        peerName = addr2.get_host_addr();
+    newTransport->peerName_ = peerName;
+    endpoint->associateHandler(newTransport);
+
+    /* cleanup name entries older than 5 seconds */
+    Date now = Date::now();
+    auto it = addr2Name.begin();
+    while (it != addr2Name.end()) {
+        const NameEntry & entry = it->second;
+        if (entry.date_.plusSeconds(5) < now) {
+            it = addr2Name.erase(it);
+        }
+        else {
+            it++;
+        }
+    }
+}
+
 void
 AcceptorT<SocketTransport>::
 closePeer()
 {
+    if (!listenSockets.empty()) {
+        shutdown = true;
+
+        ML::memory_barrier();
+
+        /* The event threads that are accepting see that we're shutting
+           down once done and won't restart the polling */
+        for (;;) {
+            int oldValue = acceptsInProgress;
+            if (oldValue == 0) break;
+            ML::futex_wait(acceptsInProgress, oldValue);
+        }
+
+        for (auto & socket: listenSockets) {
+            endpoint->stopPolling(socket->epollData);
+            close(socket->fd);
+            socket->fd = -1;
+        }
+
+        /* An event thread may still be about to look at their epoll data */
+        closedListenSockets.insert(closedListenSockets.end(),
+                                   listenSockets.begin(),
+                                   listenSockets.end());
+        listenSockets.clear();
+        return;
+    }
+
     if (!acceptThread) return;
     shutdown = true;
 
@@ -189,21 +474,12 @@ port() const
     return addr.get_port_number();
 }
 
-struct NameEntry {
-    NameEntry(const string & name)
-        : name_(name), date_(Date::now())
-        {}
-
-    string name_;
-    Date date_;
-};
-
 void
 AcceptorT<SocketTransport>::
 runAcceptThread()
 {
     //static const char *fName = "AcceptorT<SocketTransport>::runAcceptThread:";
-    unordered_map<string,NameEntry> addr2Name;
+    NameCache names;
 
     int res = fcntl(fd, F_SETFL, O_NONBLOCK);
     if (res != 0) {
@@ -251,62 +527,12 @@ runAcceptThread()
 
         if (res == -1 && errno == EINTR) continue;
 
-        if (res == -1)
+        if (res == -1) {
             endpoint->acceptError(format("accept: %s", strerror(errno)));
-
-#if 0
-        union {
-            char octets[4];
-            uint32_t addr;
-        } a;
-        a.addr = addr.sin_addr;
-#endif
-
-        ACE_INET_Addr addr2(&addr, addr_len);
-
-#if 0
-        ptime now = second_clock::universal_time();
-
-        cerr << boost::this_thread::get_id() << ":"<<to_iso_extended_string(now) << ":accept succeeded from "
-             << addr2.get_host_addr() << ":" << addr2.get_port_number()
-             << " (" << addr2.get_host_name() << ")"
-             << " for endpoint " << endpoint->name() << " res = " << res
-             << " pointer " << endpoint << endl;
-#endif
-        std::shared_ptr<SocketTransport> newTransport
-            (new SocketTransport(this->endpoint));
-
-        newTransport->peer_ = ACE_SOCK_Stream(res);
-        string peerName = addr2.get_host_addr();
-        if (nameLookup) {
-            auto it = addr2Name.find(peerName);
-            if (it == addr2Name.end()) {
-                string addr = peerName;
-                peerName = addr2.get_host_name();
-                addr2Name.insert({addr, NameEntry(peerName)});
-            }
-            else {
-                peerName = it->second.name_;
-            }
+            continue;
         }
 
-        if (peerName == "<unknown>")
-            peerName = addr2.get_host_addr();
-        newTransport->peerName_ = peerName;
-        endpoint->associateHandler(newTransport);
-
-        /* cleanup name entries older than 5 seconds */
-        Date now = Date::now();
-        auto it = addr2Name.begin();
-        while (it != addr2Name.end()) {
-            const NameEntry & entry = it->second;
-            if (entry.date_.plusSeconds(5) < now) {
-                it = addr2Name.erase(it);
-            }
-            else {
-                it++;
-            }
-        }
+        newConnection(res, addr, addr_len, names);
     }
 }
 
@@ -10,6 +10,7 @@
 #include "soa/service/endpoint.h"
 #include "soa/service/port_range_service.h"
 #include "jml/arch/wakeup_fd.h"
+#include <netinet/in.h>
 
 namespace Datacratic {
 
@@ -126,6 +127,16 @@ struct PassiveEndpoint: public EndpointBase {
 
     /** Object that can be overridden to deal with an accept error. */
     boost::function<void (std::string)> onAcceptError;
+
+    /** Accept the connections from the event threads instead of from a
+        dedicated accept thread.  Each event thread gets its own
+        SO_REUSEPORT listening socket on the port, so that the kernel
+        spreads the incoming connections over them and a storm of
+        connections is accepted in parallel.  The peer names are then
+        left as numeric addresses whatever nameLookup says, as the reverse
+        lookup would block the event thread.  Must be set before listen().
+    */
+    bool reusePortAccept;
     
 protected:
 
@@ -214,6 +225,25 @@ struct AcceptorT<SocketTransport> : public Acceptor {
     void waitListening() const;
 
 protected:
+    struct NameCache;
+    struct ListenSocket;
+
+    /** Listen with one SO_REUSEPORT socket per event thread of the
+        endpoint.  See PassiveEndpoint::reusePortAccept.
+    */
+    int listenReusePort(PortRange const & portRange,
+                        const std::string & hostname,
+                        int backlog);
+
+    /** Accept the pending connections of the given listening socket from
+        an event thread, and restart its polling.
+    */
+    void acceptFromEventThread(ListenSocket & socket);
+
+    /** Create the transport for a connection that was just accepted. */
+    void newConnection(int connFd, sockaddr_in & connAddr,
+                       socklen_t connAddrLen, NameCache & names);
+
     std::shared_ptr<boost::thread> acceptThread;
     ML::Wakeup_Fd wakeup;
     ACE_INET_Addr addr;
@@ -222,6 +252,12 @@ protected:
     int listening_; // whether the socket is listening
     bool nameLookup;
     bool shutdown;
+
+    /* SO_REUSEPORT mode: the sockets being listened to, and those that were
+       closed but may still be referred to by an event in flight */
+    std::vector<std::shared_ptr<ListenSocket> > listenSockets;
+    std::vector<std::shared_ptr<ListenSocket> > closedListenSockets;
+    int acceptsInProgress;
 };
 
 
@@ -86,6 +86,16 @@ onEvent(const std::string & name,
     stats->record(name + "." + event, type, value);
 }
 
+void
+NullEventService::
+onInternedEvent(const std::string & fullName,
+                StatEventType type,
+                float value,
+                std::initializer_list<int>)
+{
+    stats->record(fullName, type, value);
+}
+
 void
 NullEventService::
 dump(std::ostream & stream) const
@@ -142,6 +152,16 @@ onEvent(const std::string & name,
     connector->record(stat, type, value, extra);
 }
 
+void
+CarbonEventService::
+onInternedEvent(const std::string & fullName,
+                StatEventType type,
+                float value,
+                std::initializer_list<int> extra)
+{
+    connector->record(fullName, type, value, extra);
+}
+
 
 /*****************************************************************************/
 /* CONFIGURATION SERVICE                                                     */
@@ -204,7 +224,7 @@ getJson(const std::string & key, Watch watch)
     if (!entry)
         return Json::Value();
 
-    entry->watch = watch;
+    if (watch) entry->watch = watch;
     return entry->value;
 }
     
@@ -213,14 +233,16 @@ InternalConfigurationService::
 set(const std::string & key,
     const Json::Value & value)
 {
-    Guard guard(lock);
-    Entry & node = createNode(root, key);
-    node.hasValue = true;
-    node.value = value;
-    if (node.watch) {
-        node.watch.trigger(key, VALUE_CHANGED);
-        node.watch = Watch();
+    std::vector<Trigger> triggers;
+    {
+        Guard guard(lock);
+        Entry & node = createNode(root, "", key, triggers);
+        node.hasValue = true;
+        node.value = value;
+        if (node.watch)
+            triggers.push_back(Trigger{ std::move(node.watch), key, VALUE_CHANGED });
     }
+    fire(triggers);
 }
 
 std::string
@@ -228,24 +250,30 @@ InternalConfigurationService::
 setUnique(const std::string & key_,
           const Json::Value & value)
 {
-    Guard guard(lock);
+    std::vector<Trigger> triggers;
+    string key;
+    {
+        Guard guard(lock);
 
-    int r = 0;
+        int r = 0;
 
-    for (;; r = random()) {
-        string key = key_;
-        if (r != 0)
-            key += ":" + to_string(r);
-        
-        Entry & node = createNode(root, key);
-        if (node.hasValue)
-            continue;
-        
-        node.hasValue = true;
-        node.value = value;
-        
-        return key;
+        for (;; r = random()) {
+            key = key_;
+            if (r != 0)
+                key += ":" + to_string(r);
+
+            Entry & node = createNode(root, "", key, triggers);
+            if (node.hasValue)
+                continue;
+
+            node.hasValue = true;
+            node.value = value;
+            break;
+        }
     }
+    fire(triggers);
+
+    return key;
 }
 
 std::vector<std::string>
@@ -260,7 +288,7 @@ getChildren(const std::string & key,
     if (node) {
         for (auto & ch: node->children)
             result.push_back(ch.first);
-        node->watch = watch;
+        if (watch) node->watch = watch;
     }
     return result;
 }
@@ -293,7 +321,8 @@ forEachEntry(const OnEntry & onEntry,
 
 InternalConfigurationService::Entry &
 InternalConfigurationService::
-createNode(Entry & node, const std::string & key)
+createNode(Entry & node, const std::string & path, const std::string & key,
+           std::vector<Trigger> & triggers)
 {
     if (key == "")
         return node;
@@ -301,17 +330,37 @@ createNode(Entry & node, const std::string & key)
     string root, leaf;
     std::tie(root, leaf) = splitPath(key);
 
-    bool existed = node.children.count(root);
-
     shared_ptr<Entry> & entryPtr = node.children[root];
-    if (!entryPtr)
+    if (!entryPtr) {
         entryPtr.reset(new Entry());
-    else if (entryPtr->watch && !existed) {
-        entryPtr->watch.trigger(key, VALUE_CHANGED);
-        entryPtr->watch = Watch();
+
+        // Whoever listed the children of this node wants to hear about it
+        if (node.watch)
+            triggers.push_back(Trigger{ std::move(node.watch), path, NEW_CHILD });
     }
 
-    return createNode(*entryPtr, leaf);
+    return createNode(*entryPtr, path.empty() ? root : path + "/" + root,
+                      leaf, triggers);
+}
+
+void
+InternalConfigurationService::
+removeNode(Entry & node, const std::string & path,
+           std::vector<Trigger> & triggers)
+{
+    if (node.watch)
+        triggers.push_back(Trigger{ std::move(node.watch), path, DELETED });
+
+    for (auto & ch: node.children)
+        removeNode(*ch.second, path + "/" + ch.first, triggers);
+}
+
+void
+InternalConfigurationService::
+fire(std::vector<Trigger> & triggers)
+{
+    for (auto & trigger: triggers)
+        trigger.watch.trigger(trigger.path, trigger.change);
 }
 
 const InternalConfigurationService::Entry *
@@ -356,17 +405,33 @@ void
 InternalConfigurationService::
 removePath(const std::string & key)
 {
+    // The leaf is the last component of the path, not the first
     string path, leaf;
-    std::tie(path, leaf) = splitPath(key);
+    string::size_type pos = key.rfind('/');
+    if (pos != string::npos) {
+        path = string(key, 0, pos);
+        leaf = string(key, pos + 1);
+    }
+    else leaf = key;
 
-    Guard guard(lock);
-    Entry * parent = getNode(root, path);
-    if (!parent)
-        return;
+    std::vector<Trigger> triggers;
+    {
+        Guard guard(lock);
+        Entry * parent = getNode(root, path);
+        if (!parent)
+            return;
+
+        auto it = parent->children.find(leaf);
+        if (it == parent->children.end())
+            return;
 
-    // TODO: listeners for onChange, both here and children
+        removeNode(*it->second, key, triggers);
+        parent->children.erase(it);
 
-    parent->children.erase(leaf);
+        if (parent->watch)
+            triggers.push_back(Trigger{ std::move(parent->watch), path, NEW_CHILD });
+    }
+    fire(triggers);
 }
 
 /*****************************************************************************/
@@ -681,6 +746,15 @@ EventRecorder(const std::string & eventPrefix,
 {
 }
 
+std::string
+EventRecorder::
+internEvent(const std::string & event) const
+{
+    if (eventPrefix_.empty())
+        return event;
+    return eventPrefix_ + "." + event;
+}
+
 void
 EventRecorder::
 recordEventFmt(StatEventType type,
@@ -758,7 +832,9 @@ registerServiceProvider(const std::string & name,
         json["serviceName"] = name;
         json["serviceLocation"] = services_->config->currentLocation;
         json["servicePath"] = name;
-        services_->config->setUnique("serviceClass/" + cl + "/" + name, json);
+
+        string path = "serviceClass/" + cl + "/" + name;
+        providerKeys_[path] = services_->config->setUnique(path, json);
     }
 }
 
@@ -766,15 +842,18 @@ void
 ServiceBase::
 registerShardedServiceProvider(const std::string & name,
                                const std::vector<std::string> & serviceClasses,
-                               size_t shardIndex)
+                               size_t shardIndex,
+                               const Json::Value & attributes)
 {
     for (auto cl: serviceClasses) {
-        Json::Value json;
+        Json::Value json = attributes.isNull() ? Json::Value(Json::objectValue) : attributes;
         json["serviceName"] = name;
         json["serviceLocation"] = services_->config->currentLocation;
         json["servicePath"] = name;
         json["shardIndex"] = shardIndex;
-        services_->config->setUnique("serviceClass/" + cl + "/" + name, json);
+
+        string path = "serviceClass/" + cl + "/" + name;
+        providerKeys_[path] = services_->config->setUnique(path, json);
     }
 }
 
@@ -784,7 +863,16 @@ unregisterServiceProvider(const std::string & name,
                           const std::vector<std::string> & serviceClasses)
 {
     for (auto cl: serviceClasses) {
-        services_->config->removePath("serviceClass/" + cl + "/" + name);
+        string path = "serviceClass/" + cl + "/" + name;
+
+        // Only what this service registered; the plain path may belong to
+        // another instance running under the same name.
+        auto it = providerKeys_.find(path);
+        if (it == providerKeys_.end()) continue;
+
+        if (!it->second.empty())
+            services_->config->removePath(it->second);
+        providerKeys_.erase(it);
     }
 }
 
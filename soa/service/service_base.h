@@ -52,6 +52,18 @@ struct EventService {
                          float value,
                          std::initializer_list<int> extra = DefaultOutcomePercentiles) = 0;
 
+    /** Notify of an event whose full name, prefix included, was built
+        beforehand by EventRecorder::internEvent().  The default passes it
+        on to onEvent() with an empty prefix.
+    */
+    virtual void onInternedEvent(const std::string & fullName,
+                                 StatEventType type,
+                                 float value,
+                                 std::initializer_list<int> extra = DefaultOutcomePercentiles)
+    {
+        onEvent("", fullName.c_str(), type, value, extra);
+    }
+
     virtual void dump(std::ostream & stream) const
     {
     }
@@ -76,6 +88,11 @@ struct NullEventService : public EventService {
                          float value,
                          std::initializer_list<int> extra = DefaultOutcomePercentiles);
 
+    virtual void onInternedEvent(const std::string & fullName,
+                                 StatEventType type,
+                                 float value,
+                                 std::initializer_list<int> extra = DefaultOutcomePercentiles);
+
     virtual void dump(std::ostream & stream) const;
 
     std::unique_ptr<MultiAggregator> stats;
@@ -102,6 +119,11 @@ struct CarbonEventService : public EventService {
                          float value,
                          std::initializer_list<int> extra = std::initializer_list<int>());
 
+    virtual void onInternedEvent(const std::string & fullName,
+                                 StatEventType type,
+                                 float value,
+                                 std::initializer_list<int> extra = std::initializer_list<int>());
+
     std::shared_ptr<CarbonConnector> connector;
 };
 
@@ -197,7 +219,7 @@ struct ConfigurationService {
         {
             if (!data)
                 throw ML::Exception("triggered unused watch");
-            if (!(data->watchReferences <= 0))
+            if (data->watchReferences <= 0)
                 return;
             ExcAssert(data);
             data->onChange(path, change);
@@ -347,7 +369,22 @@ private:
         std::unordered_map<std::string, std::shared_ptr<Entry> > children;
     };
 
-    Entry & createNode(Entry & node, const std::string & key);
+    /** A watch that fired while the lock was held.  They're triggered once
+        it's released so that their callbacks are free to call back into
+        the service from any thread.
+    */
+    struct Trigger {
+        Watch watch;
+        std::string path;
+        ChangeType change;
+    };
+
+    Entry & createNode(Entry & node, const std::string & path,
+                       const std::string & key,
+                       std::vector<Trigger> & triggers);
+    void removeNode(Entry & node, const std::string & path,
+                    std::vector<Trigger> & triggers);
+    static void fire(std::vector<Trigger> & triggers);
     const Entry * getNode(const Entry & node, const std::string & key) const;
     Entry * getNode(Entry & node, const std::string & key);
 
@@ -475,17 +512,25 @@ struct EventRecorder {
                      float value = 1.0,
                      std::initializer_list<int> extra = DefaultOutcomePercentiles) const
     {
-        EventService * es = 0;
-        if (events_)
-            es = events_.get();
-        if (!es && services_)
-            es = services_->events.get();
-        if (!es)
-        {
-            std::cerr << "no services configured!!!!" << std::endl;
-            return;
-        }
-        es->onEvent(eventPrefix_, eventName, type, value, extra);
+        if (EventService * es = eventService())
+            es->onEvent(eventPrefix_, eventName, type, value, extra);
+    }
+
+    /** Return the full name, prefix included, under which the given event
+        is recorded.  Events that are recorded on every request should be
+        interned once up front and recorded with recordInterned(), which
+        doesn't need to build their name each time.
+    */
+    std::string internEvent(const std::string & event) const;
+
+    /** Notify that an event interned with internEvent() has happened. */
+    void recordInterned(const std::string & fullName,
+                        StatEventType type = ET_COUNT,
+                        float value = 1.0,
+                        std::initializer_list<int> extra = DefaultOutcomePercentiles) const
+    {
+        if (EventService * es = eventService())
+            es->onInternedEvent(fullName, type, value, extra);
     }
 
     void recordEventFmt(StatEventType type,
@@ -645,6 +690,18 @@ struct EventRecorder {
     }
 
 protected:
+    EventService * eventService() const
+    {
+        EventService * es = 0;
+        if (events_)
+            es = events_.get();
+        if (!es && services_)
+            es = services_->events.get();
+        if (!es)
+            std::cerr << "no services configured!!!!" << std::endl;
+        return es;
+    }
+
     std::string eventPrefix_;
     std::shared_ptr<EventService> events_;
     std::shared_ptr<ServiceProxies> services_;
@@ -695,11 +752,20 @@ struct ServiceBase: public EventRecorder {
     void registerServiceProvider(const std::string & name,
                                  const std::vector<std::string> & serviceClasses);
 
+    /** Same as registerServiceProvider() but also advertises the index of
+        the shard handled by this service along with any extra attributes
+        that the consumers of the service class may need.
+    */
     void registerShardedServiceProvider(const std::string & name,
                                         const std::vector<std::string> & serviceClasses,
-                                        size_t shardIndex);
+                                        size_t shardIndex,
+                                        const Json::Value & attributes = Json::Value());
 
-    /** Unregister service from configuration service. */
+    /** Unregister service from configuration service.  Removes the keys
+        that this service's registration was actually written under, which
+        may have had a suffix added to keep them unique; calling it again or
+        for classes that weren't registered does nothing.
+    */
 
     void unregisterServiceProvider(const std::string & name,
                                    const std::vector<std::string> & serviceClasses);
@@ -757,6 +823,12 @@ protected:
     std::string serviceName_;
     ServiceBase * parent_;
     std::vector<ServiceBase *> children_;
+
+private:
+    /** Key returned by setUnique() for each service provider registration,
+        keyed by the path that was asked for.
+    */
+    std::map<std::string, std::string> providerKeys_;
 };
 
 
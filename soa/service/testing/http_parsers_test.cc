@@ -2,9 +2,11 @@
 #define BOOST_TEST_DYN_LINK
 
 #include <iostream>
+#include <memory>
 #include <boost/test/unit_test.hpp>
 
 #include "soa/service/http_parsers.h"
+#include "soa/service/http_header.h"
 #include "soa/utils/print_utils.h"
 
 using namespace std;
@@ -255,3 +257,314 @@ BOOST_AUTO_TEST_CASE( http_parser_chunked_encoding_test )
     BOOST_CHECK_EQUAL(numResponses, 3);
 }
 #endif
+
+#if 1
+/* Progressive testing of the HttpRequestParser, similar to the one of the
+ * HttpResponseParser above. */
+BOOST_AUTO_TEST_CASE( http_request_parser_test )
+{
+    string requestLine;
+    vector<string> headers;
+    string body;
+    bool headersDone;
+    bool done;
+    bool shouldClose;
+
+    HttpRequestParser parser;
+    parser.onRequestStart = [&] (const char * verb, size_t verbSize,
+                                 const char * resource, size_t resourceSize,
+                                 const char * version, size_t versionSize) {
+        requestLine = (string(verb, verbSize) + "|"
+                       + string(resource, resourceSize) + "|"
+                       + string(version, versionSize));
+        headers.clear();
+        body.clear();
+        headersDone = false;
+        done = false;
+    };
+    parser.onHeader = [&] (const char * name, size_t nameSize,
+                           const char * value, size_t valueSize) {
+        headers.emplace_back(string(name, nameSize) + "="
+                             + string(value, valueSize));
+    };
+    parser.onHeadersDone = [&] () {
+        headersDone = true;
+    };
+    parser.onData = [&] (const char * data, size_t size) {
+        body.append(data, size);
+    };
+    parser.onDone = [&] (bool doClose) {
+        shouldClose = doClose;
+        done = true;
+    };
+
+    /* request line */
+    parser.feed("PO");
+    BOOST_CHECK_EQUAL(requestLine, "");
+    parser.feed("ST /auct");
+    BOOST_CHECK_EQUAL(requestLine, "");
+    parser.feed("ions?a=1 HTTP/1.1\r");
+    BOOST_CHECK_EQUAL(requestLine, "");
+    parser.feed("\n");
+    BOOST_CHECK_EQUAL(requestLine, "POST|/auctions?a=1|HTTP/1.1");
+
+    /* headers */
+    parser.feed("Head");
+    BOOST_CHECK_EQUAL(headers.size(), 0);
+    parser.feed("er1:  value1 \r\nContent-Length: 10\r\n");
+    BOOST_CHECK_EQUAL(headers.size(), 2);
+    BOOST_CHECK_EQUAL(headers[0], "Header1=value1");
+    BOOST_CHECK_EQUAL(headers[1], "Content-Length=10");
+    BOOST_CHECK_EQUAL(headersDone, false);
+    parser.feed("\r\n");
+    BOOST_CHECK_EQUAL(headersDone, true);
+    BOOST_CHECK_EQUAL(parser.remainingBody(), 10);
+
+    /* body */
+    parser.feed("0123");
+    parser.feed("456");
+    BOOST_CHECK_EQUAL(done, false);
+    parser.feed("789");
+    BOOST_CHECK_EQUAL(body, "0123456789");
+    BOOST_CHECK_EQUAL(done, true);
+    BOOST_CHECK_EQUAL(shouldClose, false);
+    BOOST_CHECK_EQUAL(parser.buffered(), 0);
+
+    /* one full request without body and a partial one */
+    parser.feed("GET /ready HTTP/1.1\r\n"
+                "Connection: close\r\n\r\nGET /rea");
+    BOOST_CHECK_EQUAL(requestLine, "GET|/ready|HTTP/1.1");
+    BOOST_CHECK_EQUAL(headers.size(), 1);
+    BOOST_CHECK_EQUAL(body, "");
+    BOOST_CHECK_EQUAL(done, true);
+    BOOST_CHECK_EQUAL(shouldClose, true);
+    BOOST_CHECK_EQUAL(parser.buffered(), 8);
+
+    /* HTTP/1.0 closes by default */
+    parser.feed("dy HTTP/1.0\r\n\r\n");
+    BOOST_CHECK_EQUAL(requestLine, "GET|/ready|HTTP/1.0");
+    BOOST_CHECK_EQUAL(done, true);
+    BOOST_CHECK_EQUAL(shouldClose, true);
+    BOOST_CHECK_EQUAL(parser.buffered(), 0);
+
+    /* chunked body, with the chunks split over several feeds */
+    parser.feed("POST /auctions HTTP/1.1\r\n"
+                "Transfer-Encoding: chunked\r\n"
+                "\r\n"
+                "5;ext=1\r\n012");
+    BOOST_CHECK_EQUAL(body, "012");
+    parser.feed("34\r");
+    parser.feed("\na\r\n56789abcde\r\n0\r\n");
+    BOOST_CHECK_EQUAL(body, "0123456789abcde");
+    BOOST_CHECK_EQUAL(done, false);
+    parser.feed("Trailer: x\r\n\r\n");
+    BOOST_CHECK_EQUAL(done, true);
+
+    /* errors */
+    {
+        HttpRequestParser parser;
+        BOOST_CHECK_THROW(parser.feed("GET /\r\n"), ML::Exception);
+    }
+    {
+        HttpRequestParser parser;
+        BOOST_CHECK_THROW(parser.feed("GET / FTP/1.1\r\n"), ML::Exception);
+    }
+    {
+        HttpRequestParser parser;
+        BOOST_CHECK_THROW(parser.feed("POST / HTTP/1.1\r\n"
+                                      "Content-Length: 1x\r\n"),
+                          ML::Exception);
+    }
+    {
+        HttpRequestParser parser;
+        string longHeader("GET / HTTP/1.1\r\nHeader: ");
+        longHeader.append(HttpRequestParser::MaxHeaderSize, 'x');
+        BOOST_CHECK_THROW(parser.feed(longHeader.c_str(), longHeader.size()),
+                          ML::Exception);
+    }
+}
+#endif
+
+#if 1
+/* Ensures that pipelined requests are held while the parser is paused, and
+ * that an HttpHeader refilled from one request to the next doesn't keep the
+ * headers of the previous one. */
+BOOST_AUTO_TEST_CASE( http_request_parser_pipelining_test )
+{
+    HttpRequestParser parser;
+    parser.setPauseAfterRequest(true);
+
+    HttpHeader header;
+    string payload;
+    int numRequests(0);
+
+    parser.onRequestStart = [&] (const char * verb, size_t verbSize,
+                                 const char * resource, size_t resourceSize,
+                                 const char * version, size_t versionSize) {
+        header.startRequest(verb, verbSize, resource, resourceSize,
+                            version, versionSize);
+        payload.clear();
+    };
+    parser.onHeader = [&] (const char * name, size_t nameSize,
+                           const char * value, size_t valueSize) {
+        header.addHeader(name, nameSize, value, valueSize);
+    };
+    parser.onHeadersDone = [&] () {
+        header.finishHeaders();
+    };
+    parser.onData = [&] (const char * data, size_t size) {
+        payload.append(data, size);
+    };
+    parser.onDone = [&] (bool doClose) {
+        numRequests++;
+    };
+
+    parser.feed("POST /auctions?x=a%20b&y HTTP/1.1\r\n"
+                "X-Openrtb-Version: 2.1\r\n"
+                "X-Other: 1\r\n"
+                "Content-Type: application/json\r\n"
+                "Content-Length: 2\r\n"
+                "\r\n"
+                "{}"
+                "POST /auctions HTTP/1.1\r\n"
+                "x-openrtb-version: 2.2\r\n"
+                "Content-Length: 3\r\n"
+                "\r\n"
+                "[]");
+
+    BOOST_CHECK_EQUAL(numRequests, 1);
+    BOOST_CHECK(parser.paused());
+    BOOST_CHECK_EQUAL(header.verb, "POST");
+    BOOST_CHECK_EQUAL(header.resource, "/auctions");
+    BOOST_CHECK_EQUAL(header.queryParams.size(), 2);
+    BOOST_CHECK_EQUAL(header.queryParams.getValue("x"), "a b");
+    BOOST_CHECK_EQUAL(header.contentType, "application/json");
+    BOOST_CHECK_EQUAL(header.contentLength, 2);
+    BOOST_CHECK_EQUAL(header.headers.size(), 2);
+    BOOST_CHECK_EQUAL(header.getHeader("x-openrtb-version"), "2.1");
+    BOOST_CHECK_EQUAL(payload, "{}");
+
+    /* data fed while paused is held */
+    parser.feed(" ");
+    BOOST_CHECK_EQUAL(numRequests, 1);
+
+    parser.resume();
+    BOOST_CHECK_EQUAL(numRequests, 2);
+    BOOST_CHECK_EQUAL(header.queryParams.size(), 0);
+    BOOST_CHECK_EQUAL(header.contentType, "");
+    BOOST_CHECK_EQUAL(header.headers.size(), 1);
+    BOOST_CHECK_EQUAL(header.getHeader("x-openrtb-version"), "2.2");
+    BOOST_CHECK_EQUAL(header.tryGetHeader("x-other"), "");
+    BOOST_CHECK_EQUAL(payload, "[] ");
+    BOOST_CHECK_EQUAL(parser.buffered(), 0);
+}
+#endif
+
+#if 1
+/* Ensures that the bodies larger than the maximum are rejected before any of
+ * their data is reported, whether their size is announced upfront or by
+ * their chunks. */
+BOOST_AUTO_TEST_CASE( http_request_parser_max_body_size_test )
+{
+    auto makeParser = [] (HttpRequestParser & parser, string & body,
+                          uint64_t & tooLarge, int & numDone) {
+        parser.setMaxBodySize(10);
+        parser.onData = [&] (const char * data, size_t size) {
+            body.append(data, size);
+        };
+        parser.onBodyTooLarge = [&] (uint64_t size) {
+            tooLarge = size;
+        };
+        parser.onDone = [&] (bool) {
+            numDone++;
+        };
+    };
+
+    /* at the limit */
+    {
+        HttpRequestParser parser;
+        string body;
+        uint64_t tooLarge(0);
+        int numDone(0);
+        makeParser(parser, body, tooLarge, numDone);
+
+        parser.feed("POST / HTTP/1.1\r\nContent-Length: 10\r\n\r\n0123456789");
+        BOOST_CHECK_EQUAL(numDone, 1);
+        BOOST_CHECK_EQUAL(tooLarge, 0);
+        BOOST_CHECK_EQUAL(body, "0123456789");
+    }
+
+    /* announced by the content-length, the rest of the data is dropped */
+    {
+        HttpRequestParser parser;
+        string body;
+        uint64_t tooLarge(0);
+        int numDone(0);
+        makeParser(parser, body, tooLarge, numDone);
+
+        parser.feed("POST / HTTP/1.1\r\nContent-Length: 11\r\n\r\n01234");
+        BOOST_CHECK_EQUAL(tooLarge, 11);
+        parser.feed("56789a"
+                    "GET / HTTP/1.1\r\n\r\n");
+        BOOST_CHECK_EQUAL(numDone, 0);
+        BOOST_CHECK_EQUAL(body, "");
+        BOOST_CHECK_EQUAL(parser.buffered(), 0);
+    }
+
+    /* chunks that add up to more than the limit */
+    {
+        HttpRequestParser parser;
+        string body;
+        uint64_t tooLarge(0);
+        int numDone(0);
+        makeParser(parser, body, tooLarge, numDone);
+
+        parser.feed("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                    "6\r\n012345\r\n");
+        BOOST_CHECK_EQUAL(tooLarge, 0);
+        parser.feed("5\r\n6789a\r\n0\r\n\r\n");
+        BOOST_CHECK_EQUAL(tooLarge, 11);
+        BOOST_CHECK_EQUAL(numDone, 0);
+        BOOST_CHECK_EQUAL(body, "012345");
+    }
+
+    /* no callback */
+    {
+        HttpRequestParser parser;
+        parser.setMaxBodySize(10);
+        BOOST_CHECK_THROW(parser.feed("POST / HTTP/1.1\r\n"
+                                      "Content-Length: 100\r\n\r\n"),
+                          ML::Exception);
+    }
+}
+#endif
+
+#if 1
+/* Ensures that a copy of a header being filled incrementally doesn't refer
+ * to the headers of the original. */
+BOOST_AUTO_TEST_CASE( http_header_copy_test )
+{
+    unique_ptr<HttpHeader> original(new HttpHeader());
+    original->startRequest("GET", 3, "/", 1, "HTTP/1.1", 8);
+    original->addHeader("X-Kept", 6, "1", 1);
+    original->finishHeaders();
+
+    original->startRequest("GET", 3, "/", 1, "HTTP/1.1", 8);
+    original->addHeader("X-Seen", 6, "2", 1);
+
+    HttpHeader copy(*original);
+    HttpHeader assigned;
+    assigned = *original;
+    original.reset();
+
+    copy.addHeader("X-Other", 7, "3", 1);
+    copy.finishHeaders();
+    BOOST_CHECK_EQUAL(copy.headers.size(), 2);
+    BOOST_CHECK_EQUAL(copy.getHeader("x-seen"), "2");
+    BOOST_CHECK_EQUAL(copy.getHeader("x-other"), "3");
+
+    assigned.finishHeaders();
+    BOOST_CHECK_EQUAL(assigned.headers.size(), 1);
+    BOOST_CHECK_EQUAL(assigned.getHeader("x-seen"), "2");
+}
+#endif
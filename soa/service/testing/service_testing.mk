@@ -14,6 +14,9 @@ service_utils_test: $(LIB)/libcustom_preload_1.so \
 $(eval $(call test,epoll_test,services,boost))
 $(eval $(call test,epoll_wait_test,services,boost manual))
 
+$(eval $(call test,timing_wheel_test,types,boost))
+$(eval $(call test,timeout_map_bench,types,boost manual))
+
 $(eval $(call test,named_endpoint_test,services,boost manual))
 $(eval $(call test,zmq_named_pub_sub_test,services,boost manual))
 $(eval $(call test,zmq_endpoint_test,services,boost manual))
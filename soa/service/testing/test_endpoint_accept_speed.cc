@@ -21,33 +21,19 @@
 #include "ping_pong.h"
 #include <poll.h>
 #include "jml/utils/exc_assert.h"
+#include <thread>
 
 
 using namespace std;
 using namespace ML;
 using namespace Datacratic;
 
-void runAcceptSpeedTest()
+/* Open the given number of connections to the port, write to each and get
+   a response back, which makes sure that all are open.  Returns the
+   sockets that were opened.
+*/
+vector<int> openConnections(int port, int nconnections)
 {
-    string connectionError;
-
-    PassiveEndpointT<SocketTransport> acceptor("acceptor");
-    
-    acceptor.onMakeNewHandler = [&] ()
-        {
-            return ML::make_std_sp(new PongConnectionHandler(connectionError));
-        };
-    
-    int port = acceptor.init();
-
-    cerr << "port = " << port << endl;
-
-    BOOST_CHECK_EQUAL(acceptor.numConnections(), 0);
-
-    int nconnections = 100;
-
-    Date before = Date::now();
-
     vector<int> sockets;
 
     /* Open all the connections */
@@ -89,23 +75,68 @@ void runAcceptSpeedTest()
         }
     }
 
-    Date after = Date::now();
+    return sockets;
+}
 
-    BOOST_CHECK_LT(after.secondsSince(before), 1);
+/* Opens nconnections connections from each of numClients threads at once,
+   and returns the rate at which they were accepted and served. */
+double runAcceptSpeedTest(bool reusePort, int numThreads,
+                          int nconnections, int numClients = 1)
+{
+    string connectionError;
 
-    BOOST_CHECK_EQUAL(sockets.size(), nconnections);
+    PassiveEndpointT<SocketTransport> acceptor("acceptor");
+    acceptor.reusePortAccept = reusePort;
+    
+    acceptor.onMakeNewHandler = [&] ()
+        {
+            return ML::make_std_sp(new PongConnectionHandler(connectionError));
+        };
+    
+    int port = acceptor.init(PortRange(), "localhost", numThreads);
 
+    cerr << "port = " << port << endl;
 
+    BOOST_CHECK_EQUAL(acceptor.numConnections(), 0);
 
-    BOOST_CHECK_EQUAL(acceptor.numConnections(), nconnections);
+    Date before = Date::now();
+
+    vector<vector<int> > sockets(numClients);
+    vector<std::thread> clients;
+    for (unsigned i = 0;  i < numClients;  ++i) {
+        clients.emplace_back([&, i] ()
+                             {
+                                 sockets[i] = openConnections(port, nconnections);
+                             });
+    }
+    for (auto & client: clients)
+        client.join();
+
+    Date after = Date::now();
+    double elapsed = after.secondsSince(before);
+
+    int total = numClients * nconnections;
+    double rate = total / elapsed;
+
+    cerr << (reusePort ? "SO_REUSEPORT" : "accept thread")
+         << " with " << numThreads << " threads: "
+         << total << " connections from " << numClients << " clients in "
+         << elapsed * 1000 << "ms: " << rate << " connections/s" << endl;
+
+    for (auto & clientSockets: sockets)
+        BOOST_CHECK_EQUAL(clientSockets.size(), nconnections);
+
+    BOOST_CHECK_EQUAL(acceptor.numConnections(), total);
 
     acceptor.closePeer();
 
-    for (unsigned i = 0;  i < sockets.size();  ++i) {
-        close(sockets[i]);
-    }
+    for (auto & clientSockets: sockets)
+        for (int s: clientSockets)
+            close(s);
 
     acceptor.shutdown();
+
+    return rate;
 }
 
 
@@ -121,10 +152,46 @@ BOOST_AUTO_TEST_CASE( test_accept_speed )
     //ntests = 1000;  // stress test
 
     for (unsigned i = 0;  i < ntests;  ++i) {
-        runAcceptSpeedTest();
+        double rate = runAcceptSpeedTest(false, 1, 100);
+        BOOST_CHECK_GT(rate, 100);
     }
 
     BOOST_CHECK_EQUAL(TransportBase::created, TransportBase::destroyed);
     BOOST_CHECK_EQUAL(ConnectionHandler::created,
                       ConnectionHandler::destroyed);
 }
+
+BOOST_AUTO_TEST_CASE( test_accept_speed_reuse_port )
+{
+    Watchdog watchdog(50.0);
+
+    double rate = runAcceptSpeedTest(true, 1, 100);
+    BOOST_CHECK_GT(rate, 100);
+
+    BOOST_CHECK_EQUAL(TransportBase::created, TransportBase::destroyed);
+    BOOST_CHECK_EQUAL(ConnectionHandler::created,
+                      ConnectionHandler::destroyed);
+}
+
+/* Compares the connection rate of both modes under a storm of connections
+   coming from several clients at once. */
+BOOST_AUTO_TEST_CASE( test_accept_rate_connection_storm )
+{
+    Watchdog watchdog(120.0);
+
+    int numThreads = 4;
+    int numClients = 8;
+    int nconnections = 50;  // stays within the default limit of 1024 fds
+
+    double acceptThreadRate
+        = runAcceptSpeedTest(false, numThreads, nconnections, numClients);
+    double reusePortRate
+        = runAcceptSpeedTest(true, numThreads, nconnections, numClients);
+
+    cerr << "connection rate with SO_REUSEPORT: "
+         << reusePortRate / acceptThreadRate << "x" << endl;
+
+    BOOST_CHECK_EQUAL(TransportBase::created, TransportBase::destroyed);
+    BOOST_CHECK_EQUAL(ConnectionHandler::created,
+                      ConnectionHandler::destroyed);
+}
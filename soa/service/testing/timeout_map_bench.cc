@@ -0,0 +1,162 @@
+/* timeout_map_bench.cc
+   Copyright (c) 2013 Datacratic.  All rights reserved.
+
+   Compares the cost of the timeout operations of the TimeoutMap with 1M live
+   entries against the multimap of timeouts it used before the timing wheel.
+   The workload mimics the router's in flight auctions: every auction is
+   inserted with a short timeout, most of them are erased when they complete
+   and the rest expire.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include "soa/service/timeout_map.h"
+#include "jml/arch/timers.h"
+#include "jml/arch/format.h"
+
+#include <map>
+#include <random>
+#include <iostream>
+
+using namespace std;
+using namespace Datacratic;
+
+
+/*****************************************************************************/
+/* LEGACY TIMEOUT MAP                                                        */
+/*****************************************************************************/
+
+/** The timeout bookkeeping of the previous TimeoutMap. */
+struct LegacyTimeoutMap {
+
+    struct Node;
+    typedef std::map<uint64_t, Node> Nodes;
+    typedef std::multimap<Date, Nodes::iterator> Timeouts;
+
+    struct Node {
+        uint64_t value;
+        Timeouts::iterator timeoutIt;
+    };
+
+    Nodes nodes;
+    Timeouts timeouts;
+    Date earliest;
+
+    LegacyTimeoutMap() : earliest(Date::positiveInfinity()) {}
+
+    void insert(uint64_t key, uint64_t value, Date timeout)
+    {
+        auto it = nodes.insert(make_pair(key, Node{ value, {} })).first;
+        it->second.timeoutIt = timeouts.insert(make_pair(timeout, it));
+        if (timeout < earliest) earliest = timeout;
+    }
+
+    void updateTimeout(uint64_t key, Date timeout)
+    {
+        auto it = nodes.find(key);
+        timeouts.erase(it->second.timeoutIt);
+        it->second.timeoutIt = timeouts.insert(make_pair(timeout, it));
+        earliest = timeouts.begin()->first;
+    }
+
+    bool count(uint64_t key) const
+    {
+        return nodes.count(key);
+    }
+
+    bool erase(uint64_t key)
+    {
+        auto it = nodes.find(key);
+        if (it == nodes.end()) return false;
+        timeouts.erase(it->second.timeoutIt);
+        nodes.erase(it);
+        earliest = timeouts.empty() ?
+            Date::positiveInfinity() : timeouts.begin()->first;
+        return true;
+    }
+
+    void expire(Date now)
+    {
+        while (!timeouts.empty() && timeouts.begin()->first <= now) {
+            nodes.erase(timeouts.begin()->second);
+            timeouts.erase(timeouts.begin());
+        }
+        earliest = timeouts.empty() ?
+            Date::positiveInfinity() : timeouts.begin()->first;
+    }
+
+    size_t size() const { return nodes.size(); }
+};
+
+struct Value {
+    uint64_t value;
+};
+
+struct WheelTimeoutMap : public TimeoutMap<uint64_t, Value> {
+    void insert(uint64_t key, uint64_t value, Date timeout)
+    {
+        TimeoutMap<uint64_t, Value>::insert(key, Value{ value }, timeout);
+    }
+};
+
+
+/*****************************************************************************/
+/* BENCH                                                                     */
+/*****************************************************************************/
+
+template<typename Map>
+void bench(const string & name)
+{
+    const size_t liveEntries = 1000000;
+    const size_t operations = 4000000;
+    const double timeout = 0.1;
+
+    Map map;
+    mt19937_64 rng(0);
+
+    // The clock advances by the same amount for every auction so that about
+    // liveEntries auctions are in flight once half of them are erased early.
+    // It's computed from the auction number since the steps are below the
+    // precision of a Date.
+    Date start = Date::now();
+    double step = timeout / (2 * liveEntries);
+    Date now;
+
+    uint64_t next = 0;
+    for (; next < liveEntries;  ++next) {
+        now = start.plusSeconds(next * step);
+        map.insert(next, next, now.plusSeconds(timeout));
+    }
+
+    ML::Timer timer;
+
+    for (size_t i = 0;  i < operations;  ++i) {
+        now = start.plusSeconds(next * step);
+        map.insert(next, next, now.plusSeconds(timeout));
+        ++next;
+
+        // 90% of the auctions complete before they time out and the others
+        // get their timeout pushed back.
+        uint64_t key = next - 1 - rng() % (liveEntries / 2);
+        if (rng() % 10 < 9) map.erase(key);
+        else if (map.count(key))
+            map.updateTimeout(key, now.plusSeconds(timeout));
+
+        if (now >= map.earliest) map.expire(now);
+    }
+
+    double elapsed = timer.elapsed_wall();
+
+    cerr << ML::format("%-8s live=%8zd ops=%8zd %8.1fns/op\n",
+            name.c_str(), map.size(), operations,
+            elapsed / operations * 1e9);
+}
+
+BOOST_AUTO_TEST_CASE( timeoutMapBench )
+{
+    bench<LegacyTimeoutMap>("legacy");
+    bench<WheelTimeoutMap>("wheel");
+}
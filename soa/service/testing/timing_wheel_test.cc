@@ -0,0 +1,196 @@
+/* timing_wheel_test.cc
+   Copyright (c) 2013 Datacratic.  All rights reserved.
+
+   Tests for the timing wheel and the timeout maps built on top of it.
+*/
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+
+#include "soa/service/timing_wheel.h"
+#include "soa/service/timeout_map.h"
+
+#include <map>
+#include <set>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace Datacratic;
+
+
+struct Entry : public TimingWheelHook {
+    int id;
+    Date timeout;
+};
+
+BOOST_AUTO_TEST_CASE( test_timing_wheel_basics )
+{
+    Date start = Date::fromSecondsSinceEpoch(1400000000);
+    TimingWheel<Entry> wheel(0.001, start);
+
+    vector<Entry> entries(4);
+    for (int i = 0;  i < 4;  ++i) entries[i].id = i;
+
+    wheel.insert(entries[0], start.plusSeconds(0.5));
+    wheel.insert(entries[1], start.plusSeconds(10));
+    wheel.insert(entries[2], start.plusSeconds(100000));
+    wheel.insert(entries[3], Date::positiveInfinity());
+
+    BOOST_CHECK_EQUAL(wheel.size(), 4);
+    BOOST_CHECK_EQUAL(wheel.earliest(), start.plusSeconds(0.5));
+
+    vector<int> expired;
+    auto onExpire = [&] (Entry & entry) { expired.push_back(entry.id); };
+
+    BOOST_CHECK_EQUAL(wheel.expire(onExpire, start.plusSeconds(0.4999)), 0);
+    BOOST_CHECK_EQUAL(wheel.expire(onExpire, start.plusSeconds(0.5)), 1);
+    BOOST_CHECK(!entries[0].isLinked());
+    BOOST_CHECK_GT(wheel.earliest(), start.plusSeconds(0.5));
+    BOOST_CHECK_LE(wheel.earliest(), start.plusSeconds(10));
+
+    wheel.erase(entries[1]);
+    BOOST_CHECK_EQUAL(wheel.expire(onExpire, start.plusSeconds(50)), 0);
+
+    // Expired entries can be put back from the callback.
+    auto reschedule = [&] (Entry & entry) {
+        expired.push_back(entry.id);
+        wheel.insert(entry, start.plusSeconds(200000));
+    };
+    BOOST_CHECK_EQUAL(wheel.expire(reschedule, start.plusSeconds(100000)), 1);
+    BOOST_CHECK(entries[2].isLinked());
+
+    BOOST_CHECK_EQUAL(wheel.expire(onExpire, start.plusSeconds(1e9)), 1);
+    BOOST_CHECK(expired == vector<int>({ 0, 2, 2 }));
+    BOOST_CHECK_EQUAL(wheel.size(), 1);
+    BOOST_CHECK_EQUAL(wheel.earliest(), Date::positiveInfinity());
+
+    wheel.clear();
+    BOOST_CHECK(!entries[3].isLinked());
+    BOOST_CHECK(wheel.empty());
+}
+
+/* Compares the wheel against an ordered set with timeouts spread over every
+   level of the wheel and the overflow list. */
+// The slots are only allocated once something lands in their level.
+BOOST_AUTO_TEST_CASE( test_timing_wheel_footprint )
+{
+    BOOST_CHECK_LT(sizeof(TimingWheel<Entry>), 1024);
+    BOOST_CHECK_LT(sizeof(TimeoutMap<int, string>), 1024);
+
+    Date start = Date::fromSecondsSinceEpoch(1400000000);
+    TimingWheel<Entry> wheel(0.001, start);
+    BOOST_CHECK_EQUAL(wheel.earliest(), Date::positiveInfinity());
+    BOOST_CHECK_EQUAL(wheel.expire([] (Entry &) {}, start.plusSeconds(1e6)), 0);
+
+    Entry entry;
+    wheel.insert(entry, start.plusSeconds(1000));
+    wheel.erase(entry);
+    wheel.insert(entry, start.plusSeconds(0.01));
+    BOOST_CHECK_EQUAL(wheel.expire([] (Entry &) {}, start.plusSeconds(2e6)), 1);
+}
+
+BOOST_AUTO_TEST_CASE( test_timing_wheel_random )
+{
+    const size_t numEntries = 2000;
+    const double scales[] = { 0.0005, 0.1, 10, 1000, 1e5, 1e7, 1e9 };
+
+    for (unsigned seed = 0;  seed < 20;  ++seed) {
+        mt19937 rng(seed);
+        auto uniform = [&] (double scale) {
+            return uniform_real_distribution<double>(0, scale)(rng);
+        };
+
+        Date now = Date::fromSecondsSinceEpoch(1400000000 + seed);
+        TimingWheel<Entry> wheel(0.001, now);
+
+        vector<Entry> entries(numEntries);
+        for (size_t i = 0;  i < numEntries;  ++i) entries[i].id = i;
+
+        set<pair<Date, int> > expected;
+
+        for (unsigned step = 0;  step < 5000;  ++step) {
+            unsigned op = rng() % 10;
+            Entry & entry = entries[rng() % numEntries];
+
+            if (op < 5) {
+                double scale = scales[rng() % 7];
+                Date timeout = now.plusSeconds(uniform(2 * scale) - scale);
+
+                if (entry.isLinked()) {
+                    expected.erase({ entry.timeout, entry.id });
+                    wheel.update(entry, timeout);
+                }
+                else wheel.insert(entry, timeout);
+
+                entry.timeout = timeout;
+                expected.insert({ timeout, entry.id });
+            }
+            else if (op < 7) {
+                if (entry.isLinked())
+                    expected.erase({ entry.timeout, entry.id });
+                wheel.erase(entry);
+            }
+            else {
+                now = now.plusSeconds(uniform(scales[rng() % 7]));
+
+                set<int> expired;
+                wheel.expire([&] (Entry & entry) { expired.insert(entry.id); }, now);
+
+                set<int> due;
+                while (!expected.empty() && expected.begin()->first <= now) {
+                    due.insert(expected.begin()->second);
+                    expected.erase(expected.begin());
+                }
+
+                BOOST_REQUIRE(expired == due);
+                BOOST_REQUIRE_EQUAL(wheel.size(), expected.size());
+                if (!expected.empty()) {
+                    BOOST_REQUIRE_LE(wheel.earliest(), expected.begin()->first);
+                    BOOST_REQUIRE_GT(wheel.earliest(), now);
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_timeout_map )
+{
+    Date now = Date::now();
+
+    TimeoutMap<int, string> map;
+    map.insert(1, "one", now.plusSeconds(1));
+    map.insert(2, "two", now.plusSeconds(2));
+    map.insert(3, "three", now.plusSeconds(3));
+    BOOST_CHECK_EQUAL(map.earliest, now.plusSeconds(1));
+
+    map.updateTimeout(1, now.plusSeconds(10));
+    BOOST_CHECK_EQUAL(map.find(1)->second.timeout, now.plusSeconds(10));
+
+    // Copies are independent of the original.
+    TimeoutMap<int, string> copy = map;
+    copy.erase(2);
+    BOOST_CHECK_EQUAL(map.size(), 3);
+    BOOST_CHECK_EQUAL(copy.size(), 2);
+
+    vector<int> expired;
+    map.expire([&] (int key, const string & value) -> Date {
+                expired.push_back(key);
+                return key == 2 ? now.plusSeconds(20) : Date();
+            }, now.plusSeconds(5));
+
+    BOOST_CHECK(expired == vector<int>({ 2, 3 }));
+    BOOST_CHECK_EQUAL(map.size(), 2);
+    BOOST_CHECK_GT(map.earliest, now.plusSeconds(5));
+    BOOST_CHECK_LE(map.earliest, now.plusSeconds(10));
+
+    copy.expire(now.plusSeconds(5));
+    BOOST_CHECK_EQUAL(copy.size(), 1);
+    BOOST_CHECK(copy.count(1));
+
+    map.clear();
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK_EQUAL(map.earliest, Date::positiveInfinity());
+}
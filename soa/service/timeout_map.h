@@ -5,6 +5,10 @@
    Map from key -> value with inbuilt timeouts.
 
    Eventually will allow persistance.
+
+   The timeouts are kept in a hierarchical timing wheel so that inserting,
+   updating and erasing an entry don't touch any ordered structure and
+   expiring only looks at the entries that are due.
 */
 
 #ifndef __router__timeout_map_h__
@@ -12,12 +16,22 @@
 
 #include <map>
 #include "soa/types/date.h"
+#include "timing_wheel.h"
 #include <boost/function.hpp>
 #include "jml/arch/exception.h"
 #include <math.h>
 
 namespace Datacratic {
 
+/** Map from key to value where each entry has a timeout, after which
+    expire() removes it.
+
+    Besides the nodes of the map, each map holds a TimingWheel whose slots
+    are only allocated as the timeouts reach further out: an empty map costs
+    about 300 bytes and each of the four levels of the wheel that gets used
+    adds 10kb.  With the 1ms resolution of the wheel, timeouts less than
+    256ms away use at most two levels, and less than 65s away three.
+*/
 template<typename Key, class Value>
 struct TimeoutMap {
 
@@ -26,6 +40,27 @@ struct TimeoutMap {
     {
     }
 
+    TimeoutMap(const TimeoutMap & other)
+        : defaultTimeout(other.defaultTimeout),
+          throwException(other.throwException),
+          nodes(other.nodes),
+          earliest(Date::positiveInfinity())
+    {
+        relink();
+    }
+
+    TimeoutMap & operator = (const TimeoutMap & other)
+    {
+        if (this == &other) return *this;
+
+        defaultTimeout = other.defaultTimeout;
+        throwException = other.throwException;
+        timeouts.clear();
+        nodes = other.nodes;
+        relink();
+        return *this;
+    }
+
     double defaultTimeout;
 
     boost::function<void (const std::string & reason)> throwException;
@@ -58,9 +93,8 @@ struct TimeoutMap {
             if (!std::isnormal(defaultTimeout) || defaultTimeout < 0.0)
                 doThrowException("no default timeout specified and insert "
                                  "not used");
-            Date timeout = Date::now().plusSeconds(defaultTimeout);
-            it->second.timeoutIt = timeouts.insert(std::make_pair(timeout, it));
-            if (timeout < earliest) earliest = timeout;
+            it->second.timeout = Date::now().plusSeconds(defaultTimeout);
+            link(it);
         }
         
         return it->second;
@@ -75,8 +109,7 @@ struct TimeoutMap {
         auto it = res.first;
         if (res.second) {
             // inserted... insert the timeout
-            it->second.timeoutIt = timeouts.insert(std::make_pair(timeout, it));
-            if (timeout < earliest) earliest = timeout;
+            link(it);
         }
         else {
             // already existed... update the timeout
@@ -97,14 +130,13 @@ struct TimeoutMap {
             std::cerr << "contents (" << nodes.size() << ") = " << std::endl;
             int n = 0;
             for (auto it = nodes.begin(), end = nodes.end();  it != end && n < 20;  ++it, ++n)
-                std::cerr << it->first << " @ " << it->second.timeoutIt->first << " "
+                std::cerr << it->first << " @ " << it->second.timeout << " "
                           << (it->first == key ? "*****" : "") << std::endl;
             doThrowException("TimeoutMap: "
                              "attempt to re-insert existing key");
         }
         auto it = res.first;
-        it->second.timeoutIt = timeouts.insert(std::make_pair(timeout, it));
-        if (timeout < earliest) earliest = timeout;
+        link(it);
         return it->second;
     }
 
@@ -119,14 +151,13 @@ struct TimeoutMap {
             std::cerr << "contents (" << nodes.size() << ") = " << std::endl;
             int n = 0;
             for (auto it = nodes.begin(), end = nodes.end();  it != end && n < 20;  ++it, ++n)
-                std::cerr << it->first << " @ " << it->second.timeoutIt->first << " "
+                std::cerr << it->first << " @ " << it->second.timeout << " "
                           << (it->first == key ? "*****" : "") << std::endl;
             doThrowException("TimeoutMap: "
                              "attempt to re-insert existing key");
         }
         auto it = res.first;
-        it->second.timeoutIt = timeouts.insert(std::make_pair(timeout, it));
-        if (timeout < earliest) earliest = timeout;
+        link(it);
         return it->second;
     }
 
@@ -179,53 +210,43 @@ struct TimeoutMap {
 #endif
 
     /** Call the callback on any which have expired, removing them from
-        the map.
+        the map unless the callback returns a new expiry date.
     */
     template<typename Callback>
     void expire(const Callback & callback, Date now = Date::now())
     {
-        // Look for loss timeout expiries
-        for (auto it = timeouts.begin(), end = timeouts.end();
-             it != end && it->first <= now;  /* no inc */) {
-            auto it2 = it;
-            auto expired = it->second;
-            Date newExpiry = callback(expired->first, expired->second);
-            ++it;
-            if (newExpiry != Date()) {
-                auto tit = expired->second.timeoutIt;
-                timeouts.erase(tit);
-                expired->second.timeoutIt
-                    = timeouts.insert(make_pair(newExpiry, expired));
-                if (newExpiry < earliest) earliest = newExpiry;
-            } else {
-                erase(expired);
-            }
-        }
+        timeouts.expire([&] (Node & node) {
+                auto expired = node.self;
+                Date newExpiry = callback(expired->first, expired->second);
+                if (newExpiry != Date()) {
+                    node.timeout = newExpiry;
+                    timeouts.insert(node, newExpiry);
+                }
+                else nodes.erase(expired);
+            }, now);
+
+        earliest = timeouts.earliest();
     }
 
     /** Remove any which have expired. */
     void expire(Date now = Date::now())
     {
-        // Look for loss timeout expiries
-        for (auto it = timeouts.begin(), end = timeouts.end();
-             it != end && it->first <= now;  /* no inc */) {
-            auto expired = it->second;
-            ++it;
-            erase(expired);
-        }
+        timeouts.expire([&] (Node & node) { nodes.erase(node.self); }, now);
+        earliest = timeouts.earliest();
     }
     
     typedef std::map<Key, Node> Nodes;
     Nodes nodes;
 
-    /** Ordered set of timeouts in submitted for auction loss messages. */
-    typedef std::multimap<Date, typename Nodes::iterator> Timeouts;
+    /** Timeouts of the nodes. */
+    typedef TimingWheel<Node> Timeouts;
     Timeouts timeouts;
 
-    // Date of the earliest timeout
+    // Lower bound of the earliest timeout; exact after a call to expire()
+    // but not raised when the earliest entry is erased.
     Date earliest;
 
-    struct Node : public Value {
+    struct Node : public Value, public TimingWheelHook {
         Node() {}
         Node(const Value & val, Date timeout)
             : Value(val), timeout(timeout)
@@ -238,7 +259,7 @@ struct TimeoutMap {
         }
 
         Date timeout;
-        typename Timeouts::iterator timeoutIt;
+        typename Nodes::iterator self;
     };
 
     typedef typename Nodes::const_iterator const_iterator;
@@ -301,12 +322,10 @@ struct TimeoutMap {
     {
         if (it == nodes.end())
             doThrowException("erasing with invalid iterator");
-        auto tit = it->second.timeoutIt;
+        timeouts.erase(it->second);
         nodes.erase(it);
-        timeouts.erase(tit);
         if (timeouts.empty())
             earliest = Date::positiveInfinity();
-        else earliest = timeouts.begin()->first;
     }
 
     void updateTimeout(const iterator & it, Date timeout)
@@ -314,10 +333,9 @@ struct TimeoutMap {
         if (it == nodes.end())
             throw ML::Exception("attempt to update wrong timeout");
 
-        auto & tit = it->second.timeoutIt;
-        timeouts.erase(tit);
-        tit = timeouts.insert(std::make_pair(timeout, it));
-        earliest = timeouts.begin()->first;
+        it->second.timeout = timeout;
+        timeouts.update(it->second, timeout);
+        earliest = timeouts.earliest();
     }
 
     size_t size() const
@@ -336,6 +354,20 @@ struct TimeoutMap {
         nodes.clear();
         earliest = Date::positiveInfinity();
     }
+
+private:
+    void link(const iterator & it)
+    {
+        it->second.self = it;
+        timeouts.insert(it->second, it->second.timeout);
+        earliest = timeouts.earliest();
+    }
+
+    void relink()
+    {
+        for (auto it = nodes.begin(), end = nodes.end();  it != end;  ++it)
+            link(it);
+    }
 };
 
 
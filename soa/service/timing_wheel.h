@@ -0,0 +1,573 @@
+/* timing_wheel.h                                                  -*- C++ -*-
+   Copyright (c) 2013 Datacratic.  All rights reserved.
+
+   Hierarchical timing wheel used to expire the entries of the timeout maps.
+*/
+
+#pragma once
+
+#include "soa/types/date.h"
+#include "jml/utils/exc_assert.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+
+namespace Datacratic {
+
+
+/*****************************************************************************/
+/* TIMING WHEEL HOOK                                                         */
+/*****************************************************************************/
+
+/** Intrusive link of an object in a TimingWheel. The object must derive
+    from the hook which keeps insertions and removals free of allocations.
+
+    Copying a hook yields an unlinked hook so that the objects that embed
+    one remain copyable; it's up to the owner to link the copy.
+*/
+struct TimingWheelHook {
+
+    TimingWheelHook()
+        : wheelPrev_(nullptr), wheelNext_(nullptr),
+          wheelTick_(0), wheelSlot_(0)
+    {
+    }
+
+    TimingWheelHook(const TimingWheelHook &)
+        : wheelPrev_(nullptr), wheelNext_(nullptr),
+          wheelTick_(0), wheelSlot_(0)
+    {
+    }
+
+    TimingWheelHook & operator = (const TimingWheelHook &)
+    {
+        return *this;
+    }
+
+    bool isLinked() const
+    {
+        return wheelNext_ != nullptr;
+    }
+
+private:
+    template<typename T> friend struct TimingWheel;
+
+    TimingWheelHook * wheelPrev_;
+    TimingWheelHook * wheelNext_;
+    Date wheelTimeout_;
+    int64_t wheelTick_;
+    unsigned wheelSlot_;
+
+    void linkBefore(TimingWheelHook & head)
+    {
+        wheelNext_ = &head;
+        wheelPrev_ = head.wheelPrev_;
+        head.wheelPrev_->wheelNext_ = this;
+        head.wheelPrev_ = this;
+    }
+
+    void unlink()
+    {
+        wheelPrev_->wheelNext_ = wheelNext_;
+        wheelNext_->wheelPrev_ = wheelPrev_;
+        wheelPrev_ = wheelNext_ = nullptr;
+    }
+
+    void makeHead()
+    {
+        wheelPrev_ = wheelNext_ = this;
+    }
+
+    bool emptyHead() const
+    {
+        return wheelNext_ == this;
+    }
+
+    /** Moves all the entries of this list to the end of the other list. */
+    void spliceInto(TimingWheelHook & head)
+    {
+        if (emptyHead()) return;
+        wheelNext_->wheelPrev_ = head.wheelPrev_;
+        head.wheelPrev_->wheelNext_ = wheelNext_;
+        wheelPrev_->wheelNext_ = &head;
+        head.wheelPrev_ = wheelPrev_;
+        makeHead();
+    }
+};
+
+
+/*****************************************************************************/
+/* TIMING WHEEL                                                              */
+/*****************************************************************************/
+
+/** Hierarchical timing wheel (Varghese & Lauck) of objects of type T which
+    must derive from TimingWheelHook.
+
+    Time is divided in ticks of a fixed resolution and the wheel is made of
+    four levels of 256 slots; level n covers 256^(n+1) ticks and an entry is
+    kept at the lowest level whose span contains it. Entries that are further
+    than 2^32 ticks away (or that never time out) are kept in an overflow
+    list. Inserting and removing an entry are O(1) and expiring walks only
+    the slots that contain something thanks to an occupancy bitmap of each
+    level; the entries of the higher levels are redistributed to the lower
+    levels as the time reaches their slot.
+
+    Timeouts are exact: the entries of a slot are compared against the
+    current date before being expired so the resolution only determines how
+    entries are grouped. The slot of the current tick is sorted the first
+    time it's partially expired so that the repeated calls made while the
+    time goes through a tick don't rescan it.
+
+    The slots of each level are allocated on the heap by the first entry
+    that lands in the level, 10kb apiece (256 slots of 40 bytes) on 64 bit
+    platforms. An empty wheel only takes about 300 bytes and the wheels of
+    timeouts that all fall within 256 ticks never go past one level.
+
+    earliest() is a lower bound of the earliest timeout. It's only lowered
+    when entries are inserted and is recomputed after every call to
+    expire() which means that it can be earlier than the real earliest
+    timeout after an erase. It's always later than the date passed to the
+    last expire() call if nothing was inserted since.
+
+    Not thread safe.
+*/
+template<typename T>
+struct TimingWheel {
+
+    enum {
+        SlotBits = 8,
+        NumSlots = 1 << SlotBits,
+        NumLevels = 4,
+        OverflowSlot = NumLevels * NumSlots,
+        DeferredSlot = OverflowSlot + 1
+    };
+
+    TimingWheel(double resolution = 0.001, Date now = Date::now())
+        : resolution(resolution),
+          current(toTick(now)),
+          size_(0),
+          earliest_(Date::positiveInfinity()),
+          expiring(false)
+    {
+        ExcAssertGreater(resolution, 0.0);
+        reset();
+    }
+
+    TimingWheel(const TimingWheel &) = delete;
+    TimingWheel & operator = (const TimingWheel &) = delete;
+
+    /** Number of entries in the wheel. */
+    size_t size() const
+    {
+        return size_;
+    }
+
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+    /** Lower bound of the earliest timeout in the wheel. */
+    Date earliest() const
+    {
+        return earliest_;
+    }
+
+    /** Adds the entry which must not already be in a wheel. */
+    void insert(T & entry, Date timeout)
+    {
+        TimingWheelHook & hook = entry;
+        ExcAssert(!hook.isLinked());
+
+        hook.wheelTimeout_ = timeout;
+        hook.wheelTick_ = toTick(timeout);
+
+        // Entries that are due while we're expiring would land in a slot
+        // that we may be about to leave so they're placed at the end.
+        if (expiring && hook.wheelTick_ <= current) {
+            hook.linkBefore(deferred);
+            hook.wheelSlot_ = DeferredSlot;
+        }
+        else place(hook);
+
+        ++size_;
+        if (timeout < earliest_) earliest_ = timeout;
+    }
+
+    /** Removes the entry from the wheel. Does nothing if it isn't linked. */
+    void erase(T & entry)
+    {
+        TimingWheelHook & hook = entry;
+        if (!hook.isLinked()) return;
+
+        unlink(hook);
+        --size_;
+    }
+
+    /** Changes the timeout of an entry that is already in the wheel. */
+    void update(T & entry, Date timeout)
+    {
+        erase(entry);
+        insert(entry, timeout);
+    }
+
+    /** Unlinks every entry. */
+    void clear()
+    {
+        for (auto & level : slots) {
+            if (!level) continue;
+            for (auto & head : *level)
+                unlinkAll(head);
+        }
+        unlinkAll(overflow);
+        unlinkAll(deferred);
+
+        reset();
+        size_ = 0;
+        earliest_ = Date::positiveInfinity();
+    }
+
+    /** Removes every entry whose timeout is before or at now and calls fn
+        with each of them in the order of their slots. The entry is unlinked
+        before fn is called so fn is free to insert it back, to destroy it or
+        to modify the wheel in any other way. Entries that fn inserts with a
+        timeout that is already due can be left for the next call. Returns
+        the number of expired entries.
+    */
+    template<typename Fn>
+    size_t expire(const Fn & fn, Date now = Date::now())
+    {
+        int64_t target = toTick(now);
+        size_t expired = 0;
+
+        expiring = true;
+
+        try {
+            for (;;) {
+                expired += expireSlot(fn, now, current >= target);
+                if (current >= target) break;
+
+                int64_t next = nextEvent();
+                if (next > target) {
+                    current = target;
+                    break;
+                }
+
+                current = next;
+                cascade();
+            }
+        } catch (...) {
+            finishExpire();
+            throw;
+        }
+
+        finishExpire();
+        return expired;
+    }
+
+private:
+    typedef std::array<uint64_t, NumSlots / 64> Bitmap;
+    typedef std::array<TimingWheelHook, NumSlots> Level;
+
+    double resolution;
+    int64_t current;
+    size_t size_;
+    Date earliest_;
+
+    std::array<std::unique_ptr<Level>, NumLevels> slots;  // null until used
+    std::array<Bitmap, NumLevels> occupied;
+    TimingWheelHook overflow;
+
+    // Entries inserted during expire() that were already due.
+    TimingWheelHook deferred;
+    bool expiring;
+
+    // Tick for which the current slot is sorted by timeout.
+    int64_t sortedTick;
+    std::vector<TimingWheelHook *> sortBuffer;
+
+    int64_t toTick(Date date) const
+    {
+        double ticks = std::floor(date.secondsSinceEpoch() / resolution);
+
+        // Anything that far out (including infinity) never times out.
+        if (!(ticks < 4e18)) return std::numeric_limits<int64_t>::max();
+        if (ticks < -4e18) return std::numeric_limits<int64_t>::min();
+        return ticks;
+    }
+
+    void reset()
+    {
+        for (auto & level : slots) {
+            if (!level) continue;
+            for (auto & head : *level)
+                head.makeHead();
+        }
+        overflow.makeHead();
+        deferred.makeHead();
+
+        for (auto & bitmap : occupied)
+            bitmap.fill(0);
+
+        sortedTick = std::numeric_limits<int64_t>::min();
+    }
+
+    /** Slots of the given level, which are allocated the first time. */
+    Level & levelSlots(unsigned level)
+    {
+        if (!slots[level]) {
+            slots[level].reset(new Level());
+            for (auto & head : *slots[level])
+                head.makeHead();
+        }
+        return *slots[level];
+    }
+
+    static void unlinkAll(TimingWheelHook & head)
+    {
+        for (TimingWheelHook * hook = head.wheelNext_;  hook != &head;) {
+            TimingWheelHook * next = hook->wheelNext_;
+            hook->wheelPrev_ = hook->wheelNext_ = nullptr;
+            hook = next;
+        }
+        head.makeHead();
+    }
+
+    static int findNext(const Bitmap & bitmap, int from)
+    {
+        if (from >= NumSlots) return -1;
+
+        int word = from / 64;
+        uint64_t bits = bitmap[word] & (~uint64_t(0) << (from % 64));
+
+        for (;;) {
+            if (bits) return word * 64 + __builtin_ctzll(bits);
+            if (++word == int(bitmap.size())) return -1;
+            bits = bitmap[word];
+        }
+    }
+
+    /** Links the hook in the slot that contains its tick relative to the
+        current tick. Entries that are already due go in the current slot.
+    */
+    void place(TimingWheelHook & hook)
+    {
+        int64_t tick = std::max(hook.wheelTick_, current);
+        uint64_t diff = uint64_t(tick ^ current);
+
+        for (unsigned level = 0;  level < NumLevels;  ++level) {
+            unsigned shift = level * SlotBits;
+            if (diff >> (shift + SlotBits)) continue;
+
+            unsigned index = (tick >> shift) & (NumSlots - 1);
+            if (level == 0 && tick == current)
+                sortedTick = std::numeric_limits<int64_t>::min();
+
+            hook.linkBefore(levelSlots(level)[index]);
+            hook.wheelSlot_ = level * NumSlots + index;
+            occupied[level][index / 64] |= uint64_t(1) << (index % 64);
+            return;
+        }
+
+        hook.linkBefore(overflow);
+        hook.wheelSlot_ = OverflowSlot;
+    }
+
+    void unlink(TimingWheelHook & hook)
+    {
+        hook.unlink();
+        if (hook.wheelSlot_ >= OverflowSlot) return;
+
+        unsigned level = hook.wheelSlot_ / NumSlots;
+        unsigned index = hook.wheelSlot_ % NumSlots;
+        if ((*slots[level])[index].emptyHead())
+            occupied[level][index / 64] &= ~(uint64_t(1) << (index % 64));
+    }
+
+    /** Detaches every entry of the slot and links them back through
+        place().
+    */
+    void redistribute(TimingWheelHook & head)
+    {
+        TimingWheelHook pending;
+        pending.makeHead();
+        head.spliceInto(pending);
+
+        while (!pending.emptyHead()) {
+            TimingWheelHook & hook = *pending.wheelNext_;
+            hook.unlink();
+            place(hook);
+        }
+    }
+
+    /** Expires the entries of the slot of the current tick. If the time is
+        past the tick then every entry is due, otherwise the slot is sorted
+        and only the due prefix is expired.
+    */
+    template<typename Fn>
+    size_t expireSlot(const Fn & fn, Date now, bool partial)
+    {
+        if (!slots[0]) return 0;
+
+        unsigned index = current & (NumSlots - 1);
+        TimingWheelHook & head = (*slots[0])[index];
+        if (head.emptyHead()) return 0;
+
+        if (partial) sortCurrentSlot();
+
+        TimingWheelHook pending;
+        pending.makeHead();
+        head.spliceInto(pending);
+        occupied[0][index / 64] &= ~(uint64_t(1) << (index % 64));
+
+        size_t expired = 0;
+        while (!pending.emptyHead()) {
+            TimingWheelHook & hook = *pending.wheelNext_;
+            if (hook.wheelTimeout_ > now) break;
+
+            hook.unlink();
+            --size_;
+            ++expired;
+            fn(static_cast<T &>(hook));
+        }
+
+        // Nothing can be inserted in the current slot while expiring so the
+        // slot is still empty and stays sorted.
+        if (!pending.emptyHead()) {
+            pending.spliceInto(head);
+            occupied[0][index / 64] |= uint64_t(1) << (index % 64);
+        }
+
+        return expired;
+    }
+
+    void sortCurrentSlot()
+    {
+        if (sortedTick == current) return;
+        sortedTick = current;
+
+        TimingWheelHook & head = (*slots[0])[current & (NumSlots - 1)];
+
+        sortBuffer.clear();
+        for (TimingWheelHook * hook = head.wheelNext_;  hook != &head;
+             hook = hook->wheelNext_)
+            sortBuffer.push_back(hook);
+
+        std::sort(sortBuffer.begin(), sortBuffer.end(),
+                  [] (const TimingWheelHook * lhs, const TimingWheelHook * rhs)
+                  {
+                      return lhs->wheelTimeout_ < rhs->wheelTimeout_;
+                  });
+
+        head.makeHead();
+        for (TimingWheelHook * hook : sortBuffer)
+            hook->linkBefore(head);
+    }
+
+    void finishExpire()
+    {
+        expiring = false;
+        redistribute(deferred);
+        earliest_ = computeEarliest();
+    }
+
+    /** Returns the next tick after the current one at which there is either
+        an entry to expire on the first level or a slot of a higher level to
+        redistribute.
+    */
+    int64_t nextEvent() const
+    {
+        int64_t next = current + 1;
+
+        for (unsigned level = 0;  level < NumLevels;  ++level) {
+            unsigned shift = level * SlotBits;
+            int64_t unit = int64_t(1) << shift;
+            int64_t span = unit << SlotBits;
+
+            // Slots of this level start on a multiple of unit and only the
+            // ones in the same span as the current tick are in use.
+            next = (next + unit - 1) & ~(unit - 1);
+            if ((next ^ current) & ~(span - 1)) continue;
+
+            int index = findNext(occupied[level], (next >> shift) & (NumSlots - 1));
+            if (index >= 0)
+                return (next & ~(span - 1)) + (int64_t(index) << shift);
+        }
+
+        if (overflow.emptyHead())
+            return std::numeric_limits<int64_t>::max();
+
+        int64_t earliestTick = std::numeric_limits<int64_t>::max();
+        for (const TimingWheelHook * hook = overflow.wheelNext_;
+             hook != &overflow;  hook = hook->wheelNext_)
+            earliestTick = std::min(earliestTick, hook->wheelTick_);
+
+        if (earliestTick == std::numeric_limits<int64_t>::max())
+            return earliestTick;
+
+        int64_t span = int64_t(1) << (NumLevels * SlotBits);
+        return std::max(next, earliestTick & ~(span - 1));
+    }
+
+    /** Redistributes the slots of the higher levels that start at the
+        current tick, from the highest to the lowest.
+    */
+    void cascade()
+    {
+        int64_t span = int64_t(1) << (NumLevels * SlotBits);
+        if ((current & (span - 1)) == 0)
+            redistribute(overflow);
+
+        for (unsigned level = NumLevels - 1;  level > 0;  --level) {
+            unsigned shift = level * SlotBits;
+            if (current & ((int64_t(1) << shift) - 1)) continue;
+
+            if (!slots[level]) continue;
+
+            unsigned index = (current >> shift) & (NumSlots - 1);
+            TimingWheelHook & head = (*slots[level])[index];
+            if (head.emptyHead()) continue;
+
+            occupied[level][index / 64] &= ~(uint64_t(1) << (index % 64));
+            redistribute(head);
+        }
+    }
+
+    Date computeEarliest() const
+    {
+        if (size_ == 0) return Date::positiveInfinity();
+
+        // Everything in the current slot is earlier than the other slots.
+        const TimingWheelHook * head = nullptr;
+        if (slots[0]) head = &(*slots[0])[current & (NumSlots - 1)];
+
+        if (head && !head->emptyHead() && sortedTick == current)
+            return head->wheelNext_->wheelTimeout_;
+
+        if (head && !head->emptyHead()) {
+            Date result = Date::positiveInfinity();
+            for (const TimingWheelHook * hook = head->wheelNext_;
+                 hook != head;  hook = hook->wheelNext_)
+                result = std::min(result, hook->wheelTimeout_);
+            return result;
+        }
+
+        int64_t next = nextEvent();
+        if (next != std::numeric_limits<int64_t>::max())
+            return Date::fromSecondsSinceEpoch(next * resolution);
+
+        Date result = Date::positiveInfinity();
+        for (const TimingWheelHook * hook = overflow.wheelNext_;
+             hook != &overflow;  hook = hook->wheelNext_)
+            result = std::min(result, hook->wheelTimeout_);
+        return result;
+    }
+};
+
+} // namespace Datacratic
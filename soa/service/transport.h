@@ -25,6 +25,13 @@
 #include <boost/type_traits/is_convertible.hpp>
 #include <boost/enable_shared_from_this.hpp>
 
+/** Set to 0 to compile out the recording of activities on transports and
+    their connection handlers altogether.
+*/
+#ifndef TRANSPORT_ACTIVITIES_ENABLED
+#  define TRANSPORT_ACTIVITIES_ENABLED 1
+#endif
+
 namespace Datacratic {
 
 
@@ -237,11 +244,11 @@ public:
     
     Activities activities;
 
-    bool debugOn() const { return debug; }
+    bool debugOn() const { return TRANSPORT_ACTIVITIES_ENABLED && debug; }
 
     void addActivity(const std::string & act)
     {
-        if (!debug) return;
+        if (!debugOn()) return;
         //assertLockedByThisThread();
         checkMagic();
         activities.add(act);
@@ -249,15 +256,15 @@ public:
 
     void addActivityS(const char * act)
     {
-        if (!debug) return;
+        if (!debugOn()) return;
         //assertLockedByThisThread();
         checkMagic();
         activities.add(act);
     }
 
-    void addActivity(const char * fmt, ...)
+    void addActivity(const char * fmt, ...) JML_FORMAT_STRING(2, 3)
     {
-        if (!debug) return;
+        if (!debugOn()) return;
         //assertLockedByThisThread();
         checkMagic();
 
@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <queue>
 #include <thread>
 
@@ -86,6 +88,163 @@ private:
 };
 
 
+/*****************************************************************************
+ * TYPED MESSAGE BATCH SINK                                                  *
+ *****************************************************************************/
+
+/* Message sink for high rates of messages.  Unlike TypedMessageSink, each
+ * producer thread gets its own single writer ring (a lane), so pushing a
+ * message is free of locks and of atomic read-modify-writes, and the eventfd
+ * is only signalled when a lane goes from empty to non-empty.  The consumer
+ * drains up to batchSize messages at a time across the lanes.
+ *
+ * A thread claims a lane the first time it pushes and keeps it for the life
+ * of the sink.  Once maxProducers threads have claimed one, the other
+ * threads share a last lane which is protected by a spinlock. */
+template<typename Message>
+struct TypedMessageBatchSink: public AsyncEventSource {
+
+    TypedMessageBatchSink(size_t bufferSize,
+                          size_t maxProducers = 4,
+                          size_t batchSize = 64)
+        : wakeup(EFD_NONBLOCK), bufferSize(bufferSize),
+          batchSize(batchSize), nextLane(0)
+    {
+        setMaxProducers(maxProducers);
+    }
+
+    std::function<void (Message && message)> onEvent;
+
+    /* Set the number of threads that get a lane of their own.  Must be
+     * called before anything is pushed. */
+    void setMaxProducers(size_t maxProducers)
+    {
+        lanes.clear();
+        for (size_t i = 0; i <= maxProducers; ++i)
+            lanes.emplace_back(new Lane(bufferSize));
+        lanes.back()->owner = Shared;
+    }
+
+    /* Push a message, waiting for room if the lane is full. */
+    template<typename MessageT>
+    void push(MessageT&& message)
+    {
+        Lane & l = lane();
+        bool wasEmpty;
+
+        // A failed push leaves the message untouched
+        while (!l.tryPush(std::forward<MessageT>(message), wasEmpty))
+            std::this_thread::yield();
+
+        if (wasEmpty)
+            wakeup.signal();
+    }
+
+    template<typename MessageT>
+    bool tryPush(MessageT&& message)
+    {
+        bool wasEmpty;
+        if (!lane().tryPush(std::forward<MessageT>(message), wasEmpty))
+            return false;
+
+        if (wasEmpty)
+            wakeup.signal();
+        return true;
+    }
+
+    //protected:
+    virtual int selectFd() const
+    {
+        return wakeup.fd();
+    }
+
+    virtual bool poll() const
+    {
+        for (auto & l : lanes)
+            if (l->ring.couldPop()) return true;
+        return false;
+    }
+
+    virtual bool processOne()
+    {
+        size_t done = 0;
+
+        for (size_t i = 0; i < lanes.size() && done < batchSize; ++i) {
+            Lane & l = *lanes[nextLane];
+            nextLane = (nextLane + 1) % lanes.size();
+
+            Message msg;
+            while (done < batchSize && l.ring.tryPop(msg)) {
+                onEvent(std::move(msg));
+                ++done;
+            }
+        }
+
+        if (done == batchSize)
+            return true;
+
+        // Producers only signal the empty to non-empty transition so the
+        // lanes have to be checked again once the wakeup is cleared.
+        wakeup.tryRead();
+        return poll();
+    }
+
+    uint64_t size() const
+    {
+        uint64_t result = 0;
+        for (auto & l : lanes) result += l->ring.size();
+        return result;
+    }
+
+private:
+
+    struct Lane {
+        Lane(size_t size) : owner(0), ring(size) {}
+
+        template<typename MessageT>
+        bool tryPush(MessageT&& message, bool & wasEmpty)
+        {
+            if (owner != Shared)
+                return ring.tryPush(std::forward<MessageT>(message), wasEmpty);
+
+            std::lock_guard<ML::Spinlock> guard(lock);
+            return ring.tryPush(std::forward<MessageT>(message), wasEmpty);
+        }
+
+        std::atomic<uintptr_t> owner;
+        ML::Spinlock lock;
+        ML::RingBufferSWSR<Message> ring;
+    };
+
+    static constexpr uintptr_t Shared = 1;
+
+    Lane & lane()
+    {
+        // The address of a thread local is unique to each live thread
+        static __thread char token;
+        uintptr_t self = reinterpret_cast<uintptr_t>(&token);
+
+        size_t owned = lanes.size() - 1;
+        for (size_t i = 0; i < owned; ++i) {
+            uintptr_t owner = lanes[i]->owner.load(std::memory_order_relaxed);
+            if (owner == self) return *lanes[i];
+            if (owner) continue;
+
+            if (lanes[i]->owner.compare_exchange_strong(owner, self))
+                return *lanes[i];
+        }
+
+        return *lanes.back();
+    }
+
+    ML::Wakeup_Fd wakeup;
+    size_t bufferSize;
+    size_t batchSize;
+    std::vector<std::unique_ptr<Lane> > lanes;
+    size_t nextLane;
+};
+
+
 /*****************************************************************************
  * TYPED MESSAGE QUEUE                                                       *
  *****************************************************************************/
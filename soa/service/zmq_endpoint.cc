@@ -560,6 +560,8 @@ onServiceProvidersChanged(const std::string & path, bool local)
     std::vector<std::string> children
         = config->getChildren(path, serviceProvidersWatch);
 
+    std::map<std::string, Json::Value> providers;
+
     for (auto c: children) {
         Json::Value value = config->getJson(path + "/" + c);
         std::string name = value["serviceName"].asString();
@@ -576,6 +578,7 @@ onServiceProvidersChanged(const std::string & path, bool local)
         }
 
         watchServiceProvider(name, path, shardIndex);
+        providers[name] = value;
     }
 
     // deleting the connection could trigger a callback which is a bad idea
@@ -605,6 +608,8 @@ onServiceProvidersChanged(const std::string & path, bool local)
     // disconnect and trigger the callbacks.
     pendingDisconnects.clear();
 
+    if (providersHandler) providersHandler(providers);
+
     exitProvidersChanged();
 }
 
@@ -1121,6 +1121,29 @@ struct ZmqMultipleNamedClientBusProxy: public MessageLoop {
         return false;
     }
 
+    /** Same as sendMessage() but returns false instead of throwing when
+        the recipient isn't known (anymore).
+    */
+    template<typename... Args>
+    bool trySendMessage(const std::string & recipient,
+                        const std::string & topic,
+                        Args&&... args) const
+    {
+        std::unique_lock<Lock> guard(connectionsLock);
+        auto it = connections.find(recipient);
+        if (it == connections.end()) return false;
+
+        it->second->sendMessage(topic, std::forward<Args>(args)...);
+        return true;
+    }
+
+    bool isConnectedTo(const std::string & recipient) const
+    {
+        std::unique_lock<Lock> guard(connectionsLock);
+        auto it = connections.find(recipient);
+        return it != connections.end() && it->second->isConnected();
+    }
+
     bool isConnectedToShard(size_t shard) const
     {
         std::unique_lock<Lock> guard(connectionsLock);
@@ -1180,6 +1203,18 @@ struct ZmqMultipleNamedClientBusProxy: public MessageLoop {
             disconnectHandler(source);
     }
 
+    /** Type of callback for a change in the set of service providers.  It's
+        given the registration of each provider, keyed by service name.
+    */
+    typedef std::function<void (const std::map<std::string, Json::Value> &)>
+    ProvidersHandler;
+
+    /** Callback that will be called with the providers we connect to every
+        time the set of service providers changes.  Must be set before
+        connectAllServiceProviders().
+    */
+    ProvidersHandler providersHandler;
+
     /** Type of handler to override what we do when we get a message. */
     typedef std::function<void (std::string, std::vector<std::string>)>
     MessageHandler;
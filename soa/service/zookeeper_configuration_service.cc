@@ -200,12 +200,16 @@ setUnique(const std::string & key,
 {
     //cerr << "setting unique " << key << " to " << value << endl;
     ExcAssert(zoo);
-    return zoo->createNode(prefix + key, boost::trim_copy(value.toString()),
-                           true /* ephemeral */,
-                           false /* sequential */,
-                           true /* mustSucceed */,
-                           true /* create path */)
+    string path = zoo->createNode(prefix + key, boost::trim_copy(value.toString()),
+                                  true /* ephemeral */,
+                                  false /* sequential */,
+                                  true /* mustSucceed */,
+                                  true /* create path */)
         .first;
+
+    // Same as the other configuration services: relative to the prefix
+    ExcAssert(path.compare(0, prefix.size(), prefix) == 0);
+    return path.substr(prefix.size());
 }
 
 std::vector<std::string>
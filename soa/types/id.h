@@ -209,6 +209,21 @@ struct Id {
         return Hash128to64(std::make_pair(val1, val2));
     }
 
+    /** hash() run through the MurmurHash3 finalizer.  hash() leaves the bits
+        of integer ids poorly mixed; this is for the users that take a
+        subset of the bits, like a bucket index or a position on a ring.
+    */
+    uint64_t mixedHash() const
+    {
+        uint64_t h = hash();
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
     bool complexEqual(const Id & other) const;
     bool complexLess(const Id & other) const;
     uint64_t complexHash() const;
@@ -32,6 +32,17 @@ expectStringUtf8()
     skipJsonWhitespace((*context));
     context->expect_literal('"');
 
+    // Strings without escapes are taken straight from the parse buffer
+    const char * start, * end;
+    auto isSpecial = [] (char c)
+        {
+            return c == '"' || c == '\\' || c == '\n';
+        };
+    if (context->match_span(start, end, isSpecial, '"')) {
+        ++(*context);
+        return Utf8String(string(start, end));
+    }
+
     char internalBuffer[4096];
 
     char * buffer = internalBuffer;
@@ -306,7 +306,7 @@ struct StreamingJsonParsingContext
                 fn();
             };
         
-        expectJsonObjectAscii(*context, onMember);
+        expectJsonObjectAscii(*context, std::ref(onMember));
     }
 
     virtual void forEachMember(const std::function<void ()> & fn)
@@ -330,7 +330,7 @@ struct StreamingJsonParsingContext
                 first = false;
             };
         
-        expectJsonArray(*context, onElement);
+        expectJsonArray(*context, std::ref(onElement));
 
         if (!first)
             popPath();
@@ -343,7 +343,7 @@ struct StreamingJsonParsingContext
 
     void skip()
     {
-        ML::expectJson(*context);
+        ML::skipJson(*context);
     }
 
     virtual int expectInt()
@@ -394,6 +394,102 @@ S2Description::S2Description()
     addField("val2", &S2::val2, "second value");
 }
 
+struct CompiledStructure : S2 {
+    CompiledStructure()
+        : intValue(0), unsignedValue(0), longValue(0), doubleValue(0),
+          boolValue(false), unknown(0)
+    {
+    }
+
+    int intValue;
+    unsigned unsignedValue;
+    long long longValue;
+    double doubleValue;
+    bool boolValue;
+    std::string stringValue;
+    Utf8String utf8Value;
+    TaggedInt taggedInt;
+    std::vector<std::string> stringVector;
+    S2 nested;
+    int unknown;
+};
+
+CREATE_STRUCTURE_DESCRIPTION(CompiledStructure);
+
+CompiledStructureDescription::CompiledStructureDescription()
+{
+    addParent<S2>();
+    addField("intValue", &CompiledStructure::intValue, "");
+    addField("unsignedValue", &CompiledStructure::unsignedValue, "");
+    addField("longValue", &CompiledStructure::longValue, "");
+    addField("doubleValue", &CompiledStructure::doubleValue, "");
+    addField("boolValue", &CompiledStructure::boolValue, "");
+    addField("stringValue", &CompiledStructure::stringValue, "");
+    addField("utf8Value", &CompiledStructure::utf8Value, "");
+    addField("taggedInt", &CompiledStructure::taggedInt, "");
+    addField("stringVector", &CompiledStructure::stringVector, "");
+    addField("nested", &CompiledStructure::nested, "");
+    // Names that share a prefix with other fields
+    addField("int", &CompiledStructure::unknown, "");
+
+    onUnknownField = [] (CompiledStructure * s, JsonParsingContext & context)
+        {
+            ++s->unknown;
+            context.skip();
+        };
+}
+
+BOOST_AUTO_TEST_CASE( test_compiled_structure_parser )
+{
+    string json = "{\"int\":10,\"val1\":\"a\",\"val2\":\"b\",\"intValue\":-3,"
+        "\"unsignedValue\":4,\"longValue\":12345678901,\"doubleValue\":1.5,"
+        "\"boolValue\":true,\"stringValue\":\"str\",\"utf8Value\":\"\\u00e9\","
+        "\"taggedInt\":\"7\",\"stringVector\":[\"x\",\"y\"],"
+        "\"nested\":{\"val2\":\"c\",\"other\":1},"
+        "\"intValu\":1,\"intValuee\":2,\"\":3}";
+
+    CompiledStructureDescription desc;
+    BOOST_CHECK(desc.compiledOk);
+
+    auto parse = [&] (StructureDescriptionBase::ParserBackend backend)
+        {
+            StructureDescriptionBase::setParserBackend(backend);
+            CompiledStructure result;
+            StreamingJsonParsingContext context("test", json.c_str(),
+                                                json.size());
+            desc.parseJson(&result, context);
+            return result;
+        };
+
+    CompiledStructure map = parse(StructureDescriptionBase::PB_MAP);
+    CompiledStructure compiled = parse(StructureDescriptionBase::PB_COMPILED);
+
+    for (auto & s: { map, compiled }) {
+        BOOST_CHECK_EQUAL(s.val1, "a");
+        BOOST_CHECK_EQUAL(s.val2, "b");
+        BOOST_CHECK_EQUAL(s.intValue, -3);
+        BOOST_CHECK_EQUAL(s.unsignedValue, 4);
+        BOOST_CHECK_EQUAL(s.longValue, 12345678901LL);
+        BOOST_CHECK_EQUAL(s.doubleValue, 1.5);
+        BOOST_CHECK_EQUAL(s.boolValue, true);
+        BOOST_CHECK_EQUAL(s.stringValue, "str");
+        BOOST_CHECK_EQUAL(s.utf8Value, Utf8String("\xc3\xa9"));
+        BOOST_CHECK_EQUAL(s.taggedInt.val, 7);
+        BOOST_CHECK(s.stringVector == vector<string>({ "x", "y" }));
+        BOOST_CHECK_EQUAL(s.nested.val2, "c");
+        BOOST_CHECK_EQUAL(s.unknown, 14);
+    }
+
+    // Every field is found in the table and nothing else.
+    for (auto & f: desc.fields) {
+        auto compiledField = desc.findCompiledField(f.first);
+        BOOST_REQUIRE(compiledField);
+        BOOST_CHECK_EQUAL(compiledField->offset, f.second.offset);
+    }
+    BOOST_CHECK(!desc.findCompiledField("val"));
+    BOOST_CHECK(!desc.findCompiledField("val12"));
+}
+
 struct RecursiveStructure {
     std::map<std::string, std::shared_ptr<RecursiveStructure> > elements;
     std::vector<std::shared_ptr<RecursiveStructure> > vec;
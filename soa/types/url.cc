@@ -156,6 +156,20 @@ host() const
     return url->host();
 }
 
+const char *
+Url::
+hostData(size_t & length) const
+{
+    const auto & host = url->parsed_for_possibly_invalid_spec().host;
+    if (host.len <= 0) {
+        length = 0;
+        return "";
+    }
+
+    length = host.len;
+    return url->possibly_invalid_spec().c_str() + host.begin;
+}
+
 bool
 Url::
 hostIsIpAddress() const
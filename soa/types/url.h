@@ -38,6 +38,10 @@ struct Url {
     std::string username() const;
     std::string password() const;
     std::string host() const;
+    /** Same as host() but points inside of the parsed url instead of making
+        a copy.  The pointer is valid as long as the url isn't modified.
+    */
+    const char * hostData(size_t & length) const;
     bool hostIsIpAddress() const;
     bool domainMatches(const std::string & str) const;
     int port() const;
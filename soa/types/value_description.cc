@@ -8,6 +8,8 @@
 
 
 #include <mutex>
+#include <atomic>
+#include <algorithm>
 #if 0
 #include "jml/arch/demangle.h"
 #endif
@@ -137,6 +139,8 @@ operator = (const StructureDescriptionBase & other)
         orderedFields.push_back(it);
     }
 
+    compileFields();
+
     return *this;
 }
 
@@ -152,7 +156,130 @@ operator = (StructureDescriptionBase && other)
     orderedFields = std::move(other.orderedFields);
     // don't set owner
 
+    compileFields();
+
     return *this;
 }
 
+namespace {
+std::atomic<int> parserBackend(StructureDescriptionBase::PB_COMPILED);
+}
+
+void
+StructureDescriptionBase::
+setParserBackend(ParserBackend backend)
+{
+    parserBackend = backend;
+}
+
+StructureDescriptionBase::ParserBackend
+StructureDescriptionBase::
+getParserBackend()
+{
+    return ParserBackend(parserBackend.load(std::memory_order_relaxed));
+}
+
+void
+StructureDescriptionBase::
+compileFields()
+{
+    compiledFields.clear();
+    compiledDisplacements.clear();
+    compiledOk = false;
+
+    size_t numFields = fields.size();
+    if (numFields == 0) {
+        compiledFields.resize(1, CompiledField());
+        compiledDisplacements.resize(1, 0);
+        compiledMask = 0;
+        compiledOk = true;
+        return;
+    }
+
+    // Half full table and one bucket per field on average; finding the
+    // displacements is then almost always immediate.
+    size_t tableSize = 1;
+    while (tableSize < 2 * numFields)
+        tableSize *= 2;
+    size_t numBuckets = numFields;
+
+    struct Key {
+        uint64_t hash;
+        uint32_t length;
+        const FieldDescription * field;
+    };
+
+    for (uint32_t seed = 0;  seed < 16 && !compiledOk;  ++seed) {
+        std::vector<std::vector<Key> > buckets(numBuckets);
+        for (auto & f: fields) {
+            Key key;
+            key.hash = hashFieldName(f.first, seed, key.length);
+            key.field = &f.second;
+            buckets[(key.hash >> 32) % numBuckets].push_back(key);
+        }
+
+        std::vector<uint32_t> order(numBuckets);
+        for (unsigned i = 0;  i < numBuckets;  ++i)
+            order[i] = i;
+        std::stable_sort(order.begin(), order.end(),
+                         [&] (uint32_t b1, uint32_t b2)
+                         {
+                             return buckets[b1].size() > buckets[b2].size();
+                         });
+
+        std::vector<CompiledField> table(tableSize, CompiledField());
+        std::vector<uint32_t> displacements(numBuckets, 0);
+        std::vector<uint32_t> slots;
+        uint32_t mask = tableSize - 1;
+        bool failed = false;
+
+        for (uint32_t b: order) {
+            const auto & bucket = buckets[b];
+            if (bucket.empty())
+                break;
+
+            bool placed = false;
+            for (uint32_t d = 0;  d < 4 * tableSize && !placed;  ++d) {
+                slots.clear();
+                for (auto & key: bucket) {
+                    uint32_t slot = compiledSlot(key.hash, d) & mask;
+                    if (table[slot].name
+                        || std::find(slots.begin(), slots.end(), slot)
+                           != slots.end())
+                        break;
+                    slots.push_back(slot);
+                }
+                if (slots.size() != bucket.size())
+                    continue;
+
+                for (unsigned i = 0;  i < bucket.size();  ++i) {
+                    const FieldDescription & fd = *bucket[i].field;
+                    CompiledField & entry = table[slots[i]];
+                    entry.name = fd.fieldName.c_str();
+                    entry.length = bucket[i].length;
+                    entry.offset = fd.offset;
+                    entry.description = fd.description.get();
+                    entry.parse = fd.description->getDirectParser();
+                }
+                displacements[b] = d;
+                placed = true;
+            }
+
+            if (!placed) {
+                failed = true;
+                break;
+            }
+        }
+
+        if (failed)
+            continue;
+
+        compiledFields = std::move(table);
+        compiledDisplacements = std::move(displacements);
+        compiledSeed = seed;
+        compiledMask = mask;
+        compiledOk = true;
+    }
+}
+
 } // namespace Datacratic
@@ -116,6 +116,22 @@ struct ValueDescription {
     virtual void * constructDefault() const = 0;
     virtual void destroy(void *) const = 0;
 
+    /** Function that parses a value of the described type without any
+        virtual dispatch on the description.  Used by the compiled
+        structure parsers to write the members directly.
+    */
+    typedef void (*DirectParser) (const ValueDescription * desc,
+                                  void * val,
+                                  JsonParsingContext & context);
+
+    /** Return the direct parser for this description, or null if it
+        doesn't have one.
+    */
+    virtual DirectParser getDirectParser() const
+    {
+        return nullptr;
+    }
+
     
     virtual void * optionalMakeValue(void * val) const
     {
@@ -675,6 +691,23 @@ struct ValueDescriptionI : public ValueDescriptionT<T> {
     {
         regme.done = true;
     }
+
+    /** Calls Impl's parseJsonTyped non virtually.  Classes deriving from
+        Impl may parse differently so they don't get one.
+    */
+    virtual ValueDescription::DirectParser getDirectParser() const
+    {
+        if (typeid(*this) != typeid(Impl))
+            return nullptr;
+        return &parseDirect;
+    }
+
+    static void parseDirect(const ValueDescription * desc, void * val,
+                            JsonParsingContext & context)
+    {
+        static_cast<const Impl *>(desc)
+            ->Impl::parseJsonTyped(reinterpret_cast<T *>(val), context);
+    }
 };
 
 template<typename T, ValueKind kind, typename Impl>
@@ -751,7 +784,10 @@ struct StructureDescriptionBase {
         : type(type),
           structName(structName.empty() ? ML::demangle(type->name()) : structName),
           nullAccepted(nullAccepted),
-          owner(owner)
+          owner(owner),
+          compiledSeed(0),
+          compiledMask(0),
+          compiledOk(false)
     {
     }
 
@@ -806,6 +842,78 @@ struct StructureDescriptionBase {
 
     std::vector<Fields::const_iterator> orderedFields;
 
+    /** Implementations of parseJson. */
+    enum ParserBackend {
+        PB_MAP,        ///< Look up every member in the fields map
+        PB_COMPILED    ///< Use the compiled field table
+    };
+
+    /** Select the implementation used by every structure description.
+        Both give the same results; PB_COMPILED is the default.
+    */
+    static void setParserBackend(ParserBackend backend);
+    static ParserBackend getParserBackend();
+
+    /** Entry of the compiled field table, with everything needed to parse
+        the member without going back to the fields map.
+    */
+    struct CompiledField {
+        const char * name;          ///< Null for empty slots
+        uint32_t length;
+        int offset;
+        const ValueDescription * description;
+        ValueDescription::DirectParser parse;  ///< May be null
+    };
+
+    /* The compiled field table is a perfect hash of the field names built
+       by hash and displace: the hash of a name picks a displacement, which
+       picks its slot, and the displacements are chosen when the table is
+       compiled so that no two fields share a slot.  A lookup is therefore
+       one pass over the name, one probe and one comparison.
+    */
+    std::vector<CompiledField> compiledFields;
+    std::vector<uint32_t> compiledDisplacements;
+    uint32_t compiledSeed;
+    uint32_t compiledMask;
+    bool compiledOk;   ///< False if no table could be built; use the map
+
+    /** Rebuild the compiled field table. Must be called whenever the fields
+        change.
+    */
+    void compileFields();
+
+    static uint64_t hashFieldName(const char * name, uint32_t seed,
+                                  uint32_t & length)
+    {
+        uint64_t h = 14695981039346656037ULL ^ seed;
+        const char * p = name;
+        for (;  *p;  ++p) {
+            h ^= (unsigned char)*p;
+            h *= 1099511628211ULL;
+        }
+        length = p - name;
+        return h;
+    }
+
+    static uint32_t compiledSlot(uint64_t hash, uint32_t displacement)
+    {
+        return uint32_t(hash) + displacement * (uint32_t(hash >> 32) | 1);
+    }
+
+    const CompiledField * findCompiledField(const char * name) const
+    {
+        uint32_t length;
+        uint64_t h = hashFieldName(name, compiledSeed, length);
+        uint32_t d = compiledDisplacements[(h >> 32)
+                                           % compiledDisplacements.size()];
+        const CompiledField & field
+            = compiledFields[compiledSlot(h, d) & compiledMask];
+        if (field.name && field.length == length
+            && memcmp(field.name, name, length) == 0)
+            return &field;
+        return nullptr;
+    }
+
     struct Exception: public ML::Exception {
         Exception(JsonParsingContext & context,
                   const std::string & message)
@@ -832,10 +940,27 @@ struct StructureDescriptionBase {
             if (!context.isObject())
                 context.exception("expected structure of type " + structName);
 
+            bool compiled = compiledOk
+                && getParserBackend() == PB_COMPILED;
+
             auto onMember = [&] ()
                 {
                     try {
                         auto n = context.fieldNamePtr();
+                        if (compiled) {
+                            auto f = findCompiledField(n);
+                            if (!f)
+                                context.onUnknownField(owner);
+                            else if (f->parse)
+                                f->parse(f->description,
+                                         addOffset(output, f->offset),
+                                         context);
+                            else f->description
+                                     ->parseJson(addOffset(output, f->offset),
+                                                 context);
+                            return;
+                        }
+
                         auto it = fields.find(n);
                         if (it == fields.end()) {
                             context.onUnknownField(owner);
@@ -858,7 +983,9 @@ struct StructureDescriptionBase {
                     }
                 };
 
-            context.forEachMember(onMember);
+            // Passed by reference so that the std::function doesn't
+            // need to allocate a copy of the closure for every structure
+            context.forEachMember(std::ref(onMember));
 
             onExit(output, context);
         }
@@ -992,6 +1119,7 @@ struct StructureDescription
         fd.offset = (size_t)&(p->*field);
         fd.fieldNum = fields.size() - 1;
         orderedFields.push_back(it);
+        compileFields();
         //using namespace std;
         //cerr << "offset = " << fd.offset << endl;
     }
@@ -1134,6 +1262,8 @@ addParent(ValueDescriptionT<V> * description_)
         fd.fieldNum = fields.size() - 1;
         orderedFields.push_back(it);
     }
+
+    compileFields();
 }
 
 
@@ -1259,7 +1389,7 @@ struct ListDescriptionBase {
                 val->emplace_back(std::move(el));
             };
         
-        context.forEachElement(onElement);
+        context.forEachElement(std::ref(onElement));
     }
 
     template<typename List>
@@ -1277,7 +1407,7 @@ struct ListDescriptionBase {
                 val->insert(std::move(el));
             };
         
-        context.forEachElement(onElement);
+        context.forEachElement(std::ref(onElement));
     }
 
     template<typename List>